@@ -41,6 +41,7 @@ public:
 
 	void refreshMatrices();
 
+	/* World space planes of projectionViewMatrix(), as of the last refreshMatrices(). */
 	_NODISCARD Frustum makeFrustum() const;
 
 	_NODISCARD static Camera3D *currentCameraEntity();
@@ -155,6 +155,7 @@ Optional<RenderPassInfo> DirectionalLight::customRenderPass() const
 	return RenderPassInfo
 	{
 		.pass = Shadow,
+		.model_matrix_location = 0, //< Explicit in csm.vert.
 		.view_matrix_location = -1,
 		.projection_matrix_location = -1,
 		.inverse_view_matrix_location = -1,
@@ -163,12 +164,15 @@ Optional<RenderPassInfo> DirectionalLight::customRenderPass() const
 		.bind_normal_texture = false,
 		.bind_orm_texture = false,
 		.bind_object_id = false,
+		.bind_vertex_packing = true,
+		.bind_instancing = true,
 		.frustum_culling = false,
 		.render_sky = false,
 		.cull = true,
 		.cull_face = Back,
 		.bind_time = std::nullopt,
 		.viewport = ivec4( 0, 0, resolution, resolution ),
+		.indirect_draws = RENDER_MULTI_DRAW_INDIRECT ? &shadow_draws_ : nullptr,
 		.shader_program = render_depth_.get(),
 		.csm = {
 			.bind_buffer = true,
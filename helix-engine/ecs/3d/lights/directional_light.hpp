@@ -4,6 +4,7 @@
 
 #include "ecs/core/component.hpp"
 #include "gpu/graphics.hpp"
+#include "gpu/indirect_draws.hpp"
 
 class Buffer;
 class Framebuffer;
@@ -49,6 +50,7 @@ class DirectionalLight : public Component {
 	Box<Framebuffer> fb_;
 	Box<Texture> tx_;
 	Box<Buffer> lsm_;
+	mutable IndirectDrawBatch shadow_draws_; //< Filled and submitted while the pass customRenderPass() returns is drawn.
 	u8 cascade_count_;
 	f32 zMult = 20.0f;
 
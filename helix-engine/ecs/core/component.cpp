@@ -21,6 +21,7 @@ void Component::update(double) {
 Optional<RenderPassInfo> Component::customRenderPass() const { return std::nullopt; }
 void Component::renderSetup(RenderPassInfo const &info) {}
 void Component::draw(RenderPassInfo const &info) {}
+void Component::gatherBounds(FrustumCuller &culling) {}
 void Component::mouse(MouseInputEvent const &event) {}
 void Component::editor() {}
 
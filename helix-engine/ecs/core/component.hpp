@@ -7,6 +7,7 @@
 #include "scene_tree.hpp"
 
 class Window;
+class FrustumCuller;
 struct RenderPassInfo;
 
 class Component {
@@ -24,6 +25,8 @@ public:
 	virtual Optional<RenderPassInfo> customRenderPass() const;
 	virtual void renderSetup(RenderPassInfo const &info);
 	virtual void draw(RenderPassInfo const &info);
+	/* World space bounds for the pass to cull, draw() finds the result through RenderPassInfo::culling. */
+	virtual void gatherBounds(FrustumCuller &culling);
 	virtual void mouse(MouseInputEvent const &event);
 	
 #ifdef _DEBUG
@@ -3,7 +3,9 @@
 #include <cassert>
 
 #include "component.hpp"
+#include "gpu/frustum_culling.hpp"
 #include "gpu/graphics.hpp"
+#include "gpu/indirect_draws.hpp"
 
 //
 // SceneTree
@@ -96,11 +98,22 @@ void SceneTree::initiateDraw(RenderPassInfo const &info) {
 	
 	setupRenderPass(info);
 	
+	if (info.frustum_culling && info.culling != nullptr) {
+		info.culling->clear();
+		visitComponent([](Component *component, FrustumCuller &culling) {
+			component->gatherBounds(culling);
+		}, root_id_, *info.culling);
+		info.culling->cull(info.camera);
+	}
+	if (info.indirect_draws != nullptr)
+		info.indirect_draws->clear();
 	visitComponent([](Component *component, RenderPassInfo const &p_info) {
 		component->draw(p_info);
 		
 		gpu_check;
 	}, root_id_, info);
+	if (info.indirect_draws != nullptr)
+		info.indirect_draws->submit(info);
 }
 
 void SceneTree::initiateRenderSetup(RenderPassInfo const &info) {
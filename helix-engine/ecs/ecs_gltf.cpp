@@ -1,11 +1,37 @@
 ﻿#include "ecs_gltf.hpp"
 #include "mesh-renderer.h"
+#include "instanced-mesh-renderer.h"
 #include "transform.h"
 #include "bone-map.h"
 #include "light.hpp"
+#include "gpu/hlxscene.hpp"
 
 namespace gltf {
-	uid node2entity(gltf::data &gltf_data, Vec<SharedPtr<Buffer>> &buffer_views, SharedPtr<SceneTree> const &tree, gltf::node &node, uid node_id, _STD vector<uid> &node_id_to_entity_id) {
+	/*
+	 * GPU data built during one import. Nodes that reference the same mesh get the same Mesh,
+	 * so its vertex arrays, buffers and tangents are only built once.
+	 */
+	struct import_cache {
+		Vec<SharedPtr<Buffer>> buffer_views; //< These will get allocated as needed by the mesh importer
+		Vec<SharedPtr<Mesh>> meshes; //< Indexed by mesh id
+		Map<_STD pair<id, id>, SharedPtr<Mesh>> skinned_meshes; //< Keyed by (mesh id, skin id), the skin is baked into the Mesh
+		hlxscene::scene const *cooked = nullptr; //< Set when meshes come from a cooked scene instead of accessors
+		PendingTangents tangents; //< MikkTSpace jobs of every mesh in the import, drained once all nodes exist
+
+		explicit import_cache(data const &gltf_data) : buffer_views(gltf_data.buffer_views.size()), meshes(gltf_data.meshes.size()) {}
+	};
+
+	/* The unskinned Mesh of glTF mesh `mesh_id`, built on first use. */
+	SharedPtr<Mesh> const &sharedMesh(gltf::data &gltf_data, import_cache &cache, id const mesh_id) {
+		SharedPtr<Mesh> &mesh = cache.meshes[mesh_id];
+		if (!mesh && cache.cooked != nullptr)
+			mesh = _STD make_shared<Mesh>(gltf_data, *cache.cooked, mesh_id);
+		else if (!mesh)
+			mesh = _STD make_shared<Mesh>(gltf_data, mesh_id, cache.buffer_views, &cache.tangents);
+		return mesh;
+	}
+
+	uid node2entity(gltf::data &gltf_data, import_cache &cache, SharedPtr<SceneTree> const &tree, gltf::node &node, uid node_id, _STD vector<uid> &node_id_to_entity_id) {
 		uid const ent_id = tree->createEntity();
 		node_id_to_entity_id[node_id] = ent_id;
 		SharedPtr<Entity> const ent = tree->entity(ent_id);
@@ -19,18 +45,29 @@ namespace gltf {
 			
 		}
 
-		if (node.mesh != -1) {
+		if (node.mesh != -1 && node.extensions.EXT_mesh_gpu_instancing.has_value()) {
+			// Skins are ignored on instanced nodes, the extension leaves that combination undefined.
+			InstancedMeshRenderer3D &instanced_component = ent->component<InstancedMeshRenderer3D>();
+			instanced_component.mesh = sharedMesh(gltf_data, cache, node.mesh);
+			instanced_component.setInstances(ext::mesh_gpu_instancing::instance_transforms(gltf_data, node.extensions.EXT_mesh_gpu_instancing.value()));
+		}
+		else if (node.mesh != -1) {
 			StaticMeshRenderer3D &mesh_component = ent->component<StaticMeshRenderer3D>();
 #ifdef GLTF_SKIN
 			if (node.skin != -1) {
-				mesh_component.mesh.reset(new Mesh(gltf_data, node.mesh, node.skin));
+				SharedPtr<Mesh> &mesh = cache.skinned_meshes[{ node.mesh, node.skin }];
+				if (!mesh)
+					mesh = _STD make_shared<Mesh>(gltf_data, node.mesh, node.skin);
+				mesh_component.mesh = mesh;
 				// We need a post-hook to obtain the final entity id's for each joint!
 				auto &b = ent->component<BoneMap>(); // we are just instantiating it here.
 				b.skin = node.skin;
 			}
 			else
 #endif
-				mesh_component.mesh.reset(new Mesh(gltf_data, node.mesh, buffer_views));
+			{
+				mesh_component.mesh = sharedMesh(gltf_data, cache, node.mesh);
+			}
 		}
 
 		if (node.extensions.KHR_lights_punctual.has_value()) {
@@ -46,7 +83,7 @@ namespace gltf {
 		}
 
 		for (gltf::id const child : node.children) {
-			uid const child_id = node2entity(gltf_data, buffer_views, tree, gltf_data.nodes[child], child, node_id_to_entity_id);
+			uid const child_id = node2entity(gltf_data, cache, tree, gltf_data.nodes[child], child, node_id_to_entity_id);
 			ent->addChild(tree->entity(child_id));
 		}
             
@@ -71,26 +108,36 @@ namespace gltf {
 		}
 #endif
 	}
-}
 
-uid gltf::createEntityFromGltf(SharedPtr<SceneTree> const &scene_tree, data &data) {
-	_STD vector<uid> node_id_to_entity_id(data.nodes.size());
-	uid const true_root = scene_tree->createEntity().value(); //< So because there can be multiple top level nodes in gltf, we have one entity residing as the top-level
-	SharedPtr<Entity> scene = scene_tree->entity(true_root);
-	scene->name_ = data.scenes[data.scene].name;
-	
-	Vec<SharedPtr<Buffer>> buffer_views(data.buffer_views.size()); // These will get allocated as needed by the mesh importer
-	
-	for (uid const node_id : data.scenes[data.scene].nodes) {
-		uid const node = node2entity(data, buffer_views, scene_tree, data.nodes[node_id], node_id, node_id_to_entity_id);
-		scene->addChild(scene_tree->entity(node));
-	}
+	uid createSceneEntities(SharedPtr<SceneTree> const &scene_tree, data &data, import_cache &cache) {
+		_STD vector<uid> node_id_to_entity_id(data.nodes.size());
+		uid const true_root = scene_tree->createEntity().value(); //< So because there can be multiple top level nodes in gltf, we have one entity residing as the top-level
+		SharedPtr<Entity> scene = scene_tree->entity(true_root);
+		scene->name_ = data.scenes[data.scene].name;
+		
+		for (uid const node_id : data.scenes[data.scene].nodes) {
+			uid const node = node2entity(data, cache, scene_tree, data.nodes[node_id], node_id, node_id_to_entity_id);
+			scene->addChild(scene_tree->entity(node));
+		}
+		cache.tangents.finish();
 
 #ifdef GLTF_SKIN
-	for (uid const node_id : data.scenes[data.scene].nodes) {
-		parseNodeBoneMap(data, scene_tree, scene_tree->entity(node_id_to_entity_id[node_id]), data.nodes[node_id], node_id_to_entity_id); 
-	}
+		for (uid const node_id : data.scenes[data.scene].nodes) {
+			parseNodeBoneMap(data, scene_tree, scene_tree->entity(node_id_to_entity_id[node_id]), data.nodes[node_id], node_id_to_entity_id); 
+		}
 #endif
-	
-	return true_root;
+		
+		return true_root;
+	}
+}
+
+uid gltf::createEntityFromGltf(SharedPtr<SceneTree> const &scene_tree, data &data) {
+	import_cache cache(data);
+	return createSceneEntities(scene_tree, data, cache);
+}
+
+uid gltf::createEntityFromCookedScene(SharedPtr<SceneTree> const &scene_tree, hlxscene::scene &scene) {
+	import_cache cache(scene.data());
+	cache.cooked = &scene;
+	return createSceneEntities(scene_tree, scene.data(), cache);
 }
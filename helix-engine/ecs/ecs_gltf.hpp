@@ -3,6 +3,10 @@
 #include "core/core_includes.hpp"
 #include "core/scene_tree.hpp"
 
+namespace hlxscene {
+	class scene;
+}
+
 namespace gltf {
 	struct data;
 	
@@ -13,4 +17,10 @@ namespace gltf {
 	 * @return The root entity id, note that it has yet to be added to the scene hierarchy as it is not the child of any entity.
 	 */
 	extern uid createEntityFromGltf(SharedPtr<SceneTree> const &scene_tree, data &data);
+
+	/**
+	 * @see hlxscene::scene::open
+	 * Same as createEntityFromGltf, for a scene opened from the cooked cache. Meshes are built from the cooked vertex and index blobs.
+	 */
+	extern uid createEntityFromCookedScene(SharedPtr<SceneTree> const &scene_tree, hlxscene::scene &scene);
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+﻿#include "instanced-mesh-renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "imgui.h"
+#include "mesh-renderer.h"
+#include "transform.h"
+#include "gpu/buffer.h"
+#include "gpu/frustum_culling.hpp"
+#include "gpu/mesh.hpp"
+#include "gpu/texture_streamer.hpp"
+
+ComponentProvider<InstancedMeshRenderer3D> ComponentProvider<InstancedMeshRenderer3D>::instance_ = ComponentProvider();
+
+namespace {
+	f32 maxAxisScale(mat4 const &matrix) {
+		return std::sqrt(std::max({ glm::dot(vec3(matrix[0]), vec3(matrix[0])), glm::dot(vec3(matrix[1]), vec3(matrix[1])), glm::dot(vec3(matrix[2]), vec3(matrix[2])) }));
+	}
+
+	void bindModelMatrix(RenderPassInfo const &pass_info, mat4 const &model) {
+		if (!pass_info.bind_model_matrix)
+			return;
+		if (pass_info.model_matrix_location != -1)
+			pass_info.shader_program->setUniform(pass_info.model_matrix_location, model);
+		if (pass_info.inverse_model_matrix_location != -1)
+			pass_info.shader_program->setUniform(pass_info.inverse_model_matrix_location, glm::inverse(model));
+	}
+}
+
+
+void InstancedMeshRenderer3D::setInstances(std::span<mat4 const> const transforms) {
+	instances_.assign(transforms.begin(), transforms.end());
+	instance_bounds_.clear();
+	instance_buffer_.reset();
+	if (instances_.empty())
+		return;
+	// Storage is immutable, a new set of instances gets a new buffer.
+	instance_buffer_ = std::make_shared<Buffer>();
+	instance_buffer_->allocate(instances_.size() * sizeof(mat4), instances_.data(), gl::BufferStorageMask::DynamicStorageBit);
+	instance_buffer_->setLabel("Instance Transforms");
+}
+
+AABB const &InstancedMeshRenderer3D::instanceBounds(std::size_t const submesh) {
+	if (instance_bounds_.size() != mesh->subMeshCount()) {
+		instance_bounds_.clear();
+		instance_bounds_.reserve(mesh->subMeshCount());
+		for (std::size_t i = 0; i < mesh->subMeshCount(); i++) {
+			vec3 min(std::numeric_limits<f32>::max());
+			vec3 max(std::numeric_limits<f32>::lowest());
+			Array<vec3, 8> const corners = mesh->bounds(i).vertices();
+			for (mat4 const &instance : instances_) {
+				for (vec3 const &corner : corners) {
+					vec3 const p(instance * vec4(corner, 1.0f));
+					min = glm::min(min, p);
+					max = glm::max(max, p);
+				}
+			}
+			instance_bounds_.emplace_back(min, max);
+		}
+	}
+	return instance_bounds_[submesh];
+}
+
+void InstancedMeshRenderer3D::gatherBounds(FrustumCuller &culling) {
+	if (!mesh || instances_.empty())
+		return;
+	mat4 const model = SearchForModelMatrix(entity.lock());
+	first_bounds_ = culling.size();
+	for (std::size_t i = 0; i < mesh->subMeshCount(); i++)
+		static_cast<void>(culling.add(instanceBounds(i).transformed(model)));
+}
+
+void InstancedMeshRenderer3D::draw(RenderPassInfo const &pass_info) {
+	if (!mesh || instances_.empty())
+		return;
+	gpu_check;
+	std::shared_ptr<Entity> const owner = entity.lock();
+	mat4 const model = SearchForModelMatrix(owner);
+	if (pass_info.bind_debug_hovered && pass_info.debug_hovered_location != -1)
+		pass_info.shader_program->setUniform(pass_info.debug_hovered_location, owner->debug_hovered_ ? 1 : 0);
+
+	// A primitive is culled when the box around all of its instances is, gatherBounds() ran for this pass right before.
+	bool const culling = pass_info.frustum_culling && pass_info.culling != nullptr;
+	auto const visible = [&](std::size_t const submesh) {
+		return !culling || pass_info.culling->visible(first_bounds_ + static_cast<u32>(submesh));
+	};
+
+	if (!pass_info.bind_instancing) {
+		for (mat4 const &instance : instances_) {
+			bindModelMatrix(pass_info, model * instance);
+			for (std::size_t i = 0; i < mesh->subMeshCount(); i++) {
+				if (visible(i))
+					mesh->drawSubMesh(pass_info, i);
+			}
+		}
+		gpu_check;
+		return;
+	}
+
+	bindModelMatrix(pass_info, model);
+	instance_buffer_->bindBufferBase(gl::BufferTargetARB::ShaderStorageBuffer, INSTANCE_TRANSFORM_BUFFER_BINDING);
+	pass_info.shader_program->setUniform(INSTANCING_UNIFORM_LOCATION, 1);
+	i32 const instance_count = static_cast<i32>(instances_.size());
+	for (std::size_t i = 0; i < mesh->subMeshCount(); i++) {
+		if (!visible(i))
+			continue;
+		u32 lod = 0;
+		if (pass_info.lod_pixels_per_unit > 0.0f) {
+			// One level for every instance of the primitive, the one closest to the camera decides so none of them shows more error than it should.
+			AABB const &bounds = mesh->bounds(i);
+			f32 pixels_per_unit = 0.0f;
+			for (mat4 const &instance : instances_) {
+				mat4 const world = model * instance;
+				f32 const scale = maxAxisScale(world);
+				vec3 const center(world * vec4(bounds.center, 1.0f));
+				f32 const radius = glm::length(bounds.extents) * scale;
+				f32 const distance = std::max(glm::distance(center, pass_info.camera_position) - radius, 0.01f);
+				pixels_per_unit = std::max(pixels_per_unit, pass_info.lod_pixels_per_unit * scale / distance);
+			}
+			lod = mesh->selectLod(i, pixels_per_unit, pass_info.lod_error_threshold);
+			if (pass_info.request_texture_streaming && mesh->material(i) != nullptr)
+				TextureStreamer::singleton()->request(*mesh->material(i), 2.0f * glm::length(bounds.extents) * pixels_per_unit);
+		}
+		mesh->drawSubMesh(pass_info, i, lod, instance_count);
+	}
+	// Everything else drawn with this program isn't instanced.
+	pass_info.shader_program->setUniform(INSTANCING_UNIFORM_LOCATION, 0);
+	gpu_check;
+}
+
+
+#ifdef _DEBUG
+
+void InstancedMeshRenderer3D::editor() {
+	using namespace ImGui;
+
+	Text("Instances: %zu", instances_.size());
+	if (mesh)
+		Text("Draws per pass: %zu", mesh->subMeshCount());
+}
+#endif
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <span>
+
+#include "core/component.hpp"
+#include "gpu/geometry.hpp"
+
+class Buffer;
+class Mesh;
+
+/* Explicit uniform location and storage buffer binding used by shaders/instancing.glsl. */
+constexpr i32 INSTANCING_UNIFORM_LOCATION = 43;
+constexpr u32 INSTANCE_TRANSFORM_BUFFER_BINDING = 14;
+
+/**
+ * @brief Draws one mesh many times over, e.g. a node with EXT_mesh_gpu_instancing. Instance transforms are relative to
+ * the entity and live in a storage buffer, every primitive is a single instanced draw.
+ *
+ * Passes whose program doesn't include shaders/instancing.glsl (RenderPassInfo::bind_instancing unset) get one draw per instance instead.
+ */
+class InstancedMeshRenderer3D : public Component {
+public:
+	InstancedMeshRenderer3D(SharedPtr<SceneTree> const &p_tree, SharedPtr<Entity> const &p_entity) : Component(p_tree, p_entity) {}
+
+	/* Replaces every instance and uploads them, has to run on the main thread. */
+	void setInstances(_STD span<mat4 const> transforms);
+	_NODISCARD _STD span<mat4 const> instances() const { return instances_; }
+
+	void gatherBounds(FrustumCuller &culling) override;
+	void draw(RenderPassInfo const &pass_info) override;
+
+	SharedPtr<Mesh> mesh; //< Shared with any other renderer built from the same glTF mesh.
+
+	#ifdef _DEBUG
+	void editor() override;
+	#endif
+
+private:
+	/* Entity space bounds of primitive `submesh` over every instance. */
+	_NODISCARD AABB const &instanceBounds(_STD size_t submesh);
+
+	Vec<mat4> instances_;
+	SharedPtr<Buffer> instance_buffer_;
+	Vec<AABB> instance_bounds_; //< Lazily built per primitive, cleared whenever the instances change.
+	u32 first_bounds_ = 0; //< FrustumCuller slot of the first primitive's instanceBounds(), the rest follow it.
+};
@@ -41,6 +41,7 @@ void OmniLight::update(double x) {
 	static RenderPassInfo ri{
 		.pass = RenderPassType::Shadow,
 		.model_matrix_location = 0,
+		.bind_vertex_packing = true,
 		.cull = true,
 		.cull_face = gl::TriangleFace::Back,
 		.viewport = ivec4(0, 0, OMNI_LIGHT_SHADOW_RESOLUTION, OMNI_LIGHT_SHADOW_RESOLUTION)
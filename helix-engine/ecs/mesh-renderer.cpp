@@ -1,43 +1,43 @@
 ﻿#include "mesh-renderer.h"
 
+#include <algorithm>
+#include <cmath>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "bone-map.h"
 #include "imgui.h"
 #include "transform.h"
+#include "gpu/frustum_culling.hpp"
+#include "gpu/indirect_draws.hpp"
 #include "gpu/material.hpp"
+#include "gpu/mesh.hpp"
 #include "gpu/texture.h"
+#include "gpu/texture_streamer.hpp"
 
 ComponentProvider<StaticMeshRenderer3D> ComponentProvider<StaticMeshRenderer3D>::instance_ = ComponentProvider();
 
-namespace {
-	mat4 SearchForModelMatrix(SharedPtr<Entity> const &entity) {
-		if (entity->hasComponent<Transform>()) {
-			return entity->component<Transform>().matrix();
-		}
-		return entity->root() ? mat4(1.0) : SearchForModelMatrix(entity->parent());
+mat4 SearchForModelMatrix(SharedPtr<Entity> const &entity) {
+	if (entity->hasComponent<Transform>()) {
+		return entity->component<Transform>().matrix();
 	}
+	return entity->root() ? mat4(1.0) : SearchForModelMatrix(entity->parent());
 }
 
 
-bool StaticMeshRenderer3D::culled(RenderPassInfo const &pass_info) {
-	std::shared_ptr<Entity> const owner = entity.lock();
-	Transform const &transform = owner->component<Transform>();
-	for (auto &primitive : mesh->primitives_) {
-		if (!primitive.aabb_.onFrustum(pass_info.camera, transform)) {
-			wasMostRecentlyCulled = true;
-			return true;
-		}
-	}
-	wasMostRecentlyCulled = false;
-	return false;
+void StaticMeshRenderer3D::gatherBounds(FrustumCuller &culling) {
+	if (!mesh)
+		return;
+	mat4 const model = SearchForModelMatrix(entity.lock());
+	first_bounds_ = culling.size();
+	for (std::size_t i = 0; i < mesh->subMeshCount(); i++)
+		static_cast<void>(culling.add(mesh->bounds(i).transformed(model)));
 }
 
 void StaticMeshRenderer3D::draw(RenderPassInfo const &pass_info) {
 	gpu_check;
 	std::shared_ptr<Entity> const owner = entity.lock();
+	mat4 const model = SearchForModelMatrix(owner);
 	if (pass_info.bind_model_matrix) {
-		mat4 const model = SearchForModelMatrix(owner);
 		if (pass_info.model_matrix_location != -1)
 			pass_info.shader_program->setUniform(pass_info.model_matrix_location, model);
 		if (pass_info.inverse_model_matrix_location != -1)
@@ -46,22 +46,45 @@ void StaticMeshRenderer3D::draw(RenderPassInfo const &pass_info) {
 	if (pass_info.bind_debug_hovered && pass_info.debug_hovered_location != -1)
 		pass_info.shader_program->setUniform(pass_info.debug_hovered_location, owner->debug_hovered_ ? 1 : 0);
 
-	/*
-	if (pass_info.frustum_culling) {
-		Transform const &transform = owner->component<Transform>();
-		primitives_drawn_ = 0;
-		for (size_t i = 0; i < mesh->primitives_.size(); i++) {
-			if (auto primitive = mesh->primitives_[i];
-				primitive.aabb_.onFrustum(pass_info.camera, transform)) {
-				primitives_drawn_++;
-				mesh->drawSubMesh(pass_info, i);
-			}
+	// gatherBounds() ran for this pass right before, in the same order.
+	bool const culling = pass_info.frustum_culling && pass_info.culling != nullptr;
+	primitives_drawn_ = 0;
+
+	// Pooled submeshes go to the pass's batch, which draws everything it got once the visit is over.
+	Optional<u32> model_index;
+	auto const drawSubMesh = [&](std::size_t const submesh, u32 const lod) {
+		primitives_drawn_++;
+		if (pass_info.indirect_draws == nullptr || !mesh->pooled(submesh)) {
+			mesh->drawSubMesh(pass_info, submesh, lod);
+			return;
+		}
+		if (!model_index.has_value())
+			model_index = pass_info.indirect_draws->addModel(model);
+		mesh->queueSubMesh(*pass_info.indirect_draws, model_index.value(), submesh, lod);
+	};
+
+	if (pass_info.lod_pixels_per_unit > 0.0f) {
+		// Screen space error: the level's object space error, scaled like the mesh and divided by the distance to it.
+		f32 const scale = std::sqrt(std::max({ glm::dot(vec3(model[0]), vec3(model[0])), glm::dot(vec3(model[1]), vec3(model[1])), glm::dot(vec3(model[2]), vec3(model[2])) }));
+		for (std::size_t i = 0; i < mesh->subMeshCount(); i++) {
+			if (culling && !pass_info.culling->visible(first_bounds_ + static_cast<u32>(i)))
+				continue;
+			AABB const &bounds = mesh->bounds(i);
+			vec3 const center(model * vec4(bounds.center, 1.0f));
+			f32 const radius = glm::length(bounds.extents) * scale;
+			f32 const distance = std::max(glm::distance(center, pass_info.camera_position) - radius, 0.01f);
+			if (pass_info.request_texture_streaming && mesh->material(i) != nullptr)
+				TextureStreamer::singleton()->request(*mesh->material(i), 2.0f * radius * pass_info.lod_pixels_per_unit / distance);
+			drawSubMesh(i, mesh->selectLod(i, pass_info.lod_pixels_per_unit * scale / distance, pass_info.lod_error_threshold));
 		}
 	}
 	else {
-	*/
-	mesh->drawAllSubMeshes(pass_info);
-	//}
+		for (std::size_t i = 0; i < mesh->subMeshCount(); i++) {
+			if (!culling || pass_info.culling->visible(first_bounds_ + static_cast<u32>(i)))
+				drawSubMesh(i, 0);
+		}
+	}
+	wasMostRecentlyCulled = primitives_drawn_ == 0;
 	gpu_check;
 }
 
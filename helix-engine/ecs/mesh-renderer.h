@@ -4,6 +4,9 @@
 
 class Mesh;
 
+/* World matrix of the closest entity up the hierarchy (`entity` included) that has a Transform. */
+extern mat4 SearchForModelMatrix(SharedPtr<Entity> const &entity);
+
 /**
  * @brief Encompasses both static meshes and skinned meshes. Skinned meshes also need a Skeleton component
  */
@@ -13,15 +16,18 @@ class StaticMeshRenderer3D : public Component {
 public:
 	StaticMeshRenderer3D(SharedPtr<SceneTree> const &p_tree, SharedPtr<Entity> const &p_entity) : Component(p_tree, p_entity) {}
 
-	bool culled(RenderPassInfo const &pass_info);
+	void gatherBounds(FrustumCuller &culling) override;
 	void draw(RenderPassInfo const &pass_info) override;
 	
 	
-	UniquePtr<Mesh> mesh;
+	SharedPtr<Mesh> mesh; //< Shared between every entity an import created from the same glTF mesh.
 	bool wasMostRecentlyCulled = false;
 	i32 primitives_drawn_ = 0;
 
 	#ifdef _DEBUG
 	void editor() override;
 	#endif
+
+private:
+	u32 first_bounds_ = 0; //< FrustumCuller slot of the first primitive, the rest follow it.
 };
\ No newline at end of file
@@ -0,0 +1,70 @@
+﻿#include "benchmark.hpp"
+
+#if BENCHMARKS_ENABLED
+
+#include "util.hpp"
+#include "gpu/frustum_culling.hpp"
+#include "gpu/gltf.h"
+#include "gpu/loaders/dds.hpp"
+#include "gpu/mesh.hpp"
+#include "gpu/meshlet.hpp"
+#include "gpu/texture_streaming.hpp"
+#include "gpu/vertex_packing.hpp"
+
+std::string bench::argument(Vec<std::string_view> const &p_args, std::size_t const p_index, std::string_view const p_default) {
+	return std::string(p_index < p_args.size() ? p_args[p_index] : p_default);
+}
+
+u32 bench::numberArgument(Vec<std::string_view> const &p_args, std::size_t const p_index, u32 const p_default) {
+	return p_index < p_args.size() ? static_cast<u32>(std::stoul(std::string(p_args[p_index]))) : p_default;
+}
+
+Optional<simdjson::padded_string> bench::loadJson(std::string const &p_file_path) {
+	simdjson::padded_string json;
+	if (simdjson::padded_string::load(p_file_path).get(json) != simdjson::SUCCESS) {
+		fprintf(stderr, "[bench] failed to load \"%s\"\n", p_file_path.c_str());
+		return std::nullopt;
+	}
+	return json;
+}
+
+Optional<gltf::data> bench::loadScene(std::string const &p_file_path) {
+	Optional<simdjson::padded_string> json = loadJson(p_file_path);
+	if (!json)
+		return std::nullopt;
+	return gltf::parse(p_file_path, std::move(*json));
+}
+
+int bench::run(std::string_view const p_name, Vec<std::string_view> const &p_args) {
+	switch (hash(p_name)) {
+		case hash("dds-parse"):
+			return benchmarkDdsParse(p_args);
+		case hash("dds-validate"):
+			return benchmarkDdsValidate(p_args);
+		case hash("frustum-culling"):
+			return benchmarkFrustumCulling(p_args);
+		case hash("frustum-planes"):
+			return benchmarkFrustumPlanes(p_args);
+		case hash("gltf-parse"):
+			return gltf::benchmarkParse(p_args);
+		case hash("gltf-buffers"):
+			return gltf::benchmarkBufferMemory(p_args);
+		case hash("gltf-images"):
+			return gltf::benchmarkImageProbing(p_args);
+		case hash("gltf-meshopt"):
+			return gltf::benchmarkMeshoptDecode(p_args);
+		case hash("mesh-tangents"):
+			return benchmarkTangents(p_args);
+		case hash("meshlets"):
+			return benchmarkMeshlets(p_args);
+		case hash("texture-streaming"):
+			return benchmarkTextureStreaming(p_args);
+		case hash("vertex-packing"):
+			return benchmarkVertexPacking(p_args);
+		default:
+			fprintf(stderr, "[bench] unknown benchmark \"%.*s\"\n", static_cast<int>(p_name.size()), p_name.data());
+			return -1;
+	}
+}
+
+#endif
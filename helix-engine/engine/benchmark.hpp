@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#define BENCHMARKS_ENABLED 0
+
+//
+// Opt-in micro benchmarks, run with `helix-engine --bench <name> [args...]`.
+// Everything here compiles away when BENCHMARKS_ENABLED is 0, same deal as the profiler.
+//
+
+#if BENCHMARKS_ENABLED
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "types.hpp"
+#include "simdjson/simdjson.h"
+
+namespace gltf {
+	struct data;
+}
+
+namespace bench {
+	struct Timing {
+		f64 min_ms;
+		f64 median_ms;
+		f64 mean_ms;
+		f64 max_ms;
+		f64 stddev_ms;
+	};
+
+	/* Runs `p_fn` `p_iterations` times (after one warm-up run) and prints min/median/mean/max and the standard deviation. */
+	template <typename Fn>
+	Timing measure(char const *p_label, u32 const p_iterations, Fn &&p_fn) {
+		using clock = std::chrono::steady_clock;
+
+		p_fn();
+
+		Vec<f64> samples;
+		samples.reserve(p_iterations);
+		for (u32 i = 0; i < p_iterations; i++) {
+			clock::time_point const start = clock::now();
+			p_fn();
+			samples.push_back(std::chrono::duration<f64, std::milli>(clock::now() - start).count());
+		}
+
+		std::ranges::sort(samples);
+		f64 total = 0.0;
+		for (f64 const s : samples)
+			total += s;
+
+		f64 const mean = total / static_cast<f64>(samples.size());
+		f64 variance = 0.0;
+		for (f64 const s : samples)
+			variance += (s - mean) * (s - mean);
+
+		Timing const timing{
+			.min_ms = samples.front(),
+			.median_ms = samples[samples.size() / 2],
+			.mean_ms = mean,
+			.max_ms = samples.back(),
+			.stddev_ms = std::sqrt(variance / static_cast<f64>(samples.size()))
+		};
+		printf("[bench] %-32s min %9.3f ms | median %9.3f ms | mean %9.3f ms | max %9.3f ms | stddev %8.3f ms (%u runs)\n",
+			p_label, timing.min_ms, timing.median_ms, timing.mean_ms, timing.max_ms, timing.stddev_ms, p_iterations);
+		return timing;
+	}
+
+	/* The glTF the scene benchmarks load when they aren't given a file. */
+	constexpr char const *DEFAULT_SCENE = "test-resources\\sponza\\NewSponza_Main_glTF_003.gltf";
+
+	/* Positional argument `p_index`, `p_default` when it wasn't passed. */
+	std::string argument(Vec<std::string_view> const &p_args, std::size_t p_index, std::string_view p_default = {});
+	/* Positional argument `p_index` as a number, `p_default` when it wasn't passed. */
+	u32 numberArgument(Vec<std::string_view> const &p_args, std::size_t p_index, u32 p_default);
+
+	/* Reads the glTF json at `p_file_path`, prints the failure and returns nothing when it can't. */
+	Optional<simdjson::padded_string> loadJson(std::string const &p_file_path);
+	/* loadJson() and gltf::parse(). */
+	Optional<gltf::data> loadScene(std::string const &p_file_path);
+
+	/* Dispatches `--bench <name>`, returns the process exit code. */
+	int run(std::string_view p_name, Vec<std::string_view> const &p_args);
+}
+
+#endif
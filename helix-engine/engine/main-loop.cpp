@@ -1,5 +1,6 @@
 ﻿#include "main-loop.hpp"
 
+#include <chrono>
 #include <fstream>
 
 #include "Input.h"
@@ -7,8 +8,14 @@
 #include "ecs/ecs_gltf.hpp"
 #include "ecs/3d/editor/editor_camera.hpp"
 #include "ecs/core/scene_tree.hpp"
+#include "engine/engine.h"
+#include "engine/thread_pool.hpp"
 #include "gpu/gltf.h"
 #include "gpu/graphics.hpp"
+#include "gpu/hlxscene.hpp"
+#include "gpu/staging_ring.hpp"
+#include "gpu/texture_streamer.hpp"
+#include "gpu/texture_upload.hpp"
 #include "gpu/renderers/deferred.hpp"
 #include "inipp/inipp.h"
 #include "simdjson/simdjson.h"
@@ -52,9 +59,9 @@ Result<IMainLoop &> Main::mainLoop() {
 }
 
 namespace {
-	gltf::data loadModelAsync(std::string const &path) {
+	gltf::data loadModelAsync(std::string const &path, gltf::parse_options const &options) {
 		auto gltf_path = simdjson::padded_string::load(path).value();
-		return gltf::parse(path, std::move(gltf_path));
+		return gltf::parse(path, std::move(gltf_path), options);
 	}
 }
 
@@ -62,8 +69,30 @@ Result<> DefMainLoop::start(std::string const &startup_scene) {
 	std::ifstream config_stream("config.ini");
 	config_.parse(config_stream);
 
+	gltf::parse_options parse_options;
+	auto const &sec_engine_assets = config_.sections["Engine/Assets"];
+	inipp::get_value(sec_engine_assets,
+		"ImageIOConcurrency", parse_options.image_io_concurrency);
+	inipp::get_value(sec_engine_assets,
+		"ImageTranscodeConcurrency", parse_options.image_transcode_concurrency);
+	u64 texture_upload_budget = TEXTURE_UPLOAD_BYTES_PER_FRAME;
+	inipp::get_value(sec_engine_assets,
+		"TextureUploadBytesPerFrame", texture_upload_budget);
+	TextureUploader::singleton()->setBudget(texture_upload_budget);
+	u64 texture_streaming_budget = TEXTURE_STREAMING_BUDGET_BYTES;
+	inipp::get_value(sec_engine_assets,
+		"TextureStreamingBudgetBytes", texture_streaming_budget);
+	TextureStreamer::singleton()->setBudget(texture_streaming_budget);
+
+	// A valid cooked copy skips the glTF import entirely, otherwise the import runs while the window comes up.
+	SharedPtr<hlxscene::scene> cooked_scene;
+	std::future<gltf::data> gltf_data_future;
+	if (Result<SharedPtr<hlxscene::scene>> result_cooked = hlxscene::scene::open(startup_scene, parse_options); result_cooked.error() == OK)
+		cooked_scene = result_cooked.value();
+	else
+		gltf_data_future = std::async(loadModelAsync, startup_scene, parse_options);
+
 	std::string renderer_name;
-	std::future<gltf::data> gltf_data_future = std::async(loadModelAsync, startup_scene);
 
 	auto const &sec_engine_graphics = config_.sections["Engine/Graphics"];
 	auto &sec_engine_graphics_window = config_.sections["Engine/Graphics/Window"];
@@ -91,9 +120,26 @@ Result<> DefMainLoop::start(std::string const &startup_scene) {
 		.decorated = true
 	});
 
+	// The ring's buffer is created by its first use, which has to be here on the main thread before any loader runs.
+	StagingRing::singleton();
+
 	auto const scene_tree = std::make_shared<SceneTree>(window_);
-	gltf::data scene_data = gltf_data_future.get();
-	uid const root_entity_uid = gltf::createEntityFromGltf(scene_tree, scene_data);
+	uid root_entity_uid;
+	if (cooked_scene) {
+		root_entity_uid = gltf::createEntityFromCookedScene(scene_tree, *cooked_scene);
+		scene_data_ = cooked_scene;
+	}
+	else {
+		auto const scene_data = std::make_shared<gltf::data>(gltf_data_future.get());
+		// The cook gets its own copy, taken before the import starts filling in this one's caches, and the first frame doesn't wait for it.
+		auto const cook_source = std::make_shared<gltf::data const>(*scene_data);
+		cook_ = ThreadPool::singleton()->addTaskToQueue([cook_source, startup_scene] {
+			if (Error const cook_error = hlxscene::cook(*cook_source); cook_error != OK)
+				printf("Couldn't cook \"%s\" (%d), it will be imported from glTF again next launch.\n", startup_scene.c_str(), static_cast<int>(cook_error));
+		});
+		root_entity_uid = gltf::createEntityFromGltf(scene_tree, *scene_data);
+		scene_data_ = scene_data;
+	}
 	scene_tree->setRoot(root_entity_uid);
 
 	SharedPtr<Entity> root_entity = scene_tree->entity(root_entity_uid);
@@ -146,15 +192,21 @@ Result<> DefMainLoop::iter([[maybe_unused]] f64 delta) {
 	
 	SharedPtr<IRenderer> const renderer = window_->renderer();
 
+	TextureUploader::singleton()->drain();
 	Result<> const result = renderer->render();
 	if (result.error() != OK) _UNLIKELY
 		return result;
+	// The G-buffer pass requested what it saw, residency changes land before the next frame draws.
+	TextureStreamer::singleton()->update();
 	scene_tree->initiateFrame(delta);
 	
 	return OK;
 }
 
 Result<> DefMainLoop::stop() {
+	// Let a first launch's cook finish, texture loads it queued behind may still need main thread tasks.
+	while (cook_.valid() && cook_.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+		Engine::singleton()->workLazyTasks();
 	GlfwWindowUserPointerEngineData const *const window_data = static_cast<GlfwWindowUserPointerEngineData *>(glfwGetWindowUserPointer(window_->window));
 	delete window_data;
 	window_->dispose();
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <future>
 #include <memory>
 
 #include "types.hpp"
@@ -52,4 +53,6 @@ public:
 	inipp::Ini<char> config_;
 private:
 	SharedPtr<Window> window_;
+	SharedPtr<void> scene_data_; //< Source data of the startup scene, texture loads still in flight read from it.
+	_STD future<void> cook_; //< The startup scene being cooked on the ThreadPool, first launch only.
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 ﻿#include "thread_pool.hpp"
 
-ThreadPool::ThreadPool(size_t const thread_count) : threads_(thread_count), sem_(0), stop_(false) {
+ThreadPool::ThreadPool(size_t const thread_count) : sem_(0), stop_(false) {
+	threads_.reserve(thread_count);
 	for (size_t i = 0; i < thread_count; ++i)
 		threads_.emplace_back([this, i] { Worker(i); });
 	
@@ -8,10 +9,8 @@ ThreadPool::ThreadPool(size_t const thread_count) : threads_(thread_count), sem_
 
 void ThreadPool::Worker(size_t thread_index) {
 	while (true) {
-		while (!stop_.load()) {
-			if (sem_.try_acquire())
-				break;
-		}
+		// One tick per queued task, plus one per thread on shutdown. Sleep until there is something to do.
+		sem_.acquire();
 
 		Task<void()> task;
 		{
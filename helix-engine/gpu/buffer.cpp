@@ -128,6 +128,11 @@ void Buffer::bindBufferBase(gl::BufferTargetARB const p_target, u32 const p_inde
 	glBindBufferRange(static_cast<GLenum>(p_target), p_index, buffer_object_, p_offset, p_size);
 }
 
+void Buffer::copySubData(Buffer const &destination, i64 const read_offset, i64 const write_offset, i64 const size) const {
+	glCopyNamedBufferSubData(buffer_object_, destination.buffer_object_, static_cast<GLintptr>(read_offset), static_cast<GLintptr>(write_offset), static_cast<GLsizeiptr>(size));
+	gpu_check;
+}
+
 void Buffer::download(i64 const p_offset, i64 const p_size, u8 *out_data) const {
 	if (out_data == nullptr)
 		out_data = new u8[p_size];
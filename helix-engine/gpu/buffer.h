@@ -84,6 +84,9 @@ public:
 
 	void bindBufferBase(gl::BufferTargetARB const p_target, u32 const p_index, i64 const p_offset, i64 const p_size) const;
 
+	/* GPU side copy of `size` bytes into `destination`, which may be this buffer as long as the ranges don't overlap. */
+	void copySubData(Buffer const &destination, i64 read_offset, i64 write_offset, i64 size) const;
+
 	void download(i64 const p_offset, i64 const p_size, u8 *out_data) const;
 	void download(i64 const p_offset, u8 *out_data) const;
 	void download(u8 *out_data) const;
@@ -0,0 +1,275 @@
+﻿#include "frustum_culling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <immintrin.h>
+#include <limits>
+
+#include "engine/thread_pool.hpp"
+
+u32 FrustumCuller::add(AABB const &world_bounds) {
+	if (count_ == center_x_.size()) {
+		std::size_t const capacity = std::max<std::size_t>(64, center_x_.size() * 2);
+		for (Vec<f32> *array : { &center_x_, &center_y_, &center_z_, &extent_x_, &extent_y_, &extent_z_ })
+			array->resize(capacity, 0.0f);
+	}
+	center_x_[count_] = world_bounds.center.x;
+	center_y_[count_] = world_bounds.center.y;
+	center_z_[count_] = world_bounds.center.z;
+	extent_x_[count_] = world_bounds.extents.x;
+	extent_y_[count_] = world_bounds.extents.y;
+	extent_z_[count_] = world_bounds.extents.z;
+	return count_++;
+}
+
+void FrustumCuller::cull(Frustum const &frustum, u32 const boxes_per_task) {
+	Array<vec4, 6> planes;
+	Plane const *faces[] = { &frustum.leftFace, &frustum.rightFace, &frustum.topFace, &frustum.bottomFace, &frustum.nearFace, &frustum.farFace };
+	for (std::size_t i = 0; i < planes.size(); i++)
+		planes[i] = vec4(faces[i]->normal, faces[i]->distance);
+
+	std::size_t const words = (static_cast<std::size_t>(count_) + 63) / 64;
+	if (visibility_.size() < words)
+		visibility_.resize(words);
+	std::size_t const words_per_task = std::max<std::size_t>(1, (static_cast<std::size_t>(boxes_per_task) + 63) / 64);
+
+	// Tasks own whole words, nothing is shared between them. The calling thread takes the first chunk.
+	Vec<std::future<void>> tasks;
+	for (std::size_t first = words_per_task; first < words; first += words_per_task) {
+		std::size_t const last = std::min(first + words_per_task, words);
+		tasks.push_back(ThreadPool::singleton()->addTaskToQueue([this, &planes, first, last] { cullWords(planes, first, last); }));
+	}
+	cullWords(planes, 0, std::min(words_per_task, words));
+	for (std::future<void> &task : tasks)
+		task.wait();
+
+	if (u32 const tail = count_ & 63; tail != 0)
+		visibility_[words - 1] &= (u64{ 1 } << tail) - 1;
+}
+
+void FrustumCuller::cullWords(Array<vec4, 6> const &planes, std::size_t const first_word, std::size_t const last_word) {
+	// Same operations in the same order as AABB::forwardPlane(): (n.c - d) >= -(e.|n|).
+#ifdef __AVX2__
+	using simd = __m256;
+	constexpr u32 width = 8;
+	auto const load = [](Vec<f32> const &v, std::size_t const i) { return _mm256_loadu_ps(v.data() + i); };
+	auto const broadcast = [](f32 const f) { return _mm256_set1_ps(f); };
+	auto const add = [](simd const a, simd const b) { return _mm256_add_ps(a, b); };
+	auto const sub = [](simd const a, simd const b) { return _mm256_sub_ps(a, b); };
+	auto const mul = [](simd const a, simd const b) { return _mm256_mul_ps(a, b); };
+	auto const inside = [](simd const distance, simd const negative_radius) { return _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ); };
+	auto const both = [](simd const a, simd const b) { return _mm256_and_ps(a, b); };
+	auto const mask = [](simd const a) { return static_cast<u64>(_mm256_movemask_ps(a)); };
+#else
+	using simd = __m128;
+	constexpr u32 width = 4;
+	auto const load = [](Vec<f32> const &v, std::size_t const i) { return _mm_loadu_ps(v.data() + i); };
+	auto const broadcast = [](f32 const f) { return _mm_set1_ps(f); };
+	auto const add = [](simd const a, simd const b) { return _mm_add_ps(a, b); };
+	auto const sub = [](simd const a, simd const b) { return _mm_sub_ps(a, b); };
+	auto const mul = [](simd const a, simd const b) { return _mm_mul_ps(a, b); };
+	auto const inside = [](simd const distance, simd const negative_radius) { return _mm_cmpge_ps(distance, negative_radius); };
+	auto const both = [](simd const a, simd const b) { return _mm_and_ps(a, b); };
+	auto const mask = [](simd const a) { return static_cast<u64>(_mm_movemask_ps(a)); };
+#endif
+
+	struct BroadcastPlane {
+		simd nx, ny, nz, d;
+		simd ax, ay, az;
+	};
+	Array<BroadcastPlane, 6> broadcast_planes;
+	for (std::size_t i = 0; i < planes.size(); i++) {
+		vec4 const &plane = planes[i];
+		broadcast_planes[i] = {
+			broadcast(plane.x), broadcast(plane.y), broadcast(plane.z), broadcast(plane.w),
+			broadcast(std::abs(plane.x)), broadcast(std::abs(plane.y)), broadcast(std::abs(plane.z))
+		};
+	}
+	simd const zero = broadcast(0.0f);
+
+	for (std::size_t word = first_word; word < last_word; word++) {
+		u64 bits = 0;
+		for (u32 lane = 0; lane < 64; lane += width) {
+			std::size_t const i = word * 64 + lane;
+			simd const cx = load(center_x_, i), cy = load(center_y_, i), cz = load(center_z_, i);
+			simd const ex = load(extent_x_, i), ey = load(extent_y_, i), ez = load(extent_z_, i);
+			simd visible = inside(zero, zero); //< All lanes set.
+			for (BroadcastPlane const &plane : broadcast_planes) {
+				simd const distance = sub(add(add(mul(plane.nx, cx), mul(plane.ny, cy)), mul(plane.nz, cz)), plane.d);
+				simd const radius = add(add(mul(ex, plane.ax), mul(ey, plane.ay)), mul(ez, plane.az));
+				visible = both(visible, inside(distance, sub(zero, radius)));
+			}
+			bits |= mask(visible) << lane;
+		}
+		visibility_[word] = bits;
+	}
+}
+
+#if BENCHMARKS_ENABLED
+#include <bit>
+#include <random>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+int benchmarkFrustumCulling(Vec<std::string_view> const &p_args) {
+	u32 const iterations = !p_args.empty() ? static_cast<u32>(std::stoul(std::string(p_args[0]))) : 20;
+
+	// Looking down -Z from the origin, boxes scattered around it so roughly a sixth of them are in view.
+	Frustum const frustum = createFrustumFromCamera(vec3(0.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 1.0f, 0.0f), glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	std::mt19937 rng(0x5eed);
+	std::uniform_real_distribution<f32> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<f32> extent(0.05f, 8.0f);
+
+	bool agree = true;
+	for (u32 const count : { 10'000u, 100'000u, 1'000'000u }) {
+		Vec<AABB> boxes;
+		boxes.reserve(count);
+		FrustumCuller culler;
+		for (u32 i = 0; i < count; i++) {
+			AABB const &box = boxes.emplace_back(vec3(position(rng), position(rng), position(rng)), extent(rng), extent(rng), extent(rng));
+			static_cast<void>(culler.add(box));
+		}
+
+		Vec<u64> reference((count + 63) / 64);
+		std::string const label = std::to_string(count / 1000) + "k";
+		bench::measure(("AABB::forwardPlane " + label).c_str(), iterations, [&] {
+			std::ranges::fill(reference, 0);
+			for (u32 i = 0; i < count; i++) {
+				AABB const &box = boxes[i];
+				bool const visible = box.forwardPlane(frustum.leftFace) && box.forwardPlane(frustum.rightFace) &&
+				                     box.forwardPlane(frustum.topFace) && box.forwardPlane(frustum.bottomFace) &&
+				                     box.forwardPlane(frustum.nearFace) && box.forwardPlane(frustum.farFace);
+				reference[i >> 6] |= static_cast<u64>(visible) << (i & 63);
+			}
+		});
+		bench::measure(("FrustumCuller 1 thread " + label).c_str(), iterations, [&] {
+			culler.cull(frustum, std::numeric_limits<u32>::max());
+		});
+		bench::measure(("FrustumCuller pooled " + label).c_str(), iterations, [&] {
+			culler.cull(frustum);
+		});
+
+		u64 visible = 0, mismatches = 0;
+		std::span<u64 const> const bits = culler.visibility();
+		for (std::size_t word = 0; word < bits.size(); word++) {
+			visible += std::popcount(bits[word]);
+			mismatches += std::popcount(bits[word] ^ reference[word]);
+		}
+		printf("[bench] %s boxes: %llu visible, %llu disagreeing with AABB::forwardPlane\n",
+			label.c_str(), static_cast<unsigned long long>(visible), static_cast<unsigned long long>(mismatches));
+		agree = agree && mismatches == 0;
+	}
+	return agree ? 0 : 1;
+}
+
+int benchmarkFrustumPlanes(Vec<std::string_view> const &p_args) {
+	u32 const cameras = !p_args.empty() ? static_cast<u32>(std::stoul(std::string(p_args[0]))) : 1000;
+	u32 const boxes_per_camera = p_args.size() > 1 ? static_cast<u32>(std::stoul(std::string(p_args[1]))) : 1000;
+
+	std::mt19937 rng(0x5eed);
+	auto const uniform = [&](f32 const min, f32 const max) { return std::uniform_real_distribution<f32>(min, max)(rng); };
+
+	f32 worst_normal = 0.0f;	//< | |n| - 1 |
+	f32 worst_corner = 0.0f;	//< Distance of a frustum corner to the planes it sits on, relative to its distance to the eye.
+	u64 total_boxes = 0, culled = 0, culled_by_corners = 0, false_culls = 0;
+	Vec<Frustum> frusta;
+	Vec<AABB> boxes; //< boxes_per_camera per frustum.
+	Vec<FrustumCuller> cullers(cameras); //< The same boxes, as the engine culls them.
+	frusta.reserve(cameras);
+	boxes.reserve(static_cast<std::size_t>(cameras) * boxes_per_camera);
+
+	for (u32 camera = 0; camera < cameras; camera++) {
+		vec3 const eye(uniform(-100.0f, 100.0f), uniform(-100.0f, 100.0f), uniform(-100.0f, 100.0f));
+		quat const orientation = glm::normalize(quat(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f)));
+		f32 const near_z = uniform(0.01f, 1.0f), far_z = uniform(50.0f, 2000.0f);
+		mat4 const projection = glm::perspective(glm::radians(uniform(30.0f, 120.0f)), uniform(0.5f, 2.5f), near_z, far_z);
+		mat4 const view = glm::inverse(glm::translate(mat4(1.0f), eye) * glm::mat4_cast(orientation));
+		mat4 const projection_view = projection * view;
+		Frustum const &frustum = frusta.emplace_back(createFrustumFromViewProjection(projection_view));
+
+		Plane const *planes[] = { &frustum.leftFace, &frustum.rightFace, &frustum.bottomFace, &frustum.topFace, &frustum.nearFace, &frustum.farFace };
+		for (Plane const *plane : planes)
+			worst_normal = std::max(worst_normal, std::abs(glm::length(plane->normal) - 1.0f));
+
+		// Every NDC cube corner lies on one plane per axis: x = -1 on left, x = 1 on right and so on, in the order of `planes`.
+		glm::dmat4 const inverse = glm::inverse(glm::dmat4(projection_view));
+		for (i32 corner = 0; corner < 8; corner++) {
+			ivec3 const side(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+			glm::dvec4 const clip = inverse * glm::dvec4(side.x ? 1.0 : -1.0, side.y ? 1.0 : -1.0, side.z ? 1.0 : -1.0, 1.0);
+			vec3 const world(glm::dvec3(clip) / clip.w);
+			f32 const scale = std::max(glm::distance(world, eye), 1.0f);
+			for (i32 axis = 0; axis < 3; axis++)
+				worst_corner = std::max(worst_corner, std::abs(planes[axis * 2 + side[axis]]->signedDistance(world)) / scale);
+		}
+
+		// Boxes from well inside to well outside, sized from specks to bigger than the frustum.
+		FrustumCuller &culler = cullers[camera];
+		Vec<bool> inside_by_corners(boxes_per_camera);
+		for (u32 i = 0; i < boxes_per_camera; i++) {
+			f32 const reach = far_z * 1.5f;
+			AABB const &box = boxes.emplace_back(eye + vec3(uniform(-reach, reach), uniform(-reach, reach), uniform(-reach, reach)),
+				std::exp(uniform(-4.0f, 6.0f)), std::exp(uniform(-4.0f, 6.0f)), std::exp(uniform(-4.0f, 6.0f)));
+
+			// Brute force: outside when all eight corners are behind the same plane.
+			Array<vec3, 8> const corners = box.vertices();
+			bool corners_outside = false;	//< Every corner clearly behind one plane.
+			bool corners_inside = true;		//< Some corner clearly in front of every plane.
+			f32 const tolerance = 1e-4f * std::max({ 1.0f, glm::length(box.center - eye), glm::length(box.extents) });
+			for (Plane const *plane : planes) {
+				f32 furthest = std::numeric_limits<f32>::lowest();
+				for (vec3 const &corner : corners)
+					furthest = std::max(furthest, plane->signedDistance(corner));
+				corners_outside = corners_outside || furthest < -tolerance;
+				corners_inside = corners_inside && furthest > tolerance;
+			}
+
+			static_cast<void>(culler.add(box));
+			inside_by_corners[i] = corners_inside;
+			culled_by_corners += corners_outside ? 1 : 0;
+		}
+
+		culler.cull(frustum);
+		for (u32 i = 0; i < boxes_per_camera; i++) {
+			bool const kept = culler.visible(i);
+			total_boxes++;
+			culled += kept ? 0 : 1;
+			false_culls += !kept && inside_by_corners[i] ? 1 : 0;
+		}
+	}
+
+	u64 kept = 0;
+	bench::measure("FrustumCuller", 5, [&] {
+		kept = 0;
+		for (u32 camera = 0; camera < cameras; camera++) {
+			cullers[camera].cull(frusta[camera]);
+			for (u64 const word : cullers[camera].visibility())
+				kept += std::popcount(word);
+		}
+	});
+	u64 kept_by_corners = 0;
+	bench::measure("corners one by one", 5, [&] {
+		kept_by_corners = 0;
+		for (std::size_t i = 0; i < boxes.size(); i++) {
+			Frustum const &frustum = frusta[i / boxes_per_camera];
+			Array<vec3, 8> const corners = boxes[i].vertices();
+			bool outside = false;
+			for (Plane const *plane : { &frustum.leftFace, &frustum.rightFace, &frustum.bottomFace, &frustum.topFace, &frustum.nearFace, &frustum.farFace })
+				outside = outside || std::ranges::all_of(corners, [&](vec3 const &corner) { return plane->signedDistance(corner) < 0.0f; });
+			kept_by_corners += outside ? 0 : 1;
+		}
+	});
+
+	printf("[bench] %u camera(s): worst normal length error %.2e, worst frustum corner off its planes by %.2e of its distance\n",
+		cameras, worst_normal, worst_corner);
+	printf("[bench] %llu box(es): %llu culled, %llu with every corner behind a plane, %llu culled with a corner in front of every plane\n",
+		static_cast<unsigned long long>(total_boxes), static_cast<unsigned long long>(culled),
+		static_cast<unsigned long long>(culled_by_corners), static_cast<unsigned long long>(false_culls));
+	printf("[bench] kept %llu by FrustumCuller, %llu by corners\n",
+		static_cast<unsigned long long>(kept), static_cast<unsigned long long>(kept_by_corners));
+
+	bool const ok = worst_normal <= 1e-5f && worst_corner <= 1e-3f && false_culls == 0;
+	return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <span>
+
+#include "geometry.hpp"
+#include "engine/benchmark.hpp"
+
+/* Boxes per ThreadPool task, sets up to this size are culled on the calling thread. Multiple of 64. */
+#define FRUSTUM_CULLING_BOXES_PER_TASK (1u << 14)
+
+/*
+ * World space AABBs kept as SoA arrays and tested against the six planes of a frustum, 8 at a time with AVX2 or 4 with SSE,
+ * with the work split over the ThreadPool. The result is a bitset: bit `slot` is set when the box add() returned `slot` for
+ * may be on screen, as of the last cull(). The test is AABB::forwardPlane() operation for operation, both agree on every box.
+ */
+class FrustumCuller {
+public:
+	void clear() { count_ = 0; }
+	_NODISCARD u32 add(AABB const &world_bounds);
+	/* Fills the bitset, in tasks of `boxes_per_task` boxes (rounded up to whole words) besides the calling thread's. */
+	void cull(Frustum const &frustum, u32 boxes_per_task = FRUSTUM_CULLING_BOXES_PER_TASK);
+
+	_NODISCARD bool visible(u32 const slot) const { return (visibility_[slot >> 6] >> (slot & 63) & 1) != 0; }
+	_NODISCARD _STD span<u64 const> visibility() const { return { visibility_.data(), (count_ + 63) / 64 }; }
+	_NODISCARD u32 size() const { return count_; }
+
+private:
+	/* Boxes [first_word * 64, last_word * 64), planes as (normal, distance). */
+	void cullWords(Array<vec4, 6> const &planes, _STD size_t first_word, _STD size_t last_word);
+
+	u32 count_ = 0;
+	// Allocated 64 boxes at a time, so the kernels only ever see whole words. Boxes past count_ are stale or zero.
+	Vec<f32> center_x_, center_y_, center_z_;
+	Vec<f32> extent_x_, extent_y_, extent_z_;
+	Vec<u64> visibility_;
+};
+
+#if BENCHMARKS_ENABLED
+/*
+ * `--bench frustum-culling [iterations]`, culls 10k, 100k and 1M random boxes with AABB::forwardPlane() one box at a time,
+ * with FrustumCuller on one thread and with FrustumCuller on the ThreadPool. Exits with 1 if FrustumCuller disagrees with AABB.
+ */
+extern int benchmarkFrustumCulling(Vec<_STD string_view> const &p_args);
+/*
+ * `--bench frustum-planes [cameras] [boxes per camera]`, checks createFrustumFromViewProjection() against random
+ * perspective cameras (unit normals, the frustum's corners on its planes) and FrustumCuller with those planes against
+ * testing the eight corners of random boxes one by one. Exits with 1 if a plane is off or a box with a corner in front
+ * of every plane gets culled.
+ */
+extern int benchmarkFrustumPlanes(Vec<_STD string_view> const &p_args);
+#endif
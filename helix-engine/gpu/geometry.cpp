@@ -1,6 +1,10 @@
 ﻿#include "geometry.hpp"
 
 #include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <immintrin.h>
 
 #include "ecs/transform.h"
 
@@ -30,11 +34,25 @@ Frustum createFrustumFromCamera(vec3 const &position, vec3 const &forward, vec3
 	return result;
 }
 
-Frustum createFrustumFromMatrix(mat4 const &view, f32 const fovY, f32 const aspectRatio, f32 const nearZ, f32 const farZ) {
-	vec3 const position(view[0][2], view[1][2], view[2][2]);
-	vec3 const forward(-view[2]);
-	vec3 const up(view[1]);
-	return createFrustumFromCamera(position, forward, up, fovY, aspectRatio, nearZ, farZ);
+Frustum createFrustumFromViewProjection(mat4 const &projection_view) {
+	// A point is inside when -w <= x, y, z <= w in clip space, every inequality is a plane dotted with (p, 1).
+	mat4 const rows = glm::transpose(projection_view);
+	auto const plane = [](vec4 const &coefficients) {
+		f32 const length = glm::length(vec3(coefficients));
+		Plane p;
+		p.normal = vec3(coefficients) / length;
+		p.distance = -coefficients.w / length;
+		return p;
+	};
+
+	Frustum result;
+	result.leftFace		= plane(rows[3] + rows[0]);
+	result.rightFace	= plane(rows[3] - rows[0]);
+	result.bottomFace	= plane(rows[3] + rows[1]);
+	result.topFace		= plane(rows[3] - rows[1]);
+	result.nearFace		= plane(rows[3] + rows[2]);
+	result.farFace		= plane(rows[3] - rows[2]);
+	return result;
 }
 
 #define ON_FRUSTUM(OBJECT, FRUSTUM) \
@@ -82,6 +100,12 @@ Array<vec3, 8> AABB::vertices() const {
 	};
 }
 
+AABB AABB::transformed(mat4 const &matrix) const {
+	vec3 const global_center(matrix * vec4(center, 1.0f));
+	vec3 const global_extents = glm::abs(vec3(matrix[0])) * extents.x + glm::abs(vec3(matrix[1])) * extents.y + glm::abs(vec3(matrix[2])) * extents.z;
+	return { global_center, global_extents.x, global_extents.y, global_extents.z };
+}
+
 bool AABB::onFrustum(Frustum const &frustum, Transform const &model) const {
 	vec3 const global_center( model.matrix() * vec4(center, 1.0f) );
 
@@ -117,4 +141,63 @@ bool AABB::forwardPlane(Plane const &plane) const {
 				  extents.z * std::abs(plane.normal.z);
 	
 	return -r <= plane.signedDistance(center);
-}
\ No newline at end of file
+}
+
+namespace {
+	// NaN positions are skipped by both paths: glm::min/max keep the running value when the comparison fails,
+	// _mm_min_ps/_mm_max_ps return their second operand when either is NaN, so the running value goes second.
+	void positionBoundsScalar(u8 const *positions, size_t const count, size_t const stride, vec3 &min, vec3 &max) {
+		for (size_t i = 0; i < count; i++) {
+			vec3 position;
+			std::memcpy(&position, positions + i * stride, sizeof(vec3));
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+		}
+	}
+}
+
+AABB computePositionBounds(void const *positions, size_t const count, size_t const stride) {
+	if (count == 0)
+		return { vec3(0.0f), vec3(0.0f) };
+
+	auto const bytes = static_cast<u8 const *>(positions);
+	vec3 min(std::numeric_limits<f32>::max());
+	vec3 max(std::numeric_limits<f32>::lowest());
+
+	size_t done = 0;
+	if (stride == sizeof(vec3)) {
+		// Four packed positions are exactly three registers: [x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3].
+		// Reduce each register slot on its own and only untangle the lanes at the end.
+		__m128 min_a = _mm_set1_ps(std::numeric_limits<f32>::max()), min_b = min_a, min_c = min_a;
+		__m128 max_a = _mm_set1_ps(std::numeric_limits<f32>::lowest()), max_b = max_a, max_c = max_a;
+
+		auto const floats = reinterpret_cast<f32 const *>(bytes);
+		for (; done + 4 <= count; done += 4) {
+			f32 const *block = floats + done * 3;
+			__m128 const a = _mm_loadu_ps(block);
+			__m128 const b = _mm_loadu_ps(block + 4);
+			__m128 const c = _mm_loadu_ps(block + 8);
+			min_a = _mm_min_ps(a, min_a); max_a = _mm_max_ps(a, max_a);
+			min_b = _mm_min_ps(b, min_b); max_b = _mm_max_ps(b, max_b);
+			min_c = _mm_min_ps(c, min_c); max_c = _mm_max_ps(c, max_c);
+		}
+
+		alignas(16) f32 lo[12], hi[12];
+		_mm_store_ps(lo, min_a); _mm_store_ps(lo + 4, min_b); _mm_store_ps(lo + 8, min_c);
+		_mm_store_ps(hi, max_a); _mm_store_ps(hi + 4, max_b); _mm_store_ps(hi + 8, max_c);
+		for (size_t lane = 0; lane < 12; lane++) {
+			min[lane % 3] = std::min(min[lane % 3], lo[lane]);
+			max[lane % 3] = std::max(max[lane % 3], hi[lane]);
+		}
+	}
+
+	positionBoundsScalar(bytes + done * stride, count - done, stride, min, max);
+
+#ifdef _DEBUG
+	vec3 reference_min(std::numeric_limits<f32>::max()), reference_max(std::numeric_limits<f32>::lowest());
+	positionBoundsScalar(bytes, count, stride, reference_min, reference_max);
+	assert(reference_min == min && reference_max == max);
+#endif
+
+	return { min, max };
+}
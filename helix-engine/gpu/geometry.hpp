@@ -9,6 +9,7 @@ namespace rd {
 }
 
 class Transform;
+struct AABB;
 
 struct Plane {
 	vec3 normal;
@@ -44,13 +45,11 @@ extern Frustum createFrustumFromCamera(
 	f32 farZ
 );
 
-extern Frustum createFrustumFromMatrix(
-	mat4 const &view,
-	f32 fovY,
-	f32 aspectRatio,
-	f32 nearZ,
-	f32 farZ
-);
+/*
+ * Gribb-Hartmann: the planes of the clip volume of `projection_view` (OpenGL depth, -w <= z <= w), in world space when
+ * it is projection * view. Normals are unit length and face inwards.
+ */
+extern Frustum createFrustumFromViewProjection(mat4 const &projection_view);
 
 struct Bounds {
 	virtual ~Bounds() = default;
@@ -80,6 +79,14 @@ struct AABB : public Bounds {
 		center(cen), extents(i, j, k) {}
 
 	_NODISCARD Array<vec3, 8> vertices() const;
+	/* Smallest AABB around this one once transformed by `matrix`. */
+	_NODISCARD AABB transformed(mat4 const &matrix) const;
 	_NODISCARD bool onFrustum(Frustum const &frustum, Transform const &model) const override;
 	_NODISCARD bool forwardPlane(Plane const &plane) const final;
-};
\ No newline at end of file
+};
+
+/*
+ * Bounds of `count` positions (3 floats each) laid out `stride` bytes apart, e.g. a POSITION accessor
+ * or an interleaved vertex stream. Tightly packed streams take an SSE path, anything else is scalar.
+ */
+extern AABB computePositionBounds(void const *positions, size_t count, size_t stride = sizeof(vec3));
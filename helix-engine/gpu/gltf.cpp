@@ -11,6 +11,8 @@
 #include "stb/stb_image.h"
 #include "libpng/png.h"
 
+#include "os.hpp"
+#include "engine/thread_pool.hpp"
 #include "types.hpp"
 #include "util.hpp"
 #include "khr/ktx.h"
@@ -45,20 +47,39 @@ void accessor::setCount(size const p_count) { count_ = p_count; }
 size accessor::count() const { return count_; }
 
 
-void accessor::setMax(_STD array<number, 16> const &p_max) { max_ = p_max; }
-void accessor::setMaxComponent(_STD size_t const p_index, number const p_value) { max_[p_index] = p_value; }
+void accessor::setMax(_STD array<number, 16> const &p_max) { max_ = p_max; has_max_ = true; }
+void accessor::setMaxComponent(_STD size_t const p_index, number const p_value) { max_[p_index] = p_value; has_max_ = true; }
 _STD array<number, 16> const & accessor::max() const { return max_; }
 
-void accessor::setMin(_STD array<number, 16> const &p_min) { min_ = p_min; }
-void accessor::setMinComponent(_STD size_t const p_index, number const p_value) { min_[p_index] = p_value; }
+void accessor::setMin(_STD array<number, 16> const &p_min) { min_ = p_min; has_min_ = true; }
+void accessor::setMinComponent(_STD size_t const p_index, number const p_value) { min_[p_index] = p_value; has_min_ = true; }
 _STD array<number, 16> const & accessor::min() const { return min_; }
 
+bool accessor::hasBounds() const { return has_min_ && has_max_; }
+
+void accessor::setNormalized(bool const p_normalized) { normalized_ = p_normalized; }
+bool accessor::normalized() const { return normalized_; }
+
+void accessor::setSparse(accessor_sparse const &p_sparse) { sparse_ = p_sparse; }
+_STD optional<accessor_sparse> const & accessor::sparse() const { return sparse_; }
+
+bool accessor::hasBufferView() const { return buffer_view_ >= 0; }
+
 #ifndef min
 #define min(a,b)            (((a) < (b)) ? (a) : (b))
 #endif
 
 buffer::buffer(_STD string const& uri, _STD string const& name)
 	: uri_(uri), name_(name) {
+
+	// Map the file if we can, accessors then read straight out of the page cache.
+	if (Result<SharedPtr<os::MappedFile>> mapped = os::MappedFile::open(uri); mapped.has_value()) {
+		SharedPtr<os::MappedFile> const file = mapped.value();
+		borrowed_ = file->data();
+		borrowed_length_ = file->size();
+		owner_ = file;
+		return;
+	}
 	
 #ifdef GLTF_USE_STD_FILESYSTEM
 	_STD fstream file(uri_.value(), _STD ios::binary);
@@ -95,6 +116,16 @@ buffer::buffer(_STD string const& uri, _STD string const& name)
 buffer::buffer(_STD vector<char> &&data) : data_(_STD move(data)) {
 }
 
+buffer::buffer(SharedPtr<void const> owner, char *data, size const length)
+	: owner_(_STD move(owner)), borrowed_(data), borrowed_length_(length) {
+}
+
+buffer buffer::fallback(size const length) {
+	buffer result(_STD vector<char>(length));
+	result.fallback_ = true;
+	return result;
+}
+
 //
 //
 // MAIN ACTUAL PARSING IS BELOW!!
@@ -105,106 +136,228 @@ using namespace simdjson;
 _STD vector<_STD thread> gltf_worker_threads_;
 
 namespace {
-	accessor parse_accessor(ondemand::value &accessor) {
-		gltf::accessor a;
-		simdjson_result<ondemand::value> bv = accessor["bufferView"];
-		simdjson_result<ondemand::value> bo = accessor["byteOffset"];
-		simdjson_result<ondemand::value> ct = accessor["componentType"];
-		simdjson_result<ondemand::value> t = accessor["type"];
-		simdjson_result<ondemand::value> mn = accessor["min"];
-		simdjson_result<ondemand::value> max = accessor["max"];
-		simdjson_result<ondemand::value> cn = accessor["count"];
-
-		if (mn.has_value()) {
-			
+	void parse_accessor_type(gltf::accessor &a, _STD string_view const text) {
+		if (text.length() == 6) {
+			a.setType(type::scalar); // scalar is 6 letters lol, fun little way to optimize
+			return;
+		}
+		char const initial = text[0];
+		char const number = text[3];
+		switch (initial) {
+			case 'V': {
+				switch (number) {
+					case '2': {
+						a.setType(type::vec2);
+						break;
+					}
+					case '3': {
+						a.setType(type::vec3);
+						break;
+					}
+					case '4': {
+						a.setType(type::vec4);
+						break;
+					}
+					default:
+						break;
+				}
+				break;
+			}
+			case 'M': {
+				switch (number) {
+					case '2': {
+						a.setType(type::mat2);
+						break;
+					}
+					case '3': {
+						a.setType(type::mat3);
+						break;
+					}
+					case '4': {
+						a.setType(type::mat4);
+						break;
+					}
+					default: break;
+				}
+				break;
+			}
+			default: break;
 		}
+	}
 
-#ifdef GLTF_VERBOSE_DEBUG
-		gltfDebugPrintf("[Accessor] bufferView is valid %s", bv.has_value() ? "true" : "false");
-		gltfDebugPrintf("[Accessor] componentType: %s", ct.has_value() ? "true" : "false");
-		gltfDebugPrintf("[Accessor] type: %s", t.has_value() ? "true" : "false");
-#endif
-		
-		if (bv.has_value()) a.setBufferView(static_cast<id>(bv.get_int64().value()));
+	component_type parse_component_type(i64 const gl_type) {
+		switch (gl_type) {
+			case 5120: return component_type::signed_byte;
+			case 5121: return component_type::unsigned_byte;
+			case 5122: return component_type::signed_short;
+			case 5123: return component_type::unsigned_short;
+			case 5125: return component_type::unsigned_int;
+			case 5126: return component_type::single_float;
+			default: break;
+		}
+		gltfDebugPrintf("[Accessor] Unknown componentType %lld", gl_type);
+		return component_type::single_float;
+	}
 
-		if (bo.has_value()) a.setOffset(static_cast<size_t>(bo.get_int64().value()));
-		
-		if (ct.has_value()) {
-			switch(auto const ctv = ct.get_int64().value()) {
-				case 5126:
-					a.setComponentType(component_type::single_float);
+	accessor_sparse parse_accessor_sparse(ondemand::value &object) {
+		accessor_sparse sparse{};
+		for (simdjson_result field : object.get_object()) {
+			_STD string_view const key = field.unescaped_key().value();
+			ondemand::value value = field.value().value();
+			switch (hash(key)) {
+				case hash("count"):
+					sparse.count = value.get_uint64().value();
+					break;
+				case hash("indices"): {
+					for (simdjson_result index_field : value.get_object()) {
+						_STD string_view const index_key = index_field.unescaped_key().value();
+						ondemand::value index_value = index_field.value().value();
+						switch (hash(index_key)) {
+							case hash("bufferView"): sparse.indices_buffer_view = static_cast<id>(index_value.get_int64().value()); break;
+							case hash("byteOffset"): sparse.indices_offset = index_value.get_uint64().value(); break;
+							case hash("componentType"): sparse.indices_component_type = parse_component_type(index_value.get_int64().value()); break;
+							default: break;
+						}
+					}
 					break;
-				case 5125:
-					a.setComponentType(component_type::unsigned_short);
+				}
+				case hash("values"): {
+					for (simdjson_result values_field : value.get_object()) {
+						_STD string_view const values_key = values_field.unescaped_key().value();
+						ondemand::value values_value = values_field.value().value();
+						switch (hash(values_key)) {
+							case hash("bufferView"): sparse.values_buffer_view = static_cast<id>(values_value.get_int64().value()); break;
+							case hash("byteOffset"): sparse.values_offset = values_value.get_uint64().value(); break;
+							default: break;
+						}
+					}
 					break;
-				case 5121:
-					a.setComponentType(component_type::unsigned_byte);
+				}
+				default:
 					break;
-				default: break;
 			}
 		}
+		return sparse;
+	}
 
-		if (t.has_value()) {
-			if (_STD string_view const text = t.get_string().value(); text.length() == 6) {
-				a.setType(type::scalar); // scalar is 6 letters lol, fun little way to optimize
-			}
-			else {
-				char const initial = text[0];
-				char const number = text[3];
-				switch (initial) {
-					case 'V': {
-						switch (number) {
-							case '2': {
-								a.setType(type::vec2);
-								break;
-							}
-							case '3': {
-								a.setType(type::vec3);
-								break;
-							}
-							case '4': {
-								a.setType(type::vec4);
-								break;
-							}
-							default:
-								break;
-						}
-						break;
+	accessor parse_accessor(ondemand::value &accessor) {
+		gltf::accessor a;
+
+		// Walk the members in document order, ondemand values can't be revisited once we've moved past them.
+		for (simdjson_result field : accessor.get_object()) {
+			_STD string_view const key = field.unescaped_key().value();
+			ondemand::value value = field.value().value();
+			switch (hash(key)) {
+				case hash("bufferView"):
+					a.setBufferView(static_cast<id>(value.get_int64().value()));
+					break;
+				case hash("byteOffset"):
+					a.setOffset(static_cast<size_t>(value.get_int64().value()));
+					break;
+				case hash("componentType"):
+					a.setComponentType(parse_component_type(value.get_int64().value()));
+					break;
+				case hash("normalized"):
+					a.setNormalized(value.get_bool().value());
+					break;
+				case hash("sparse"):
+					a.setSparse(parse_accessor_sparse(value));
+					break;
+				case hash("type"):
+					parse_accessor_type(a, value.get_string().value());
+					break;
+				case hash("min"): {
+					_STD size_t i = 0;
+					for (simdjson_result component : value.get_array()) {
+						if (i < 16)
+							a.setMinComponent(i++, static_cast<number>(component.get_double().value()));
 					}
-					case 'M': {
-						switch (number) {
-							case '2': {
-								a.setType(type::mat2);
-								break;
-							}
-							case '3': {
-								a.setType(type::mat3);
-								break;
-							}
-							case '4': {
-								a.setType(type::mat4);
-								break;
-							}
-							default: break;
-						}
-						break;
+					break;
+				}
+				case hash("max"): {
+					_STD size_t i = 0;
+					for (simdjson_result component : value.get_array()) {
+						if (i < 16)
+							a.setMaxComponent(i++, static_cast<number>(component.get_double().value()));
 					}
-					default: break;
+					break;
 				}
+				case hash("count"):
+					a.setCount(static_cast<_STD uint32_t>(value.get_int64().value()));
+					break;
+				default:
+					break;
 			}
 		}
 
-		if (cn.has_value()) {
-			a.setCount(static_cast<_STD uint32_t>(cn.get_int64().value()));
-		}
+#ifdef GLTF_VERBOSE_DEBUG
+		gltfDebugPrintf("[Accessor] bufferView: %d", a.bufferView());
+		gltfDebugPrintf("[Accessor] componentType: %s", to_string(a.componentType()));
+		gltfDebugPrintf("[Accessor] type: %s", to_string(a.type()));
+#endif
 
 		return (a);
 	}
 
+	/* Decodes the payload of a `data:[<mime>];base64,<payload>` uri. */
+	Result<_STD vector<char>> decode_data_uri(_STD string_view const uri) {
+		_STD size_t const comma = uri.find(',');
+		if (comma == _STD string_view::npos || uri.substr(0, comma).find(";base64") == _STD string_view::npos)
+			return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+
+		constexpr auto sextet = [](char const c) -> i32 {
+			if (c >= 'A' && c <= 'Z') return c - 'A';
+			if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+			if (c >= '0' && c <= '9') return c - '0' + 52;
+			if (c == '+') return 62;
+			if (c == '/') return 63;
+			return -1;
+		};
+
+		_STD string_view const payload = uri.substr(comma + 1);
+		_STD vector<char> decoded;
+		decoded.reserve(payload.size() / 4 * 3);
+
+		u32 accumulator = 0;
+		i32 bits = 0;
+		for (char const c : payload) {
+			if (c == '=')
+				break;
+			i32 const value = sextet(c);
+			if (value < 0)
+				return { ERR_FILE_CORRUPT, __LINE__ };
+			accumulator = accumulator << 6 | static_cast<u32>(value);
+			bits += 6;
+			if (bits >= 8) {
+				bits -= 8;
+				decoded.push_back(static_cast<char>(accumulator >> bits & 0xFF));
+			}
+		}
+		return decoded;
+	}
+
 	buffer parse_buffer(_STD filesystem::path &root, ondemand::value &object) {
 		if (auto uri = object["uri"]; uri.has_value()) {
 			gltfDebugPrint("Buffer contains a uri, not inline data.");
 			auto const text = uri.get_string().value();
+
+			// Embedded buffers are the only ones that still get copied into a vector.
+			if (text.starts_with("data:")) {
+				Result<_STD vector<char>> decoded = decode_data_uri(text);
+				if (!decoded.has_value()) {
+					HELIX_ERR_PRINT("[glTF] Failed to decode a data: uri buffer (%d)", static_cast<int>(decoded.error()));
+					return {};
+				}
+				return { _STD move(decoded).value() };
+			}
+
+			// External files are mapped, resolveUri() picks the same file the .hlxscene cache hashes.
+			Result<SharedPtr<os::MappedFile>> mapped = os::MappedFile::open(resolveUri(root, text).string());
+			if (mapped.has_value()) {
+				SharedPtr<os::MappedFile> const file = mapped.value();
+				return { file, file->data(), static_cast<size>(file->size()) };
+			}
+
 			auto const chars = new char[text.length() + 1];
 			_STD memset(chars, 0, text.length() + 1);
 			text.copy(chars, text.length());
@@ -267,8 +420,13 @@ namespace {
 		
 			return {_STD move(data)};
 		}
-		else {
-			// TODO; this isnt common practice so just add it later.
+
+		// EXT_meshopt_compression fallbacks have no bytes of their own, they get storage for the decoded views instead.
+		if (auto extensions = object["extensions"]; extensions.has_value()) {
+			if (auto meshopt = extensions[ext::meshopt_compression::name]; meshopt.has_value() && ext::meshopt_compression::parse_ext_buffer_fallback(meshopt.value())) {
+				if (auto length = object["byteLength"]; length.has_value())
+					return buffer::fallback(length.get_uint64().value());
+			}
 		}
 		return {};
 	}
@@ -311,6 +469,11 @@ namespace {
 					buffer_view.stride = kv.value().get_uint64().value();
 					break;
 				}
+				case hash("extensions"): {
+					if (auto meshopt = kv.value()[ext::meshopt_compression::name]; meshopt.has_value())
+						buffer_view.extensions.EXT_meshopt_compression = ext::meshopt_compression::parse_ext_buffer_view(meshopt.value());
+					break;
+				}
 				default:
 					break;
 			}
@@ -383,7 +546,29 @@ namespace {
 
 
 
-static image parse_image(_STD filesystem::path &path, std::string uri) {
+namespace {
+	/* Caps the two halves of an image probe independently: reading files, and Basis transcoding. */
+	struct image_probe_limits {
+		Semaphore<> io;
+		Semaphore<> transcode;
+
+		explicit image_probe_limits(parse_options const &options)
+			: io(_STD max<_STD ptrdiff_t>(options.image_io_concurrency, 1))
+			, transcode(_STD max<_STD ptrdiff_t>(options.image_transcode_concurrency != 0 ? options.image_transcode_concurrency : _STD thread::hardware_concurrency(), 1)) {}
+	};
+
+	/* Holds one count of a semaphore for the enclosing scope. */
+	class semaphore_slot {
+		Semaphore<> &semaphore_;
+	public:
+		explicit semaphore_slot(Semaphore<> &semaphore) : semaphore_(semaphore) { semaphore_.acquire(); }
+		~semaphore_slot() { semaphore_.release(); }
+		semaphore_slot(semaphore_slot const &) = delete;
+		semaphore_slot &operator=(semaphore_slot const &) = delete;
+	};
+}
+
+static image parse_image(_STD filesystem::path const &path, std::string uri, image_probe_limits &limits) {
 		image image;
 		{
 #ifdef GLTF_THREADED_IMAGE_LOADING
@@ -402,10 +587,20 @@ static image parse_image(_STD filesystem::path &path, std::string uri) {
 
 			bool is_normal = uri.ends_with("ormal.png"); // Avoid case-sensitive errors.
 			
-			if (FILE *ktx_image = fopen(ktxPath.c_str(), "rb"); ktx_image != nullptr && !is_normal) {
-				HELIX_ASSUME(fclose(ktx_image) == 0); // we know it exists, but we will use libktx's file system
-				ktxTexture *ktx_texture;
-				ktxResult result = ktxTexture_CreateFromNamedFile(ktxPath.c_str(), 0, &ktx_texture);
+			bool ktx_found = false;
+			ktxTexture *ktx_texture = nullptr;
+			ktxResult result = KTX_FILE_OPEN_FAILED;
+			if (!is_normal) {
+				semaphore_slot const io_slot(limits.io);
+				if (FILE *ktx_image = fopen(ktxPath.c_str(), "rb"); ktx_image != nullptr) {
+					HELIX_ASSUME(fclose(ktx_image) == 0); // we know it exists, but we will use libktx's file system
+					ktx_found = true;
+					// Read the payload now, while holding the I/O slot, so the transcode below never waits on the disk.
+					result = ktxTexture_CreateFromNamedFile(ktxPath.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktx_texture);
+				}
+			}
+
+			if (ktx_found) {
 				if (result == KTX_SUCCESS) {
 					if (ktxTexture_NeedsTranscoding(ktx_texture)) {
 						if (ktx_texture->classId == ktxTexture2_c) {
@@ -424,6 +619,7 @@ static image parse_image(_STD filesystem::path &path, std::string uri) {
 									break;
 							}
 							
+							semaphore_slot const transcode_slot(limits.transcode);
 							result = ktxTexture2_TranscodeBasis((ktxTexture2*)ktx_texture, tf, 0);
 						}
 						assert(result == KTX_SUCCESS);
@@ -701,6 +897,9 @@ namespace  {
 			if (auto khr_lp = exts[khr::lights_punctual::name]; khr_lp.has_value()) {
 				node.extensions.KHR_lights_punctual = khr::lights_punctual::parse_ext_node(khr_lp.value());
 			}
+			if (auto instancing = exts[ext::mesh_gpu_instancing::name]; instancing.has_value()) {
+				node.extensions.EXT_mesh_gpu_instancing = ext::mesh_gpu_instancing::parse_ext_node(instancing.value());
+			}
 		}
 		
 		return node;
@@ -740,250 +939,675 @@ namespace  {
 	}
 }
 
-// #define GLTF_ASYNC
+namespace {
+	struct parse_context {
+		_STD filesystem::path const &path;
+		image_probe_limits &image_limits;
+		Vec<_STD future<void>> &image_probes; //< Joined once every top-level member has been parsed.
+		SharedPtr<void const> container; //< Keeps the whole .glb alive, only set for binary files.
+		_STD span<char> bin_chunk;
+	};
+
+	image parse_embedded_image(parse_context const &context, ondemand::value &object) {
+		image image{};
+		image.bufferView = object["bufferView"].get<id>();
+		if (auto mime_type_object = object["mimeType"]; mime_type_object.has_value())
+			image.mimeType = _STD string(mime_type_object.get_string().value());
+		if (auto name_object = object["name"]; name_object.has_value())
+			image.name = _STD string(name_object.get_string().value());
+
+		// Only PNG has a loader for now, anything else is left for the caller to skip.
+		image.image_type = image.mimeType == "image/png" ? image_type_png : image_type_generic;
+		image.hash_value = hash(context.path.string() + '#' + _STD to_string(image.bufferView));
+		image.compressed = false;
+		image.is_ktx2 = false;
+		image.is_dds = false;
+		return image;
+	}
 
-#ifdef GLTF_ASYNC
-#define GLTF_GetFuture(F) (F).get()
-#define GLTF_DefAsync(...) std::async(__VA_ARGS__)
-#else
-#define GLTF_GetFuture(F) (F)()
-#define GLTF_DefAsync(...) __VA_ARGS__
-#endif
+	/*
+	 * Parses a single top-level member of the glTF document into `gltf_data`.
+	 * Every array is counted up front so the destination vector only allocates once.
+	 */
+	void parse_root_member(data &gltf_data, parse_context const &context, u32 const key, ondemand::value value) {
+		switch (key) {
+			case hash("meshes"): {
+				auto meshes_array = value.get_array();
+				gltf_data.meshes.reserve(meshes_array.count_elements());
+				for (simdjson_result mesh_obj : meshes_array) {
+					assert(mesh_obj.has_value());
+					gltf_data.meshes.emplace_back(parse_meshes(mesh_obj.value()));
+				}
+				break;
+			}
+			case hash("images"): {
+				auto images_array = value.get_array();
+				gltf_data.images.resize(images_array.count_elements());
+				context.image_probes.reserve(gltf_data.images.size());
+				_STD size_t image_index = 0;
+				for (simdjson_result image_obj : images_array) {
+					assert(image_obj.has_value());
+					image &slot = gltf_data.images[image_index++];
+					if (auto uri_object = image_obj["uri"]; uri_object.has_value()) {
+						// Each probe writes straight into its own slot, so the order of completion doesn't matter.
+						context.image_probes.push_back(ThreadPool::singleton()->addTaskToQueue(
+							[&slot, &path = context.path, &limits = context.image_limits, uri = _STD string(uri_object.get_string().value())] {
+								slot = parse_image(path, uri, limits);
+								slot.source_uri = uri;
+							}));
+					}
+					else {
+						slot = parse_embedded_image(context, image_obj.value());
+					}
+				}
+				break;
+			}
+			case hash("textures"): {
+				auto textures_array = value.get_array();
+				gltf_data.textures.reserve(textures_array.count_elements());
+				for (simdjson_result texture_obj : textures_array) {
+					assert(texture_obj.has_value());
+					gltf_data.textures.emplace_back(parse_texture(texture_obj.value()));
+				}
+				break;
+			}
+			case hash("samplers"): {
+				auto samplers_array = value.get_array();
+				gltf_data.samplers.reserve(samplers_array.count_elements());
+				for (simdjson_result sampler_obj : samplers_array) {
+					assert(sampler_obj.has_value());
+					gltf_data.samplers.emplace_back(parse_sampler(sampler_obj.value()));
+				}
+				break;
+			}
+			case hash("materials"): {
+				auto materials_array = value.get_array();
+				gltf_data.materials.reserve(materials_array.count_elements());
+				for (simdjson_result mat_obj : materials_array) {
+					assert(mat_obj.has_value());
+					gltf_data.materials.emplace_back(parse_material(mat_obj.value()));
+				}
+				break;
+			}
+			case hash("nodes"): {
+				auto nodes_array = value.get_array();
+				gltf_data.nodes.reserve(nodes_array.count_elements());
+				for (simdjson_result node_obj : nodes_array) {
+					assert(node_obj.has_value());
+					gltf_data.nodes.emplace_back(parse_node(node_obj.value()));
+				}
+				break;
+			}
+			case hash("scenes"): {
+				auto scenes_array = value.get_array();
+				gltf_data.scenes.reserve(scenes_array.count_elements());
+				for (simdjson_result scene_obj : scenes_array) {
+					assert(scene_obj.has_value());
+					gltf_data.scenes.emplace_back(parse_scene(scene_obj.value()));
+				}
+				break;
+			}
+			case hash("scene"): {
+				gltf_data.scene = value.get<id>();
+				break;
+			}
+			case hash("skins"): {
+				auto skins_array = value.get_array();
+				gltf_data.skins.reserve(skins_array.count_elements());
+				for (simdjson_result skin_obj : skins_array) {
+					assert(skin_obj.has_value());
+					gltf_data.skins.emplace_back(parse_skin(skin_obj.value()));
+				}
+				break;
+			}
+			case hash("accessors"): {
+				auto accessors_array = value.get_array();
+				gltf_data.accessors.reserve(accessors_array.count_elements());
+				for (simdjson_result accessor : accessors_array) {
+					assert(accessor.has_value());
+					gltf_data.accessors.push_back(parse_accessor(accessor.value()));
+				}
+				break;
+			}
+			case hash("bufferViews"): {
+				auto buffer_views_array = value.get_array();
+				gltf_data.buffer_views.reserve(buffer_views_array.count_elements());
+				for (simdjson_result buffer_view : buffer_views_array) {
+					assert(buffer_view.has_value());
+					gltf_data.buffer_views.emplace_back(parse_buffer_view(buffer_view.value()));
+				}
+				break;
+			}
+			case hash("buffers"): {
+				auto buffers_array = value.get_array();
+				gltf_data.buffers.reserve(buffers_array.count_elements());
+				auto root_directory = context.path.parent_path();
+				for (simdjson_result buffer : buffers_array) {
+					assert(buffer.has_value());
+					// A .glb's first buffer has no uri and refers to the BIN chunk, which is borrowed as-is.
+					if (gltf_data.buffers.empty() && !context.bin_chunk.empty() && !buffer["uri"].has_value())
+						gltf_data.buffers.emplace_back(context.container, context.bin_chunk.data(), context.bin_chunk.size());
+					else
+						gltf_data.buffers.emplace_back(parse_buffer(root_directory, buffer.value()));
+				}
+				break;
+			}
+			case hash("extensionsRequired"): {
+				// Anything else changes how the document has to be read, it still gets imported but the result may be off.
+				for (simdjson_result extension : value.get_array()) {
+					_STD string_view const name = extension.get_string().value();
+					if (name != khr::lights_punctual::name && name != "KHR_mesh_quantization" && name != ext::meshopt_compression::name
+						&& name != ext::mesh_gpu_instancing::name)
+						HELIX_ERR_PRINT("[glTF] \"%s\" requires unsupported extension %.*s", context.path.string().c_str(), static_cast<int>(name.size()), name.data());
+				}
+				break;
+			}
+			case hash("extensions"): {
+				if (auto KHR_lights_punctual = value[khr::lights_punctual::name]; KHR_lights_punctual.has_value())
+					gltf_data.extensions.KHR_lights_punctual = khr::lights_punctual::parse_ext_global(KHR_lights_punctual.value());
+				break;
+			}
+			default:
+				// asset, extensionsUsed, extensionsRequired, animations, cameras, extras...
+				break;
+		}
+	}
 
-data gltf::parse(_STD string const& file_path, padded_string &&file) {
-	data gltf_data;
-	simdjson_result const json = _STD move(file);
+	constexpr u32 GLB_MAGIC = charsToType<u32>("glTF");
+	constexpr u32 GLB_CHUNK_JSON = charsToType<u32>("JSON");
+	constexpr u32 GLB_CHUNK_BIN = charsToType<u32>("BIN");
 
-	// Save the base directory of the file, this is applied to relative directories
-	//_STD cout << "PP: " << file_path << '\n';
-	_STD filesystem::path path(file_path);
+	struct glb_chunks {
+		_STD string_view json;
+		_STD span<char> bin;
+	};
 
-	gltf_data.path = path;
+	u32 read_u32(char const *bytes) {
+		u32 value;
+		_STD memcpy(&value, bytes, sizeof(u32));
+		return value;
+	}
 
-	auto load_mesh_promise = GLTF_DefAsync([&gltf_data, &json]() {
-		ondemand::parser parser;
+	bool is_glb(padded_string const &file) {
+		return file.size() >= 12 && read_u32(file.data()) == GLB_MAGIC;
+	}
 
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		ondemand::value meshes_obj = obj["meshes"].value();
-
-		for (
-			simdjson_result mesh_obj : meshes_obj
-			) {
-			assert(mesh_obj.has_value());
-			mesh mesh = parse_meshes(mesh_obj.value());
-			gltf_data.meshes.emplace_back(_STD move(mesh));
+	/* Splits a binary glTF container into its JSON and (optional) BIN chunk, nothing is copied. */
+	Error split_glb(padded_string &file, glb_chunks &chunks) {
+		_STD size_t const file_size = file.size();
+		u32 const version = read_u32(file.data() + 4);
+		u32 const declared_length = read_u32(file.data() + 8);
+		if (version != 2)
+			return ERR_FILE_UNRECOGNIZED;
+		if (declared_length > file_size)
+			return ERR_FILE_CORRUPT;
+
+		_STD size_t cursor = 12;
+		while (cursor + 8 <= declared_length) {
+			u32 const chunk_length = read_u32(file.data() + cursor);
+			u32 const chunk_type = read_u32(file.data() + cursor + 4);
+			cursor += 8;
+			if (cursor + chunk_length > declared_length)
+				return ERR_FILE_CORRUPT;
+
+			switch (chunk_type) {
+				case GLB_CHUNK_JSON:
+					chunks.json = _STD string_view(file.data() + cursor, chunk_length);
+					break;
+				case GLB_CHUNK_BIN:
+					if (chunks.bin.empty())
+						chunks.bin = _STD span<char>(file.data() + cursor, chunk_length);
+					break;
+				default: // Unknown chunks must be ignored.
+					break;
+			}
+			cursor += chunk_length;
 		}
-	});
 
-	auto load_images_promise = GLTF_DefAsync([&gltf_data, &json, &path]() {
-		ondemand::parser parser;
+		return chunks.json.empty() ? ERR_FILE_CORRUPT : OK;
+	}
 
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
+	/* Points every buffer view (and embedded image) at its bytes once all buffers are loaded. */
+	void resolve_buffer_views(data &gltf_data) {
+		for (buffer_view &view : gltf_data.buffer_views) {
+			if (static_cast<_STD size_t>(view.buffer) >= gltf_data.buffers.size())
+				continue;
+			buffer &owner = gltf_data.buffers[view.buffer];
+			if (view.offset + view.length > owner.length())
+				continue;
+			view.data = reinterpret_cast<u8 *>(owner.data().data()) + view.offset;
+		}
 
-		ondemand::value images_obj = obj["images"].value();
-		std::vector<std::future<image>> images_promise(gltf_data.images.size());
-		images images(images_obj.count_elements());
-		for (
-			simdjson_result image_obj : images_obj
-			) {
-			assert(image_obj.has_value());
-			//images_promise.push_back(GLTF_DefAsync([](_STD filesystem::path &path__, ondemand::value &object__) { return parse_image(path__, object__); }, path, image_obj.value()));
-			auto &image_object_valued = image_obj.value();
-			_STD string uri (image_object_valued["uri"].get_string().value().data(), image_object_valued["uri"].get_string()->length());  // NOLINT(bugprone-suspicious-stringview-data-usage)
-			images_promise.push_back(std::async([&path, uri](){ _STD string uri2 = uri; return parse_image(path, uri2); }));
+		for (image &image : gltf_data.images) {
+			if (image.bufferView < 0 || static_cast<_STD size_t>(image.bufferView) >= gltf_data.buffer_views.size())
+				continue;
+			buffer_view const &view = gltf_data.buffer_views[image.bufferView];
+			if (view.data != nullptr)
+				image.embedded = _STD span<u8 const>(view.data, view.length);
 		}
+	}
 
-		// gltfDebugPrintf("GLTF File has %llu images\n", gltf_data.images.size());
+	/*
+	 * EXT_meshopt_compression: every compressed view is decoded on the pool straight into its fallback buffer,
+	 * so accessors, uploads and the cook only ever see plain bufferViews. Views whose fallback buffer has real data are left alone.
+	 */
+	void decode_compressed_buffer_views(data &gltf_data) {
+		Vec<_STD future<void>> jobs;
+		for (buffer_view const &view : gltf_data.buffer_views) {
+			if (!view.extensions.EXT_meshopt_compression.has_value())
+				continue;
+			ext::meshopt_compression::buffer_view const &compressed = view.extensions.EXT_meshopt_compression.value();
+			if (static_cast<_STD size_t>(view.buffer) >= gltf_data.buffers.size() || static_cast<_STD size_t>(compressed.buffer) >= gltf_data.buffers.size())
+				continue;
+			buffer &target = gltf_data.buffers[view.buffer];
+			if (!target.isFallback())
+				continue;
+
+			buffer const &source = gltf_data.buffers[compressed.buffer];
+			size const decoded_size = compressed.count * compressed.stride;
+			if (compressed.offset + compressed.length > source.length() || decoded_size > view.length || view.offset + view.length > target.length()) {
+				HELIX_ERR_PRINT("[glTF] Compressed bufferView is out of bounds, it stays zeroed");
+				continue;
+			}
 
-		for (auto &i : images_promise) {
-			gltf_data.images.push_back(i.get());
+			_STD span<u8 const> const bytes(reinterpret_cast<u8 const *>(source.data().data()) + compressed.offset, compressed.length);
+			u8 *const destination = reinterpret_cast<u8 *>(target.data().data()) + view.offset;
+			jobs.push_back(ThreadPool::singleton()->addTaskToQueue([&compressed, bytes, destination] {
+				if (Error const error = ext::meshopt_compression::decode(compressed, bytes, destination); error != OK)
+					HELIX_ERR_PRINT("[glTF] Failed to decode a compressed bufferView (%d)", static_cast<int>(error));
+			}));
 		}
-	});
-
-	auto load_textures_promise = GLTF_DefAsync([&gltf_data, &json]() {
-		ondemand::parser parser;
+		for (auto &job : jobs)
+			job.get();
+	}
 
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		ondemand::value textures_obj = obj["textures"].value();
-		textures textures(textures_obj.count_elements());
-
-		for (
-			simdjson_result texture_obj : textures_obj
-		) {
-			assert(texture_obj.has_value());
-			texture texture = parse_texture(texture_obj.value());
-			gltf_data.textures.emplace_back(texture);
+#if GLTF_NARROW_INDICES
+	/*
+	 * Halves index bandwidth for most content: u32 index accessors whose largest index fits in 16 bits
+	 * are rewritten as u16 in place, at the start of their own range. The rewrite changes the bytes under the view,
+	 * so only views that no other accessor reads (sparse ones included) and that aren't vertex data get narrowed.
+	 * 0xFFFF is left alone in case primitive restart is ever turned on.
+	 */
+	void narrow_indices(data &gltf_data) {
+		Vec<bool> visited(gltf_data.accessors.size(), false);
+		Vec<u32> view_readers(gltf_data.buffer_views.size(), 0);
+		auto const read = [&view_readers](id const view) {
+			if (view >= 0 && static_cast<_STD size_t>(view) < view_readers.size())
+				view_readers[view]++;
+		};
+		for (accessor const &reader : gltf_data.accessors) {
+			if (reader.hasBufferView())
+				read(reader.bufferView());
+			if (reader.sparse().has_value()) {
+				read(reader.sparse()->indices_buffer_view);
+				read(reader.sparse()->values_buffer_view);
+			}
+		}
+		size narrowed_bytes = 0;
+
+		for (mesh const &mesh : gltf_data.meshes) {
+			for (primitive const &primitive : mesh.primitives) {
+				if (primitive.indices < 0 || visited[primitive.indices])
+					continue;
+				visited[primitive.indices] = true;
+
+				accessor &indices = gltf_data.accessors[primitive.indices];
+				if (indices.componentType() != component_type::unsigned_int || !indices.hasBufferView() || indices.sparse().has_value())
+					continue;
+
+				buffer_view const &view = gltf_data.buffer_views[indices.bufferView()];
+				if (view.data == nullptr || (view.stride != 0 && view.stride != sizeof(u32)))
+					continue;
+				if (view_readers[indices.bufferView()] != 1 || view.target == buffer_view_target::ARRAY)
+					continue;
+
+				u8 *const first = view.data + indices.offset();
+				size const count = indices.count();
+
+				u32 largest = 0;
+				for (size i = 0; i < count; i++) {
+					u32 index;
+					_STD memcpy(&index, first + i * sizeof(u32), sizeof(u32));
+					largest = largest > index ? largest : index;
+				}
+				if (largest >= 0xFFFFu)
+					continue;
+
+				// Front to back is safe, the u16 write for `i` never lands past the u32 read for `i`.
+				for (size i = 0; i < count; i++) {
+					u32 index;
+					_STD memcpy(&index, first + i * sizeof(u32), sizeof(u32));
+					u16 const narrow = static_cast<u16>(index);
+					_STD memcpy(first + i * sizeof(u16), &narrow, sizeof(u16));
+				}
+				indices.setComponentType(component_type::unsigned_short);
+				narrowed_bytes += count * (sizeof(u32) - sizeof(u16));
+			}
 		}
 
-		// gltfDebugPrintf("GLTF File has %llu textures\n", gltf_data.textures.size());
-		// return textures;
-	});
+		gltfDebugPrintf("Narrowed u32 indices to u16, %llu bytes of index data saved", narrowed_bytes);
+		(void)narrowed_bytes;
+	}
+#endif
+}
 
-	auto load_samplers_promise = GLTF_DefAsync([&gltf_data, &json]() {
-		ondemand::parser parser;
+data gltf::parse(_STD string const& file_path, padded_string &&file, parse_options const &options) {
+	data gltf_data;
+	SharedPtr<padded_string> const file_data = _STD make_shared<padded_string>(_STD move(file));
 
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		ondemand::value samplers_obj = obj["samplers"].value();
-		//samplers samplers(samplers_obj.count_elements());
-
-		for (
-			simdjson_result sampler_obj : samplers_obj
-		) {
-			assert(sampler_obj.has_value());
-			sampler sampler = parse_sampler(sampler_obj.value());
-			gltf_data.samplers.emplace_back(sampler);
+	// Save the base directory of the file, this is applied to relative directories
+	_STD filesystem::path path(file_path);
+
+	gltf_data.path = path;
+	gltf_data.scene = 0;
+
+	image_probe_limits image_limits(options);
+	Vec<_STD future<void>> image_probes;
+	parse_context context{ .path = path, .image_limits = image_limits, .image_probes = image_probes };
+	padded_string_view json(file_data->data(), file_data->size(), file_data->size() + SIMDJSON_PADDING);
+
+	if (is_glb(*file_data)) {
+		glb_chunks chunks;
+		if (Error const error = split_glb(*file_data, chunks); error != OK) {
+			HELIX_ERR_PRINT("[glTF] \"%s\" is not a valid GLB container (%d)", file_path.c_str(), static_cast<int>(error));
+			return gltf_data;
 		}
 
-		// gltfDebugPrintf("GLTF File has %llu samplers\n", gltf_data.samplers.size());
-		// return samplers;
-	});
+		// The JSON chunk is parsed in place, whatever follows it (BIN chunk, then the padding) stands in for simdjson's padding.
+		_STD size_t const json_offset = chunks.json.data() - file_data->data();
+		json = padded_string_view(chunks.json.data(), chunks.json.size(), file_data->size() + SIMDJSON_PADDING - json_offset);
+		context.container = file_data;
+		context.bin_chunk = chunks.bin;
+	}
 
-	auto load_materials_promise = GLTF_DefAsync([&gltf_data, &json]() {
-		ondemand::parser parser;
+	// One tokenization of the document, top-level members are dispatched as they are met.
+	ondemand::parser parser;
+	ondemand::document doc = parser.iterate(json);
+	for (simdjson_result member : doc.get_object()) {
+		_STD string_view const key = member.unescaped_key().value();
+		parse_root_member(gltf_data, context, hash(key), member.value().value());
+	}
+	// The probes write into gltf_data.images, which nothing after "images" resizes.
+	for (auto &probe : image_probes)
+		probe.get();
+
+	resolve_buffer_views(gltf_data);
+	decode_compressed_buffer_views(gltf_data);
+#if GLTF_NARROW_INDICES
+	narrow_indices(gltf_data);
+#endif
+	
+	gltfDebugPrint("-- GLTF DUMP --");
+	gltfDebugPrintf("Mesh count: %llu", gltf_data.meshes.size());
+	gltfDebugPrintf("Material count: %llu", gltf_data.materials.size());
+	gltfDebugPrintf("Node count: %llu", gltf_data.nodes.size());
+	gltfDebugPrintf("Scene count: %llu", gltf_data.scenes.size());
+	gltfDebugPrintf("Skin count: %llu", gltf_data.skins.size());
+	gltfDebugPrintf("Accessor count: %llu", gltf_data.accessors.size());
+	gltfDebugPrintf("Buffer view count: %llu", gltf_data.buffer_views.size());
+	gltfDebugPrintf("Buffer count: %llu", gltf_data.buffers.size());
+	gltfDebugPrintf("Texture count: %llu", gltf_data.textures.size());
 
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		ondemand::value materials_obj = obj["materials"].value();
+	return gltf_data;
+}
 
-		for (simdjson_result mat_obj : materials_obj) {
-			assert(mat_obj.has_value());
-			material mat = parse_material(mat_obj.value());
-			gltf_data.materials.emplace_back(_STD move(mat));
-		}
-	});
+_STD filesystem::path gltf::resolveUri(_STD filesystem::path const &document_directory, _STD string_view const uri) {
+	_STD filesystem::path const working_relative(uri);
+	if (_STD filesystem::exists(working_relative))
+		return working_relative;
+	return document_directory / uri;
+}
 
-	auto load_nodes_promise = GLTF_DefAsync([&gltf_data, &json]() {
-		ondemand::parser parser;
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		ondemand::value nodes_obj = obj["nodes"].value();
-		std::vector<node> nodes(nodes_obj.count_elements());
-		for (simdjson_result node_obj : nodes_obj) {
-			assert(node_obj.has_value());
-			node node = parse_node(node_obj.value());
-			gltf_data.nodes.push_back(node);
+void gltf::probeImages(_STD filesystem::path const &file_path, _STD span<image> images, parse_options const &options) {
+	image_probe_limits limits(options);
+	Vec<_STD future<void>> image_probes;
+	image_probes.reserve(images.size());
+	for (image &slot : images) {
+		if (slot.source_uri.empty())
+			continue;
+		image_probes.push_back(ThreadPool::singleton()->addTaskToQueue([&slot, &file_path, &limits] {
+			_STD string uri = _STD move(slot.source_uri);
+			slot = parse_image(file_path, uri, limits);
+			slot.source_uri = _STD move(uri);
+		}));
+	}
+	for (auto &probe : image_probes)
+		probe.get();
+}
+
+#if BENCHMARKS_ENABLED
+
+#include "gltf/accessor_view.hpp"
+
+int gltf::benchmarkParse(Vec<_STD string_view> const &p_args) {
+	_STD string const file_path = bench::argument(p_args, 0, bench::DEFAULT_SCENE);
+	u32 const iterations = bench::numberArgument(p_args, 1, 10);
+
+	Optional<padded_string> const loaded = bench::loadJson(file_path);
+	if (!loaded)
+		return -1;
+	padded_string const &json = *loaded;
+
+	_STD filesystem::path const path(file_path);
+	image_probe_limits image_limits(parse_options{});
+	Vec<_STD future<void>> image_probes;
+	parse_context const context{ .path = path, .image_limits = image_limits, .image_probes = image_probes };
+
+	// The previous importer: a fresh parser and a full iterate() for every top-level member.
+	bench::measure("gltf parse (pass per member)", iterations, [&] {
+		data gltf_data;
+		gltf_data.path = path;
+		constexpr _STD string_view members[] = {
+			"meshes", "images", "textures", "samplers", "materials", "nodes",
+			"scenes", "scene", "skins", "accessors", "bufferViews", "buffers", "extensions"
+		};
+		for (_STD string_view const member : members) {
+			ondemand::parser parser;
+			ondemand::document doc = parser.iterate(json);
+			auto obj = doc.get_object();
+			if (auto value = obj[member]; value.has_value())
+				parse_root_member(gltf_data, context, hash(member), value.value());
 		}
+		for (auto &probe : image_probes)
+			probe.get();
+		image_probes.clear();
 	});
 
-	auto load_scenes_promise = GLTF_DefAsync([&gltf_data, &json]() {
-		ondemand::parser parser;
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		ondemand::value scenes_obj = obj["scenes"].value();
-		for (simdjson_result scene_obj : scenes_obj) {
-			assert(scene_obj.has_value());
-			scene scene = parse_scene(scene_obj.value());
-			gltf_data.scenes.push_back(scene);
-		}
-		ondemand::value scene_id = obj["scene"].value();
-		gltf_data.scene = scene_id.get<id>();
+	bench::measure("gltf parse (single pass)", iterations, [&] {
+		data gltf_data = parse(file_path, padded_string(json.data(), json.size()));
+		(void)gltf_data;
 	});
 
-	auto load_skins_promise = GLTF_DefAsync([&gltf_data, &json]() {
-		ondemand::parser parser;
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		auto skins_result_obj = obj["skins"];
-		if (!skins_result_obj.has_value())
-			return;
+	return 0;
+}
 
-		ondemand::value skins_obj = skins_result_obj.value();
-		//gltf::skins sk(skins_obj.count_elements());
-		for (simdjson_result skin_obj : skins_obj) {
-			assert(skin_obj.has_value());
-			skin skin = parse_skin(skin_obj.value());
-			gltf_data.skins.push_back(skin);
-			//sk.emplace_back(skin);
-		}
-	});
-	
-	auto load_accessors_promise = GLTF_DefAsync([&gltf_data, &json]() {
+int gltf::benchmarkBufferMemory(Vec<_STD string_view> const &p_args) {
+	_STD string const file_path = bench::argument(p_args, 0, bench::DEFAULT_SCENE);
+
+	Optional<padded_string> json = bench::loadJson(file_path);
+	if (!json)
+		return -1;
+
+	os::memory_usage const before = os::memoryUsage();
+	data const gltf_data = parse(file_path, _STD move(*json));
+	os::memory_usage const parsed = os::memoryUsage();
+
+	// Touch one byte per page of every buffer, the same pages the mesh importer will end up reading.
+	u64 checksum = 0;
+	u64 buffer_bytes = 0;
+	for (buffer const &b : gltf_data.buffers) {
+		for (size i = 0; i < b.length(); i += 4096)
+			checksum += static_cast<u8>(b[i]);
+		buffer_bytes += b.length();
+	}
+	os::memory_usage const touched = os::memoryUsage();
+
+	constexpr f64 MB = 1024.0 * 1024.0;
+	printf("[bench] %llu buffer(s), %.1f MB of buffer data (checksum %llu)\n", static_cast<unsigned long long>(gltf_data.buffers.size()), static_cast<f64>(buffer_bytes) / MB, static_cast<unsigned long long>(checksum));
+	printf("[bench] resident : %+.1f MB after parse, %+.1f MB after touching buffers\n",
+		(static_cast<f64>(parsed.resident) - static_cast<f64>(before.resident)) / MB,
+		(static_cast<f64>(touched.resident) - static_cast<f64>(before.resident)) / MB);
+#ifdef _WIN32
+	// Commit is charged for whole copy-on-write views as soon as they're mapped, so it matches a copy here, it isn't physical memory.
+	printf("[bench] commit   : %+.1f MB after parse, %+.1f MB after touching buffers (reading them would commit %.1f MB too)\n",
+#else
+	printf("[bench] private  : %+.1f MB after parse, %+.1f MB after touching buffers (copying the buffers would add %.1f MB)\n",
+#endif
+		(static_cast<f64>(parsed.private_committed) - static_cast<f64>(before.private_committed)) / MB,
+		(static_cast<f64>(touched.private_committed) - static_cast<f64>(before.private_committed)) / MB,
+		static_cast<f64>(buffer_bytes) / MB);
+	return 0;
+}
+
+int gltf::benchmarkImageProbing(Vec<_STD string_view> const &p_args) {
+	_STD string const file_path = bench::argument(p_args, 0, bench::DEFAULT_SCENE);
+	u32 const iterations = bench::numberArgument(p_args, 1, 10);
+
+	Optional<padded_string> const json = bench::loadJson(file_path);
+	if (!json)
+		return -1;
+
+	Vec<_STD string> uris;
+	{
 		ondemand::parser parser;
-		ondemand::document doc = parser.iterate(json);
+		ondemand::document doc = parser.iterate(*json);
 		auto obj = doc.get_object();
-		ondemand::value accessors = obj["accessors"].value();
-		for (
-			simdjson_result accessor : accessors
-		) {
-			assert(accessor.has_value());
-			gltf::accessor a = parse_accessor(accessor.value());
-			//_STD cout << "buffer view " << a.bufferView() << '\n' << "type " << to_string(a.type()) << '\n' << "comp type " << to_string(a.componentType()) << '\n' << "count " << a.count() << '\n' << '\n';
-			gltf_data.accessors.push_back(a);
+		if (auto images_array = obj["images"]; images_array.has_value()) {
+			for (simdjson_result image_obj : images_array.get_array()) {
+				if (auto uri_object = image_obj["uri"]; uri_object.has_value())
+					uris.emplace_back(uri_object.get_string().value());
+			}
+		}
+	}
+	printf("[bench] %llu external image(s)\n", static_cast<unsigned long long>(uris.size()));
+
+	_STD filesystem::path const path(file_path);
+	Vec<image> images(uris.size());
+	auto const release_images = [&images] {
+		for (image &i : images) {
+			if (i.is_ktx2 && i.ktx2_texture != nullptr)
+				ktxTexture_Destroy(i.ktx2_texture);
+			i = image{};
 		}
+	};
+
+	// The previous importer: one std::async per image, nothing bounding I/O or transcoding.
+	parse_options unbounded;
+	unbounded.image_io_concurrency = static_cast<u32>(_STD max<_STD size_t>(uris.size(), 1));
+	unbounded.image_transcode_concurrency = unbounded.image_io_concurrency;
+	image_probe_limits unbounded_limits(unbounded);
+	bench::measure("image probe (std::async each)", iterations, [&] {
+		Vec<_STD future<void>> probes;
+		probes.reserve(uris.size());
+		for (_STD size_t i = 0; i < uris.size(); i++)
+			probes.push_back(_STD async(_STD launch::async, [&, i] { images[i] = parse_image(path, uris[i], unbounded_limits); }));
+		for (auto &probe : probes)
+			probe.get();
+		release_images();
 	});
 
-	auto load_buffer_views_promise = GLTF_DefAsync([&gltf_data, &json]() {
-		ondemand::parser parser;
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		ondemand::array buffer_views = obj["bufferViews"].get_array().value();
-		for (
-			simdjson_result buffer_view : buffer_views
-		) {
-			assert(buffer_view.has_value());
-			gltf::buffer_view view = parse_buffer_view(buffer_view.value());
-			gltf_data.buffer_views.emplace_back(view);
-		}
+	image_probe_limits pooled_limits(parse_options{});
+	bench::measure("image probe (pooled, bounded)", iterations, [&] {
+		Vec<_STD future<void>> probes;
+		probes.reserve(uris.size());
+		for (_STD size_t i = 0; i < uris.size(); i++)
+			probes.push_back(ThreadPool::singleton()->addTaskToQueue([&, i] { images[i] = parse_image(path, uris[i], pooled_limits); }));
+		for (auto &probe : probes)
+			probe.get();
+		release_images();
 	});
 
-	auto load_buffers_promise = GLTF_DefAsync([&gltf_data, &json, path]() {
-		ondemand::parser parser;
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		for (
-			ondemand::value buffers = obj["buffers"].value();
-			simdjson_result buffer : buffers
-			) {
-			assert(buffer.has_value());
-			auto root_directory = path.parent_path();
-			gltf::buffer buf = parse_buffer(root_directory, buffer.value());
-			gltf_data.buffers.emplace_back(_STD move(buf));
-		}
+	return 0;
+}
 
-		// print num of buffers
-		// gltfDebugPrintf("GLTF File has %llu buffer(s)", gltf_data.buffers.size());
-	});
+int gltf::benchmarkMeshoptDecode(Vec<_STD string_view> const &p_args) {
+	_STD string const file_path = bench::argument(p_args, 0, "test-resources\\sponza-meshopt\\Sponza.glb");
+	_STD string const reference_path = bench::argument(p_args, 1);
+	u32 const iterations = bench::numberArgument(p_args, 2, 10);
+
+	Optional<data> const loaded = bench::loadScene(file_path);
+	if (!loaded)
+		return -1;
+	data const &gltf_data = *loaded;
+
+	struct compressed_view {
+		ext::meshopt_compression::buffer_view const *view;
+		_STD span<u8 const> bytes;
+		Vec<u8> scalar, simd;
+	};
+	Vec<compressed_view> views;
+	size compressed_bytes = 0, decoded_bytes = 0;
+	for (buffer_view const &view : gltf_data.buffer_views) {
+		if (!view.extensions.EXT_meshopt_compression.has_value())
+			continue;
+		ext::meshopt_compression::buffer_view const &compressed = view.extensions.EXT_meshopt_compression.value();
+		buffer const &source = gltf_data.buffers[compressed.buffer];
+		size const decoded_size = compressed.count * compressed.stride;
+		views.push_back({
+			.view = &compressed,
+			.bytes = { reinterpret_cast<u8 const *>(source.data().data()) + compressed.offset, compressed.length },
+			.scalar = Vec<u8>(decoded_size),
+			.simd = Vec<u8>(decoded_size)
+		});
+		compressed_bytes += compressed.length;
+		decoded_bytes += decoded_size;
+	}
+	constexpr f64 MB = 1024.0 * 1024.0;
+	printf("[bench] %llu compressed view(s), %.2f MB -> %.2f MB\n", static_cast<unsigned long long>(views.size()),
+		static_cast<f64>(compressed_bytes) / MB, static_cast<f64>(decoded_bytes) / MB);
+
+	u64 failures = 0;
+	for (bool const simd : { false, true }) {
+		bench::Timing const timing = bench::measure(simd ? "meshopt decode (simd)" : "meshopt decode (scalar)", iterations, [&] {
+			for (compressed_view &v : views)
+				failures += ext::meshopt_compression::decode(*v.view, v.bytes, (simd ? v.simd : v.scalar).data(), simd) != OK ? 1 : 0;
+		});
+		printf("[bench] %-32s %.0f MB/s decoded (median)\n", simd ? "simd" : "scalar", static_cast<f64>(decoded_bytes) / MB / (timing.median_ms / 1000.0));
+	}
+	for (compressed_view const &v : views)
+		failures += v.scalar != v.simd ? 1 : 0;
+	printf("[bench] %llu decode failure(s) or scalar/simd mismatch(es)\n", static_cast<unsigned long long>(failures));
+
+	if (!reference_path.empty()) {
+		Optional<data> const loaded_reference = bench::loadScene(reference_path);
+		if (!loaded_reference)
+			return -1;
+		data const &reference = *loaded_reference;
+		if (reference.accessors.size() != gltf_data.accessors.size()) {
+			fprintf(stderr, "[bench] \"%s\" has %llu accessors, expected %llu\n", reference_path.c_str(),
+				static_cast<unsigned long long>(reference.accessors.size()), static_cast<unsigned long long>(gltf_data.accessors.size()));
+			return 1;
+		}
 
-	auto load_KHR_lights_punctual = GLTF_DefAsync([&gltf_data, &json, path]() -> std::optional<khr::lights_punctual::global> {
-		ondemand::parser parser;
-		ondemand::document doc = parser.iterate(json);
-		auto obj = doc.get_object();
-		if (auto extensions = obj["extensions"]; extensions.has_value()) {
-			if (auto KHR_lights_punctual = extensions[khr::lights_punctual::name]; KHR_lights_punctual.has_value()) {
-				return khr::lights_punctual::parse_ext_global(KHR_lights_punctual.value());
+		// Unfiltered views are lossless, filtered ones are only as exact as the filter's encoding.
+		u64 compared = 0, mismatches = 0;
+		for (size a = 0; a < gltf_data.accessors.size(); a++) {
+			accessor const &decoded_accessor = gltf_data.accessors[a];
+			if (!decoded_accessor.hasBufferView())
+				continue;
+			auto const &compressed = gltf_data.buffer_views[decoded_accessor.bufferView()].extensions.EXT_meshopt_compression;
+			if (!compressed.has_value())
+				continue;
+			f32 const tolerance = compressed->filter == ext::meshopt_compression::filter::none ? 0.0f : 0.02f;
+			AccessorView<vec4> const decoded_values(gltf_data, decoded_accessor);
+			AccessorView<vec4> const reference_values(reference, reference.accessors[a]);
+			if (decoded_values.size() != reference_values.size()) {
+				mismatches++;
+				continue;
 			}
+			for (size i = 0; i < decoded_values.size(); i++) {
+				vec4 const d = glm::abs(decoded_values[i] - reference_values[i]);
+				vec4 const limit = tolerance * glm::max(glm::abs(reference_values[i]), vec4(1.0f));
+				mismatches += glm::any(glm::greaterThan(d, limit)) ? 1 : 0;
+			}
+			compared++;
 		}
-		return std::nullopt;
-	});
+		printf("[bench] %llu accessor(s) checked against \"%s\", %llu mismatching element(s)\n",
+			static_cast<unsigned long long>(compared), reference_path.c_str(), static_cast<unsigned long long>(mismatches));
+		failures += mismatches;
+	}
 
-	GLTF_GetFuture(load_mesh_promise);
-	GLTF_GetFuture(load_images_promise);
-	GLTF_GetFuture(load_textures_promise);
-	GLTF_GetFuture(load_samplers_promise);
-	GLTF_GetFuture(load_materials_promise);
-	GLTF_GetFuture(load_nodes_promise);
-	GLTF_GetFuture(load_scenes_promise);
-	GLTF_GetFuture(load_skins_promise);
-	GLTF_GetFuture(load_accessors_promise);
-	GLTF_GetFuture(load_buffer_views_promise);
-	GLTF_GetFuture(load_buffers_promise);
-	// EXTENSIONS
-	gltf_data.extensions.KHR_lights_punctual = GLTF_GetFuture(load_KHR_lights_punctual);
-	
-	gltfDebugPrint("-- GLTF DUMP --");
-	gltfDebugPrintf("Mesh count: %llu", gltf_data.meshes.size());
-	gltfDebugPrintf("Material count: %llu", gltf_data.materials.size());
-	gltfDebugPrintf("Node count: %llu", gltf_data.nodes.size());
-	gltfDebugPrintf("Scene count: %llu", gltf_data.scenes.size());
-	gltfDebugPrintf("Skin count: %llu", gltf_data.skins.size());
-	gltfDebugPrintf("Accessor count: %llu", gltf_data.accessors.size());
-	gltfDebugPrintf("Buffer view count: %llu", gltf_data.buffer_views.size());
-	gltfDebugPrintf("Buffer count: %llu", gltf_data.buffers.size());
-	gltfDebugPrintf("Texture count: %llu", gltf_data.textures.size());
+	return failures == 0 ? 0 : 1;
+}
 
-	return gltf_data;
-}
\ No newline at end of file
+#endif
@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <span>
 #include <variant>
 #include <future>
 
@@ -18,6 +19,12 @@
 
 #define GLTF_DEBUG 0
 
+/* Rewrites u32 index accessors as u16 at import whenever every index fits. */
+#define GLTF_NARROW_INDICES 1
+
+/* Default number of image probes allowed to hit the disk at once, see gltf::parse_options. */
+#define GLTF_IMAGE_IO_CONCURRENCY 4
+
 class Material;
 namespace gl {
 	enum class TextureMagFilter : enum_t;
@@ -42,7 +49,10 @@ namespace gl {
 
 #include "types.hpp"
 #include "simdjson/simdjson.h"
+#include "engine/benchmark.hpp"
 #include "gltf/KHR_lights_punctual.hpp"
+#include "gltf/EXT_mesh_gpu_instancing.hpp"
+#include "gltf/EXT_meshopt_compression.hpp"
 
 namespace gltf {
 	#ifdef GLTF_NUMBER_IS_DOUBLE
@@ -59,6 +69,7 @@ namespace gltf {
 		unsigned_byte,
 		signed_short,
 		unsigned_short,
+		unsigned_int,
 		single_float
 	};
 	constexpr char const *to_string(component_type e) {
@@ -67,6 +78,7 @@ namespace gltf {
 			case component_type::unsigned_byte: return "unsigned_byte";
 			case component_type::signed_short: return "signed_short";
 			case component_type::unsigned_short: return "unsigned_short";
+			case component_type::unsigned_int: return "unsigned_int";
 			case component_type::single_float: return "single_float";
 		}
 		return "unknown"; // <--- stupid shit to shut up the ide
@@ -78,6 +90,7 @@ namespace gltf {
 			case component_type::unsigned_byte: return GL_UNSIGNED_BYTE;
 			case component_type::signed_short: return GL_SHORT;
 			case component_type::unsigned_short: return GL_UNSIGNED_SHORT;
+			case component_type::unsigned_int: return GL_UNSIGNED_INT;
 			case component_type::single_float: return GL_FLOAT;
 		}
 		return GL_NONE;
@@ -112,6 +125,7 @@ namespace gltf {
 			case component_type::unsigned_byte: return sizeof(u8);
 			case component_type::signed_short: return sizeof(i16);
 			case component_type::unsigned_short: return sizeof(u16);
+			case component_type::unsigned_int: return sizeof(u32);
 			case component_type::single_float: return sizeof(number);
 		}
 		return sizeof(number);
@@ -123,6 +137,7 @@ namespace gltf {
 			case component_type::unsigned_byte: return EComponentType::UNSIGNED_BYTE;
 			case component_type::signed_short: return EComponentType::SIGNED_SHORT;
 			case component_type::unsigned_short: return EComponentType::UNSIGNED_SHORT;
+			case component_type::unsigned_int: return EComponentType::UNSIGNED_INT;
 			case component_type::single_float: return EComponentType::SINGLE_FLOAT;
 		}
 		return EComponentType::SINGLE_FLOAT;
@@ -155,6 +170,16 @@ namespace gltf {
 	/**
 	 * 
 	 */
+	/* Sparse storage: `count` elements at the listed indices replace the ones from the base bufferView (or zeros). */
+	struct accessor_sparse {
+		size count = 0u;
+		id indices_buffer_view = -1;
+		size indices_offset = 0u;
+		component_type indices_component_type = component_type::unsigned_int;
+		id values_buffer_view = -1;
+		size values_offset = 0u;
+	};
+
 	class accessor : public CGltfProperty {
 	public:
 
@@ -185,16 +210,31 @@ namespace gltf {
 		void setMin(_STD array<GLTF_NUMBER, 16> const& p_min);
 		void setMinComponent(_STD size_t p_index, GLTF_NUMBER p_value);
 		[[nodiscard]] _STD array<GLTF_NUMBER, 16> const& min() const;
+
+		/* min/max are optional in the spec, except for POSITION where most exporters write them anyway. */
+		[[nodiscard]] bool hasBounds() const;
+
+		void setNormalized(bool p_normalized);
+		[[nodiscard]] bool normalized() const;
+
+		void setSparse(accessor_sparse const& p_sparse);
+		[[nodiscard]] _STD optional<accessor_sparse> const& sparse() const;
+
+		/* Sparse accessors may leave out the bufferView, every element then starts out as zero. */
+		[[nodiscard]] bool hasBufferView() const;
 	
 	private:
 		component_type component_type_ = component_type::signed_byte;
 		gltf::type type_ = type::scalar;
-		_STD array<GLTF_NUMBER, 16> max_;
-		_STD array<GLTF_NUMBER, 16> min_;
-		id buffer_view_ = 0u;
+		_STD array<GLTF_NUMBER, 16> max_{};
+		_STD array<GLTF_NUMBER, 16> min_{};
+		bool has_max_ = false;
+		bool has_min_ = false;
+		id buffer_view_ = -1;
 		size offset_ = 0u;
 		size count_ = 0u;
 		bool normalized_ = false;
+		_STD optional<accessor_sparse> sparse_;
 	};
 	
 	constexpr size_t accessor::stride() const {
@@ -222,21 +262,30 @@ namespace gltf {
 		buffer() = default;
 		buffer(_STD string const& uri, _STD string const& name);
 		buffer(_STD vector<char> &&data);
+		/* Borrows `length` bytes at `data` without copying them, `owner` keeps that memory alive (e.g. the BIN chunk of a .glb). */
+		buffer(SharedPtr<void const> owner, char *data, size length);
+		/* An EXT_meshopt_compression fallback buffer without a uri, `length` zeroed bytes its compressed views decode into. */
+		static buffer fallback(size length);
 
-		[[nodiscard]] constexpr char const& operator[](_STD size_t const index) const {
-			return data_[index];
+		[[nodiscard]] char const& operator[](_STD size_t const index) const {
+			return data()[index];
 		}
 
-		[[nodiscard]] constexpr size length() const { return data_.size(); }
+		[[nodiscard]] size length() const { return owner_ ? borrowed_length_ : data_.size(); }
 
-		inline _STD vector<char> const& data() const { return data_; }
-		inline _STD vector<char>& data() { return data_; }
+		inline _STD span<char const> data() const { return owner_ ? _STD span<char const>(borrowed_, borrowed_length_) : _STD span<char const>(data_); }
+		inline _STD span<char> data() { return owner_ ? _STD span<char>(borrowed_, borrowed_length_) : _STD span<char>(data_); }
 		inline _STD string uri() const noexcept { return uri_.value_or(""); }
 		inline _STD string name() const noexcept { return name_.value_or(""); }
+		[[nodiscard]] bool isFallback() const { return fallback_; }
 	
 	private:
 		_STD vector<char> data_;
+		SharedPtr<void const> owner_;
+		char *borrowed_ = nullptr;
+		size borrowed_length_ = 0u;
 		_STD optional<_STD string> uri_, name_;
+		bool fallback_ = false;
 	};
 
 	enum class buffer_view_target : _STD uint16_t {
@@ -249,7 +298,11 @@ namespace gltf {
 		id buffer = 0;
 		size length = 0u, offset = 0u, stride = 0u;
 		_STD optional<buffer_view_target> target = _STD nullopt;
-		_STD uint8_t *data = nullptr;
+		_STD uint8_t *data = nullptr; //< Resolved once parsing is done, points into the owning buffer's storage.
+
+		struct {
+			_STD optional<ext::meshopt_compression::buffer_view> EXT_meshopt_compression; //< Decoded into `buffer` by parse().
+		} extensions;
 	};
 
 	struct camera_orthographic {
@@ -309,8 +362,10 @@ namespace gltf {
 		_STD string mimeType;
 		image_type image_type;
 		_STD string uri; //< If this is empty, check bufferView!
+		_STD string source_uri; //< `uri` exactly as the document wrote it, `uri` itself may have been resolved against the file.
 		id channels; //< Not a part of the glTF spec, but is used to share the information from assembling buffers & images to the gpu alloc stage.
-		id bufferView; //< Ensure that URI is unused!
+		id bufferView = -1; //< Ensure that URI is unused!
+		_STD span<u8 const> embedded; //< Encoded image bytes when `bufferView` is used, borrowed from the buffer.
 		u32 hash_value;
 		bool compressed;
 		glm::ivec2 size;
@@ -379,6 +434,7 @@ namespace gltf {
 
 		struct {
 			_STD optional<khr::lights_punctual::node> KHR_lights_punctual;
+			_STD optional<ext::mesh_gpu_instancing::node> EXT_mesh_gpu_instancing;
 		} extensions;
 	};
 
@@ -474,22 +530,20 @@ namespace gltf {
 
 		[[nodiscard]] u32 accessor_count(i32 const accessorIndex) const { return accessors[accessorIndex].count(); }
 
+		/* Raw element access for accessors whose storage is exactly T. Prefer AccessorView (gltf/accessor_view.hpp) for anything else. */
 		template <typename T>
 		[[nodiscard]] T *make_cursor(i32 const accessorIndex, i32 const valueIndex) {
 			accessor & acc = accessors[accessorIndex];
 			buffer_view & bv = buffer_views[acc.bufferView()];
 			buffer & buf = buffers[bv.buffer];
 			assert(buf.length() >= bv.offset + bv.length);
-			return &reinterpret_cast<T *>(buf.data().data() + bv.offset + acc.offset())[valueIndex];
+			size const stride = bv.stride != 0u ? bv.stride : sizeof(T);
+			return reinterpret_cast<T *>(buf.data().data() + bv.offset + acc.offset() + stride * valueIndex);
 		}
 
 		template <typename T>
 		[[nodiscard]] T const &read_accessor(i32 const accessorIndex, i32 const valueIndex) {
-			accessor & acc = accessors[accessorIndex];
-			buffer_view & bv = buffer_views[acc.bufferView()];
-			buffer & buf = buffers[bv.buffer];
-			assert(buf.length() >= bv.offset + bv.length);
-			return reinterpret_cast<T *>(buf.data().data() + bv.offset + acc.offset())[valueIndex];
+			return *make_cursor<T>(accessorIndex, valueIndex);
 		}
 	};
 
@@ -497,5 +551,43 @@ namespace gltf {
 		_STD fstream file;
 	};
 
-	extern data parse(_STD string const& file_path, simdjson::padded_string &&file);
+	struct parse_options {
+		/* Image probes allowed to read from disk at the same time. */
+		u32 image_io_concurrency = GLTF_IMAGE_IO_CONCURRENCY;
+		/* Basis transcodes allowed to run at the same time, 0 means one per hardware thread. */
+		u32 image_transcode_concurrency = 0;
+	};
+
+	/*
+	 * Images are probed on the ThreadPool while the rest of the document is parsed and joined before returning,
+	 * so this must not be called from a pool thread.
+	 */
+	extern data parse(_STD string const& file_path, simdjson::padded_string &&file, parse_options const &options = {});
+
+	/*
+	 * Probes every image in `images` that has a `source_uri`, the same way parse() does, writing each result back into its slot.
+	 * Used to rebuild images for scenes that didn't come from parse(), such as cooked scenes.
+	 */
+	extern void probeImages(_STD filesystem::path const &file_path, _STD span<image> images, parse_options const &options = {});
+
+	/*
+	 * Where an external buffer's uri points: the working directory first, then next to the document.
+	 * Shared by the importer and anything that has to find the same file again, such as the .hlxscene source hash.
+	 */
+	extern _STD filesystem::path resolveUri(_STD filesystem::path const &document_directory, _STD string_view uri);
+
+#if BENCHMARKS_ENABLED
+	/* `--bench gltf-parse [file] [iterations]`, compares the old pass-per-member import against parse(). */
+	extern int benchmarkParse(Vec<_STD string_view> const &p_args);
+	/* `--bench gltf-buffers [file]`, reports how much of the buffer data is brought into memory by parsing and by reading it. */
+	extern int benchmarkBufferMemory(Vec<_STD string_view> const &p_args);
+	/* `--bench gltf-images [file] [iterations]`, load-time spread of std::async-per-image probing against the bounded pool. */
+	extern int benchmarkImageProbing(Vec<_STD string_view> const &p_args);
+	/*
+	 * `--bench gltf-meshopt [file] [reference] [iterations]`, EXT_meshopt_compression decode throughput, scalar against SIMD.
+	 * Both paths must agree byte for byte; with `reference` (the same asset exported without compression) every accessor
+	 * read from a compressed view is also checked against it. Exits with 1 on any mismatch.
+	 */
+	extern int benchmarkMeshoptDecode(Vec<_STD string_view> const &p_args);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+﻿#include "json.hpp"
+#include "EXT_mesh_gpu_instancing.hpp"
+#include "accessor_view.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace gltf;
+using namespace gltf::ext;
+using namespace gltf::ext::mesh_gpu_instancing;
+using namespace simdjson;
+using namespace simdjson::ondemand;
+
+mesh_gpu_instancing::node mesh_gpu_instancing::parse_ext_node(value &object) {
+	node instancing{};
+	if (auto attributes = object["attributes"]; attributes.has_value()) {
+		instancing.translation = static_cast<i32>(ezGet<i64>(attributes["TRANSLATION"], -1));
+		instancing.rotation = static_cast<i32>(ezGet<i64>(attributes["ROTATION"], -1));
+		instancing.scale = static_cast<i32>(ezGet<i64>(attributes["SCALE"], -1));
+	}
+	return instancing;
+}
+
+u64 mesh_gpu_instancing::instance_count(data const &gltf_data, node const &instancing) {
+	for (i32 const accessor : { instancing.translation, instancing.rotation, instancing.scale }) {
+		if (accessor >= 0 && static_cast<std::size_t>(accessor) < gltf_data.accessors.size())
+			return gltf_data.accessors[accessor].count();
+	}
+	return 0;
+}
+
+Vec<mat4> mesh_gpu_instancing::instance_transforms(data const &gltf_data, node const &instancing) {
+	u64 const count = instance_count(gltf_data, instancing);
+	// The specification requires every attribute to have the same count, anything shorter is treated as absent.
+	auto const usable = [&](i32 const accessor) {
+		return accessor >= 0 && static_cast<std::size_t>(accessor) < gltf_data.accessors.size() && gltf_data.accessors[accessor].count() >= count;
+	};
+
+	Vec<vec3> translations(count, vec3(0.0f));
+	Vec<vec4> rotations(count, vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	Vec<vec3> scales(count, vec3(1.0f));
+	if (usable(instancing.translation))
+		AccessorView<vec3>(gltf_data, instancing.translation).copy_to(translations);
+	if (usable(instancing.rotation))
+		AccessorView<vec4>(gltf_data, instancing.rotation).copy_to(rotations);
+	if (usable(instancing.scale))
+		AccessorView<vec3>(gltf_data, instancing.scale).copy_to(scales);
+
+	Vec<mat4> transforms(count);
+	for (u64 i = 0; i < count; i++) {
+		vec4 const &q = rotations[i];
+		mat4 const rotation = glm::mat4_cast(glm::normalize(glm::quat(q.w, q.x, q.y, q.z)));
+		transforms[i] = glm::scale(glm::translate(mat4(1.0f), translations[i]) * rotation, scales[i]);
+	}
+	return transforms;
+}
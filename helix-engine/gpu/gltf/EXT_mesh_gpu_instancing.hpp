@@ -0,0 +1,33 @@
+﻿// https://github.com/KhronosGroup/glTF/blob/main/extensions/2.0/Vendor/EXT_mesh_gpu_instancing/README.md
+
+#pragma once
+
+#include "types.hpp"
+#include "math.hpp"
+#include "simdjson/simdjson.h"
+
+namespace gltf {
+	struct data;
+
+	namespace ext::mesh_gpu_instancing {
+		constexpr auto name = "EXT_mesh_gpu_instancing";
+
+		/* Accessor ids of the node's per instance attributes, -1 for the ones it leaves out. */
+		struct node {
+			i32 translation = -1;	//< VEC3 float.
+			i32 rotation = -1;		//< VEC4 float or normalized byte/short, a quaternion in xyzw order.
+			i32 scale = -1;			//< VEC3 float.
+		};
+
+		extern node parse_ext_node(simdjson::ondemand::value &object);
+
+		/* Instances the attributes describe, the count of any one of them. */
+		_NODISCARD extern u64 instance_count(data const &gltf_data, node const &instancing);
+
+		/*
+		 * One matrix per instance, translation * rotation * scale. These place instances in the node's space,
+		 * the node's own transform still applies on top.
+		 */
+		_NODISCARD extern Vec<mat4> instance_transforms(data const &gltf_data, node const &instancing);
+	}
+}
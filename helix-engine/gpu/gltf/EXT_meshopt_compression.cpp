@@ -0,0 +1,520 @@
+﻿#include "json.hpp"
+#include "EXT_meshopt_compression.hpp"
+
+#include <cmath>
+#include <cstring>
+#if GLTF_MESHOPT_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace gltf::ext;
+using namespace gltf::ext::meshopt_compression;
+using namespace simdjson;
+using namespace simdjson::ondemand;
+
+//
+// A port of the reference decoders (meshoptimizer's vertexcodec.cpp, indexcodec.cpp and vertexfilter.cpp),
+// the bitstream formats are the ones the extension specification describes.
+//
+namespace {
+	constexpr u8 VERTEX_HEADER = 0xa0;
+	constexpr u8 INDEX_HEADER = 0xe0;
+	constexpr u8 SEQUENCE_HEADER = 0xd0;
+
+	constexpr std::size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+	constexpr std::size_t VERTEX_BLOCK_MAX_SIZE = 256;
+	constexpr std::size_t BYTE_GROUP_SIZE = 16;
+	constexpr std::size_t BYTE_GROUP_DECODE_LIMIT = 24; //< The most one group can read, header byte(s) and all escapes.
+	constexpr std::size_t TAIL_MAX_SIZE = 32;
+
+	std::size_t vertexBlockSize(std::size_t const vertex_size) {
+		std::size_t const result = (VERTEX_BLOCK_SIZE_BYTES / vertex_size) & ~(BYTE_GROUP_SIZE - 1);
+		return result < VERTEX_BLOCK_MAX_SIZE ? result : VERTEX_BLOCK_MAX_SIZE;
+	}
+
+	u8 unzigzag8(u8 const v) {
+		return static_cast<u8>((0 - (v & 1)) ^ (v >> 1));
+	}
+
+	/* 16 values of 0, 2, 4 or 8 bits each, values equal to the largest one (2 and 4 bit only) are escapes read from after the header. */
+	u8 const *decodeBytesGroup(u8 const *data, u8 *buffer, int const bitslog2) {
+		switch (bitslog2) {
+			case 0:
+				std::memset(buffer, 0, BYTE_GROUP_SIZE);
+				return data;
+			case 1:
+			case 2: {
+				u32 const bits = 1u << bitslog2;
+				u32 const escape = (1u << bits) - 1;
+				u8 const *escapes = data + bits * 2;
+				for (std::size_t i = 0; i < BYTE_GROUP_SIZE; i += 8 / bits) {
+					u8 byte = *data++;
+					for (u32 k = 0; k < 8 / bits; k++) {
+						u32 const value = byte >> (8 - bits);
+						byte = static_cast<u8>(byte << bits);
+						buffer[i + k] = value == escape ? *escapes++ : static_cast<u8>(value);
+					}
+				}
+				return escapes;
+			}
+			default:
+				std::memcpy(buffer, data, BYTE_GROUP_SIZE);
+				return data + BYTE_GROUP_SIZE;
+		}
+	}
+
+#if GLTF_MESHOPT_SIMD
+	/* For every 8 lane escape mask: which escape byte each lane takes (0x80 clears it), and how many escapes the mask uses. */
+	struct group_shuffles {
+		alignas(16) u8 shuffle[256][8];
+		u8 count[256];
+	};
+
+	constexpr group_shuffles makeGroupShuffles() {
+		group_shuffles tables{};
+		for (u32 mask = 0; mask < 256; mask++) {
+			u8 next = 0;
+			for (u32 lane = 0; lane < 8; lane++)
+				tables.shuffle[mask][lane] = (mask & (1u << lane)) ? next++ : 0x80;
+			tables.count[mask] = next;
+		}
+		return tables;
+	}
+
+	constexpr group_shuffles GROUP_SHUFFLES = makeGroupShuffles();
+
+	/* Same as decodeBytesGroup, the caller guarantees BYTE_GROUP_DECODE_LIMIT readable bytes. */
+	u8 const *decodeBytesGroupSimd(u8 const *data, u8 *buffer, int const bitslog2) {
+		__m128i selectors;
+		u8 const *escapes;
+		u8 escape_value;
+		switch (bitslog2) {
+			case 0:
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(buffer), _mm_setzero_si128());
+				return data;
+			case 1: {
+				// Spread the 4 header bytes into 16 lanes, most significant pair first.
+				i32 header;
+				std::memcpy(&header, data, sizeof(header));
+				__m128i const sel2 = _mm_cvtsi32_si128(header);
+				__m128i const sel22 = _mm_unpacklo_epi8(_mm_srli_epi16(sel2, 4), sel2);
+				__m128i const sel2222 = _mm_unpacklo_epi8(_mm_srli_epi16(sel22, 2), sel22);
+				selectors = _mm_and_si128(sel2222, _mm_set1_epi8(3));
+				escapes = data + 4;
+				escape_value = 3;
+				break;
+			}
+			case 2: {
+				__m128i const sel4 = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(data));
+				__m128i const sel44 = _mm_unpacklo_epi8(_mm_srli_epi16(sel4, 4), sel4);
+				selectors = _mm_and_si128(sel44, _mm_set1_epi8(15));
+				escapes = data + 8;
+				escape_value = 15;
+				break;
+			}
+			default:
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(buffer), _mm_loadu_si128(reinterpret_cast<__m128i const *>(data)));
+				return data + BYTE_GROUP_SIZE;
+		}
+
+		__m128i const is_escape = _mm_cmpeq_epi8(selectors, _mm_set1_epi8(static_cast<char>(escape_value)));
+		u32 const mask = static_cast<u32>(_mm_movemask_epi8(is_escape));
+		u32 const low = mask & 0xff, high = mask >> 8;
+
+		// The high half's escapes start after the low half's.
+		__m128i const shuffle_low = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(GROUP_SHUFFLES.shuffle[low]));
+		__m128i const shuffle_high = _mm_add_epi8(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(GROUP_SHUFFLES.shuffle[high])),
+		                                          _mm_set1_epi8(static_cast<char>(GROUP_SHUFFLES.count[low])));
+		__m128i const shuffle = _mm_unpacklo_epi64(shuffle_low, shuffle_high);
+
+		__m128i const escaped = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(escapes)), shuffle);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(buffer), _mm_or_si128(escaped, _mm_andnot_si128(is_escape, selectors)));
+		return escapes + GROUP_SHUFFLES.count[low] + GROUP_SHUFFLES.count[high];
+	}
+#endif
+
+	u8 const *decodeBytes(u8 const *data, u8 const *const data_end, u8 *buffer, std::size_t const buffer_size, bool const simd) {
+		// Two bits of header per group, rounded up to whole bytes.
+		u8 const *const header = data;
+		std::size_t const header_size = (buffer_size / BYTE_GROUP_SIZE + 3) / 4;
+		if (static_cast<std::size_t>(data_end - data) < header_size)
+			return nullptr;
+		data += header_size;
+
+		for (std::size_t i = 0; i < buffer_size; i += BYTE_GROUP_SIZE) {
+			if (static_cast<std::size_t>(data_end - data) < BYTE_GROUP_DECODE_LIMIT)
+				return nullptr;
+			std::size_t const group = i / BYTE_GROUP_SIZE;
+			int const bitslog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+#if GLTF_MESHOPT_SIMD
+			if (simd) {
+				data = decodeBytesGroupSimd(data, buffer + i, bitslog2);
+				continue;
+			}
+#endif
+			data = decodeBytesGroup(data, buffer + i, bitslog2);
+		}
+		(void)simd;
+		return data;
+	}
+
+	/* Every byte of the vertex is its own stream of zigzagged deltas against the previous vertex. */
+	u8 const *decodeVertexBlock(u8 const *data, u8 const *const data_end, u8 *vertices, std::size_t const vertex_count,
+	                            std::size_t const vertex_size, u8 *last_vertex, bool const simd) {
+		u8 buffer[VERTEX_BLOCK_MAX_SIZE];
+		u8 transposed[VERTEX_BLOCK_SIZE_BYTES];
+		std::size_t const aligned_count = (vertex_count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+
+		for (std::size_t k = 0; k < vertex_size; k++) {
+			data = decodeBytes(data, data_end, buffer, aligned_count, simd);
+			if (data == nullptr)
+				return nullptr;
+			u8 previous = last_vertex[k];
+			for (std::size_t i = 0; i < vertex_count; i++) {
+				previous = static_cast<u8>(unzigzag8(buffer[i]) + previous);
+				transposed[i * vertex_size + k] = previous;
+			}
+		}
+
+		std::memcpy(vertices, transposed, vertex_count * vertex_size);
+		std::memcpy(last_vertex, transposed + vertex_size * (vertex_count - 1), vertex_size);
+		return data;
+	}
+
+	Error decodeVertexBuffer(u8 *destination, std::size_t const vertex_count, std::size_t const vertex_size, std::span<u8 const> const source, bool const simd) {
+		if (vertex_size == 0 || vertex_size > 256 || vertex_size % 4 != 0)
+			return ERR_INVALID_DATA;
+		u8 const *data = source.data();
+		u8 const *const data_end = data + source.size();
+		if (source.size() < 1 + vertex_size)
+			return ERR_FILE_CORRUPT;
+		u8 const header = *data++;
+		if ((header & 0xf0) != VERTEX_HEADER || (header & 0x0f) > 0)
+			return ERR_FILE_UNRECOGNIZED;
+
+		// The tail holds the first vertex, the base the first block's deltas start from.
+		u8 last_vertex[256];
+		std::memcpy(last_vertex, data_end - vertex_size, vertex_size);
+
+		std::size_t const block_size = vertexBlockSize(vertex_size);
+		for (std::size_t offset = 0; offset < vertex_count; offset += block_size) {
+			std::size_t const count = offset + block_size < vertex_count ? block_size : vertex_count - offset;
+			data = decodeVertexBlock(data, data_end, destination + offset * vertex_size, count, vertex_size, last_vertex, simd);
+			if (data == nullptr)
+				return ERR_FILE_CORRUPT;
+		}
+
+		std::size_t const tail_size = vertex_size < TAIL_MAX_SIZE ? TAIL_MAX_SIZE : vertex_size;
+		return static_cast<std::size_t>(data_end - data) == tail_size ? OK : ERR_FILE_CORRUPT;
+	}
+
+	u32 decodeVByte(u8 const *&data) {
+		u8 const lead = *data++;
+		if (lead < 128)
+			return lead;
+		u32 result = lead & 127;
+		u32 shift = 7;
+		for (int i = 0; i < 4; i++) {
+			u8 const group = *data++;
+			result |= static_cast<u32>(group & 127) << shift;
+			shift += 7;
+			if (group < 128)
+				break;
+		}
+		return result;
+	}
+
+	u32 decodeIndex(u8 const *&data, u32 const last) {
+		u32 const v = decodeVByte(data);
+		return last + ((v >> 1) ^ (0u - (v & 1)));
+	}
+
+	void writeIndex(u8 *destination, std::size_t const i, std::size_t const index_size, u32 const index) {
+		if (index_size == sizeof(u16)) {
+			u16 const narrow = static_cast<u16>(index);
+			std::memcpy(destination + i * sizeof(u16), &narrow, sizeof(u16));
+		}
+		else {
+			std::memcpy(destination + i * sizeof(u32), &index, sizeof(u32));
+		}
+	}
+
+	struct triangle_fifos {
+		u32 edges[16][2];
+		u32 vertices[16];
+		std::size_t edge_offset = 0;
+		std::size_t vertex_offset = 0;
+
+		triangle_fifos() {
+			std::memset(edges, -1, sizeof(edges));
+			std::memset(vertices, -1, sizeof(vertices));
+		}
+
+		void pushEdge(u32 const a, u32 const b) {
+			edges[edge_offset][0] = a;
+			edges[edge_offset][1] = b;
+			edge_offset = (edge_offset + 1) & 15;
+		}
+
+		void pushVertex(u32 const v, bool const condition = true) {
+			vertices[vertex_offset] = v;
+			vertex_offset = (vertex_offset + (condition ? 1 : 0)) & 15;
+		}
+	};
+
+	/*
+	 * Triangles as one code byte each: either an edge from the edge fifo plus a vertex from the vertex fifo,
+	 * the next new vertex or an explicit one, or (0xf0 and up) a triangle of new/fifo/explicit vertices.
+	 */
+	Error decodeIndexBuffer(u8 *destination, std::size_t const index_count, std::size_t const index_size, std::span<u8 const> const source) {
+		if (index_count % 3 != 0 || (index_size != 2 && index_size != 4))
+			return ERR_INVALID_DATA;
+		// Header, a code per triangle and the 16 byte auxiliary code table at the end.
+		if (source.size() < 1 + index_count / 3 + 16)
+			return ERR_FILE_CORRUPT;
+		if ((source[0] & 0xf0) != INDEX_HEADER || (source[0] & 0x0f) > 1)
+			return ERR_FILE_UNRECOGNIZED;
+		int const version = source[0] & 0x0f;
+
+		triangle_fifos fifo;
+		u32 next = 0, last = 0;
+		u32 const explicit_limit = version >= 1 ? 13 : 15; //< Version 1 spends 13 and 14 on +-1 deltas.
+
+		u8 const *code = source.data() + 1;
+		u8 const *data = code + index_count / 3;
+		u8 const *const data_safe_end = source.data() + source.size() - 16;
+		u8 const *const codeaux_table = data_safe_end;
+
+		for (std::size_t i = 0; i < index_count; i += 3) {
+			// A triangle reads at most 16 bytes, the auxiliary table makes up the slack.
+			if (data > data_safe_end)
+				return ERR_FILE_CORRUPT;
+			u8 const codetri = *code++;
+
+			if (codetri < 0xf0) {
+				u32 const fe = codetri >> 4;
+				u32 const a = fifo.edges[(fifo.edge_offset - 1 - fe) & 15][0];
+				u32 const b = fifo.edges[(fifo.edge_offset - 1 - fe) & 15][1];
+				u32 const fec = codetri & 15;
+				u32 c;
+				bool advance = true;
+				if (fec < explicit_limit) {
+					c = fec == 0 ? next : fifo.vertices[(fifo.vertex_offset - 1 - fec) & 15];
+					advance = fec == 0;
+					next += advance ? 1 : 0;
+				}
+				else {
+					// Free indices are deltas against the last free one, 13 and 14 are -1 and +1.
+					last = c = fec != 15 ? last + (fec == 13 ? ~0u : 1u) : decodeIndex(data, last);
+				}
+				writeIndex(destination, i + 0, index_size, a);
+				writeIndex(destination, i + 1, index_size, b);
+				writeIndex(destination, i + 2, index_size, c);
+				fifo.pushVertex(c, advance);
+				fifo.pushEdge(c, b);
+				fifo.pushEdge(a, c);
+			}
+			else {
+				u32 a, b, c;
+				u32 feb, fec;
+				if (codetri < 0xfe) {
+					u8 const codeaux = codeaux_table[codetri & 15];
+					feb = codeaux >> 4;
+					fec = codeaux & 15;
+					// `next` moves for all three vertices before any is read, like the encoder does.
+					a = next++;
+					b = feb == 0 ? next : fifo.vertices[(fifo.vertex_offset - feb) & 15];
+					next += feb == 0 ? 1 : 0;
+					c = fec == 0 ? next : fifo.vertices[(fifo.vertex_offset - fec) & 15];
+					next += fec == 0 ? 1 : 0;
+				}
+				else {
+					u8 const codeaux = *data++;
+					u32 const fea = codetri == 0xfe ? 0 : 15;
+					feb = codeaux >> 4;
+					fec = codeaux & 15;
+					if (codeaux == 0) // Restart, codeaux is 0 but spelled out rather than taken from the table.
+						next = 0;
+					a = fea == 0 ? next++ : 0;
+					b = feb == 0 ? next++ : fifo.vertices[(fifo.vertex_offset - feb) & 15];
+					c = fec == 0 ? next++ : fifo.vertices[(fifo.vertex_offset - fec) & 15];
+					if (fea == 15) last = a = decodeIndex(data, last);
+					if (feb == 15) last = b = decodeIndex(data, last);
+					if (fec == 15) last = c = decodeIndex(data, last);
+				}
+				writeIndex(destination, i + 0, index_size, a);
+				writeIndex(destination, i + 1, index_size, b);
+				writeIndex(destination, i + 2, index_size, c);
+				fifo.pushVertex(a);
+				fifo.pushVertex(b, feb == 0 || feb == 15);
+				fifo.pushVertex(c, fec == 0 || fec == 15);
+				fifo.pushEdge(b, a);
+				fifo.pushEdge(c, b);
+				fifo.pushEdge(a, c);
+			}
+		}
+
+		return data == data_safe_end ? OK : ERR_FILE_CORRUPT;
+	}
+
+	/* Arbitrary index lists: zigzagged deltas against one of two running baselines, picked by the low bit. */
+	Error decodeIndexSequence(u8 *destination, std::size_t const index_count, std::size_t const index_size, std::span<u8 const> const source) {
+		if (index_size != 2 && index_size != 4)
+			return ERR_INVALID_DATA;
+		if (source.size() < 1 + index_count + 4)
+			return ERR_FILE_CORRUPT;
+		if ((source[0] & 0xf0) != SEQUENCE_HEADER || (source[0] & 0x0f) > 1)
+			return ERR_FILE_UNRECOGNIZED;
+
+		u8 const *data = source.data() + 1;
+		u8 const *const data_safe_end = source.data() + source.size() - 4;
+		u32 last[2] = {};
+		for (std::size_t i = 0; i < index_count; i++) {
+			if (data >= data_safe_end)
+				return ERR_FILE_CORRUPT;
+			u32 v = decodeVByte(data);
+			u32 const baseline = v & 1;
+			v >>= 1;
+			u32 const index = last[baseline] + ((v >> 1) ^ (0u - (v & 1)));
+			last[baseline] = index;
+			writeIndex(destination, i, index_size, index);
+		}
+		return data == data_safe_end ? OK : ERR_FILE_CORRUPT;
+	}
+
+	i32 roundSigned(f32 const value) {
+		return static_cast<i32>(value + (value >= 0.0f ? 0.5f : -0.5f));
+	}
+
+	/* x and y octahedral, z holds the value 1.0 is stored as; the output is renormalized to that scale. */
+	template <typename T>
+	void filterOctahedral(u8 *data, std::size_t const count) {
+		f32 const max = static_cast<f32>((1 << (sizeof(T) * 8 - 1)) - 1);
+		for (std::size_t i = 0; i < count; i++) {
+			T v[4];
+			std::memcpy(v, data + i * sizeof(v), sizeof(v));
+			f32 x = static_cast<f32>(v[0]);
+			f32 y = static_cast<f32>(v[1]);
+			f32 const z = static_cast<f32>(v[2]) - std::abs(x) - std::abs(y);
+			f32 const t = z >= 0.0f ? 0.0f : z;
+			x += x >= 0.0f ? t : -t;
+			y += y >= 0.0f ? t : -t;
+			f32 const s = max / std::sqrt(x * x + y * y + z * z);
+			v[0] = static_cast<T>(roundSigned(x * s));
+			v[1] = static_cast<T>(roundSigned(y * s));
+			v[2] = static_cast<T>(roundSigned(z * s));
+			std::memcpy(data + i * sizeof(v), v, sizeof(v));
+		}
+	}
+
+	/* Three smallest components, the fourth's index in the low bits of w and the scale in the rest. */
+	void filterQuaternion(u8 *data, std::size_t const count) {
+		f32 const scale = 1.0f / std::sqrt(2.0f);
+		for (std::size_t i = 0; i < count; i++) {
+			i16 v[4];
+			std::memcpy(v, data + i * sizeof(v), sizeof(v));
+			f32 const ss = scale / static_cast<f32>(v[3] | 3);
+			f32 const x = static_cast<f32>(v[0]) * ss;
+			f32 const y = static_cast<f32>(v[1]) * ss;
+			f32 const z = static_cast<f32>(v[2]) * ss;
+			f32 const ww = 1.0f - x * x - y * y - z * z;
+			f32 const w = std::sqrt(ww >= 0.0f ? ww : 0.0f);
+			i32 const largest = v[3] & 3;
+			i16 out[4];
+			out[(largest + 1) & 3] = static_cast<i16>(roundSigned(x * 32767.0f));
+			out[(largest + 2) & 3] = static_cast<i16>(roundSigned(y * 32767.0f));
+			out[(largest + 3) & 3] = static_cast<i16>(roundSigned(z * 32767.0f));
+			out[(largest + 0) & 3] = static_cast<i16>(static_cast<i32>(w * 32767.0f + 0.5f));
+			std::memcpy(data + i * sizeof(out), out, sizeof(out));
+		}
+	}
+
+	/* 24 bit signed mantissa and 8 bit signed exponent per float. */
+	void filterExponential(u8 *data, std::size_t const count, bool const simd) {
+		std::size_t i = 0;
+#if GLTF_MESHOPT_SIMD
+		if (simd) {
+			for (; i + 4 <= count; i += 4) {
+				__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data + i * sizeof(u32)));
+				__m128i const mantissa = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+				__m128i const exponent = _mm_srai_epi32(v, 24);
+				__m128 const power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127)), 23));
+				__m128 const result = _mm_mul_ps(power, _mm_cvtepi32_ps(mantissa));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i * sizeof(u32)), _mm_castps_si128(result));
+			}
+		}
+#endif
+		(void)simd;
+		for (; i < count; i++) {
+			u32 v;
+			std::memcpy(&v, data + i * sizeof(u32), sizeof(u32));
+			i32 const mantissa = static_cast<i32>(v << 8) >> 8;
+			i32 const exponent = static_cast<i32>(v) >> 24;
+			u32 const power_bits = static_cast<u32>(exponent + 127) << 23;
+			f32 power;
+			std::memcpy(&power, &power_bits, sizeof(f32));
+			f32 const result = power * static_cast<f32>(mantissa);
+			std::memcpy(data + i * sizeof(u32), &result, sizeof(u32));
+		}
+	}
+}
+
+meshopt_compression::buffer_view meshopt_compression::parse_ext_buffer_view(value &object) {
+	buffer_view view{
+		.buffer = static_cast<i32>(ezGet<i64>(object["buffer"], 0)),
+		.offset = ezGet<u64>(object["byteOffset"], 0),
+		.length = ezGet<u64>(object["byteLength"], 0),
+		.stride = ezGet<u64>(object["byteStride"], 0),
+		.count = ezGet<u64>(object["count"], 0)
+	};
+	switch (hash(stringValue(object["mode"], "ATTRIBUTES"))) {
+		case hash("TRIANGLES"): view.mode = mode::triangles; break;
+		case hash("INDICES"): view.mode = mode::indices; break;
+		default: view.mode = mode::attributes; break;
+	}
+	switch (hash(stringValue(object["filter"], "NONE"))) {
+		case hash("OCTAHEDRAL"): view.filter = filter::octahedral; break;
+		case hash("QUATERNION"): view.filter = filter::quaternion; break;
+		case hash("EXPONENTIAL"): view.filter = filter::exponential; break;
+		default: view.filter = filter::none; break;
+	}
+	return view;
+}
+
+bool meshopt_compression::parse_ext_buffer_fallback(value &object) {
+	return ezGet<bool>(object["fallback"], false);
+}
+
+Error meshopt_compression::decode(buffer_view const &view, std::span<u8 const> const source, u8 *destination, bool const simd) {
+	std::size_t const count = static_cast<std::size_t>(view.count);
+	std::size_t const stride = static_cast<std::size_t>(view.stride);
+	switch (view.mode) {
+		case mode::triangles:
+			return decodeIndexBuffer(destination, count, stride, source);
+		case mode::indices:
+			return decodeIndexSequence(destination, count, stride, source);
+		case mode::attributes:
+			break;
+	}
+
+	if (Error const error = decodeVertexBuffer(destination, count, stride, source, simd); error != OK)
+		return error;
+	switch (view.filter) {
+		case filter::none:
+			break;
+		case filter::octahedral:
+			if (stride == 4) filterOctahedral<i8>(destination, count);
+			else if (stride == 8) filterOctahedral<i16>(destination, count);
+			else return ERR_INVALID_DATA;
+			break;
+		case filter::quaternion:
+			if (stride != 8)
+				return ERR_INVALID_DATA;
+			filterQuaternion(destination, count);
+			break;
+		case filter::exponential:
+			filterExponential(destination, count * stride / sizeof(u32), simd);
+			break;
+	}
+	return OK;
+}
@@ -0,0 +1,51 @@
+﻿// https://github.com/KhronosGroup/glTF/blob/main/extensions/2.0/Vendor/EXT_meshopt_compression/README.md
+
+#pragma once
+
+#include <span>
+
+#include "types.hpp"
+#include "simdjson/simdjson.h"
+
+/* Decode byte groups with SSSE3 shuffles instead of one byte at a time. */
+#define GLTF_MESHOPT_SIMD 1
+
+namespace gltf::ext::meshopt_compression {
+	constexpr auto name = "EXT_meshopt_compression";
+
+	enum class mode : u8 {
+		attributes,
+		triangles,
+		indices,
+	};
+
+	enum class filter : u8 {
+		none,
+		octahedral,
+		quaternion,
+		exponential,
+	};
+
+	/* The extension object of a compressed bufferView, the view itself describes where the decoded bytes go. */
+	struct buffer_view {
+		i32 buffer = 0;		//< Holds the compressed bytes.
+		u64 offset = 0;
+		u64 length = 0;
+		u64 stride = 0;		//< Bytes per element once decoded, 2 or 4 for index modes.
+		u64 count = 0;		//< Elements (vertices or indices).
+		meshopt_compression::mode mode = meshopt_compression::mode::attributes;
+		meshopt_compression::filter filter = meshopt_compression::filter::none;
+	};
+
+	extern buffer_view parse_ext_buffer_view(simdjson::ondemand::value &object);
+
+	/* True for a buffer's extension object marking it as a fallback, i.e. its bytes are only reachable by decoding. */
+	extern bool parse_ext_buffer_fallback(simdjson::ondemand::value &object);
+
+	/*
+	 * Decodes `source` (view.length bytes) into `destination` (view.count * view.stride bytes) and applies the filter.
+	 * Fails with ERR_FILE_UNRECOGNIZED for unknown codec versions and ERR_FILE_CORRUPT for truncated or malformed data.
+	 * `simd` only exists so the benchmark can compare both paths.
+	 */
+	_NODISCARD extern Error decode(buffer_view const &view, _STD span<u8 const> source, u8 *destination, bool simd = GLTF_MESHOPT_SIMD);
+}
@@ -0,0 +1,259 @@
+﻿#pragma once
+
+//
+// Typed, read-only view over a glTF accessor.
+// Handles byteStride, normalized integers and sparse storage so consumers never touch raw buffer pointers.
+// The component type is resolved once at construction; per element work is a function pointer call, never a switch.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#include "gpu/gltf.h"
+
+namespace gltf {
+	namespace detail {
+		template <typename T>
+		struct element_traits {
+			using component = T;
+			static constexpr _STD size_t components = 1;
+			static component &at(T &element, _STD size_t) { return element; }
+		};
+
+		template <glm::length_t L, typename C, glm::qualifier Q>
+		struct element_traits<glm::vec<L, C, Q>> {
+			using component = C;
+			static constexpr _STD size_t components = L;
+			static component &at(glm::vec<L, C, Q> &element, _STD size_t const i) { return element[static_cast<glm::length_t>(i)]; }
+		};
+
+		template <typename C>
+		constexpr _STD optional<component_type> component_type_of() {
+			if constexpr (_STD is_same_v<C, i8>) return component_type::signed_byte;
+			else if constexpr (_STD is_same_v<C, u8>) return component_type::unsigned_byte;
+			else if constexpr (_STD is_same_v<C, i16>) return component_type::signed_short;
+			else if constexpr (_STD is_same_v<C, u16>) return component_type::unsigned_short;
+			else if constexpr (_STD is_same_v<C, u32>) return component_type::unsigned_int;
+			else if constexpr (_STD is_same_v<C, f32>) return component_type::single_float;
+			else return _STD nullopt;
+		}
+
+		/* glTF 2.0, "Animations" / KHR_mesh_quantization: c / max, clamped to -1 for signed types. */
+		template <typename Dst, typename Src, bool Normalized>
+		Dst convert_component(Src const value) {
+			if constexpr (Normalized && _STD is_floating_point_v<Dst> && _STD is_integral_v<Src>) {
+				constexpr Dst scale = Dst(1) / static_cast<Dst>((_STD numeric_limits<Src>::max)());
+				if constexpr (_STD is_signed_v<Src>)
+					return (_STD max)(static_cast<Dst>(value) * scale, Dst(-1));
+				else
+					return static_cast<Dst>(value) * scale;
+			}
+			else {
+				return static_cast<Dst>(value);
+			}
+		}
+
+		template <typename T, typename Src, bool Normalized>
+		T decode_element(u8 const *source, _STD size_t const components) {
+			using traits = element_traits<T>;
+			T element{};
+			for (_STD size_t c = 0; c < components; c++) {
+				Src value;
+				_STD memcpy(&value, source + c * sizeof(Src), sizeof(Src));
+				traits::at(element, c) = convert_component<typename traits::component, Src, Normalized>(value);
+			}
+			return element;
+		}
+
+		template <typename T, typename Src, bool Normalized>
+		void decode_range(u8 const *source, _STD size_t const stride, _STD size_t const count, _STD size_t const components, u8 *destination, _STD size_t const destination_stride) {
+			for (_STD size_t i = 0; i < count; i++) {
+				T const element = decode_element<T, Src, Normalized>(source + i * stride, components);
+				_STD memcpy(destination + i * destination_stride, &element, sizeof(T));
+			}
+		}
+
+		inline u8 const *buffer_view_bytes(data const &gltf_data, id const buffer_view_id, _STD size_t const offset) {
+			if (buffer_view_id < 0 || static_cast<_STD size_t>(buffer_view_id) >= gltf_data.buffer_views.size())
+				return nullptr;
+			buffer_view const &view = gltf_data.buffer_views[buffer_view_id];
+			buffer const &owner = gltf_data.buffers[view.buffer];
+			assert(view.offset + view.length <= owner.length());
+			return reinterpret_cast<u8 const *>(owner.data().data()) + view.offset + offset;
+		}
+	}
+
+	template <typename T>
+	class AccessorView {
+		using traits = detail::element_traits<T>;
+		using decode_fn = T (*)(u8 const *, _STD size_t);
+		using decode_range_fn = void (*)(u8 const *, _STD size_t, _STD size_t, _STD size_t, u8 *, _STD size_t);
+
+	public:
+		class iterator {
+		public:
+			using iterator_category = _STD forward_iterator_tag;
+			using value_type = T;
+			using difference_type = _STD ptrdiff_t;
+			using pointer = void;
+			using reference = T;
+
+			iterator() = default;
+			iterator(AccessorView const *view, _STD size_t const index) : view_(view), index_(index) {}
+
+			T operator*() const { return (*view_)[index_]; }
+			iterator &operator++() { ++index_; return *this; }
+			iterator operator++(int) { iterator copy = *this; ++index_; return copy; }
+			bool operator==(iterator const &other) const { return index_ == other.index_; }
+
+		private:
+			AccessorView const *view_ = nullptr;
+			_STD size_t index_ = 0;
+		};
+
+		AccessorView(data const &gltf_data, accessor const &accessor)
+			: count_(accessor.count()),
+			  components_((_STD min)(static_cast<_STD size_t>(componentsForType(accessor.type())), traits::components)),
+			  element_size_(accessor.stride()) {
+			if (accessor.hasBufferView()) {
+				base_ = detail::buffer_view_bytes(gltf_data, accessor.bufferView(), accessor.offset());
+				_STD size_t const view_stride = gltf_data.buffer_views[accessor.bufferView()].stride;
+				stride_ = view_stride != 0 ? view_stride : element_size_;
+			}
+
+			// Reading T straight out of the buffer is only valid when the storage *is* T.
+			direct_ = detail::component_type_of<typename traits::component>() == accessor.componentType()
+				&& static_cast<_STD size_t>(componentsForType(accessor.type())) == traits::components;
+
+			switch (accessor.componentType()) {
+				case component_type::signed_byte:    select_decoder<i8>(accessor.normalized()); break;
+				case component_type::unsigned_byte:  select_decoder<u8>(accessor.normalized()); break;
+				case component_type::signed_short:   select_decoder<i16>(accessor.normalized()); break;
+				case component_type::unsigned_short: select_decoder<u16>(accessor.normalized()); break;
+				case component_type::unsigned_int:   select_decoder<u32>(accessor.normalized()); break;
+				case component_type::single_float:   select_decoder<f32>(false); break;
+			}
+
+			if (accessor.sparse().has_value())
+				load_sparse(gltf_data, accessor.sparse().value());
+		}
+
+		AccessorView(data const &gltf_data, id const accessor_id)
+			: AccessorView(gltf_data, gltf_data.accessors[accessor_id]) {}
+
+		[[nodiscard]] _STD size_t size() const { return count_; }
+		[[nodiscard]] bool empty() const { return count_ == 0; }
+
+		/* True when data()/stride() can be handed out as-is (same component type and count as T, no sparse patches). */
+		[[nodiscard]] bool direct() const { return direct_ && base_ != nullptr && sparse_indices_.empty(); }
+		[[nodiscard]] bool contiguous() const { return direct() && stride_ == sizeof(T); }
+		[[nodiscard]] u8 const *data() const { return base_; }
+		[[nodiscard]] _STD size_t stride() const { return stride_; }
+
+		[[nodiscard]] T operator[](_STD size_t const index) const {
+			assert(index < count_);
+			if (!sparse_indices_.empty()) [[unlikely]] {
+				auto const it = _STD lower_bound(sparse_indices_.begin(), sparse_indices_.end(), static_cast<u32>(index));
+				if (it != sparse_indices_.end() && *it == index)
+					return decode_(sparse_values_ + static_cast<_STD size_t>(it - sparse_indices_.begin()) * element_size_, components_);
+			}
+			if (base_ == nullptr)
+				return T{};
+			if (direct_) {
+				T element;
+				_STD memcpy(&element, base_ + index * stride_, sizeof(T));
+				return element;
+			}
+			return decode_(base_ + index * stride_, components_);
+		}
+
+		[[nodiscard]] iterator begin() const { return { this, 0 }; }
+		[[nodiscard]] iterator end() const { return { this, count_ }; }
+
+		/* Writes every element into `first`, `destination_stride` bytes apart (e.g. one member of an interleaved vertex). */
+		void copy_to_strided(void *first, _STD size_t const destination_stride) const {
+			u8 *const destination = static_cast<u8 *>(first);
+			if (base_ == nullptr) {
+				T const zero{};
+				for (_STD size_t i = 0; i < count_; i++)
+					_STD memcpy(destination + i * destination_stride, &zero, sizeof(T));
+			}
+			else if (direct_ && stride_ == sizeof(T) && destination_stride == sizeof(T)) {
+				_STD memcpy(destination, base_, count_ * sizeof(T));
+			}
+			else if (direct_) {
+				for (_STD size_t i = 0; i < count_; i++)
+					_STD memcpy(destination + i * destination_stride, base_ + i * stride_, sizeof(T));
+			}
+			else {
+				decode_range_(base_, stride_, count_, components_, destination, destination_stride);
+			}
+
+			for (_STD size_t k = 0; k < sparse_indices_.size(); k++) {
+				T const element = decode_(sparse_values_ + k * element_size_, components_);
+				_STD memcpy(destination + sparse_indices_[k] * destination_stride, &element, sizeof(T));
+			}
+		}
+
+		void copy_to(_STD span<T> const out) const {
+			assert(out.size() >= count_);
+			copy_to_strided(out.data(), sizeof(T));
+		}
+
+		[[nodiscard]] Vec<T> to_vector() const {
+			Vec<T> out(count_);
+			copy_to(out);
+			return out;
+		}
+
+	private:
+		template <typename Src>
+		void select_decoder(bool const normalized) {
+			if (normalized) {
+				decode_ = &detail::decode_element<T, Src, true>;
+				decode_range_ = &detail::decode_range<T, Src, true>;
+			}
+			else {
+				decode_ = &detail::decode_element<T, Src, false>;
+				decode_range_ = &detail::decode_range<T, Src, false>;
+			}
+		}
+
+		void load_sparse(data const &gltf_data, accessor_sparse const &sparse) {
+			u8 const *indices = detail::buffer_view_bytes(gltf_data, sparse.indices_buffer_view, sparse.indices_offset);
+			sparse_values_ = detail::buffer_view_bytes(gltf_data, sparse.values_buffer_view, sparse.values_offset);
+			if (indices == nullptr || sparse_values_ == nullptr)
+				return;
+
+			sparse_indices_.resize(sparse.count);
+			switch (sparse.indices_component_type) {
+				case component_type::unsigned_byte:
+					detail::decode_range<u32, u8, false>(indices, sizeof(u8), sparse.count, 1, reinterpret_cast<u8 *>(sparse_indices_.data()), sizeof(u32));
+					break;
+				case component_type::unsigned_short:
+					detail::decode_range<u32, u16, false>(indices, sizeof(u16), sparse.count, 1, reinterpret_cast<u8 *>(sparse_indices_.data()), sizeof(u32));
+					break;
+				default:
+					_STD memcpy(sparse_indices_.data(), indices, sparse.count * sizeof(u32));
+					break;
+			}
+			assert(_STD ranges::is_sorted(sparse_indices_) && "Sparse accessor indices must be strictly increasing");
+		}
+
+		u8 const *base_ = nullptr;
+		_STD size_t stride_ = 0;
+		_STD size_t count_ = 0;
+		_STD size_t components_ = 0;
+		_STD size_t element_size_ = 0;
+		bool direct_ = false;
+		decode_fn decode_ = nullptr;
+		decode_range_fn decode_range_ = nullptr;
+		Vec<u32> sparse_indices_;
+		u8 const *sparse_values_ = nullptr;
+	};
+}
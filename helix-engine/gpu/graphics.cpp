@@ -57,6 +57,8 @@ void terminateGraphics() {
 
 static size_t errors_checked = 0;
 
+gpu::DrawStatistics gpu::draw_statistics;
+
 bool gpu::check([[maybe_unused]] char const *where, [[maybe_unused]] _STD size_t const line) {
 	//printf("[%s:%llu] Checking for OpenGL errors... (%llu checks)\n", where, line, errors_checked++);
 #ifndef SKIP_ERR_CHECK
@@ -635,28 +637,28 @@ void VertexArray::enableAttribute(u32 const p_bindingindex) const {
 	gpu_check;
 }
 void VertexArray::setAttribute(VertexArrayAttribute const &p_attrib) const {
-	switch (GLenum const attrib_type = componentTypeToGL(p_attrib.type)) {
-		case GL_UNSIGNED_BYTE:
-		case GL_BYTE:
-			glVertexArrayAttribIFormat(
-				vertex_array_object_,
-				p_attrib.index,
-				p_attrib.size,
-				attrib_type,
-				p_attrib.offset
-			);
-			break;
-		default:
-			glVertexArrayAttribFormat(
-				vertex_array_object_,
-				p_attrib.index,
-				p_attrib.size,
-				attrib_type,
-				GL_FALSE,
-				p_attrib.offset
-			);
-			break;
-	} gpu_check;
+	// Quantized attributes (KHR_mesh_quantization) are integers too, only the ones GLSL reads as integers skip the float conversion.
+	GLenum const attrib_type = componentTypeToGL(p_attrib.type);
+	if (p_attrib.integer) {
+		glVertexArrayAttribIFormat(
+			vertex_array_object_,
+			p_attrib.index,
+			p_attrib.size,
+			attrib_type,
+			p_attrib.offset
+		);
+	}
+	else {
+		glVertexArrayAttribFormat(
+			vertex_array_object_,
+			p_attrib.index,
+			p_attrib.size,
+			attrib_type,
+			p_attrib.normalized ? GL_TRUE : GL_FALSE,
+			p_attrib.offset
+		);
+	}
+	gpu_check;
 	glVertexArrayAttribBinding(vertex_array_object_, p_attrib.index, p_attrib.binding); gpu_check;
 	glEnableVertexArrayAttrib(vertex_array_object_, p_attrib.index); gpu_check;
 }
@@ -678,16 +680,22 @@ void VertexArray::drawArrays(gl::PrimitiveType prim, i32 const first, i32 const
 	bind();
 	glDrawArrays(static_cast<GLenum>(prim), first, count);
 	gpu_check;
+	gpu::draw_statistics.draw_calls++;
+	gpu::draw_statistics.draws++;
 }
 void VertexArray::drawArraysInstanced(gl::PrimitiveType prim, i32 const first, i32 const count, i32 const instances) const {
 	bind();
 	glDrawArraysInstanced(static_cast<GLenum>(prim), first, count, instances);
 	gpu_check;
+	gpu::draw_statistics.draw_calls++;
+	gpu::draw_statistics.draws++;
 }
 void VertexArray::drawElements(gl::PrimitiveType prim, gl::DrawElementsType elem, i32 const count) const {
 	bind();
 	glDrawElements(static_cast<GLenum>(prim), count, static_cast<GLenum>(elem), nullptr);
 	gpu_check;
+	gpu::draw_statistics.draw_calls++;
+	gpu::draw_statistics.draws++;
 }
 void VertexArray::draw() const {
 	bind();
@@ -698,6 +706,63 @@ void VertexArray::draw() const {
 		(void const *)offset_of_elements
 	);
 	gpu_check;
+	gpu::draw_statistics.draw_calls++;
+	gpu::draw_statistics.draws++;
+}
+void VertexArray::drawRange(_STD size_t const offset, _STD size_t const count) const {
+	bind();
+	glDrawElements(
+		static_cast<GLenum>(primitive_type),
+		static_cast<GLsizei>(count),
+		static_cast<GLenum>(draw_elements_type),
+		(void const *)offset
+	);
+	gpu_check;
+	gpu::draw_statistics.draw_calls++;
+	gpu::draw_statistics.draws++;
+}
+void VertexArray::drawInstanced(i32 const instances) const {
+	drawRangeInstanced(offset_of_elements, elements_count, instances);
+}
+void VertexArray::drawRangeInstanced(_STD size_t const offset, _STD size_t const count, i32 const instances) const {
+	bind();
+	glDrawElementsInstanced(
+		static_cast<GLenum>(primitive_type),
+		static_cast<GLsizei>(count),
+		static_cast<GLenum>(draw_elements_type),
+		(void const *)offset,
+		instances
+	);
+	gpu_check;
+	gpu::draw_statistics.draw_calls++;
+	gpu::draw_statistics.draws++;
+}
+void VertexArray::drawRangeBaseVertex(_STD size_t const offset, _STD size_t const count, i32 const base_vertex, i32 const instances) const {
+	bind();
+	glDrawElementsInstancedBaseVertex(
+		static_cast<GLenum>(primitive_type),
+		static_cast<GLsizei>(count),
+		static_cast<GLenum>(draw_elements_type),
+		(void const *)offset,
+		instances,
+		base_vertex
+	);
+	gpu_check;
+	gpu::draw_statistics.draw_calls++;
+	gpu::draw_statistics.draws++;
+}
+void VertexArray::multiDrawIndirect(_STD size_t const indirect_offset, i32 const draw_count) const {
+	bind();
+	glMultiDrawElementsIndirect(
+		static_cast<GLenum>(primitive_type),
+		static_cast<GLenum>(draw_elements_type),
+		(void const *)indirect_offset,
+		draw_count,
+		0
+	);
+	gpu_check;
+	gpu::draw_statistics.draw_calls++;
+	gpu::draw_statistics.draws += draw_count;
 }
 void VertexArray::dispose() {
 	glDeleteVertexArrays(1, &vertex_array_object_);
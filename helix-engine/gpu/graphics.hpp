@@ -18,6 +18,8 @@ class IRenderer;
 class Buffer;
 class Texture;
 class Camera3D;
+class IndirectDrawBatch;
+class FrustumCuller;
 extern void initGraphics();
 extern void terminateGraphics();
 
@@ -33,6 +35,13 @@ extern void terminateGraphics();
 
 namespace gpu {
 	extern bool check(char const *where, _STD size_t const line);
+
+	/* Counted by every VertexArray draw, whoever reads them resets them (see RENDER_PRINT_DRAW_STATISTICS). */
+	struct DrawStatistics {
+		u64 draw_calls = 0;	//< glDraw* and glMultiDraw* calls.
+		u64 draws = 0;		//< Element ranges drawn, a multi draw counts each of its commands.
+	};
+	extern DrawStatistics draw_statistics;
 }
 
 #if 1
@@ -395,7 +404,8 @@ struct VertexArrayAttribute {
 	i32 stride = 0; //< (opt) the length of each vertex data.
 	u32 offset = 0u; //< (opt) (requires stride) the offset in each buffer stride for each value.
 	EComponentType type = EComponentType::UNSIGNED_BYTE;
-	bool normalized = false;
+	bool normalized = false; //< Integer types only, maps to [0, 1] or [-1, 1] instead of converting the value as is.
+	bool integer = false; //< Integer types only, read as ivec/uvec in GLSL (e.g. JOINTS_0) instead of being converted to float.
 };
 
 class VertexArray : public IDisposable{
@@ -428,6 +438,15 @@ public:
 	void drawArraysInstanced(gl::PrimitiveType prim, i32 const first, i32 const count, i32 const instances) const;
 	void drawElements(gl::PrimitiveType prim = gl::PrimitiveType::Triangles, gl::DrawElementsType elem = gl::DrawElementsType::UnsignedByte, i32 const count = 0) const;
 	void draw() const;
+	/* Like draw(), but for `count` elements starting `offset` bytes into the element buffer. */
+	void drawRange(_STD size_t offset, _STD size_t count) const;
+	/* draw() and drawRange() `instances` times over, gl_InstanceID tells the shader which one it is drawing. */
+	void drawInstanced(i32 instances) const;
+	void drawRangeInstanced(_STD size_t offset, _STD size_t count, i32 instances) const;
+	/* drawRangeInstanced() with every index offset by `base_vertex`, for element buffers shared by several meshes. */
+	void drawRangeBaseVertex(_STD size_t offset, _STD size_t count, i32 base_vertex, i32 instances = 1) const;
+	/* `draw_count` DrawElementsIndirectCommand read `indirect_offset` bytes into the bound GL_DRAW_INDIRECT_BUFFER. */
+	void multiDrawIndirect(_STD size_t indirect_offset, i32 draw_count) const;
 	void dispose() override;
 	[[nodiscard]] bool disposed() const override;
 };
@@ -496,12 +515,20 @@ struct RenderPassInfo {
 	bool bind_normal_texture = false;
 	bool bind_orm_texture = false;
 	bool bind_object_id = false;
+	bool bind_vertex_packing = false; //< The program includes shaders/vertex_packing.glsl, see PackedVertex.
+	bool bind_instancing = false; //< The program includes shaders/instancing.glsl, see InstancedMeshRenderer3D.
 	bool frustum_culling = false;
+	bool request_texture_streaming = false; //< Visible primitives request their material's textures from TextureStreamer, needs lod_pixels_per_unit.
 	bool render_sky = false;
 	bool cull = false;
 	gl::TriangleFace cull_face = gl::TriangleFace::Back;
 	Optional<i32> bind_time;
 	ivec4 viewport = ivec4(0, 0, 1, 1);
+	vec3 camera_position = vec3(0.0f);
+	f32 lod_pixels_per_unit = 0.0f; //< Pixels one unit covers at distance 1 (viewport height * projection[1][1] / 2), 0 always draws full detail.
+	f32 lod_error_threshold = 1.0f; //< Pixels of geometric error a simplified level may show.
+	IndirectDrawBatch *indirect_draws = nullptr; //< Pooled geometry is queued here instead of drawn, SceneTree::initiateDraw submits it after the visit.
+	FrustumCuller *culling = nullptr; //< With frustum_culling, SceneTree::initiateDraw culls Component::gatherBounds() against `camera` before drawing.
 	Program *shader_program;
 	struct RenderPassInfo_BlendControl {
 		bool enabled = false;
@@ -0,0 +1,702 @@
+﻿#include "hlxscene.hpp"
+
+#include <cstdio>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <system_error>
+#include <type_traits>
+
+#include "os.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet.hpp"
+#include "mesh_lod.hpp"
+#include "engine/engine.h"
+#include "engine/thread_pool.hpp"
+
+using namespace hlxscene;
+
+static_assert(std::is_trivially_copyable_v<header>);
+static_assert(std::is_trivially_copyable_v<node_record>);
+static_assert(std::is_trivially_copyable_v<primitive_record>);
+static_assert(std::is_trivially_copyable_v<Meshlet>);
+static_assert(std::is_trivially_copyable_v<lod_record>);
+static_assert(std::is_trivially_copyable_v<material_record>);
+static_assert(std::is_trivially_copyable_v<light_record>);
+
+namespace {
+	constexpr std::size_t TABLE_ALIGNMENT = 16;
+
+	/* True when [offset, offset + size) lies inside `limit` bytes, without overflowing. */
+	bool fits(u64 const offset, u64 const size, u64 const limit) {
+		return offset <= limit && size <= limit - offset;
+	}
+
+	/* Bytes per index for a cooked primitive's gl::DrawElementsType, 0 for anything the cook never writes. */
+	u64 indexSize(gl::enum_t const index_type) {
+		switch (static_cast<gl::DrawElementsType>(index_type)) {
+			case gl::DrawElementsType::UnsignedShort: return sizeof(u16);
+			case gl::DrawElementsType::UnsignedInt: return sizeof(u32);
+			default: return 0;
+		}
+	}
+
+	/*
+	 * Checks every range Mesh reads straight from the mapping: each mesh's slice of the blobs,
+	 * and each primitive's (and level of detail's) vertices and indices inside that slice.
+	 */
+	bool meshRangesValid(header const &h, std::span<mesh_record const> const meshes, std::span<primitive_record const> const primitives, std::span<lod_record const> const lods) {
+		for (mesh_record const &mesh : meshes) {
+			if (!fits(mesh.vertices.offset, mesh.vertices.size, h.vertices.size) || !fits(mesh.indices.offset, mesh.indices.size, h.indices.size))
+				return false;
+			if (!fits(mesh.first_primitive, mesh.primitive_count, primitives.size()))
+				return false;
+			for (primitive_record const &primitive : primitives.subspan(mesh.first_primitive, mesh.primitive_count)) {
+				u64 const index_size = indexSize(primitive.index_type);
+				if (index_size == 0)
+					return false;
+				if (!fits(primitive.vertex_offset, static_cast<u64>(primitive.vertex_count) * VERTEX_STRIDE, mesh.vertices.size))
+					return false;
+				if (!fits(primitive.index_offset, primitive.index_count * index_size, mesh.indices.size))
+					return false;
+				if (!fits(primitive.first_lod, primitive.lod_count, lods.size()))
+					return false;
+				for (lod_record const &lod : lods.subspan(primitive.first_lod, primitive.lod_count)) {
+					if (!fits(lod.index_offset, lod.index_count * index_size, mesh.indices.size))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/* True when `index` is in [0, count), or -1 where the record allows "none". */
+	bool indexValid(i64 const index, std::size_t const count, bool const optional) {
+		return (optional && index == -1) || (index >= 0 && static_cast<u64>(index) < count);
+	}
+
+	/*
+	 * Checks every index one table holds into another: node children and scene roots, each node's mesh and light,
+	 * each primitive's material, each material's textures and each texture's image. The importer indexes with them as they are.
+	 */
+	bool referencesValid(std::span<u32 const> const children, std::span<node_record const> const nodes, std::size_t const mesh_count,
+	                     std::span<primitive_record const> const primitives, std::span<material_record const> const materials,
+	                     std::span<texture_record const> const textures, std::size_t const image_count, std::size_t const light_count) {
+		for (u32 const child : children) {
+			if (!indexValid(child, nodes.size(), false))
+				return false;
+		}
+		for (node_record const &node : nodes) {
+			if (!indexValid(node.mesh, mesh_count, true) || !indexValid(node.light, light_count, true))
+				return false;
+		}
+		for (primitive_record const &primitive : primitives) {
+			if (!indexValid(static_cast<i32>(primitive.material), materials.size(), true))
+				return false;
+		}
+		for (material_record const &material : materials) {
+			for (texture_ref const *ref : { &material.base_color_texture, &material.metallic_roughness_texture, &material.normal_texture,
+			                                &material.occlusion_texture, &material.emissive_texture }) {
+				if (ref->exists != 0 && !indexValid(ref->index, textures.size(), false))
+					return false;
+			}
+		}
+		for (texture_record const &texture : textures) {
+			if (!indexValid(texture.source, image_count, true))
+				return false;
+		}
+		return true;
+	}
+
+	/* Folds the size and write time of every dependency into one hash, touching any source file changes it. */
+	Result<u32> sourceHash(Vec<std::string_view> const &paths) {
+		std::string stamps;
+		for (std::string_view const path : paths) {
+			std::error_code error;
+			std::filesystem::path const file(path);
+			std::uintmax_t const size = std::filesystem::file_size(file, error);
+			if (error)
+				return { ERR_FILE_MISSING_DEPENDENCIES, __LINE__ };
+			std::filesystem::file_time_type const write_time = std::filesystem::last_write_time(file, error);
+			if (error)
+				return { ERR_FILE_MISSING_DEPENDENCIES, __LINE__ };
+
+			stamps.append(path);
+			stamps += '|' + std::to_string(size) + '|' + std::to_string(write_time.time_since_epoch().count()) + '\n';
+		}
+		return hash(stamps);
+	}
+
+	class string_table {
+	public:
+		string_ref add(std::string_view const str) {
+			string_ref const ref{ static_cast<u32>(chars_.size()), static_cast<u32>(str.size()) };
+			chars_.insert(chars_.end(), str.begin(), str.end());
+			return ref;
+		}
+
+		_NODISCARD std::span<char const> chars() const { return chars_; }
+
+	private:
+		Vec<char> chars_;
+	};
+
+	/* Builds the file in memory, each table starts on a TABLE_ALIGNMENT boundary so it can be used straight from the mapping. */
+	class writer {
+	public:
+		writer() : bytes_(sizeof(header)) {}
+
+		template <typename T>
+		section append(std::span<T const> const items) {
+			bytes_.resize((bytes_.size() + TABLE_ALIGNMENT - 1) & ~(TABLE_ALIGNMENT - 1));
+			section const s{ bytes_.size(), items.size_bytes() };
+			char const *const first = reinterpret_cast<char const *>(items.data());
+			bytes_.insert(bytes_.end(), first, first + items.size_bytes());
+			return s;
+		}
+
+		template <typename T>
+		section append(Vec<T> const &items) {
+			return append(std::span<T const>(items));
+		}
+
+		void finish(header &h) {
+			h.file_size = bytes_.size();
+			std::memcpy(bytes_.data(), &h, sizeof(header));
+		}
+
+		_NODISCARD Vec<char> const &bytes() const { return bytes_; }
+
+	private:
+		Vec<char> bytes_;
+	};
+
+	texture_ref makeTextureRef(gltf::texture_info const &info) {
+		return { info.index, info.tex_coord, info.scale, info.exists ? 1u : 0u };
+	}
+
+	gltf::texture_info makeTextureInfo(texture_ref const &ref) {
+		return { .index = ref.index, .tex_coord = ref.tex_coord, .scale = ref.scale, .exists = ref.exists != 0 };
+	}
+
+	bool hasPositions(gltf::primitive const &primitive) {
+		for (gltf::attribute const &attribute : primitive.attributes) {
+			if (attribute.name == "POSITION")
+				return true;
+		}
+		return false;
+	}
+}
+
+std::filesystem::path hlxscene::cachePath(std::string const &source_path) {
+	std::error_code error;
+	std::filesystem::path const absolute = std::filesystem::absolute(source_path, error);
+	std::string const key = (error ? std::filesystem::path(source_path) : absolute).generic_string();
+	return std::filesystem::path(HLXSCENE_CACHE_DIR) / (std::to_string(hash(key)) + ".hlxscene");
+}
+
+Error hlxscene::cook(gltf::data const &data) {
+	if (data.scene < 0 || static_cast<std::size_t>(data.scene) >= data.scenes.size())
+		return ERR_INVALID_DATA;
+	for (gltf::mesh const &mesh : data.meshes) {
+		for (gltf::primitive const &primitive : mesh.primitives) {
+			if (primitive.mode != gltf::primitive_mode::triangles || !hasPositions(primitive))
+				return ERR_INVALID_DATA;
+		}
+	}
+	for (gltf::node const &node : data.nodes) {
+		if (node.extensions.EXT_mesh_gpu_instancing.has_value())
+			return ERR_INVALID_DATA;
+	}
+
+	header h{};
+	h.magic = MAGIC;
+	h.version = VERSION;
+	h.vertex_stride = VERTEX_STRIDE;
+	h.flags = COOK_FLAGS;
+
+	string_table strings;
+
+	// The document and its external buffers. Images aren't part of the cooked data, so they aren't dependencies either.
+	Vec<std::string> dependency_paths{ data.path.string() };
+	for (gltf::buffer const &buffer : data.buffers) {
+		std::string const uri = buffer.uri();
+		if (uri.empty() || uri.starts_with("data:"))
+			continue;
+		dependency_paths.push_back(gltf::resolveUri(data.path.parent_path(), uri).string());
+	}
+
+	Vec<std::string_view> const dependency_views(dependency_paths.begin(), dependency_paths.end());
+	Result<u32> source_hash = sourceHash(dependency_views);
+	if (source_hash.error() != OK)
+		return source_hash.error();
+	h.source_hash = source_hash.value();
+
+	Vec<string_ref> dependencies;
+	dependencies.reserve(dependency_paths.size());
+	for (std::string const &path : dependency_paths)
+		dependencies.push_back(strings.add(path));
+
+	Vec<node_record> nodes;
+	Vec<u32> children;
+	nodes.reserve(data.nodes.size());
+	for (gltf::node const &node : data.nodes) {
+		nodes.push_back({
+			.name = strings.add(node.name),
+			.rotation = node.rotation,
+			.translation = node.translation,
+			.scale = node.scale,
+			.has_transform = node.has_transform ? 1u : 0u,
+			.mesh = node.mesh,
+			.light = node.extensions.KHR_lights_punctual.has_value() ? node.extensions.KHR_lights_punctual->light : -1,
+			.first_child = static_cast<u32>(children.size()),
+			.child_count = static_cast<u32>(node.children.size())
+		});
+		children.insert(children.end(), node.children.begin(), node.children.end());
+	}
+
+	gltf::scene const &default_scene = data.scenes[data.scene];
+	h.scene_name = strings.add(default_scene.name);
+	h.first_root = static_cast<u32>(children.size());
+	h.root_count = static_cast<u32>(default_scene.nodes.size());
+	children.insert(children.end(), default_scene.nodes.begin(), default_scene.nodes.end());
+
+	Vec<mesh_record> meshes;
+	Vec<primitive_record> primitives;
+	Vec<char> vertex_blob;
+	Vec<char> index_blob;
+	Vec<Meshlet> meshlets;
+	Vec<lod_record> lods;
+	u64 base_triangles = 0;
+	u64 lod_triangles = 0;
+
+	struct cooked_primitive {
+		InterleavedPrimitive geometry;
+		MeshOptimizationReport optimization;
+		Vec<Meshlet> meshlets;
+		Vec<SimplifiedLod> lods;
+	};
+
+	// Decoding, welding, tangents and reordering are independent per primitive, only the blobs are written in order.
+	Vec<std::future<cooked_primitive>> jobs;
+	for (gltf::mesh const &mesh : data.meshes) {
+		for (gltf::primitive const &primitive : mesh.primitives) {
+			auto job = std::make_shared<std::packaged_task<cooked_primitive()>>([&data, &primitive] {
+				cooked_primitive result{ .geometry = interleavePrimitive(data, primitive) };
+#if HLXSCENE_OPTIMIZE_MESHES
+				result.optimization = optimizeMesh(result.geometry);
+#endif
+#if HLXSCENE_BUILD_MESHLETS
+				if (!result.geometry.vertices.empty())
+					result.meshlets = buildMeshlets(result.geometry.indices, &result.geometry.vertices.front().position, sizeof(Vertex));
+#endif
+#if HLXSCENE_BUILD_LODS
+				result.lods = buildLodChain(result.geometry.indices, result.geometry.vertices);
+#endif
+				return result;
+			});
+			jobs.push_back(job->get_future());
+			ThreadPool::singleton()->addTaskToQueue([job] { (*job)(); });
+		}
+	}
+
+	MeshOptimizationReport optimization;
+	std::size_t source_vertices = 0;
+	std::size_t welded_vertices = 0;
+	std::size_t packed_bytes = 0;
+	std::size_t next_job = 0;
+	meshes.reserve(data.meshes.size());
+	for (gltf::mesh const &mesh : data.meshes) {
+		mesh_record record{
+			.name = strings.add(mesh.name),
+			.first_primitive = static_cast<u32>(primitives.size()),
+			.primitive_count = static_cast<u32>(mesh.primitives.size()),
+			.vertices = { vertex_blob.size(), 0 },
+			.indices = { index_blob.size(), 0 }
+		};
+
+		for (gltf::primitive const &primitive : mesh.primitives) {
+			std::future<cooked_primitive> &job = jobs[next_job++];
+			while (job.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready) {
+				// Texture loads still on the pool block on main thread tasks, keep those moving or the jobs never start.
+				if (Engine::singleton()->isOnMainThread())
+					Engine::singleton()->workLazyTasks();
+			}
+			auto [interleaved, report, primitive_meshlets, primitive_lods] = job.get();
+			optimization.before += report.before;
+			optimization.after += report.after;
+			source_vertices += interleaved.source_vertex_count;
+			welded_vertices += interleaved.vertices.size();
+
+			primitive_record cooked{
+				.vertex_offset = vertex_blob.size() - record.vertices.offset,
+				.index_offset = index_blob.size() - record.indices.offset,
+				.vertex_count = static_cast<u32>(interleaved.vertices.size()),
+				.index_count = static_cast<u32>(interleaved.indices.size()),
+				.index_type = static_cast<gl::enum_t>(gl::DrawElementsType::UnsignedInt),
+				.material = primitive.material,
+				.aabb_center = interleaved.aabb.center,
+				.aabb_extents = interleaved.aabb.extents,
+				.first_meshlet = static_cast<u32>(meshlets.size()),
+				.meshlet_count = static_cast<u32>(primitive_meshlets.size()),
+				.first_lod = static_cast<u32>(lods.size()),
+				.lod_count = static_cast<u32>(primitive_lods.size())
+			};
+			meshlets.insert(meshlets.end(), primitive_meshlets.begin(), primitive_meshlets.end());
+
+#if HLXSCENE_PACK_VERTICES
+			// Welding and normal accessors' min/max leave the bounds loose or stale, quantize against the exact ones.
+			if (!interleaved.vertices.empty()) {
+				AABB const bounds = computePositionBounds(&interleaved.vertices.front().position, interleaved.vertices.size(), sizeof(Vertex));
+				cooked.aabb_center = bounds.center;
+				cooked.aabb_extents = bounds.extents;
+			}
+			std::size_t const packed_offset = vertex_blob.size();
+			vertex_blob.resize(packed_offset + interleaved.vertices.size() * sizeof(PackedVertex));
+			packVertices(interleaved.vertices, AABB(cooked.aabb_center, cooked.aabb_extents.x, cooked.aabb_extents.y, cooked.aabb_extents.z),
+			             reinterpret_cast<PackedVertex *>(vertex_blob.data() + packed_offset));
+			packed_bytes += interleaved.vertices.size() * sizeof(PackedVertex);
+#else
+			char const *const vertex_bytes = reinterpret_cast<char const *>(interleaved.vertices.data());
+			vertex_blob.insert(vertex_blob.end(), vertex_bytes, vertex_bytes + interleaved.vertices.size() * sizeof(Vertex));
+#endif
+
+			bool const narrow_indices = interleaved.vertices.size() <= 0x10000;
+			if (narrow_indices)
+				cooked.index_type = static_cast<gl::enum_t>(gl::DrawElementsType::UnsignedShort);
+			auto const appendIndices = [&](std::span<u32 const> const source) {
+				if (narrow_indices) {
+					for (u32 const index : source) {
+						u16 const narrow = static_cast<u16>(index);
+						index_blob.insert(index_blob.end(), reinterpret_cast<char const *>(&narrow), reinterpret_cast<char const *>(&narrow) + sizeof(u16));
+					}
+					// Keep every range's first index 4 byte aligned.
+					index_blob.resize((index_blob.size() + 3) & ~std::size_t(3));
+				}
+				else {
+					char const *const index_bytes = reinterpret_cast<char const *>(source.data());
+					index_blob.insert(index_blob.end(), index_bytes, index_bytes + source.size_bytes());
+				}
+			};
+			appendIndices(interleaved.indices);
+
+			base_triangles += interleaved.indices.size() / 3;
+			for (SimplifiedLod const &lod : primitive_lods) {
+				lods.push_back({
+					.index_offset = index_blob.size() - record.indices.offset,
+					.index_count = static_cast<u32>(lod.indices.size()),
+					.error = lod.error
+				});
+				appendIndices(lod.indices);
+				lod_triangles += lod.indices.size() / 3;
+			}
+
+			primitives.push_back(cooked);
+		}
+
+		record.vertices.size = vertex_blob.size() - record.vertices.offset;
+		record.indices.size = index_blob.size() - record.indices.offset;
+		meshes.push_back(record);
+	}
+	printf("[hlxscene] welded %zu -> %zu vertices, %.2f MiB saved\n", source_vertices, welded_vertices,
+	       static_cast<f64>((source_vertices - welded_vertices) * sizeof(Vertex)) / (1024.0 * 1024.0));
+#if HLXSCENE_PACK_VERTICES
+	printf("[hlxscene] packed vertices: %.2f MiB -> %.2f MiB\n", static_cast<f64>(welded_vertices * sizeof(Vertex)) / (1024.0 * 1024.0),
+	       static_cast<f64>(packed_bytes) / (1024.0 * 1024.0));
+#endif
+#if HLXSCENE_BUILD_LODS
+	printf("[hlxscene] %llu triangle(s) at full detail, %llu more over %zu simplified level(s)\n",
+	       static_cast<unsigned long long>(base_triangles), static_cast<unsigned long long>(lod_triangles), lods.size());
+#endif
+#if HLXSCENE_OPTIMIZE_MESHES
+	printf("[hlxscene] vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+	       optimization.before.acmr(), optimization.after.acmr(), optimization.before.atvr(), optimization.after.atvr());
+#endif
+
+	Vec<material_record> materials;
+	materials.reserve(data.materials.size());
+	for (gltf::material const &material : data.materials) {
+		materials.push_back({
+			.name = strings.add(material.name),
+			.base_color_factor = material.pbr_metallic_roughness.base_color_factor,
+			.emissive_factor = material.emissive_factor,
+			.metallic_factor = material.pbr_metallic_roughness.metallic_factor,
+			.roughness_factor = material.pbr_metallic_roughness.roughness_factor,
+			.alpha_cutoff = material.alpha_cutoff,
+			.alpha_mode = static_cast<u32>(material.alpha_mode),
+			.double_sided = material.double_sided ? 1u : 0u,
+			.base_color_texture = makeTextureRef(material.pbr_metallic_roughness.base_color_texture),
+			.metallic_roughness_texture = makeTextureRef(material.pbr_metallic_roughness.metallic_roughness_texture),
+			.normal_texture = makeTextureRef(material.normal_texture),
+			.occlusion_texture = makeTextureRef(material.occlusion_texture),
+			.emissive_texture = makeTextureRef(material.emissive_texture)
+		});
+	}
+
+	Vec<texture_record> textures;
+	textures.reserve(data.textures.size());
+	for (gltf::texture const &texture : data.textures) {
+		gltf::sampler const sampler = static_cast<std::size_t>(texture.sampler) < data.samplers.size() ? data.samplers[texture.sampler] : gltf::sampler{};
+		textures.push_back({
+			.source = texture.source,
+			.mag_filter = static_cast<gl::enum_t>(sampler.mag_filter),
+			.min_filter = static_cast<gl::enum_t>(sampler.min_filter),
+			.wrap_s_mode = static_cast<gl::enum_t>(sampler.wrap_s_mode),
+			.wrap_t_mode = static_cast<gl::enum_t>(sampler.wrap_t_mode)
+		});
+	}
+
+	Vec<image_record> images;
+	Vec<char> image_bytes;
+	images.reserve(data.images.size());
+	for (gltf::image const &image : data.images) {
+		image_record record{
+			.name = strings.add(image.name),
+			.mime_type = strings.add(image.mimeType),
+			.uri = strings.add(image.source_uri),
+			.bytes = { image_bytes.size(), image.embedded.size() }
+		};
+		image_bytes.insert(image_bytes.end(), image.embedded.begin(), image.embedded.end());
+		images.push_back(record);
+	}
+
+	Vec<light_record> lights;
+	if (data.extensions.KHR_lights_punctual.has_value()) {
+		for (gltf::khr::lights_punctual::light const &light : data.extensions.KHR_lights_punctual->lights) {
+			lights.push_back({
+				.name = strings.add(light.name),
+				.color = light.color,
+				.intensity = light.intensity,
+				.type = static_cast<u32>(light.type),
+				.range = light.range,
+				.has_spot = light.spot.has_value() ? 1u : 0u,
+				.inner_cone_angle = light.spot.has_value() ? light.spot->inner_cone_angle : 0.0f,
+				.outer_cone_angle = light.spot.has_value() ? light.spot->outer_cone_angle : 0.0f
+			});
+		}
+	}
+
+	writer w;
+	h.strings = w.append(strings.chars());
+	h.dependencies = w.append(dependencies);
+	h.nodes = w.append(nodes);
+	h.children = w.append(children);
+	h.meshes = w.append(meshes);
+	h.primitives = w.append(primitives);
+	h.materials = w.append(materials);
+	h.textures = w.append(textures);
+	h.images = w.append(images);
+	h.lights = w.append(lights);
+	h.image_bytes = w.append(image_bytes);
+	h.vertices = w.append(vertex_blob);
+	h.indices = w.append(index_blob);
+	h.meshlets = w.append(meshlets);
+	h.lods = w.append(lods);
+	w.finish(h);
+
+	std::filesystem::path const destination = cachePath(data.path.string());
+	std::filesystem::path temporary = destination;
+	temporary += ".tmp";
+
+	std::error_code error;
+	std::filesystem::create_directories(destination.parent_path(), error);
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return ERR_FILE_CANT_OPEN;
+		file.write(w.bytes().data(), static_cast<std::streamsize>(w.bytes().size()));
+		if (!file.good())
+			return ERR_FILE_CANT_WRITE;
+	}
+	std::filesystem::rename(temporary, destination, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return ERR_FILE_CANT_WRITE;
+	}
+	return OK;
+}
+
+Result<SharedPtr<scene>> scene::open(std::string const &source_path, gltf::parse_options const &options) {
+	std::filesystem::path const path = cachePath(source_path);
+	Result<SharedPtr<os::MappedFile>> mapped = os::MappedFile::open(path.string());
+	if (mapped.error() != OK)
+		return { mapped.error(), __LINE__ };
+
+	SharedPtr<scene> cooked(new scene());
+	cooked->file_ = mapped.value();
+	cooked->bytes_ = { cooked->file_->data(), static_cast<std::size_t>(cooked->file_->size()) };
+
+	u64 const file_size = cooked->bytes_.size();
+	if (file_size < sizeof(header))
+		return { ERR_FILE_CORRUPT, __LINE__ };
+
+	header const &h = *reinterpret_cast<header const *>(cooked->bytes_.data());
+	if (h.magic != MAGIC || h.version != VERSION || h.vertex_stride != VERTEX_STRIDE || h.flags != COOK_FLAGS)
+		return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+	if (h.file_size != file_size)
+		return { ERR_FILE_CORRUPT, __LINE__ };
+	for (section const &s : { h.strings, h.dependencies, h.nodes, h.children, h.meshes, h.primitives, h.materials,
+	                          h.textures, h.images, h.lights, h.image_bytes, h.vertices, h.indices, h.meshlets, h.lods }) {
+		if (s.offset > file_size || s.size > file_size - s.offset)
+			return { ERR_FILE_CORRUPT, __LINE__ };
+	}
+	cooked->header_ = &h;
+
+	// Re-stat what it was cooked from, a different hash means the source changed and the cooked copy is stale.
+	Vec<std::string_view> dependency_paths;
+	for (string_ref const ref : cooked->table<string_ref>(h.dependencies))
+		dependency_paths.push_back(cooked->string(ref));
+	Result<u32> source_hash = sourceHash(dependency_paths);
+	if (source_hash.error() != OK)
+		return { source_hash.error(), __LINE__ };
+	if (source_hash.value() != h.source_hash)
+		return { ERR_INVALID_DATA, __LINE__ };
+
+	gltf::data &data = cooked->data_;
+	data.path = source_path;
+	data.scene = 0;
+
+	std::span<u32 const> const children = cooked->table<u32>(h.children);
+	if (static_cast<std::size_t>(h.first_root) + h.root_count > children.size())
+		return { ERR_FILE_CORRUPT, __LINE__ };
+	std::span<u32 const> const roots = children.subspan(h.first_root, h.root_count);
+	data.scenes.push_back({ .name = std::string(cooked->string(h.scene_name)), .nodes = { roots.begin(), roots.end() } });
+
+	std::span<node_record const> const nodes = cooked->table<node_record>(h.nodes);
+	data.nodes.resize(nodes.size());
+	for (std::size_t i = 0; i < nodes.size(); i++) {
+		node_record const &record = nodes[i];
+		if (static_cast<std::size_t>(record.first_child) + record.child_count > children.size())
+			return { ERR_FILE_CORRUPT, __LINE__ };
+		gltf::node &node = data.nodes[i];
+		node.name = cooked->string(record.name);
+		node.rotation = record.rotation;
+		node.translation = record.translation;
+		node.scale = record.scale;
+		node.has_transform = record.has_transform != 0;
+		node.mesh = record.mesh;
+		std::span<u32 const> const node_children = children.subspan(record.first_child, record.child_count);
+		node.children.assign(node_children.begin(), node_children.end());
+		if (record.light >= 0)
+			node.extensions.KHR_lights_punctual = gltf::khr::lights_punctual::node{ record.light };
+	}
+
+	// Meshes only carry their names here, Mesh reads the geometry straight from the mapping, so every range is checked up front.
+	std::span<mesh_record const> const meshes = cooked->meshes();
+	if (!meshRangesValid(h, meshes, cooked->table<primitive_record>(h.primitives), cooked->table<lod_record>(h.lods)))
+		return { ERR_FILE_CORRUPT, __LINE__ };
+	if (!referencesValid(children, nodes, meshes.size(), cooked->table<primitive_record>(h.primitives), cooked->table<material_record>(h.materials),
+	                     cooked->table<texture_record>(h.textures), cooked->table<image_record>(h.images).size(), cooked->table<light_record>(h.lights).size()))
+		return { ERR_FILE_CORRUPT, __LINE__ };
+	data.meshes.resize(meshes.size());
+	for (std::size_t i = 0; i < meshes.size(); i++)
+		data.meshes[i].name = cooked->string(meshes[i].name);
+
+	for (material_record const &record : cooked->table<material_record>(h.materials)) {
+		gltf::material &material = data.materials.emplace_back();
+		material.name = cooked->string(record.name);
+		material.emissive_factor = record.emissive_factor;
+		material.emissive_texture = makeTextureInfo(record.emissive_texture);
+		material.normal_texture = makeTextureInfo(record.normal_texture);
+		material.occlusion_texture = makeTextureInfo(record.occlusion_texture);
+		material.pbr_metallic_roughness.base_color_texture = makeTextureInfo(record.base_color_texture);
+		material.pbr_metallic_roughness.base_color_factor = record.base_color_factor;
+		material.pbr_metallic_roughness.metallic_roughness_texture = makeTextureInfo(record.metallic_roughness_texture);
+		material.pbr_metallic_roughness.metallic_factor = record.metallic_factor;
+		material.pbr_metallic_roughness.roughness_factor = record.roughness_factor;
+		material.double_sided = record.double_sided != 0;
+		material.alpha_cutoff = record.alpha_cutoff;
+		material.alpha_mode = static_cast<gltf::alpha_mode>(record.alpha_mode);
+	}
+
+	// Samplers were folded into the texture records, every texture gets its own back.
+	std::span<texture_record const> const textures = cooked->table<texture_record>(h.textures);
+	data.textures.reserve(textures.size());
+	data.samplers.reserve(textures.size());
+	for (texture_record const &record : textures) {
+		data.samplers.push_back({
+			.mag_filter = static_cast<gl::TextureMagFilter>(record.mag_filter),
+			.min_filter = static_cast<gl::TextureMinFilter>(record.min_filter),
+			.wrap_s_mode = static_cast<gl::TextureWrapMode>(record.wrap_s_mode),
+			.wrap_t_mode = static_cast<gl::TextureWrapMode>(record.wrap_t_mode)
+		});
+		data.textures.push_back({ .sampler = static_cast<gltf::id>(data.samplers.size() - 1), .source = record.source });
+	}
+
+	std::span<image_record const> const images = cooked->table<image_record>(h.images);
+	std::span<char const> const image_bytes = cooked->bytes_.subspan(h.image_bytes.offset, h.image_bytes.size);
+	data.images.resize(images.size());
+	for (std::size_t i = 0; i < images.size(); i++) {
+		image_record const &record = images[i];
+		gltf::image &image = data.images[i];
+		image.name = cooked->string(record.name);
+		image.mimeType = cooked->string(record.mime_type);
+		image.source_uri = cooked->string(record.uri);
+		if (!image.source_uri.empty())
+			continue;
+
+		if (record.bytes.offset > image_bytes.size() || record.bytes.size > image_bytes.size() - record.bytes.offset)
+			return { ERR_FILE_CORRUPT, __LINE__ };
+		std::span<char const> const encoded = image_bytes.subspan(record.bytes.offset, record.bytes.size);
+		image.embedded = { reinterpret_cast<u8 const *>(encoded.data()), encoded.size() };
+		image.image_type = image.mimeType == "image/png" ? gltf::image_type_png : gltf::image_type_generic;
+		image.hash_value = hash(path.string() + '#' + std::to_string(i));
+	}
+	gltf::probeImages(data.path, data.images, options);
+
+	std::span<light_record const> const lights = cooked->table<light_record>(h.lights);
+	if (!lights.empty()) {
+		gltf::khr::lights_punctual::global &global = data.extensions.KHR_lights_punctual.emplace();
+		global.lights.reserve(lights.size());
+		for (light_record const &record : lights) {
+			gltf::khr::lights_punctual::light &light = global.lights.emplace_back();
+			light.name = cooked->string(record.name);
+			light.color = record.color;
+			light.intensity = record.intensity;
+			light.type = static_cast<gltf::khr::lights_punctual::light_type>(record.type);
+			light.range = record.range;
+			if (record.has_spot != 0)
+				light.spot = gltf::khr::lights_punctual::spot{ record.inner_cone_angle, record.outer_cone_angle };
+		}
+	}
+
+	return cooked;
+}
+
+std::span<mesh_record const> scene::meshes() const {
+	return table<mesh_record>(header_->meshes);
+}
+
+std::span<primitive_record const> scene::primitives(mesh_record const &mesh) const {
+	return table<primitive_record>(header_->primitives).subspan(mesh.first_primitive, mesh.primitive_count);
+}
+
+std::span<char const> scene::vertices(mesh_record const &mesh) const {
+	return bytes_.subspan(header_->vertices.offset + mesh.vertices.offset, mesh.vertices.size);
+}
+
+std::span<char const> scene::indices(mesh_record const &mesh) const {
+	return bytes_.subspan(header_->indices.offset + mesh.indices.offset, mesh.indices.size);
+}
+
+std::span<Meshlet const> scene::meshlets(primitive_record const &primitive) const {
+	std::span<Meshlet const> const all = table<Meshlet>(header_->meshlets);
+	if (primitive.first_meshlet > all.size() || primitive.meshlet_count > all.size() - primitive.first_meshlet)
+		return {};
+	return all.subspan(primitive.first_meshlet, primitive.meshlet_count);
+}
+
+std::span<lod_record const> scene::lods(primitive_record const &primitive) const {
+	std::span<lod_record const> const all = table<lod_record>(header_->lods);
+	if (primitive.first_lod > all.size() || primitive.lod_count > all.size() - primitive.first_lod)
+		return {};
+	return all.subspan(primitive.first_lod, primitive.lod_count);
+}
+
+std::string_view scene::string(string_ref const ref) const {
+	std::span<char const> const chars = bytes_.subspan(header_->strings.offset, header_->strings.size);
+	if (ref.offset > chars.size() || ref.length > chars.size() - ref.offset)
+		return {};
+	return { chars.data() + ref.offset, ref.length };
+}
@@ -0,0 +1,226 @@
+﻿#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "types.hpp"
+#include "util.hpp"
+#include "gltf.h"
+#include "mesh.hpp"
+#include "meshlet.hpp"
+#include "vertex_packing.hpp"
+
+namespace os {
+	class MappedFile;
+}
+
+/* Cooked scenes live next to the image cache, one file per source scene. */
+#define HLXSCENE_CACHE_DIR ".local/scene-cache/"
+/* Run the vertex cache, overdraw and fetch passes from mesh_optimizer.hpp over every primitive while cooking. */
+#define HLXSCENE_OPTIMIZE_MESHES 1
+/* Partition every primitive into meshlets (see meshlet.hpp) and store them next to its indices. */
+#define HLXSCENE_BUILD_MESHLETS 1
+/* Simplify every primitive into a LOD chain (see mesh_lod.hpp), levels are extra index ranges over the same vertices. */
+#define HLXSCENE_BUILD_LODS 1
+/* Store vertices as PackedVertex (see vertex_packing.hpp) instead of Vertex, 24 bytes instead of 64 to upload and fetch. */
+#define HLXSCENE_PACK_VERTICES 0
+
+//
+// .hlxscene is a cooked copy of a glTF scene, written after the first import and mapped on every launch after that.
+//
+// Every table is an array of fixed size records starting at a section offset from the start of the file,
+// so opening one is a handful of bounds checks. Vertex and index blobs are already in the layout Mesh uploads,
+// they go from the mapping straight into glNamedBufferStorage. Images aren't cooked, they are probed from
+// their source files like gltf::parse() would (embedded images are the exception, their bytes are stored).
+//
+// A cooked file is only used if every file it was cooked from still has the same size and write time,
+// and if it was cooked with the same FLAG_ bits this build would cook it with.
+//
+namespace hlxscene {
+	constexpr u32 MAGIC = charsToType<u32>("HLXS");
+	constexpr u32 VERSION = 5;
+
+	constexpr u32 FLAG_OPTIMIZED_MESHES = 1u << 0; //< Triangles and vertices were reordered by optimizeMesh().
+	constexpr u32 FLAG_MESHLETS = 1u << 1; //< Primitives have meshlets.
+	constexpr u32 FLAG_LODS = 1u << 2; //< Primitives have simplified levels.
+	constexpr u32 FLAG_PACKED_VERTICES = 1u << 3; //< The vertex blob holds PackedVertex rather than Vertex.
+	constexpr u32 COOK_FLAGS = (HLXSCENE_OPTIMIZE_MESHES ? FLAG_OPTIMIZED_MESHES : 0u) | (HLXSCENE_BUILD_MESHLETS ? FLAG_MESHLETS : 0u)
+	                         | (HLXSCENE_BUILD_LODS ? FLAG_LODS : 0u) | (HLXSCENE_PACK_VERTICES ? FLAG_PACKED_VERTICES : 0u);
+	constexpr u32 VERTEX_STRIDE = HLXSCENE_PACK_VERTICES ? sizeof(PackedVertex) : sizeof(Vertex);
+
+	struct section {
+		u64 offset;
+		u64 size; //< In bytes.
+	};
+
+	struct string_ref {
+		u32 offset; //< Into the string table.
+		u32 length;
+	};
+
+	struct header {
+		u32 magic;
+		u32 version;
+		u32 source_hash;	//< Hash of the size and write time of every dependency, see sourceHash().
+		u32 vertex_stride;	//< VERTEX_STRIDE of the engine that cooked it.
+		u64 file_size;
+		string_ref scene_name;
+		u32 first_root;		//< Into `children`, the default scene's top level nodes.
+		u32 root_count;
+		u32 flags;			//< FLAG_ bits.
+
+		section strings;
+		section dependencies;	//< string_ref, paths of the files this was cooked from.
+		section nodes;			//< node_record
+		section children;		//< u32 node indices
+		section meshes;			//< mesh_record
+		section primitives;		//< primitive_record
+		section materials;		//< material_record
+		section textures;		//< texture_record
+		section images;			//< image_record
+		section lights;			//< light_record
+		section image_bytes;	//< Encoded embedded images.
+		section vertices;		//< Vertex, or PackedVertex with FLAG_PACKED_VERTICES.
+		section indices;		//< u16 or u32, per primitive.
+		section meshlets;		//< Meshlet, per primitive.
+		section lods;			//< lod_record, per primitive.
+	};
+
+	struct node_record {
+		string_ref name;
+		glm::quat rotation;
+		vec3 translation;
+		vec3 scale;
+		u32 has_transform;
+		i32 mesh;
+		i32 light;	//< KHR_lights_punctual, -1 when the node has none.
+		u32 first_child;
+		u32 child_count;
+	};
+
+	struct mesh_record {
+		string_ref name;
+		u32 first_primitive;
+		u32 primitive_count;
+		section vertices;	//< Relative to the vertex blob, the part owned by this mesh.
+		section indices;	//< Relative to the index blob, the part owned by this mesh.
+	};
+
+	struct primitive_record {
+		u64 vertex_offset;	//< Bytes, relative to the mesh's vertices.
+		u64 index_offset;	//< Bytes, relative to the mesh's indices.
+		u32 vertex_count;
+		u32 index_count;
+		gl::enum_t index_type;	//< gl::DrawElementsType
+		u32 material;
+		vec3 aabb_center;
+		vec3 aabb_extents;	//< Packed positions are fractions of these bounds.
+		u32 first_meshlet;	//< Into `meshlets`, first_index counts from this primitive's first index.
+		u32 meshlet_count;
+		u32 first_lod;		//< Into `lods`, level 1 onwards, the primitive's own indices are level 0.
+		u32 lod_count;
+	};
+
+	struct lod_record {
+		u64 index_offset;	//< Bytes, relative to the mesh's indices, same index type as the primitive.
+		u32 index_count;
+		f32 error;			//< Object space, see SimplifiedLod::error.
+	};
+
+	struct texture_ref {
+		i32 index;
+		i32 tex_coord;
+		f32 scale;
+		u32 exists;
+	};
+
+	struct material_record {
+		string_ref name;
+		vec4 base_color_factor;
+		vec4 emissive_factor;
+		f32 metallic_factor;
+		f32 roughness_factor;
+		f32 alpha_cutoff;
+		u32 alpha_mode;
+		u32 double_sided;
+		texture_ref base_color_texture;
+		texture_ref metallic_roughness_texture;
+		texture_ref normal_texture;
+		texture_ref occlusion_texture;
+		texture_ref emissive_texture;
+	};
+
+	struct texture_record {
+		i32 source;
+		gl::enum_t mag_filter;
+		gl::enum_t min_filter;
+		gl::enum_t wrap_s_mode;
+		gl::enum_t wrap_t_mode;
+	};
+
+	struct image_record {
+		string_ref name;
+		string_ref mime_type;
+		string_ref uri;		//< As written in the document, empty for embedded images.
+		section bytes;		//< Relative to `image_bytes`, only for embedded images.
+	};
+
+	struct light_record {
+		string_ref name;
+		vec3 color;
+		f32 intensity;
+		u32 type;
+		f32 range;
+		u32 has_spot;
+		f32 inner_cone_angle;
+		f32 outer_cone_angle;
+	};
+
+	/*
+	 * A mapped .hlxscene. Everything the entity importer needs besides geometry is rebuilt into `data()`,
+	 * the geometry itself stays in the mapping until Mesh uploads it.
+	 */
+	class scene : public NoCopy {
+	public:
+		/* Opens the cooked copy of `source_path`, fails if there is none or if it went stale. */
+		static Result<SharedPtr<scene>> open(_STD string const &source_path, gltf::parse_options const &options = {});
+
+		_NODISCARD gltf::data &data() { return data_; }
+		_NODISCARD gltf::data const &data() const { return data_; }
+
+		_NODISCARD _STD span<mesh_record const> meshes() const;
+		_NODISCARD _STD span<primitive_record const> primitives(mesh_record const &mesh) const;
+		_NODISCARD _STD span<char const> vertices(mesh_record const &mesh) const;
+		_NODISCARD _STD span<char const> indices(mesh_record const &mesh) const;
+		_NODISCARD _STD span<Meshlet const> meshlets(primitive_record const &primitive) const;
+		_NODISCARD _STD span<lod_record const> lods(primitive_record const &primitive) const;
+		_NODISCARD bool packedVertices() const { return (header_->flags & FLAG_PACKED_VERTICES) != 0; }
+		_NODISCARD _STD string_view string(string_ref ref) const;
+
+	private:
+		scene() = default;
+
+		template <typename T>
+		_NODISCARD _STD span<T const> table(section const &s) const {
+			return { reinterpret_cast<T const *>(bytes_.data() + s.offset), static_cast<_STD size_t>(s.size / sizeof(T)) };
+		}
+
+		SharedPtr<os::MappedFile> file_;
+		_STD span<char const> bytes_;
+		header const *header_ = nullptr;
+		gltf::data data_;
+	};
+
+	/* Where the cooked copy of `source_path` goes. */
+	extern _STD filesystem::path cachePath(_STD string const &source_path);
+
+	/*
+	 * Cooks an imported scene to cachePath(data.path). The file is written next to its destination and renamed over it,
+	 * so an interrupted cook never leaves a partial file behind. Scenes using anything the cooked format can't express
+	 * (non-triangle primitives, missing positions, EXT_mesh_gpu_instancing nodes) are refused with ERR_INVALID_DATA and keep loading from glTF.
+	 * Any thread, the startup scene is cooked from a ThreadPool task while its per-primitive jobs run on the other workers.
+	 */
+	extern Error cook(gltf::data const &data);
+}
@@ -0,0 +1,119 @@
+﻿#include "indirect_draws.hpp"
+
+#include <algorithm>
+
+#include "material.hpp"
+#include "model_manager.hpp"
+#include "vertex_packing.hpp"
+
+void IndirectDrawBatch::clear() {
+	models_.clear();
+	materials_.clear();
+	material_indices_.clear();
+	draws_.clear();
+}
+
+u32 IndirectDrawBatch::addModel(mat4 const &model) {
+	models_.push_back(model);
+	return static_cast<u32>(models_.size() - 1);
+}
+
+void IndirectDrawBatch::add(u32 const model_index, Material const *material, GeometryHandle const geometry, u32 const first_index, u32 const index_count) {
+	auto const [it, inserted] = material_indices_.try_emplace(material, static_cast<u32>(materials_.size()));
+	if (inserted)
+		materials_.push_back(material);
+	draws_.push_back({
+		.geometry = geometry,
+		.first_index = first_index,
+		.index_count = index_count,
+		.model_index = model_index,
+		.material_index = it->second
+	});
+}
+
+void IndirectDrawBatch::upload(StreamBuffer &buffer, std::size_t const size, void const *data) {
+	if (buffer.buffer == nullptr || buffer.capacity < size) {
+		// Storage is immutable, a bigger batch gets a new buffer.
+		buffer.capacity = std::max(size, buffer.capacity * 2);
+		buffer.buffer = std::make_shared<Buffer>();
+		buffer.buffer->allocate(buffer.capacity, nullptr, gl::BufferStorageMask::DynamicStorageBit);
+		buffer.buffer->setLabel(buffer.label);
+	}
+	buffer.buffer->update(size, 0, data);
+}
+
+void IndirectDrawBatch::submit(RenderPassInfo const &info) {
+	if (draws_.empty())
+		return;
+	gpu_check;
+	ModelManager const *const pool = ModelManager::singleton();
+
+	// Only passes that bind textures care about materials, the rest go out in a single draw call.
+	bool const binds_materials = info.bind_albedo_texture || info.bind_normal_texture || info.bind_orm_texture;
+	if (binds_materials)
+		std::ranges::stable_sort(draws_, {}, &QueuedDraw::material_index);
+
+	commands_.clear();
+	draw_data_.clear();
+	for (QueuedDraw const &draw : draws_) {
+		GeometryRange const &range = pool->range(draw.geometry);
+		commands_.push_back({
+			.count = draw.index_count,
+			.instance_count = 1,
+			.first_index = range.first_index + draw.first_index,
+			.base_vertex = static_cast<i32>(range.base_vertex),
+			.base_instance = static_cast<u32>(draw_data_.size())
+		});
+		draw_data_.push_back({ .model_index = draw.model_index, .material_index = draw.material_index });
+	}
+	upload(model_buffer_, models_.size() * sizeof(mat4), models_.data());
+	upload(command_buffer_, commands_.size() * sizeof(DrawElementsIndirectCommand), commands_.data());
+	upload(draw_data_buffer_, draw_data_.size() * sizeof(IndirectDrawData), draw_data_.data());
+
+	using enum gl::BufferTargetARB;
+	model_buffer_.buffer->bindBufferBase(ShaderStorageBuffer, INDIRECT_MODEL_BUFFER_BINDING);
+	draw_data_buffer_.buffer->bindBufferBase(ShaderStorageBuffer, INDIRECT_DRAW_BUFFER_BINDING);
+	command_buffer_.buffer->bind(DrawIndirectBuffer);
+
+	// The model matrices come from the buffer, whatever the last component left in the uniforms must not apply.
+	Program const *program = info.shader_program;
+	if (info.bind_model_matrix) {
+		if (info.model_matrix_location != -1)
+			program->setUniform(info.model_matrix_location, mat4(1.0f));
+		if (info.inverse_model_matrix_location != -1)
+			program->setUniform(info.inverse_model_matrix_location, mat4(1.0f));
+	}
+	if (info.bind_vertex_packing)
+		program->setUniform(VERTEX_PACKING_UNIFORM_LOCATION, 0); //< The pool only holds Vertex.
+	program->setUniform(INDIRECT_UNIFORM_LOCATION, 1);
+
+	VertexArray const &vertex_array = *pool->vertexArray();
+	std::size_t first = 0;
+	while (first < draws_.size()) {
+		std::size_t last = draws_.size();
+		if (binds_materials) {
+			last = first + 1;
+			while (last < draws_.size() && draws_[last].material_index == draws_[first].material_index)
+				last++;
+			if (Material const *material = materials_[draws_[first].material_index])
+				material->bind(info);
+		}
+		vertex_array.multiDrawIndirect(first * sizeof(DrawElementsIndirectCommand), static_cast<i32>(last - first));
+		first = last;
+	}
+
+	program->setUniform(INDIRECT_UNIFORM_LOCATION, 0);
+	gpu_check;
+}
+
+void IndirectDrawBatch::dispose() {
+	clear();
+	for (StreamBuffer *buffer : { &model_buffer_, &command_buffer_, &draw_data_buffer_ }) {
+		buffer->buffer.reset();
+		buffer->capacity = 0;
+	}
+}
+
+bool IndirectDrawBatch::disposed() const {
+	return model_buffer_.buffer == nullptr && command_buffer_.buffer == nullptr && draw_data_buffer_.buffer == nullptr;
+}
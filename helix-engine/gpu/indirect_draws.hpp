@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include "buffer.h"
+#include "mesh.hpp"
+
+/* Queue pooled geometry into an IndirectDrawBatch and draw it with glMultiDrawElementsIndirect, 0 draws it one primitive at a time. */
+#define RENDER_MULTI_DRAW_INDIRECT 1
+
+/* See shaders/instancing.glsl. */
+constexpr i32 INDIRECT_UNIFORM_LOCATION = 44;
+constexpr u32 INDIRECT_MODEL_BUFFER_BINDING = 15;
+constexpr u32 INDIRECT_DRAW_BUFFER_BINDING = 16;
+
+/* What glMultiDrawElementsIndirect reads per draw. */
+struct DrawElementsIndirectCommand {
+	u32 count;
+	u32 instance_count;
+	u32 first_index;
+	i32 base_vertex;
+	u32 base_instance; //< Index of the draw's IndirectDrawData, the shaders read it back as gl_BaseInstance.
+};
+
+/* Per draw data the shaders look up with gl_BaseInstance. */
+struct IndirectDrawData {
+	u32 model_index;	//< Into the batch's model matrices.
+	u32 material_index;	//< Into the batch's materials, in the order they were first queued.
+};
+
+/*
+ * Draws of one render pass over ModelManager's pool. Components queue their pooled primitives while
+ * SceneTree::initiateDraw visits them, submit() then builds the command and per draw buffers and draws all of it
+ * with one glMultiDrawElementsIndirect per material, or a single one when the pass binds no material textures.
+ * Ranges are looked up at submit() time, a defragment between queueing and submitting is harmless.
+ */
+class IndirectDrawBatch : public IDisposable {
+public:
+	void clear();
+	_NODISCARD bool empty() const { return draws_.empty(); }
+
+	/* A model matrix for add() to refer to. */
+	_NODISCARD u32 addModel(mat4 const &model);
+	/* `index_count` indices starting `first_index` into the allocation, see ModelManager::draw(). */
+	void add(u32 model_index, Material const *material, GeometryHandle geometry, u32 first_index, u32 index_count);
+
+	void submit(RenderPassInfo const &info);
+
+	void dispose() override;
+	[[nodiscard]] bool disposed() const override;
+
+private:
+	struct QueuedDraw {
+		GeometryHandle geometry;
+		u32 first_index;
+		u32 index_count;
+		u32 model_index;
+		u32 material_index;
+	};
+
+	struct StreamBuffer {
+		SharedPtr<Buffer> buffer;
+		_STD size_t capacity = 0; //< Bytes.
+		char const *label;
+	};
+
+	/* Uploads `data`, replacing the buffer with one twice as large when it doesn't fit. */
+	static void upload(StreamBuffer &buffer, _STD size_t size, void const *data);
+
+	Vec<mat4> models_;
+	Vec<Material const *> materials_;
+	UnorderedMap<Material const *, u32> material_indices_;
+	Vec<QueuedDraw> draws_;
+	Vec<DrawElementsIndirectCommand> commands_;
+	Vec<IndirectDrawData> draw_data_;
+
+	StreamBuffer model_buffer_{ .label = "Indirect Models" };
+	StreamBuffer command_buffer_{ .label = "Indirect Commands" };
+	StreamBuffer draw_data_buffer_{ .label = "Indirect Draw Data" };
+};
@@ -1,13 +1,12 @@
 ﻿#include "dds.hpp"
 
-#include <cassert>
-#include <format>
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iostream>
-#include <Windows.h>
 
+#include "os.hpp"
 #include "util.hpp"
-#include "glad/glad.h"
-#include "gpu/graphics.hpp"
 
 // #define DDS_LOADER_DEBUG
 
@@ -17,17 +16,10 @@
 #define DDS_DebugPrint(...)
 #endif
 
-#ifdef _DEBUG
-typedef struct {
-	std::atomic<size_t> allocated_memory_;
-	std::atomic<size_t> images_loaded;
-} DDS_DEBUG_STATE;
-
-static DDS_DEBUG_STATE state{0,0};
+/* D3D11's limit, GL_MAX_ARRAY_TEXTURE_LAYERS is at least as big on everything we run on. */
+constexpr u32 DDS_MAX_ARRAY_SIZE = 2048;
 
-#endif
-
-typedef enum : DWORD {
+typedef enum : u32 {
 	CAPS = 0x1,
 	HEIGHT = 0x2,
 	WIDTH = 0x4,
@@ -38,7 +30,7 @@ typedef enum : DWORD {
 	DEPTH = 0x800000
 } DDS_FLAGS1;
 
-typedef enum : DWORD {
+typedef enum : u32 {
 	ALPHAPIXELS = 0x1,
 	ALPHA = 0x2,
 	FOURCC = 0x4,
@@ -47,12 +39,13 @@ typedef enum : DWORD {
 	LUMINANCE = 0x20000
 } DDS_FLAGS2;
 
-typedef enum : DWORD {
+typedef enum : u32 {
+	TEXTURE = 0x1000,
 	CUBE_MAP = 0x1008,
 	TEXTURE_W_MIPMAPS = 0x401008
 } DDS_CAPS1;
 
-typedef enum : DWORD {
+typedef enum : u32 {
 	CUBEMAP = 0x200,
 	CUBEMAP_POSITIVE_X = 0x400,
 	CUBEMAP_NEGATIVE_X = 0x800,
@@ -60,10 +53,11 @@ typedef enum : DWORD {
 	CUBEMAP_NEGATIVE_Y = 0x2000,
 	CUBEMAP_POSITIVE_Z = 0x4000,
 	CUBEMAP_NEGATIVE_Z = 0x8000,
+	CUBEMAP_ALL_FACES = 0xFC00,
 	VOLUME = 0x200000
 } DDS_CAPS2;
 
-typedef enum : DWORD {
+typedef enum : u32 {
 	D3D10_RESOURCE_DIMENSION_UNKNOWN	= 0,
 	D3D10_RESOURCE_DIMENSION_BUFFER		= 1,
 	D3D10_RESOURCE_DIMENSION_TEXTURE1D 	= 2,
@@ -71,7 +65,7 @@ typedef enum : DWORD {
 	D3D10_RESOURCE_DIMENSION_TEXTURE3D 	= 4
 } D3D10_RESOURCE_DIMENSION;
 
-typedef enum : DWORD {
+typedef enum : u32 {
 	DXGI_FORMAT_UNKNOWN = 0,
 	DXGI_FORMAT_R32G32B32A32_TYPELESS = 1,
 	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
@@ -196,7 +190,7 @@ typedef enum : DWORD {
 	DXGI_FORMAT_FORCE_UINT = 0xffffffff
 } DXGI_FORMAT;
 
-typedef enum : DWORD {
+typedef enum : u32 {
 	D3D10_RESOURCE_MISC_GENERATE_MIPS = 0x1L,
 	D3D10_RESOURCE_MISC_SHARED = 0x2L,
 	D3D10_RESOURCE_MISC_TEXTURECUBE = 0x4L,
@@ -204,35 +198,7 @@ typedef enum : DWORD {
 	D3D10_RESOURCE_MISC_GDI_COMPATIBLE = 0x20L
 } D3D10_RESOURCE_MISC_FLAG;
 
-typedef enum : DWORD {
-	D3D11_RESOURCE_MISC_GENERATE_MIPS = 0x1L,
-	D3D11_RESOURCE_MISC_SHARED = 0x2L,
-	D3D11_RESOURCE_MISC_TEXTURECUBE = 0x4L,
-	D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS = 0x10L,
-	D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS = 0x20L,
-	D3D11_RESOURCE_MISC_BUFFER_STRUCTURED = 0x40L,
-	D3D11_RESOURCE_MISC_RESOURCE_CLAMP = 0x80L,
-	D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX = 0x100L,
-	D3D11_RESOURCE_MISC_GDI_COMPATIBLE = 0x200L,
-	D3D11_RESOURCE_MISC_SHARED_NTHANDLE = 0x800L,
-	D3D11_RESOURCE_MISC_RESTRICTED_CONTENT = 0x1000L,
-	D3D11_RESOURCE_MISC_RESTRICT_SHARED_RESOURCE = 0x2000L,
-	D3D11_RESOURCE_MISC_RESTRICT_SHARED_RESOURCE_DRIVER = 0x4000L,
-	D3D11_RESOURCE_MISC_GUARDED = 0x8000L,
-	D3D11_RESOURCE_MISC_TILE_POOL = 0x20000L,
-	D3D11_RESOURCE_MISC_TILED = 0x40000L,
-	D3D11_RESOURCE_MISC_HW_PROTECTED = 0x80000L,
-	D3D11_RESOURCE_MISC_SHARED_DISPLAYABLE,
-	D3D11_RESOURCE_MISC_SHARED_EXCLUSIVE_WRITER,
-	D3D11_RESOURCE_MISC_NO_SHADER_ACCESS
-} D3D11_RESOURCE_MISC_FLAG;
-
-typedef union {
-	D3D10_RESOURCE_MISC_FLAG flags10;
-	D3D11_RESOURCE_MISC_FLAG flags11;
-} DDS_RESOURCE_MISC_FLAG;
-
-typedef enum : DWORD {
+typedef enum : u32 {
 	DDS_ALPHA_MODE_UNKNOWN			= 0x0,
 	DDS_ALPHA_MODE_STRAIGHT			= 0x1,
 	DDS_ALPHA_MODE_PREMULTIPLIED	= 0x2,
@@ -240,49 +206,40 @@ typedef enum : DWORD {
 	DDS_ALPHA_MODE_CUSTOM 			= 0x4,
 } DDS_D3D10_MISC_FLAGS2;
 
+// Both headers are read with memcpy, nothing in the file is assumed to be aligned.
 typedef struct {
-	DWORD		dwHeaderSize;
+	u32			dwHeaderSize;
 	DDS_FLAGS1	dwFlags1;
-	DWORD		dwHeight;
-	DWORD		dwWidth;
-	DWORD		dwPitchOrLinearSize;
-	DWORD		dwDepth;
-	DWORD		dwMipMapCount;
-	DWORD		dwReserved[11];
-	DWORD		dwSize;
+	u32			dwHeight;
+	u32			dwWidth;
+	u32			dwPitchOrLinearSize;
+	u32			dwDepth;
+	u32			dwMipMapCount;
+	u32			dwReserved[11];
+	u32			dwSize;
 	DDS_FLAGS2	dwFlags2;
-	CCHAR		dwFourCC[4];
-	DWORD		dwRgbBitCount;
-	DWORD 		dwRBitMask;
-	DWORD 		dwGBitMask;
-	DWORD 		dwBBitMask;
-	DWORD 		dwABitMask;
+	char		dwFourCC[4];
+	u32			dwRgbBitCount;
+	u32 		dwRBitMask;
+	u32 		dwGBitMask;
+	u32 		dwBBitMask;
+	u32 		dwABitMask;
 	DDS_CAPS1 	dwCaps;
 	DDS_CAPS2 	dwCaps2;
-	DWORD 		dwCaps3;
-	DWORD 		dwCaps4;
-	DWORD 		dwReserved2;
-} DDS_HEADER, *LP_DDS_HEADER;
+	u32 		dwCaps3;
+	u32 		dwCaps4;
+	u32 		dwReserved2;
+} DDS_HEADER;
+static_assert(sizeof(DDS_HEADER) == 124);
 
 typedef struct {
 	DXGI_FORMAT				 dxgiFormat;
 	D3D10_RESOURCE_DIMENSION resourceDimension;
-	DDS_RESOURCE_MISC_FLAG	 miscFlag;
-	UINT					 arraySize;
-	UINT					 miscFlags2;
-} DDS_HEADER_DXT10, *LP_DDS_HEADER_DXT10;
-
-typedef struct {
-	DWORD			 dwMagic; // must be 0x20534444
-	DDS_HEADER		 header;
-	DDS_HEADER_DXT10 header10;
-	LPBYTE			 data;
-} DDS_FILE, *LP_DDS_FILE;
-
-typedef struct {
-	DWORD dwInternalFormat;
-	DWORD dwBlockSize;
-} DDS_GL_FORMAT, *LP_DDS_GL_FORMAT;
+	u32						 miscFlag;	//< D3D10_RESOURCE_MISC_FLAG
+	u32						 arraySize;
+	u32						 miscFlags2;	//< DDS_D3D10_MISC_FLAGS2
+} DDS_HEADER_DXT10;
+static_assert(sizeof(DDS_HEADER_DXT10) == 20);
 
 #ifdef DDS_LOADER_DEBUG
 static void DDS_DumpHeader(DDS_HEADER const *dds) {
@@ -312,8 +269,7 @@ static void DDS_DumpHeader10(DDS_HEADER_DXT10 const *dds) {
 	std::cout << "--== DX10 FILE DUMP ==--\n"
 		"DXGI Format: " << std::dec << dds->dxgiFormat << "\n"
 		"Resource dimension: " << std::dec << dds->resourceDimension << "\n"
-		"Misc flag (10): " << std::hex << dds->miscFlag.flags10 << "\n"
-		"Misc flag (11): " << std::hex << dds->miscFlag.flags11 << "\n"
+		"Misc flag: " << std::hex << dds->miscFlag << "\n"
 		"Array size: " << std::dec << dds->arraySize << "\n"
 		"Misc flags 2: " << std::hex << dds->miscFlags2 << "\n\n";
 	
@@ -323,233 +279,469 @@ static void DDS_DumpHeader10(DDS_HEADER_DXT10 const *dds) {
 #define DDS_DumpHeader10(...)
 #endif
 
-static Error DDS_DXGI2GL_Format(DXGI_FORMAT const dxgiFormat, LP_DDS_GL_FORMAT const format) {
+static Error DDS_FromDXGIFormat(DXGI_FORMAT const dxgiFormat, DdsFormat *const format) {
 	switch (dxgiFormat) {
 		case DXGI_FORMAT_BC1_TYPELESS:
-		case DXGI_FORMAT_BC1_UNORM:
-		case DXGI_FORMAT_BC1_UNORM_SRGB:
-			*format = {
-			.dwInternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
-			.dwBlockSize = 8
-		};
-			return OK;
-			
-		case DXGI_FORMAT_BC2_UNORM_SRGB:
-			*format = {
-			.dwInternalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT,
-			.dwBlockSize = 16
-		};
-			break;
-			
+		case DXGI_FORMAT_BC1_UNORM:			*format = DdsFormat::BC1; return OK;
+		case DXGI_FORMAT_BC1_UNORM_SRGB:	*format = DdsFormat::BC1_SRGB; return OK;
 		case DXGI_FORMAT_BC2_TYPELESS:
-		case DXGI_FORMAT_BC2_UNORM:
-			*format = {
-			.dwInternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
-			.dwBlockSize = 16
-		};
-			return OK;
-			
+		case DXGI_FORMAT_BC2_UNORM:			*format = DdsFormat::BC2; return OK;
+		case DXGI_FORMAT_BC2_UNORM_SRGB:	*format = DdsFormat::BC2_SRGB; return OK;
 		case DXGI_FORMAT_BC3_TYPELESS:
-		case DXGI_FORMAT_BC3_UNORM:
-			*format = {
-			.dwInternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
-			.dwBlockSize = 16
-		};
-			return OK;
-			
-		case DXGI_FORMAT_BC3_UNORM_SRGB:
-			*format = {
-			.dwInternalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,
-			.dwBlockSize = 16
-		};
-			return OK;
-
+		case DXGI_FORMAT_BC3_UNORM:			*format = DdsFormat::BC3; return OK;
+		case DXGI_FORMAT_BC3_UNORM_SRGB:	*format = DdsFormat::BC3_SRGB; return OK;
 		case DXGI_FORMAT_BC4_TYPELESS:
-		case DXGI_FORMAT_BC4_UNORM:
-		
-			
+		case DXGI_FORMAT_BC4_UNORM:			*format = DdsFormat::BC4; return OK;
+		case DXGI_FORMAT_BC4_SNORM:			*format = DdsFormat::BC4_SNORM; return OK;
 		case DXGI_FORMAT_BC5_TYPELESS:
-		case DXGI_FORMAT_BC5_UNORM:
-			*format = {
-			.dwInternalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
-			.dwBlockSize = 16
-		};
-			return OK;
-			
-		case DXGI_FORMAT_BC5_SNORM: {
-			*format = {
-				.dwInternalFormat = GL_COMPRESSED_SIGNED_RG_RGTC2,
-				.dwBlockSize = 16
-			};
-			return OK;
-		}
-			
+		case DXGI_FORMAT_BC5_UNORM:			*format = DdsFormat::BC5; return OK;
+		case DXGI_FORMAT_BC5_SNORM:			*format = DdsFormat::BC5_SNORM; return OK;
+		case DXGI_FORMAT_BC6H_TYPELESS:
+		case DXGI_FORMAT_BC6H_UF16:			*format = DdsFormat::BC6H_UF16; return OK;
+		case DXGI_FORMAT_BC6H_SF16:			*format = DdsFormat::BC6H_SF16; return OK;
 		case DXGI_FORMAT_BC7_TYPELESS:
-		case DXGI_FORMAT_BC7_UNORM: {
-			*format = {
-				.dwInternalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM,
-				.dwBlockSize = 16
-			};
-			return OK;
-		}	
-		case DXGI_FORMAT_BC7_UNORM_SRGB: {
-			*format = {
-				.dwInternalFormat = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,
-				.dwBlockSize = 16
-			};
-			return OK;
-		}	
+		case DXGI_FORMAT_BC7_UNORM:			*format = DdsFormat::BC7; return OK;
+		case DXGI_FORMAT_BC7_UNORM_SRGB:	*format = DdsFormat::BC7_SRGB; return OK;
 		default:
-			return ERR_FILE_CANT_READ;
+			return ERR_FILE_UNRECOGNIZED;
 	}
-	return FAILED;
 }
 
-static Error DDS_D3D9Format2GLFormat(LPCH const wc4, LP_DDS_GL_FORMAT const lpGlFormat) {
-	switch (hash(std::string(wc4, 4))) {
-		case hash("DXT1"):
-			*lpGlFormat = {
-				.dwInternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
-				.dwBlockSize = 8
-			};
-			return OK;
-		case hash("DXT3"):
-			*lpGlFormat = {
-				.dwInternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
-				.dwBlockSize = 16
-			};
-			return OK;
-		case hash("DXT5"):
-			*lpGlFormat = {
-				.dwInternalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,
-				.dwBlockSize = 16
-			};
-			return OK;
-		case hash("ATI2"):
-			printf("HELP ME");
-			*lpGlFormat = {
-				.dwInternalFormat = GL_COMPRESSED_RG_RGTC2,
-				.dwBlockSize = 16
-			};
-			return OK;
+static Error DDS_FromFourCC(u32 const fourCC, DdsFormat *const format) {
+	switch (fourCC) {
+		case charsToType<u32>("DXT1"): *format = DdsFormat::BC1; return OK;
+		case charsToType<u32>("DXT3"): *format = DdsFormat::BC2; return OK;
+		// Legacy DXT5 files have always been sampled as sRGB here.
+		case charsToType<u32>("DXT5"): *format = DdsFormat::BC3_SRGB; return OK;
+		case charsToType<u32>("ATI1"):
+		case charsToType<u32>("BC4U"): *format = DdsFormat::BC4; return OK;
+		case charsToType<u32>("BC4S"): *format = DdsFormat::BC4_SNORM; return OK;
+		case charsToType<u32>("ATI2"):
+		case charsToType<u32>("BC5U"): *format = DdsFormat::BC5; return OK;
+		case charsToType<u32>("BC5S"): *format = DdsFormat::BC5_SNORM; return OK;
 		default:
-			return ERR_FILE_CORRUPT;
+			return ERR_FILE_UNRECOGNIZED;
 	}
 }
 
-static Error UploadFromStdIo_Async(FILE* file, u32 const texture_object, std::string &error) {
-	
+Result<DdsImage> DdsImage::parse(std::span<char const> const bytes) {
+	constexpr std::size_t header_end = sizeof(u32) + sizeof(DDS_HEADER);
+	if (bytes.size() < header_end) {
+		DDS_DebugPrint("File is too small to be a valid DDS file! Size: %zu bytes", bytes.size());
+		return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+	}
+
+	u32 magic;
+	std::memcpy(&magic, bytes.data(), sizeof(magic));
+	if (magic != MAGIC) {
+		DDS_DebugPrint("File is not a valid DDS file (magic number mismatch) %u", magic);
+		return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+	}
+
+	DDS_HEADER header;
+	std::memcpy(&header, bytes.data() + sizeof(magic), sizeof(header));
+	DDS_DumpHeader(&header);
+	if (header.dwHeaderSize != sizeof(DDS_HEADER) || header.dwSize != 32)
+		return { ERR_FILE_CORRUPT, __LINE__ };
+	// Uncompressed layouts are described by bit masks, nothing we ship uses them.
+	if ((header.dwFlags2 & FOURCC) == 0)
+		return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+	if ((header.dwFlags1 & DEPTH) != 0 && header.dwDepth > 1)
+		return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+
+	DdsImage image;
+	std::size_t data_start = header_end;
+	u32 array_size = 1;
+	u32 fourCC;
+	std::memcpy(&fourCC, header.dwFourCC, sizeof(fourCC));
+	if (fourCC == charsToType<u32>("DX10")) {
+		DDS_HEADER_DXT10 header10;
+		if (bytes.size() < header_end + sizeof(header10)) {
+			DDS_DebugPrint("Failed to read DX10 extended DDS file header despite the presence of the DX10 FourCC code!");
+			return { ERR_FILE_CORRUPT, __LINE__ };
+		}
+		std::memcpy(&header10, bytes.data() + header_end, sizeof(header10));
+		DDS_DumpHeader10(&header10);
+		data_start += sizeof(header10);
+
+		if (header10.resourceDimension != D3D10_RESOURCE_DIMENSION_TEXTURE2D)
+			return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+		if (DDS_FromDXGIFormat(header10.dxgiFormat, &image.format_) != OK) {
+			DDS_DebugPrint("Unsupported DXGI format %u", static_cast<u32>(header10.dxgiFormat));
+			return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+		}
+		array_size = header10.arraySize;
+		image.cubemap_ = (header10.miscFlag & D3D10_RESOURCE_MISC_TEXTURECUBE) != 0;
+	}
+	else {
+		if ((header.dwCaps2 & VOLUME) != 0)
+			return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+		if (DDS_FromFourCC(fourCC, &image.format_) != OK) {
+			DDS_DebugPrint("Unsupported FourCC %.4s", header.dwFourCC);
+			return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+		}
+		if ((header.dwCaps2 & CUBEMAP) != 0) {
+			// D3D9 allowed cubemaps with missing faces, GL has no such thing.
+			if ((header.dwCaps2 & CUBEMAP_ALL_FACES) != CUBEMAP_ALL_FACES)
+				return { ERR_FILE_UNRECOGNIZED, __LINE__ };
+			image.cubemap_ = true;
+		}
+	}
+
+	u32 const width = header.dwWidth;
+	u32 const height = header.dwHeight;
+	if (width == 0 || height == 0 || width > 1u << (MAX_LEVELS - 1) || height > 1u << (MAX_LEVELS - 1))
+		return { ERR_FILE_CORRUPT, __LINE__ };
+	if (array_size == 0 || array_size > DDS_MAX_ARRAY_SIZE)
+		return { ERR_FILE_CORRUPT, __LINE__ };
+	if (image.cubemap_ && width != height)
+		return { ERR_FILE_CORRUPT, __LINE__ };
+
+	// Plenty of writers leave MIPMAPCOUNT out of the flags, the count alone is what counts. Zero means one level.
+	u32 const level_count = std::max(header.dwMipMapCount, 1u);
+	if (level_count > static_cast<u32>(std::bit_width(std::max(width, height))))
+		return { ERR_FILE_CORRUPT, __LINE__ };
+
+	u64 const block_size = ddsBlockSize(image.format_);
+	u64 layer_size = 0;
+	for (u32 i = 0; i < level_count; i++) {
+		u32 const level_width = std::max(width >> i, 1u);
+		u32 const level_height = std::max(height >> i, 1u);
+		u64 const level_size = static_cast<u64>((level_width + 3) / 4) * ((level_height + 3) / 4) * block_size;
+		image.levels_[i] = { .width = level_width, .height = level_height, .offset = layer_size, .size = level_size };
+		layer_size += level_size;
+	}
+
+	image.level_count_ = level_count;
+	image.layer_count_ = array_size * (image.cubemap_ ? 6 : 1);
+	image.layer_size_ = layer_size;
+	u64 const payload_size = layer_size * image.layer_count_;
+	if (payload_size > bytes.size() - data_start) {
+		DDS_DebugPrint("File is truncated, %llu bytes of pixels for %zu bytes left", payload_size, bytes.size() - data_start);
+		return { ERR_FILE_CORRUPT, __LINE__ };
+	}
+	image.payload_ = bytes.subspan(data_start, static_cast<std::size_t>(payload_size));
+	return image;
 }
 
-Error DDS_UploadFromStdIO(FILE *file, u32 const texture_object, std::string &error) {
-	if (fseek(file, 0, SEEK_END) != 0) return ERR_FILE_NOT_FOUND;
-	u32 const uiFileSize = ftell(file);
-	if (fseek(file, 0, SEEK_SET) != 0) return ERR_FILE_NOT_FOUND;
+Result<DdsImage> DdsImage::open(std::string const &path) {
+	Result<SharedPtr<os::MappedFile>> mapped = os::MappedFile::open(path);
+	if (mapped.error() != OK)
+		return { mapped.error(), __LINE__ };
 
-	DDS_FILE dds;
-	DDS_HEADER *ddsFileHeaderInfo = &dds.header;
-	ZeroMemory(ddsFileHeaderInfo, sizeof(DDS_HEADER));
+	SharedPtr<os::MappedFile> const file = mapped.value();
+	Result<DdsImage> parsed = parse(file->bytes());
+	if (parsed.error() != OK)
+		return { parsed.error(), __LINE__ };
 
-	UINT64 ullBufferSize = uiFileSize - sizeof(DWORD) - sizeof(DDS_HEADER);
+	DdsImage image = parsed.value();
+	image.file_ = file;
+	return image;
+}
 
-	if (uiFileSize < sizeof(DWORD) + sizeof(DDS_HEADER)) {
-		DDS_DebugPrint("File is too small to be a valid DDS file! Size: %u bytes\n", uiFileSize);
-		error = "File is too small";
-		return ERR_FILE_UNRECOGNIZED;
+#if BENCHMARKS_ENABLED
+
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <random>
+
+struct DdsTestSpec {
+	char const *four_cc;	//< "DX10" adds the extended header.
+	DXGI_FORMAT dxgi_format;
+	u32 block_size;
+	u32 width;
+	u32 height;
+	u32 levels;				//< Written as is, zero still gets one level of pixels.
+	u32 array_size;
+	bool cubemap;
+};
+
+/* A well formed file for `spec`, every level of every layer filled with its own byte so a wrong offset shows. */
+static Vec<char> DDS_MakeTestFile(DdsTestSpec const &spec) {
+	DDS_HEADER header{};
+	header.dwHeaderSize = sizeof(DDS_HEADER);
+	header.dwFlags1 = static_cast<DDS_FLAGS1>(CAPS | HEIGHT | WIDTH | PIXELFORMAT | LINEARSIZE | (spec.levels > 1 ? MIPMAPCOUNT : 0));
+	header.dwHeight = spec.height;
+	header.dwWidth = spec.width;
+	header.dwMipMapCount = spec.levels;
+	header.dwSize = 32;
+	header.dwFlags2 = FOURCC;
+	std::memcpy(header.dwFourCC, spec.four_cc, 4);
+	header.dwCaps = spec.levels > 1 ? TEXTURE_W_MIPMAPS : TEXTURE;
+	bool const dx10 = std::strncmp(spec.four_cc, "DX10", 4) == 0;
+	if (spec.cubemap && !dx10)
+		header.dwCaps2 = static_cast<DDS_CAPS2>(CUBEMAP | CUBEMAP_ALL_FACES);
+
+	u32 const magic = DdsImage::MAGIC;
+	Vec<char> bytes(sizeof(magic) + sizeof(header));
+	std::memcpy(bytes.data(), &magic, sizeof(magic));
+	std::memcpy(bytes.data() + sizeof(magic), &header, sizeof(header));
+	if (dx10) {
+		DDS_HEADER_DXT10 const header10{
+			.dxgiFormat = spec.dxgi_format,
+			.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D,
+			.miscFlag = spec.cubemap ? static_cast<u32>(D3D10_RESOURCE_MISC_TEXTURECUBE) : 0u,
+			.arraySize = spec.array_size,
+			.miscFlags2 = DDS_ALPHA_MODE_UNKNOWN
+		};
+		bytes.resize(bytes.size() + sizeof(header10));
+		std::memcpy(bytes.data() + bytes.size() - sizeof(header10), &header10, sizeof(header10));
 	}
-	
-	if (fread_s(&dds.dwMagic, sizeof(DWORD), sizeof(DWORD), 1, file) != 1) {
-		DDS_DebugPrint("Failed to read DDS file magic number!");
-		error = "Failed to read DDS file magic";
-		return ERR_FILE_CANT_READ;
+
+	u32 const layers = spec.array_size * (spec.cubemap ? 6 : 1);
+	for (u32 layer = 0; layer < layers; layer++) {
+		u32 w = spec.width, h = spec.height;
+		for (u32 level = 0; level < std::max(spec.levels, 1u); level++) {
+			std::size_t const blocks = ((w + 3) / 4) * static_cast<std::size_t>((h + 3) / 4);
+			bytes.resize(bytes.size() + blocks * spec.block_size, static_cast<char>(layer * 31 + level + 1));
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
 	}
-	
-	if (dds.dwMagic != static_cast<DWORD>(0x20534444)) {
-		DDS_DebugPrint("File is not a valid DDS file (magic number mismatch) %lu\n", dds.dwMagic);
-		error = "File is not a valid DDS file";
-		return ERR_FILE_UNRECOGNIZED;
+	return bytes;
+}
+
+/* `file` with its headers run through `edit`. */
+static Vec<char> DDS_EditTestFile(Vec<char> file, std::function<void(DDS_HEADER &, DDS_HEADER_DXT10 &)> const &edit) {
+	DDS_HEADER header;
+	DDS_HEADER_DXT10 header10{};
+	std::size_t const header10_offset = sizeof(u32) + sizeof(DDS_HEADER);
+	bool const dx10 = file.size() >= header10_offset + sizeof(header10) && std::strncmp(file.data() + 4 + offsetof(DDS_HEADER, dwFourCC), "DX10", 4) == 0;
+	std::memcpy(&header, file.data() + sizeof(u32), sizeof(header));
+	if (dx10)
+		std::memcpy(&header10, file.data() + header10_offset, sizeof(header10));
+	edit(header, header10);
+	std::memcpy(file.data() + sizeof(u32), &header, sizeof(header));
+	if (dx10)
+		std::memcpy(file.data() + header10_offset, &header10, sizeof(header10));
+	return file;
+}
+
+int benchmarkDdsValidate(Vec<std::string_view> const &p_args) {
+	static_cast<void>(p_args);
+
+	struct TestCase {
+		char const *name;
+		Vec<char> bytes;
+		Error expected;
+		u32 levels = 0;
+		u32 layers = 0;
+	};
+
+	DdsTestSpec const dxt1{ "DXT1", DXGI_FORMAT_UNKNOWN, 8, 256, 256, 9, 1, false };
+	DdsTestSpec const bc7{ "DX10", DXGI_FORMAT_BC7_UNORM_SRGB, 16, 1024, 1024, 11, 1, false };
+	DdsTestSpec const bc1_cube{ "DX10", DXGI_FORMAT_BC1_UNORM, 8, 64, 64, 7, 1, true };
+
+	Vec<TestCase> corpus;
+	auto const good = [&](char const *name, DdsTestSpec const &spec, std::size_t const trailing_bytes = 0) {
+		Vec<char> bytes = DDS_MakeTestFile(spec);
+		bytes.resize(bytes.size() + trailing_bytes, 0x7f);
+		corpus.push_back({ name, std::move(bytes), OK, std::max(spec.levels, 1u), spec.array_size * (spec.cubemap ? 6 : 1) });
+	};
+	auto const bad = [&](char const *name, Vec<char> bytes, Error const expected) {
+		corpus.push_back({ name, std::move(bytes), expected });
+	};
+	using Edit = std::function<void(DDS_HEADER &, DDS_HEADER_DXT10 &)>;
+	auto const edited = [&](char const *name, DdsTestSpec const &spec, Error const expected, Edit const &edit) {
+		bad(name, DDS_EditTestFile(DDS_MakeTestFile(spec), edit), expected);
+	};
+
+	good("DXT1 256x256, full chain", dxt1);
+	good("DXT5 512x128, full chain", { "DXT5", DXGI_FORMAT_UNKNOWN, 16, 512, 128, 10, 1, false });
+	good("DXT1 1x1", { "DXT1", DXGI_FORMAT_UNKNOWN, 8, 1, 1, 1, 1, false });
+	good("DXT3 300x200, no mip count", { "DXT3", DXGI_FORMAT_UNKNOWN, 16, 300, 200, 0, 1, false });
+	good("ATI2 64x64, partial chain", { "ATI2", DXGI_FORMAT_UNKNOWN, 16, 64, 64, 4, 1, false });
+	good("BC4U 13x7, full chain", { "BC4U", DXGI_FORMAT_UNKNOWN, 8, 13, 7, 4, 1, false });
+	good("DXT1 cubemap 32x32", { "DXT1", DXGI_FORMAT_UNKNOWN, 8, 32, 32, 6, 1, true });
+	good("DX10 BC7 sRGB 1024x1024", bc7);
+	good("DX10 BC6H array of 4", { "DX10", DXGI_FORMAT_BC6H_UF16, 16, 128, 64, 8, 4, false });
+	good("DX10 BC1 cubemap", bc1_cube);
+	good("DX10 BC5 cubemap array of 2", { "DX10", DXGI_FORMAT_BC5_UNORM, 16, 16, 16, 5, 2, true });
+	good("DXT1 with trailing bytes", dxt1, 100);
+
+	bad("empty", {}, ERR_FILE_UNRECOGNIZED);
+	{
+		Vec<char> bytes = DDS_MakeTestFile(dxt1);
+		bytes.resize(100);
+		bad("shorter than the header", std::move(bytes), ERR_FILE_UNRECOGNIZED);
 	}
-	
-	if (fread_s(ddsFileHeaderInfo, sizeof(DDS_HEADER), sizeof(DDS_HEADER), 1, file) != 1) {
-		DDS_DebugPrint("Failed to read basic pre-DX10 DDS file header!");
-		error = "Failed to read basic pre-DX10 DDS file header";
-		return ERR_FILE_CORRUPT;
+	{
+		Vec<char> bytes = DDS_MakeTestFile(dxt1);
+		bytes[0] = 'X';
+		bad("bad magic", std::move(bytes), ERR_FILE_UNRECOGNIZED);
 	}
-	
-	// DDS_DumpHeader(ddsFileHeaderInfo);
+	{
+		Vec<char> bytes = DDS_MakeTestFile(dxt1);
+		bytes.pop_back();
+		bad("payload one byte short", std::move(bytes), ERR_FILE_CORRUPT);
+	}
+	{
+		Vec<char> bytes = DDS_MakeTestFile(bc7);
+		bytes.resize(sizeof(u32) + sizeof(DDS_HEADER) + 10);
+		bad("DX10 header cut short", std::move(bytes), ERR_FILE_CORRUPT);
+	}
+	edited("header size 120", dxt1, ERR_FILE_CORRUPT, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwHeaderSize = 120; });
+	edited("pixel format size 0", dxt1, ERR_FILE_CORRUPT, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwSize = 0; });
+	edited("uncompressed RGB", dxt1, ERR_FILE_UNRECOGNIZED, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwFlags2 = RGB; });
+	edited("unknown FourCC", dxt1, ERR_FILE_UNRECOGNIZED, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { std::memcpy(h.dwFourCC, "ABCD", 4); });
+	edited("legacy volume", dxt1, ERR_FILE_UNRECOGNIZED, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwCaps2 = VOLUME; });
+	edited("depth of 4", dxt1, ERR_FILE_UNRECOGNIZED, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) {
+		h.dwFlags1 = static_cast<DDS_FLAGS1>(h.dwFlags1 | DEPTH);
+		h.dwDepth = 4;
+	});
+	edited("cubemap with one face", dxt1, ERR_FILE_UNRECOGNIZED, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwCaps2 = static_cast<DDS_CAPS2>(CUBEMAP | CUBEMAP_POSITIVE_X); });
+	edited("zero width", dxt1, ERR_FILE_CORRUPT, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwWidth = 0; });
+	edited("width of 2^20", dxt1, ERR_FILE_CORRUPT, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwWidth = 1u << 20; });
+	edited("width of 2^32 - 1", dxt1, ERR_FILE_CORRUPT, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwWidth = 0xFFFFFFFFu; });
+	edited("10 levels on 256x256", dxt1, ERR_FILE_CORRUPT, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwMipMapCount = 10; });
+	edited("2^32 - 1 levels", dxt1, ERR_FILE_CORRUPT, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwMipMapCount = 0xFFFFFFFFu; });
+	edited("DX10 RGBA8", bc7, ERR_FILE_UNRECOGNIZED, [](DDS_HEADER &, DDS_HEADER_DXT10 &h) { h.dxgiFormat = DXGI_FORMAT_R8G8B8A8_UNORM; });
+	edited("DX10 volume", bc7, ERR_FILE_UNRECOGNIZED, [](DDS_HEADER &, DDS_HEADER_DXT10 &h) { h.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE3D; });
+	edited("DX10 buffer", bc7, ERR_FILE_UNRECOGNIZED, [](DDS_HEADER &, DDS_HEADER_DXT10 &h) { h.resourceDimension = D3D10_RESOURCE_DIMENSION_BUFFER; });
+	edited("DX10 array of 0", bc7, ERR_FILE_CORRUPT, [](DDS_HEADER &, DDS_HEADER_DXT10 &h) { h.arraySize = 0; });
+	edited("DX10 array of 2^30", bc7, ERR_FILE_CORRUPT, [](DDS_HEADER &, DDS_HEADER_DXT10 &h) { h.arraySize = 1u << 30; });
+	edited("DX10 array of 2 with pixels for 1", bc7, ERR_FILE_CORRUPT, [](DDS_HEADER &, DDS_HEADER_DXT10 &h) { h.arraySize = 2; });
+	edited("DX10 cubemap 64x32", bc1_cube, ERR_FILE_CORRUPT, [](DDS_HEADER &h, DDS_HEADER_DXT10 &) { h.dwHeight = 32; });
+
+	u32 failures = 0;
+	auto const fail = [&](TestCase const &test, char const *what) {
+		printf("[bench] FAIL %-40s %s\n", test.name, what);
+		failures++;
+	};
+	for (TestCase const &test : corpus) {
+		std::span<char const> const bytes(test.bytes.data(), test.bytes.size());
+		Result<DdsImage> parsed = DdsImage::parse(bytes);
+		if (parsed.error() != test.expected) {
+			printf("[bench] FAIL %-40s expected %s, got %s\n", test.name, to_string(test.expected), to_string(parsed.error()));
+			failures++;
+			continue;
+		}
+		if (test.expected != OK)
+			continue;
 
-	DDS_GL_FORMAT glFormat;
-	ZeroMemory(&glFormat, sizeof(glFormat));
-	if (hash(ddsFileHeaderInfo->dwFourCC) == hash("DX10")) {
-		if (fread_s(&dds.header10, sizeof(DDS_HEADER_DXT10), sizeof(DDS_HEADER_DXT10), 1, file) != 1) {
-			DDS_DebugPrint("Failed to read DX10 extended DDS file header despite the presence of the DX10 FourCC code!");
-			error = "Failed to read DX10 extended DDS file header";
-			return ERR_FILE_CORRUPT;
+		DdsImage const image = parsed.value();
+		if (image.levelCount() != test.levels || image.layerCount() != test.layers) {
+			fail(test, "wrong level or layer count");
+			continue;
+		}
+		std::size_t const header_size = image.payload().data() - bytes.data();
+		if (header_size != sizeof(u32) + sizeof(DDS_HEADER) && header_size != sizeof(u32) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10))
+			fail(test, "payload doesn't start right after the headers");
+		if (image.level(image.layerCount() - 1, image.levelCount() - 1).data() + image.levels().back().size != image.payload().data() + image.payload().size())
+			fail(test, "last level doesn't end the payload");
+		for (u32 layer = 0; layer < image.layerCount(); layer++) {
+			for (u32 level = 0; level < image.levelCount(); level++) {
+				std::span<char const> const pixels = image.level(layer, level);
+				char const expected = static_cast<char>(layer * 31 + level + 1);
+				if (pixels.data() < bytes.data() || pixels.data() + pixels.size() > bytes.data() + bytes.size() ||
+				    std::ranges::any_of(pixels, [expected](char const c) { return c != expected; })) {
+					fail(test, "a level points at the wrong bytes");
+					layer = image.layerCount();
+					break;
+				}
+			}
 		}
+	}
 
-		ullBufferSize -= sizeof(DDS_HEADER_DXT10);
+	printf("[bench] %zu DDS headers, %u failures\n", corpus.size(), failures);
+	return failures == 0 ? 0 : 1;
+}
 
-		DDS_DumpHeader10(&dds.header10);
-		
-		if (Error const err = DDS_DXGI2GL_Format(dds.header10.dxgiFormat, &glFormat); err != OK) {
-			DDS_DebugPrint("Failed to get DXGI format from DDS file!");
-			error = "Failed to get DXGI format from DDS file";
-			return err;
+int benchmarkDdsParse(Vec<std::string_view> const &p_args) {
+	u32 const iterations = p_args.size() > 1 ? static_cast<u32>(std::stoul(std::string(p_args[1]))) : 10;
+
+	auto const report = [](char const *label, std::size_t const files, bench::Timing const &timing) {
+		printf("[bench] %-32s %zu files, %.0f files/s (median)\n", label, files, static_cast<f64>(files) / (timing.median_ms / 1000.0));
+	};
+
+	if (p_args.empty()) {
+		// No directory, generate a spread of what a scene's textures look like and parse them from memory.
+		std::mt19937 rng(0x5eed);
+		std::uniform_int_distribution<u32> size_log2(4, 8);
+		std::uniform_int_distribution<u32> kind(0, 7);
+		Vec<Vec<char>> files;
+		files.reserve(4096);
+		for (u32 i = 0; i < 4096; i++) {
+			u32 const width = 1u << size_log2(rng);
+			u32 const height = 1u << size_log2(rng);
+			u32 const levels = static_cast<u32>(std::bit_width(std::max(width, height)));
+			switch (kind(rng)) {
+				case 0: files.push_back(DDS_MakeTestFile({ "DXT1", DXGI_FORMAT_UNKNOWN, 8, width, height, levels, 1, false })); break;
+				case 1: files.push_back(DDS_MakeTestFile({ "DXT5", DXGI_FORMAT_UNKNOWN, 16, width, height, levels, 1, false })); break;
+				case 2: files.push_back(DDS_MakeTestFile({ "ATI2", DXGI_FORMAT_UNKNOWN, 16, width, height, levels, 1, false })); break;
+				case 3: files.push_back(DDS_MakeTestFile({ "DX10", DXGI_FORMAT_BC1_UNORM_SRGB, 8, width, height, levels, 1, false })); break;
+				case 4: files.push_back(DDS_MakeTestFile({ "DX10", DXGI_FORMAT_BC5_UNORM, 16, width, height, levels, 1, false })); break;
+				case 5: files.push_back(DDS_MakeTestFile({ "DX10", DXGI_FORMAT_BC7_UNORM, 16, width, height, levels, 1, false })); break;
+				case 6: files.push_back(DDS_MakeTestFile({ "DX10", DXGI_FORMAT_BC6H_UF16, 16, width, width, 1, 1, true })); break;
+				default: files.push_back(DDS_MakeTestFile({ "DX10", DXGI_FORMAT_BC7_UNORM_SRGB, 16, width, height, levels, 4, false })); break;
+			}
 		}
+
+		u64 checksum = 0;
+		bench::Timing const timing = bench::measure("DdsImage::parse (memory)", iterations, [&] {
+			for (Vec<char> const &file : files) {
+				Result<DdsImage> parsed = DdsImage::parse({ file.data(), file.size() });
+				checksum += parsed.error() == OK ? parsed.value().payload().size() : 0;
+			}
+		});
+		report("DdsImage::parse (memory)", files.size(), timing);
+		printf("[bench] checksum %llu\n", static_cast<unsigned long long>(checksum));
+		return 0;
+	}
+
+	Vec<std::string> paths;
+	for (std::filesystem::directory_entry const &entry : std::filesystem::recursive_directory_iterator(std::string(p_args[0]))) {
+		std::string extension = entry.path().extension().string();
+		std::ranges::transform(extension, extension.begin(), [](char const c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		if (entry.is_regular_file() && extension == ".dds")
+			paths.push_back(entry.path().string());
 	}
-	else if (Error const err = DDS_D3D9Format2GLFormat(ddsFileHeaderInfo->dwFourCC, &glFormat); err != OK) {
-		DDS_DebugPrint("Failed to get D3D9 format from DDS file!");
-		std::string four_cc(ddsFileHeaderInfo->dwFourCC, 4);
-		error = std::format("Failed to get D3D9 format from DDS file ({})", four_cc);
-		return err;
+	if (paths.empty()) {
+		fprintf(stderr, "[bench] no .dds files under \"%.*s\"\n", static_cast<int>(p_args[0].size()), p_args[0].data());
+		return -1;
 	}
 
-	glTextureStorage2D(texture_object,
-	                   (GLsizei)ddsFileHeaderInfo->dwMipMapCount,
-	                   glFormat.dwInternalFormat,
-	                   (GLsizei)ddsFileHeaderInfo->dwWidth,
-	                   (GLsizei)ddsFileHeaderInfo->dwHeight);
-	gpu_check;
-
-	glTextureParameteri(texture_object, GL_TEXTURE_BASE_LEVEL, 0);gpu_check;
-	glTextureParameteri(texture_object, GL_TEXTURE_MAX_LEVEL, (GLint)(ddsFileHeaderInfo->dwMipMapCount - 1));gpu_check;
-	glTextureParameteri(texture_object, GL_TEXTURE_MAG_FILTER, GL_LINEAR);gpu_check;
-	glTextureParameteri(texture_object, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);gpu_check;
-	glTextureParameteri(texture_object, GL_TEXTURE_WRAP_S, GL_REPEAT);gpu_check;
-	glTextureParameteri(texture_object, GL_TEXTURE_WRAP_T, GL_REPEAT);gpu_check;
-	
-	auto const buffer = (u8*)std::malloc(ullBufferSize);
-	size_t const uiBufferSize = ullBufferSize;
-	assert(fread_s(buffer, ullBufferSize, ullBufferSize, 1, file) == 1);
-	
-	GLsizeiptr uiOffset = 0;
-	GLsizei uiImageSize = 0;
-	GLsizei uiWidth = (GLsizei)ddsFileHeaderInfo->dwWidth;
-	GLsizei uiHeight = (GLsizei)ddsFileHeaderInfo->dwHeight;
+	u32 refused = 0;
+	for (std::string const &path : paths) {
+		if (Result<DdsImage> opened = DdsImage::open(path); opened.error() != OK) {
+			printf("[bench] %s: %s\n", path.c_str(), to_string(opened.error()));
+			refused++;
+		}
+	}
 
-	for (GLint iTextureLevel = 0; iTextureLevel < static_cast<GLint>(ddsFileHeaderInfo->dwMipMapCount); iTextureLevel++) {
-		uiImageSize = (GLsizei)((uiWidth + 3) / 4 * ((uiHeight + 3) / 4) * glFormat.dwBlockSize);
+	u64 checksum = 0;
+	// What DDS_UploadFromStdIO used to do before touching GL: read every byte into a heap copy.
+	bench::Timing const read = bench::measure("fread + parse", iterations, [&] {
+		for (std::string const &path : paths) {
+			FILE *file = fopen(path.c_str(), "rb");
+			if (file == nullptr)
+				continue;
+			fseek(file, 0, SEEK_END);
+			long const size = ftell(file);
+			fseek(file, 0, SEEK_SET);
+			Vec<char> bytes(static_cast<std::size_t>(std::max(size, 0l)));
+			if (fread(bytes.data(), 1, bytes.size(), file) == bytes.size()) {
+				Result<DdsImage> parsed = DdsImage::parse({ bytes.data(), bytes.size() });
+				checksum += parsed.error() == OK ? parsed.value().payload().size() : 0;
+			}
+			fclose(file);
+		}
+	});
+	report("fread + parse", paths.size(), read);
 
-#ifdef _DEBUG
-		state.allocated_memory_ += uiImageSize;
-#endif
+	bench::Timing const mapped = bench::measure("DdsImage::open (mapped)", iterations, [&] {
+		for (std::string const &path : paths) {
+			Result<DdsImage> opened = DdsImage::open(path);
+			checksum += opened.error() == OK ? opened.value().payload().size() : 0;
+		}
+	});
+	report("DdsImage::open (mapped)", paths.size(), mapped);
 
-		glCompressedTextureSubImage2D(texture_object, iTextureLevel,
-			0, 0, uiWidth, uiHeight,
-			glFormat.dwInternalFormat, uiImageSize,
-			buffer + uiOffset);
-		gpu_check;
-		
-		uiOffset += uiImageSize;
-		uiWidth /= 2;
-		uiHeight /= 2;
-	}
-	
-	std::free(buffer);
+	printf("[bench] %u of %zu files refused, checksum %llu\n", refused, paths.size(), static_cast<unsigned long long>(checksum));
+	return 0;
+}
 
-#ifdef _DEBUG
-	++state.images_loaded;
 #endif
-
-	return OK;
-}
\ No newline at end of file
@@ -1,6 +1,102 @@
 ﻿#pragma once
+
+#include <span>
+#include <string>
+
 #include "types.hpp"
+#include "engine/benchmark.hpp"
+
+namespace os {
+	class MappedFile;
+}
+
+/* Block compressed formats DdsImage accepts, from a DX10 header's DXGI format or a legacy FourCC. */
+enum class DdsFormat : u8 {
+	BC1,
+	BC1_SRGB,
+	BC2,
+	BC2_SRGB,
+	BC3,
+	BC3_SRGB,
+	BC4,
+	BC4_SNORM,
+	BC5,
+	BC5_SNORM,
+	BC6H_UF16,
+	BC6H_SF16,
+	BC7,
+	BC7_SRGB
+};
+
+/* Bytes per 4x4 block. */
+_NODISCARD constexpr u32 ddsBlockSize(DdsFormat const format) {
+	return format == DdsFormat::BC1 || format == DdsFormat::BC1_SRGB || format == DdsFormat::BC4 || format == DdsFormat::BC4_SNORM ? 8 : 16;
+}
+
+/* One mip level of one layer. Every layer has the same chain, so levels are described once. */
+struct DdsLevel {
+	u32 width;
+	u32 height;
+	u64 offset;	//< Bytes, from the start of the layer.
+	u64 size;	//< Bytes, whole blocks.
+};
+
+//
+// A parsed .dds file. parse() only reads the headers and works out where every level of every layer is,
+// the pixels stay wherever `bytes` lives (usually a MappedFile, see open()) and are never copied.
+// Nothing in here touches GL, TextureUploader (gpu/texture_upload.hpp) uploads the levels.
+//
+// Layers are array elements, six faces each for cubemaps (+X, -X, +Y, -Y, +Z, -Z), stored one after
+// the other with their whole mip chain, largest level first. Volume textures and uncompressed formats are refused.
+//
+class DdsImage {
+public:
+	static constexpr u32 MAGIC = 0x20534444; //< "DDS "
+	static constexpr u32 MAX_LEVELS = 16;	 //< Up to 32768 texels on a side.
+
+	/* `bytes` has to outlive the image. Fails with ERR_FILE_UNRECOGNIZED for files it doesn't read and ERR_FILE_CORRUPT for damaged ones. */
+	static Result<DdsImage> parse(_STD span<char const> bytes);
+	/* Maps `path` and parses it, the image keeps the mapping alive. */
+	static Result<DdsImage> open(_STD string const &path);
+
+	_NODISCARD DdsFormat format() const { return format_; }
+	_NODISCARD u32 width() const { return levels_[0].width; }
+	_NODISCARD u32 height() const { return levels_[0].height; }
+	_NODISCARD u32 levelCount() const { return level_count_; }
+	/* Array size, times six for cubemaps. */
+	_NODISCARD u32 layerCount() const { return layer_count_; }
+	_NODISCARD bool cubemap() const { return cubemap_; }
+	_NODISCARD _STD span<DdsLevel const> levels() const { return { levels_.data(), level_count_ }; }
+	/* Everything past the headers that the layout covers, trailing bytes excluded. */
+	_NODISCARD _STD span<char const> payload() const { return payload_; }
+	_NODISCARD _STD span<char const> level(u32 const layer, u32 const level) const {
+		return payload_.subspan(layer * layer_size_ + levels_[level].offset, levels_[level].size);
+	}
 
+private:
+	SharedPtr<os::MappedFile> file_;
+	_STD span<char const> payload_;
+	u64 layer_size_ = 0;
+	Array<DdsLevel, MAX_LEVELS> levels_{};
+	u32 level_count_ = 0;
+	u32 layer_count_ = 0;
+	DdsFormat format_ = DdsFormat::BC1;
+	bool cubemap_ = false;
+};
 
+/* The GL compressed internal format `format` uploads as. */
+extern u32 DDS_GLInternalFormat(DdsFormat format);
 
-extern Error DDS_UploadFromStdIO(FILE *file, u32 texture_object, std::string &error);
\ No newline at end of file
+#if BENCHMARKS_ENABLED
+/*
+ * `--bench dds-validate`, parses a corpus of generated headers, well formed ones (legacy FourCCs, DX10, cubemaps, arrays,
+ * partial and odd sized mip chains) and broken ones (bad magic and sizes, truncated headers and payloads, volumes,
+ * unknown formats, absurd dimensions), and checks the error or the layout each one should give. Exits with 1 on a mismatch.
+ */
+extern int benchmarkDdsValidate(Vec<_STD string_view> const &p_args);
+/*
+ * `--bench dds-parse [directory] [iterations]`, parses every .dds under `directory` (4096 generated files in memory without one),
+ * mapped with DdsImage::open() and read whole with fread like the previous loader did.
+ */
+extern int benchmarkDdsParse(Vec<_STD string_view> const &p_args);
+#endif
@@ -0,0 +1,23 @@
+﻿#include "dds.hpp"
+
+#include "glad/glad.h"
+
+u32 DDS_GLInternalFormat(DdsFormat const format) {
+	switch (format) {
+		case DdsFormat::BC1:		return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		case DdsFormat::BC1_SRGB:	return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+		case DdsFormat::BC2:		return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+		case DdsFormat::BC2_SRGB:	return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+		case DdsFormat::BC3:		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case DdsFormat::BC3_SRGB:	return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+		case DdsFormat::BC4:		return GL_COMPRESSED_RED_RGTC1;
+		case DdsFormat::BC4_SNORM:	return GL_COMPRESSED_SIGNED_RED_RGTC1;
+		case DdsFormat::BC5:		return GL_COMPRESSED_RG_RGTC2;
+		case DdsFormat::BC5_SNORM:	return GL_COMPRESSED_SIGNED_RG_RGTC2;
+		case DdsFormat::BC6H_UF16:	return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+		case DdsFormat::BC6H_SF16:	return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+		case DdsFormat::BC7:		return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		case DdsFormat::BC7_SRGB:	return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+	}
+	return GL_NONE;
+}
@@ -6,12 +6,17 @@
 #include "gltf.h"
 #include <Windows.h>
 
+#include <algorithm>
+#include <chrono>
 #include <future>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
 #include <utility>
 
 #include "material.hpp"
 #include "texture.h"
+#include "texture_upload.hpp"
 #include "util.hpp"
 #include "khr/ktx.h"
 #include "khr/ktx_ext.h"
@@ -26,33 +31,63 @@
 #include "engine/engine.h"
 #include "engine/thread_pool.hpp"
 #include "mikktspace/mikktspace.h"
+#include "gltf/accessor_view.hpp"
+#include "hlxscene.hpp"
+#include "indirect_draws.hpp"
+#include "mesh_optimizer.hpp"
+#include "model_manager.hpp"
+#include "vertex_packing.hpp"
 
 struct PrimAttribResult {
     AABB                           aabb;
     std::future<std::vector<vec4>> tangent_future; // invalid when not needed
 };
 
+/* MikkTSpace input straight from the glTF accessors. */
+struct AccessorTangentSource {
+	gltf::AccessorView<vec3> positions;
+	gltf::AccessorView<vec3> normals;
+	gltf::AccessorView<vec2> texcoords;
+
+	vec3 position(u32 const v) const { return positions[v]; }
+	vec3 normal(u32 const v) const { return normals[v]; }
+	vec2 texcoord(u32 const v) const { return texcoords[v]; }
+};
+
+/* MikkTSpace input from vertices that were already decoded (and possibly welded). */
+struct VertexTangentSource {
+	Vertex const *vertices;
+
+	vec3 position(u32 const v) const { return vertices[v].position; }
+	vec3 normal(u32 const v) const { return vertices[v].normal; }
+	vec2 texcoord(u32 const v) const { return vertices[v].texcoord0; }
+};
+
+template <typename Source>
 struct MikktUserData {
-	vec3 const *positions  = nullptr;
-	vec3 const *normals    = nullptr;
-	vec2 const *texcoords  = nullptr;
-	u16  const *indices    = nullptr;
+	Source source;
+	std::vector<u32> indices;   // widened from u8/u16/u32
 	u32         index_count = 0;
 	std::vector<vec4> tangents_unindexed;
 };
 
-template <typename T>
-static T const *accessorPtr(gltf::data const &data, gltf::id const accessor_id) {
-    gltf::accessor    const &acc = data.accessors[accessor_id];
-    gltf::buffer_view const &bv  = data.buffer_views[acc.bufferView()];
-    gltf::buffer      const &buf = data.buffers[bv.buffer];
-    return reinterpret_cast<T const *>(buf.data().data() + bv.offset + acc.offset());
+
+static gl::DrawElementsType drawElementsTypeFromComponentType(gltf::component_type const component_type) {
+    switch (component_type) {
+        case gltf::component_type::unsigned_byte:  return gl::DrawElementsType::UnsignedByte;
+        case gltf::component_type::unsigned_short: return gl::DrawElementsType::UnsignedShort;
+        case gltf::component_type::unsigned_int:   return gl::DrawElementsType::UnsignedInt;
+        default:
+            assert(false && "Index accessors must be unsigned byte, short or int");
+            return gl::DrawElementsType::UnsignedShort;
+    }
 }
 
 // ── MikkTSpace callbacks (all static, no class involvement) ─────────────────
 
+template <typename UserData>
 static int mkkt_getNumFaces(SMikkTSpaceContext const *ctx) {
-    auto const *ud = static_cast<MikktUserData const *>(ctx->m_pUserData);
+    auto const *ud = static_cast<UserData const *>(ctx->m_pUserData);
     return static_cast<int>(ud->index_count / 3);
 }
 
@@ -60,56 +95,54 @@ static int mkkt_getNumVertsOfFace(SMikkTSpaceContext const *, int) {
     return 3; // triangles only
 }
 
+template <typename UserData>
 static void mkkt_getPosition(SMikkTSpaceContext const *ctx, float out[], int iFace, int iVert) {
-    auto const *ud = static_cast<MikktUserData const *>(ctx->m_pUserData);
-    vec3 const &p  = ud->positions[ud->indices[iFace * 3 + iVert]];
+    auto const *ud = static_cast<UserData const *>(ctx->m_pUserData);
+    vec3 const p   = ud->source.position(ud->indices[iFace * 3 + iVert]);
     out[0] = p.x; out[1] = p.y; out[2] = p.z;
 }
 
+template <typename UserData>
 static void mkkt_getNormal(SMikkTSpaceContext const *ctx, float out[], int iFace, int iVert) {
-    auto const *ud = static_cast<MikktUserData const *>(ctx->m_pUserData);
-    vec3 const &n  = ud->normals[ud->indices[iFace * 3 + iVert]];
+    auto const *ud = static_cast<UserData const *>(ctx->m_pUserData);
+    vec3 const n   = ud->source.normal(ud->indices[iFace * 3 + iVert]);
     out[0] = n.x; out[1] = n.y; out[2] = n.z;
 }
 
+template <typename UserData>
 static void mkkt_getTexCoord(SMikkTSpaceContext const *ctx, float out[], int iFace, int iVert) {
-    auto const *ud = static_cast<MikktUserData const *>(ctx->m_pUserData);
-    vec2 const &uv = ud->texcoords[ud->indices[iFace * 3 + iVert]];
+    auto const *ud = static_cast<UserData const *>(ctx->m_pUserData);
+    vec2 const uv  = ud->source.texcoord(ud->indices[iFace * 3 + iVert]);
     out[0] = uv.x; out[1] = uv.y;
 }
 
+template <typename UserData>
 static void mkkt_setTSpaceBasic(SMikkTSpaceContext const *ctx,
                                 float const fvTangent[], float const fSign,
                                 int iFace, int iVert) {
-    auto *ud = static_cast<MikktUserData *>(ctx->m_pUserData);
+    auto *ud = static_cast<UserData *>(ctx->m_pUserData);
     ud->tangents_unindexed[iFace * 3 + iVert] =
         vec4(fvTangent[0], fvTangent[1], fvTangent[2], fSign);
 }
 
-static std::vector<vec4> computeTangentsMikkt(
-    gltf::data    const &data,
-    gltf::id const index_accessor_id,
-    gltf::id const position_accessor_id,
-    gltf::id const normal_accessor_id,
-    gltf::id const texcoord_accessor_id)
-{
-    MikktUserData ud;
-
-	// We need unwelded geometry
-    ud.positions   = accessorPtr<vec3>(data, position_accessor_id);
-    ud.normals     = accessorPtr<vec3>(data, normal_accessor_id);
-    ud.texcoords   = accessorPtr<vec2>(data, texcoord_accessor_id);
-    ud.indices     = accessorPtr<u16> (data, index_accessor_id);
-    ud.index_count = static_cast<u32>(data.accessors[index_accessor_id].count());
+template <typename Source>
+static std::vector<vec4> computeTangentsMikkt(Source source, std::vector<u32> indices) {
+	using UserData = MikktUserData<Source>;
+
+    UserData ud{
+        .source  = std::move(source),
+        .indices = std::move(indices)
+    };
+    ud.index_count = static_cast<u32>(ud.indices.size());
     ud.tangents_unindexed.resize(ud.index_count);
 
     SMikkTSpaceInterface iface;
-    iface.m_getNumFaces          = mkkt_getNumFaces;
+    iface.m_getNumFaces          = mkkt_getNumFaces<UserData>;
     iface.m_getNumVerticesOfFace = mkkt_getNumVertsOfFace;
-    iface.m_getPosition          = mkkt_getPosition;
-    iface.m_getNormal            = mkkt_getNormal;
-    iface.m_getTexCoord          = mkkt_getTexCoord;
-    iface.m_setTSpaceBasic       = mkkt_setTSpaceBasic;
+    iface.m_getPosition          = mkkt_getPosition<UserData>;
+    iface.m_getNormal            = mkkt_getNormal<UserData>;
+    iface.m_getTexCoord          = mkkt_getTexCoord<UserData>;
+    iface.m_setTSpaceBasic       = mkkt_setTSpaceBasic<UserData>;
     iface.m_setTSpace            = nullptr; // basic is sufficient for normal mapping
 
     SMikkTSpaceContext const ctx{ &iface, &ud };
@@ -120,8 +153,24 @@ static std::vector<vec4> computeTangentsMikkt(
     return std::move(ud.tangents_unindexed);
 }
 
+static std::vector<vec4> computeTangentsMikkt(
+    gltf::data    const &data,
+    std::vector<u32>     indices,
+    gltf::id const position_accessor_id,
+    gltf::id const normal_accessor_id,
+    gltf::id const texcoord_accessor_id)
+{
+    return computeTangentsMikkt(
+        AccessorTangentSource{
+            .positions = gltf::AccessorView<vec3>(data, position_accessor_id),
+            .normals   = gltf::AccessorView<vec3>(data, normal_accessor_id),
+            .texcoords = gltf::AccessorView<vec2>(data, texcoord_accessor_id)
+        },
+        std::move(indices));
+}
+
 static void uploadTangentBuffer(
-    Vec<SharedPtr<Buffer>>       &buffers_out,   // Mesh::buffers_
+    Mesh                         &mesh,
     SharedPtr<VertexArray> const &vertex_array,
     std::vector<vec4>             tangents)       // moved-in
 {
@@ -131,7 +180,7 @@ static void uploadTangentBuffer(
         tangents.data(),
         std::nullopt
     );
-    buffers_out.push_back(tangent_buffer);
+    mesh.addBuffer(tangent_buffer);
 
     u32 const binding = vertex_array->vertex_buffer_count++;
 
@@ -152,6 +201,33 @@ static void uploadTangentBuffer(
     });
 }
 
+PendingTangents::~PendingTangents() {
+	assert(jobs_.empty() && "finish() must run before the meshes waiting on these tangents are used");
+}
+
+void PendingTangents::add(Mesh &mesh, SharedPtr<VertexArray> vertex_array, std::future<Vec<vec4>> tangents) {
+	jobs_.push_back({ &mesh, std::move(vertex_array), std::move(tangents) });
+}
+
+std::size_t PendingTangents::uploadReady() {
+	std::erase_if(jobs_, [](Job &job) {
+		if (job.tangents.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+		uploadTangentBuffer(*job.mesh, job.vertex_array, job.tangents.get());
+		return true;
+	});
+	return jobs_.size();
+}
+
+void PendingTangents::finish() {
+	while (uploadReady() != 0) {
+		// Texture loads on the pool block on main thread tasks, if they hold every worker the tangent jobs never start.
+		if (Engine::singleton()->isOnMainThread())
+			Engine::singleton()->workLazyTasks();
+		jobs_.front().tangents.wait_for(std::chrono::milliseconds(1));
+	}
+}
+
 #define GLTF_USE_MANY_BUFFERS
 
 CSkin::CSkin() {
@@ -173,8 +249,8 @@ Mesh::Mesh(gltf::data const &data, _STD size_t const mesh_id) : is_skinned_(fals
 	//processMesh(data, data.meshes[mesh_id]);
 	//processMaterials(data);
 }
-Mesh::Mesh(gltf::data &data, std::size_t const mesh_id, Vec<SharedPtr<Buffer>> &views) : is_skinned_(false) {
-	processMesh(data, data.meshes[mesh_id], views);
+Mesh::Mesh(gltf::data &data, std::size_t const mesh_id, Vec<SharedPtr<Buffer>> &views, PendingTangents *pending_tangents) : is_skinned_(false) {
+	processMesh(data, data.meshes[mesh_id], views, pending_tangents);
 }
 
 Mesh::Mesh(gltf::data &data, _STD size_t const mesh_id, [[maybe_unused]] _STD size_t skin_id) : is_skinned_(true){
@@ -182,20 +258,70 @@ Mesh::Mesh(gltf::data &data, _STD size_t const mesh_id, [[maybe_unused]] _STD si
 }
 
 Mesh::~Mesh() {
+	for (MeshPrimitive const &primitive : primitives_) {
+		if (primitive.geometry != INVALID_GEOMETRY)
+			ModelManager::singleton()->release(primitive.geometry);
+	}
 }
 
 _STD size_t Mesh::subMeshCount() const {
 	return primitives_.size();
 }
 
-void Mesh::drawSubMesh(RenderPassInfo const &info, _STD size_t const submesh) const {
-	auto const &[vertex_array,  material, aabb] = primitives_[submesh];
-	if (material) { //< Not really likely or unlikely I think.
-		material->bind(info);
+void Mesh::drawSubMesh(RenderPassInfo const &info, _STD size_t const submesh, u32 const lod, i32 const instances) const {
+	MeshPrimitive const &primitive = primitives_[submesh];
+	if (primitive.material) { //< Not really likely or unlikely I think.
+		primitive.material->bind(info);
 	}
-	if (vertex_array) [[likely]] {
-		vertex_array->bind();
-		vertex_array->draw();
+	if (info.bind_vertex_packing) {
+		info.shader_program->setUniform(VERTEX_PACKING_UNIFORM_LOCATION, primitive.packed_vertices ? 1 : 0);
+		if (primitive.packed_vertices) {
+			PositionDequantization const dequantization = PositionDequantization::fromBounds(primitive.aabb_);
+			info.shader_program->setUniform(VERTEX_PACKING_UNIFORM_LOCATION + 1, dequantization.offset);
+			info.shader_program->setUniform(VERTEX_PACKING_UNIFORM_LOCATION + 2, dequantization.scale);
+		}
+	}
+	if (primitive.geometry != INVALID_GEOMETRY) {
+		ModelManager const *const pool = ModelManager::singleton();
+		if (lod == 0 || lod > primitive.lods.size()) {
+			pool->draw(primitive.geometry, 0, primitive.geometry_index_count, instances);
+		}
+		else {
+			MeshLodRange const &range = primitive.lods[lod - 1];
+			pool->draw(primitive.geometry, static_cast<u32>(range.offset_of_elements / sizeof(u32)), static_cast<u32>(range.elements_count), instances);
+		}
+	}
+	else if (primitive.vertex_array) [[likely]] {
+		primitive.vertex_array->bind();
+		if (lod == 0 || lod > primitive.lods.size()) {
+			if (instances > 1)
+				primitive.vertex_array->drawInstanced(instances);
+			else
+				primitive.vertex_array->draw();
+		}
+		else {
+			MeshLodRange const &range = primitive.lods[lod - 1];
+			if (instances > 1)
+				primitive.vertex_array->drawRangeInstanced(range.offset_of_elements, range.elements_count, instances);
+			else
+				primitive.vertex_array->drawRange(range.offset_of_elements, range.elements_count);
+		}
+	}
+}
+
+bool Mesh::pooled(std::size_t const submesh) const {
+	return primitives_[submesh].geometry != INVALID_GEOMETRY;
+}
+
+void Mesh::queueSubMesh(IndirectDrawBatch &batch, u32 const model_index, _STD size_t const submesh, u32 const lod) const {
+	MeshPrimitive const &primitive = primitives_[submesh];
+	assert(primitive.geometry != INVALID_GEOMETRY);
+	if (lod == 0 || lod > primitive.lods.size()) {
+		batch.add(model_index, primitive.material.get(), primitive.geometry, 0, primitive.geometry_index_count);
+	}
+	else {
+		MeshLodRange const &range = primitive.lods[lod - 1];
+		batch.add(model_index, primitive.material.get(), primitive.geometry, static_cast<u32>(range.offset_of_elements / sizeof(u32)), static_cast<u32>(range.elements_count));
 	}
 }
 
@@ -204,6 +330,27 @@ void Mesh::drawAllSubMeshes(RenderPassInfo const &info) const {
 		drawSubMesh(info, i);
 }
 
+u32 Mesh::selectLod(std::size_t const submesh, f32 const pixels_per_unit, f32 const threshold_pixels) const {
+	Vec<MeshLodRange> const &lods = primitives_[submesh].lods;
+	u32 lod = 0;
+	// Errors only grow down the chain, stop at the first level that would show.
+	while (lod < lods.size() && lods[lod].error * pixels_per_unit <= threshold_pixels)
+		lod++;
+	return lod;
+}
+
+AABB const &Mesh::bounds(std::size_t const submesh) const {
+	return primitives_[submesh].aabb_;
+}
+
+Material const *Mesh::material(std::size_t const submesh) const {
+	return primitives_[submesh].material.get();
+}
+
+std::span<Meshlet const> Mesh::meshlets(std::size_t const submesh) const {
+	return primitives_[submesh].meshlets;
+}
+
 void Mesh::addPrimitive(SharedPtr<VertexArray> const &vertex_array, SharedPtr<Material> const &material, AABB const &aabb) {
 	primitives_.push_back(MeshPrimitive{vertex_array, material, aabb});
 }
@@ -224,17 +371,124 @@ constexpr auto alloc_block_step = 0x100000;
 #undef max
 
 AABB Mesh::processAABB(Vec<Vertex> const &vertices) {
-	vec3 minAABB(std::numeric_limits<float>::max());
-	vec3 maxAABB(std::numeric_limits<float>::min());
-	for (Vertex const &vertex : vertices) {
-		minAABB.x = std::min(minAABB.x, vertex.position.x);
-		minAABB.y = std::min(minAABB.y, vertex.position.y);
-		minAABB.z = std::min(minAABB.z, vertex.position.z);
-		maxAABB.x = std::max(maxAABB.x, vertex.position.x);
-		maxAABB.y = std::max(maxAABB.y, vertex.position.y);
-		maxAABB.z = std::max(maxAABB.z, vertex.position.z);
+	if (vertices.empty())
+		return { vec3(0.0f), vec3(0.0f) };
+	return computePositionBounds(&vertices.front().position, vertices.size(), sizeof(Vertex));
+}
+
+/* POSITION bounds, taken from the accessor's min/max when the exporter wrote them and reduced from the stream otherwise. */
+static AABB positionAccessorBounds(gltf::data const &data, gltf::id const accessor_id) {
+	gltf::accessor const &accessor = data.accessors[accessor_id];
+	if (accessor.hasBounds()) {
+		vec3 min(accessor.min()[0], accessor.min()[1], accessor.min()[2]);
+		vec3 max(accessor.max()[0], accessor.max()[1], accessor.max()[2]);
+		// Bounds are written in the stored type, normalized (KHR_mesh_quantization) ones still need mapping to [-1, 1] / [0, 1].
+		if (accessor.normalized()) {
+			f32 scale = 1.0f;
+			switch (accessor.componentType()) {
+				case gltf::component_type::signed_byte:    scale = 1.0f / 127.0f; break;
+				case gltf::component_type::unsigned_byte:  scale = 1.0f / 255.0f; break;
+				case gltf::component_type::signed_short:   scale = 1.0f / 32767.0f; break;
+				case gltf::component_type::unsigned_short: scale = 1.0f / 65535.0f; break;
+				default: break;
+			}
+			min = glm::max(min * scale, vec3(-1.0f));
+			max = glm::max(max * scale, vec3(-1.0f));
+		}
+		return { min, max };
+	}
+
+	gltf::AccessorView<vec3> const positions(data, accessor);
+	if (positions.direct())
+		return computePositionBounds(positions.data(), positions.size(), positions.stride());
+
+	Vec<vec3> const decoded = positions.to_vector();
+	return computePositionBounds(decoded.data(), decoded.size());
+}
+
+InterleavedPrimitive interleavePrimitive(gltf::data const &data, gltf::primitive const &primitive) {
+	std::optional<gltf::id> position_accessor;
+	std::optional<gltf::id> normal_accessor;
+	std::optional<gltf::id> tangent_accessor;
+	std::optional<gltf::id> uv0_accessor;
+	std::optional<gltf::id> uv1_accessor;
+	Vec<gltf::id> other_accessors; //< JOINTS_n, WEIGHTS_n, COLOR_n..., not in Vertex but they still tell vertices apart.
+
+	for (auto const &[name, accessor_id] : primitive.attributes) {
+		switch (hash(name)) {
+			case hash("POSITION"):   position_accessor = accessor_id; break;
+			case hash("NORMAL"):     normal_accessor = accessor_id; break;
+			case hash("TANGENT"):    tangent_accessor = accessor_id; break;
+			case hash("TEXCOORD_0"): uv0_accessor = accessor_id; break;
+			case hash("TEXCOORD_1"): uv1_accessor = accessor_id; break;
+			default: other_accessors.push_back(accessor_id); break;
+		}
 	}
-	return { minAABB, maxAABB };
+
+	InterleavedPrimitive result;
+	if (!position_accessor.has_value())
+		return result;
+
+	std::size_t const vertex_count = data.accessors[position_accessor.value()].count();
+	if (vertex_count == 0)
+		return result;
+	Vec<Vertex> vertices(vertex_count);
+	Vertex &first = vertices.front();
+
+	auto const copyAttribute = [&]<typename T>(std::optional<gltf::id> const accessor_id, T *destination) {
+		if (!accessor_id.has_value())
+			return;
+		gltf::AccessorView<T> const view(data, accessor_id.value());
+		assert(view.size() == vertex_count && "Every attribute of a primitive must have the same count");
+		view.copy_to_strided(destination, sizeof(Vertex));
+	};
+	copyAttribute(position_accessor, &first.position);
+	copyAttribute(normal_accessor, &first.normal);
+	copyAttribute(tangent_accessor, &first.tangent);
+	copyAttribute(uv0_accessor, &first.texcoord0);
+	copyAttribute(uv1_accessor, &first.texcoord1);
+
+	if (primitive.indices != -1) {
+		result.indices = gltf::AccessorView<u32>(data, primitive.indices).to_vector();
+	}
+	else {
+		result.indices.resize(vertex_count);
+		for (std::size_t i = 0; i < vertex_count; i++)
+			result.indices[i] = static_cast<u32>(i);
+	}
+
+	// Weld before MikkTSpace, so split copies of a vertex end up with one tangent instead of one each.
+	Vec<Vec<vec4>> other_streams;
+	other_streams.reserve(other_accessors.size());
+	Vec<VertexStream> streams{
+		{ &first.position, sizeof(Vertex::position), sizeof(Vertex) },
+		{ &first.normal, sizeof(Vertex::normal), sizeof(Vertex) },
+		{ &first.tangent, sizeof(Vertex::tangent), sizeof(Vertex) },
+		{ &first.texcoord0, sizeof(Vertex::texcoord0), sizeof(Vertex) },
+		{ &first.texcoord1, sizeof(Vertex::texcoord1), sizeof(Vertex) },
+	};
+	for (gltf::id const accessor_id : other_accessors) {
+		Vec<vec4> const &decoded = other_streams.emplace_back(gltf::AccessorView<vec4>(data, accessor_id).to_vector());
+		if (decoded.size() == vertex_count)
+			streams.push_back({ decoded.data(), sizeof(vec4), sizeof(vec4) });
+	}
+
+	Vec<u32> remap;
+	std::size_t const unique_count = generateVertexRemap(remap, result.indices, vertex_count, streams);
+	result.source_vertex_count = vertex_count;
+	result.vertices.resize(unique_count);
+	remapVertices(result.vertices.data(), vertices.data(), vertex_count, sizeof(Vertex), remap);
+	remapIndices(result.indices, remap);
+
+	if (!tangent_accessor.has_value() && normal_accessor.has_value() && uv0_accessor.has_value() && !result.indices.empty()) {
+		std::vector<vec4> const corner_tangents = computeTangentsMikkt(VertexTangentSource{ result.vertices.data() }, result.indices);
+		// MikkTSpace works per corner, each vertex keeps the tangent of the last corner that used it.
+		for (std::size_t i = 0; i < result.indices.size(); i++)
+			result.vertices[result.indices[i]].tangent = corner_tangents[i];
+	}
+
+	result.aabb = positionAccessorBounds(data, position_accessor.value());
+	return result;
 }
 
 void Mesh::processMeshAndSkin(gltf::data &data, gltf::mesh &mesh, gltf::skin &skin) {
@@ -280,25 +534,65 @@ static void channelsToInternalFormat(int const channels, bool const compressed,
 	}
 }
 
-static void loadDDS(gltf::image const &image, std::shared_ptr<Texture> const &impl) {
-	FILE *F;
-	errno_t const ore = fopen_s(&F, image.file.c_str(), "rb");
-	assert(ore == 0 && F != nullptr);
-	std::string err;
-	Error const res = DDS_UploadFromStdIO(F, impl->texture_object_, err);
-	if (res != OK) __debugbreak();
-	assert(res == OK);
-	// The loader may close the file on its own.
-	if (F) assert(fclose(F) == 0);
+static std::future<void> loadDDSAsync(gltf::image const &image, std::shared_ptr<Texture> impl) {
+	return ThreadPool::singleton()->addTaskToQueue([path = image.file, impl] {
+		Result<DdsImage> opened = DdsImage::open(path);
+		if (opened.error() != OK) {
+			printf("Couldn't load DDS \"%s\": %s\n", path.c_str(), to_string(opened.error()));
+			return;
+		}
+		auto const dds = std::make_shared<DdsImage>(opened.value());
+		if (dds->layerCount() != 1) {
+			printf("Skipping DDS \"%s\", cubemaps and arrays can't be material textures.\n", path.c_str());
+			return;
+		}
+
+		StagedTexture staged{
+			.texture = impl,
+			.internal_format = static_cast<gl::InternalFormat>(DDS_GLInternalFormat(dds->format())),
+			.compressed = true,
+			.pixels = dds->payload(),
+			.keep_alive = dds
+		};
+		for (DdsLevel const &level : dds->levels())
+			staged.levels.push_back({ ivec2(level.width, level.height), level.offset, level.size });
+		// Page faults on the mapping happen here while copying, the file is unmapped right after unless the ring was full
+		// or the texture is streamed, streamed textures keep reading their levels from the mapping.
+		stageInRing(staged);
+		TextureUploader::singleton()->enqueue(std::move(staged));
+	});
 }
 
 static void loadKTX2(gltf::image const &image, std::shared_ptr<Texture> const &impl) {
-	auto const ktx2 = image.ktx2_texture;
-	Error const res = ktx::textureLoad(ktx2, impl->texture_object_);
-	assert(res == OK);
-	impl->generateMipmap();
-	
-	ktxTexture_Destroy(ktx2);
+	ktxTexture *const ktx2 = image.ktx2_texture;
+	if (ktx2->numDimensions != 2 || ktx2->numLayers != 1 || ktx2->numFaces != 1) {
+		// Only plain 2D textures go through the uploader, anything else loads the way it always did.
+		Error const res = ktx::textureLoad(ktx2, impl->texture_object_);
+		assert(res == OK);
+		impl->generateMipmap();
+		ktxTexture_Destroy(ktx2);
+		return;
+	}
+
+	// The payload was read (and transcoded) by the importer, staging it is just describing it.
+	ktx::GlFormat const format = ktx::glFormat(ktx2);
+	StagedTexture staged{
+		.texture = impl,
+		.internal_format = static_cast<gl::InternalFormat>(format.internal_format),
+		.pixel_format = static_cast<gl::PixelFormat>(format.format),
+		.pixel_type = static_cast<gl::PixelType>(format.type),
+		.compressed = ktx2->isCompressed,
+		.generate_mipmaps = !ktx2->isCompressed && ktx2->numLevels == 1,
+		.pixels = { reinterpret_cast<char const *>(ktxTexture_GetData(ktx2)), ktxTexture_GetDataSize(ktx2) },
+		.keep_alive = SharedPtr<void>(ktx2, [](void *texture) { ktxTexture_Destroy(static_cast<ktxTexture *>(texture)); })
+	};
+	for (ktx_uint32_t level = 0; level < ktx2->numLevels; level++) {
+		ktx_size_t offset = 0;
+		ktxTexture_GetImageOffset(ktx2, level, 0, 0, &offset);
+		ivec2 const size((std::max)(ktx2->baseWidth >> level, 1u), (std::max)(ktx2->baseHeight >> level, 1u));
+		staged.levels.push_back({ size, offset, ktxTexture_GetImageSize(ktx2, level) });
+	}
+	TextureUploader::singleton()->enqueue(std::move(staged));
 }
 
 static void my_png_err(png_structp png_ptr, char const *message) {
@@ -313,67 +607,78 @@ static void my_png_warn(png_structp png_ptr, char const *message) {
 static void loadPNGAsync_Inner(int h, void *output, gltf::image const &image, std::shared_ptr<Texture> const &impl) {
 }
 
-static std::future<void> loadPNGAsync(Mesh &mesh, gltf::image const &image, std::shared_ptr<Texture> impl) {
-	return ThreadPool::singleton()->addTaskToQueue([&mesh, &image, impl] { // std::shared_ptr should almost always be copied! The IDE will yell at you but this is good practice with concurrency.
+/* Feeds libpng from an image embedded in a buffer view (GLB) instead of a file. */
+struct PngMemoryReader {
+	u8 const *cursor;
+	u8 const *end;
+};
+
+static void my_png_read_memory(png_structp png_ptr, png_bytep out, png_size_t length) {
+	auto *reader = static_cast<PngMemoryReader *>(png_get_io_ptr(png_ptr));
+	if (static_cast<png_size_t>(reader->end - reader->cursor) < length)
+		png_error(png_ptr, "read past the end of an embedded image");
+	std::memcpy(out, reader->cursor, length);
+	reader->cursor += length;
+}
+
+static std::future<void> loadPNGAsync(gltf::image const &image, std::shared_ptr<Texture> impl) {
+	return ThreadPool::singleton()->addTaskToQueue([&image, impl] { // std::shared_ptr should almost always be copied! The IDE will yell at you but this is good practice with concurrency.
 		using namespace gl;
-		FILE *f;
+		FILE *f = nullptr;
 		std::string uri(image.uri);
-		assert(fopen_s(&f,image.uri.c_str(), "rb") == 0);
+		PngMemoryReader memory_reader{ image.embedded.data(), image.embedded.data() + image.embedded.size() };
 
 		png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, my_png_err, my_png_warn);
 		png_infop info_ptr = png_create_info_struct(png_ptr);
-		png_init_io(png_ptr, f);
+		if (image.embedded.empty()) {
+			errno_t const open_result = fopen_s(&f, image.uri.c_str(), "rb");
+			assert(open_result == 0);
+			png_init_io(png_ptr, f);
+		}
+		else {
+			png_set_read_fn(png_ptr, &memory_reader, my_png_read_memory);
+		}
 		png_read_info(png_ptr, info_ptr);
 
-		png_byte const bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+		// Staged levels are 8 bits per channel, the mip chain below is built on that.
+		png_set_strip_16(png_ptr);
+		png_set_packing(png_ptr);
+		if (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_PALETTE)
+			png_set_palette_to_rgb(png_ptr);
+		if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS))
+			png_set_tRNS_to_alpha(png_ptr);
+		png_read_update_info(png_ptr, info_ptr);
+
 		png_byte const channels = png_get_channels(png_ptr, info_ptr);
 		int const w = static_cast<int>(png_get_image_width(png_ptr, info_ptr));
 		int const h = static_cast<int>(png_get_image_height(png_ptr, info_ptr));
 		size_t const rowbytes = png_get_rowbytes(png_ptr, info_ptr);
-		sizei_t const alloc_size = static_cast<sizei_t>(rowbytes * h);
-
-		::Buffer const *pixelUnpack;
-		void* data;
-		Engine::singleton()->addLazyTaskToMainThreadQueue([&] {
-			using enum MapBufferAccessMask;
-			pixelUnpack = AsyncTextureBank::singleton()->checkout(alloc_size);
-			if (pixelUnpack == nullptr)
-				return false; // Don't remove this task, because something ain't right! Let it go around again.
-			data = pixelUnpack->mapRange(0, alloc_size,  MapPersistentBit | MapWriteBit);
-			return true;
-		}).get();
-		
+
+		InternalFormat internal_format;
+		PixelFormat pixel_format;
+		channelsToInternalFormat(channels, false, internal_format, pixel_format);
+		StagedTexture staged{
+			.texture = impl,
+			.internal_format = internal_format,
+			.pixel_format = pixel_format,
+			.pixel_type = PixelType::UnsignedByte
+		};
+		staged.levels.push_back({ ivec2(w, h), 0, rowbytes * h });
+		staged.storage.resize(rowbytes * h);
+
 		std::vector<png_bytep> rowPointers(h);
 		for (int i = 0; i < h; i++) {
-			rowPointers[i] = (png_bytep)data + i * rowbytes;
+			rowPointers[i] = reinterpret_cast<png_bytep>(staged.storage.data()) + i * rowbytes;
 		}
 		png_read_image(png_ptr, rowPointers.data());
 
-		Engine::singleton()->addLazyTaskToMainThreadQueue([&pixelUnpack, w, h, channels, impl, &mesh] {
-			using enum BufferTargetARB;
-			using enum PixelType;
-			assert(pixelUnpack->unmap());
-			pixelUnpack->bind(PixelUnpackBuffer);
-			InternalFormat internal_format;
-			PixelFormat pixel_format;
-			channelsToInternalFormat(channels, false, internal_format, pixel_format);
-			impl->allocate(ivec2(w, h), 1, internal_format);
-			impl->uploadImage2D(
-				nullptr,
-				0,
-				ivec2(0, 0),
-				ivec2(w, h),
-				pixel_format,
-				UnsignedByte
-			);
-			impl->generateMipmap();
-			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-			AsyncTextureBank::singleton()->checkin(pixelUnpack);
-			return true;
-		}).get();
-		
 		png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
-		fclose(f);
+		if (f != nullptr)
+			fclose(f);
+
+		buildMipChain(staged, channels);
+		stageInRing(staged);
+		TextureUploader::singleton()->enqueue(std::move(staged));
 
 		std::cout << "Finished loading PNG " <<  uri << " asynchronously.\n";
 	});
@@ -445,13 +750,13 @@ static SharedPtr<Texture> loadTexture(Mesh &mesh, gltf::data &data, gltf::textur
 	SharedPtr<Texture> const impl = texture.impl;
 	switch (image.image_type) {
 		case gltf::image_type_dds:
-			loadDDS(image, impl);
+			mesh.async_tasks_.push_back(loadDDSAsync(image, impl));
 			break;
 		case gltf::image_type_ktx2:
 			loadKTX2(image, impl);
 			break;
 		case gltf::image_type_png:
-			mesh.async_tasks_.push_back(loadPNGAsync(mesh, image, impl));
+			mesh.async_tasks_.push_back(loadPNGAsync(image, impl));
 			break;
 		case gltf::image_type_generic:
 			break;
@@ -586,7 +891,11 @@ PrimAttribResult  Mesh::processPrimitiveAttribs(gltf::data &data, SharedPtr<Vert
 				break;
 			case hash("JOINTS_0"):
 				gltfDebugPrint("JOINTS_0 attribute identified");
+#ifdef GLTF_USE_MANY_BUFFERS
+				applyAccessorAsAttribute(data, 4, vertex_array, accessor, views, true);
+#else
 				SetupAttribute(vertex_buffer_, 44, data, 4, vertex_array, accessor);
+#endif
 				break;
 			case hash("WEIGHTS_0"):
 				gltfDebugPrint("WEIGHTS_0 attribute identified");
@@ -631,22 +940,25 @@ PrimAttribResult  Mesh::processPrimitiveAttribs(gltf::data &data, SharedPtr<Vert
 		&& uv_accessor.has_value()
 		&& index_accessor != -1)
 	{
-		tangent_future = std::async(
-			std::launch::async,
+		// Pooled rather than a thread per primitive, an import can have thousands of these in flight.
+		auto job = std::make_shared<std::packaged_task<std::vector<vec4>()>>(
 			[&data,
 			 ia  = index_accessor,
 			 pa  = position_accessor.value(),
 			 na  = normal_accessor.value(),
 			 uva = uv_accessor.value()]() -> std::vector<vec4> {
-				return computeTangentsMikkt(data, ia, pa, na, uva);
+				return computeTangentsMikkt(data, gltf::AccessorView<u32>(data, ia).to_vector(), pa, na, uva);
 			});
+		tangent_future = job->get_future();
+		ThreadPool::singleton()->addTaskToQueue([job] { (*job)(); });
 	}
 
-	return PrimAttribResult{ AABB(vec3(0),vec3(0)), std::move(tangent_future) };
+	AABB const aabb = position_accessor.has_value() ? positionAccessorBounds(data, position_accessor.value()) : AABB(vec3(0), vec3(0));
+	return PrimAttribResult{ aabb, std::move(tangent_future) };
 #endif
 }
 
-void Mesh::applyAccessorAsAttribute(gltf::data const &data, i32 const index, _STD shared_ptr<VertexArray> const &vertex_array, gltf::accessor const &accessor, Vec<SharedPtr<Buffer>> &views) {
+void Mesh::applyAccessorAsAttribute(gltf::data const &data, i32 const index, _STD shared_ptr<VertexArray> const &vertex_array, gltf::accessor const &accessor, Vec<SharedPtr<Buffer>> &views, bool const integer) {
 #ifdef GLTF_USE_MANY_BUFFERS
 	VertexArrayAttribute attrib{};
 	attrib.offset = 0;
@@ -655,6 +967,9 @@ void Mesh::applyAccessorAsAttribute(gltf::data const &data, i32 const index, _ST
 
 	size_t const size = gltf::sizeForComponentType(accessor.componentType());
 	attrib.type = gltf::gpuComponentTypeFromGltfComponentType(accessor.componentType());
+	// KHR_mesh_quantization: byte and short attributes go to the GPU as stored, GL does the dequantizing.
+	attrib.normalized = accessor.normalized();
+	attrib.integer = integer;
 	
 	gltf::buffer_view const buffer_view = data.buffer_views[accessor.bufferView()];
 	gltf::buffer const& gltf_buffer = data.buffers[buffer_view.buffer];
@@ -751,40 +1066,46 @@ void Mesh::applyAccessorAsAttributeSingleBuffer(
 	SharedPtr<VertexArray> const &vertex_array,
 	gltf::accessor const &accessor
 ) {
-	gltf::buffer_view const buffer_view = data.buffer_views[accessor.bufferView()];
-	gltf::buffer const& gltf_buffer = data.buffers[buffer_view.buffer];
-
-	assert(gltf_buffer.length() >= buffer_view.offset + buffer_view.length);
-
-	auto const raw_data = &gltf_buffer.data()[buffer_view.offset];
-	for (size_t i = 0; i < accessor.count(); ++i) {
-		switch (index) {
-			case 0:
-				buffer[i].position = reinterpret_cast<vec3 const *>(raw_data)[i];
-				break;
-			case 1:
-				buffer[i].normal = reinterpret_cast<vec3 const *>(raw_data)[i];
-				break;
-			case 3:
-				buffer[i].texcoord0 = reinterpret_cast<vec2 const *>(raw_data)[i];
-				break;
-			case 4:
-				buffer[i].joints0 = reinterpret_cast<uint32_t const *>(raw_data)[i];
-				break;
-			case 5:
-				buffer[i].weights0 = reinterpret_cast<vec4 const *>(raw_data)[i];
-				break;
-			default:
-				break;
-		}
+	switch (index) {
+		case 0:
+			gltf::AccessorView<vec3>(data, accessor).copy_to_strided(&buffer[0].position, sizeof(skinned_vertex));
+			break;
+		case 1:
+			gltf::AccessorView<vec3>(data, accessor).copy_to_strided(&buffer[0].normal, sizeof(skinned_vertex));
+			break;
+		case 3:
+			gltf::AccessorView<vec2>(data, accessor).copy_to_strided(&buffer[0].texcoord0, sizeof(skinned_vertex));
+			break;
+		case 4:
+			// Four u8 joint indices packed into one uint, u16 joints only fit while the skin has at most 256 joints.
+			if (accessor.componentType() != gltf::component_type::unsigned_byte) {
+				u16 highest_joint = 0;
+				for (glm::u16vec4 const joints : gltf::AccessorView<glm::u16vec4>(data, accessor))
+					highest_joint = (_STD max)({ highest_joint, joints.x, joints.y, joints.z, joints.w });
+				if (highest_joint > 255)
+					printf("JOINTS_0 references joint %u, skinned vertices only address 256 joints, the mesh will animate with the wrong bones.\n", static_cast<u32>(highest_joint));
+			}
+			gltf::AccessorView<glm::u8vec4>(data, accessor).copy_to_strided(&buffer[0].joints0, sizeof(skinned_vertex));
+			break;
+		case 5:
+			gltf::AccessorView<vec4>(data, accessor).copy_to_strided(&buffer[0].weights0, sizeof(skinned_vertex));
+			break;
+		default:
+			break;
 	}
 	VertexArrayAttribute attrib;
 	attrib.offset = static_cast<gltf::id>(offset);
 	attrib.type = gltf::gpuComponentTypeFromGltfComponentType(accessor.componentType());
 	attrib.size = static_cast<gltf::id>(gltf::sizeForComponentType(accessor.componentType()));
+	if (index == 4) {
+		// Joints are always stored as the packed u8vec4 above, whatever the accessor's component type.
+		attrib.type = EComponentType::UNSIGNED_BYTE;
+		attrib.size = 4;
+	}
 	attrib.binding = 0;
 	attrib.stride = 64;
 	attrib.normalized = false;
+	attrib.integer = index == 4; //< Joints.
 	attrib.index = index;
 	vertex_array->setAttribute(attrib);
 	gpu_check;
@@ -828,13 +1149,13 @@ void Mesh::applyAccessorAsElementBuffer(gltf::data const &data, _STD shared_ptr<
 	vertex_array->elements_count = accessor.count();
 	vertex_array->offset_of_elements = accessor.offset(); //< offset is in bytes.
 	
-	vertex_array->draw_elements_type = gl::DrawElementsType::UnsignedShort;
+	vertex_array->draw_elements_type = drawElementsTypeFromComponentType(accessor.componentType());
 	vertex_array->setElementBuffer(*buffer);
 	
 	gltfDebugPrintf("Element buffer applied with %llu elements", accessor.count());
 }
 
-void Mesh::processMesh(gltf::data &data, gltf::mesh const &mesh, Vec<SharedPtr<Buffer>> &views) {
+void Mesh::processMesh(gltf::data &data, gltf::mesh const &mesh, Vec<SharedPtr<Buffer>> &views, PendingTangents *pending_tangents) {
 
     struct PrimRecord {
         SharedPtr<VertexArray>         vertex_array;
@@ -876,12 +1197,15 @@ void Mesh::processMesh(gltf::data &data, gltf::mesh const &mesh, Vec<SharedPtr<B
         ++label_suffix;
     }
 	
+    // Without an import to hand the jobs to, this mesh waits for its own tangents.
+    PendingTangents local_tangents;
+    PendingTangents &tangents = pending_tangents != nullptr ? *pending_tangents : local_tangents;
     for (auto &rec : records) {
-        if (rec.tangent_future.valid()) {
-            uploadTangentBuffer(buffers_, rec.vertex_array,
-                                rec.tangent_future.get());
-        }
+        if (rec.tangent_future.valid())
+            tangents.add(*this, rec.vertex_array, std::move(rec.tangent_future));
     }
+    tangents.uploadReady();
+    local_tangents.finish();
 
     primitives_.reserve(primitives_.size() + records.size());
     for (auto &rec : records) {
@@ -892,3 +1216,187 @@ void Mesh::processMesh(gltf::data &data, gltf::mesh const &mesh, Vec<SharedPtr<B
         });
     }
 }
+
+/* PackedVertex, same locations. shaders/vertex_packing.glsl turns them back into what InterleavedVertexAttributes feed. */
+static constexpr VertexArrayAttribute PackedVertexAttributes[] = {
+	{ .index = 0, .binding = 0, .size = 4, .stride = sizeof(PackedVertex), .offset = offsetof(PackedVertex, position),  .type = EComponentType::UNSIGNED_SHORT, .normalized = true },
+	{ .index = 1, .binding = 0, .size = 2, .stride = sizeof(PackedVertex), .offset = offsetof(PackedVertex, normal),    .type = EComponentType::SIGNED_SHORT,   .normalized = true },
+	{ .index = 2, .binding = 0, .size = 2, .stride = sizeof(PackedVertex), .offset = offsetof(PackedVertex, tangent),   .type = EComponentType::SIGNED_SHORT,   .normalized = true },
+	{ .index = 3, .binding = 0, .size = 2, .stride = sizeof(PackedVertex), .offset = offsetof(PackedVertex, texcoord0), .type = EComponentType::HALF_FLOAT,     .normalized = false },
+	{ .index = 4, .binding = 0, .size = 2, .stride = sizeof(PackedVertex), .offset = offsetof(PackedVertex, texcoord1), .type = EComponentType::HALF_FLOAT,     .normalized = false },
+};
+
+Mesh::Mesh(gltf::data &data, hlxscene::scene const &scene, std::size_t const mesh_id) : is_skinned_(false) {
+	hlxscene::mesh_record const &record = scene.meshes()[mesh_id];
+	std::span<char const> const vertices = scene.vertices(record);
+	std::span<char const> const indices = scene.indices(record);
+	if (vertices.empty() || indices.empty())
+		return;
+
+	if (!scene.packedVertices()) {
+		addPooledPrimitives(data, scene, record);
+		return;
+	}
+
+	// The blobs are already laid out for the GPU, they go from the mapping straight into buffer storage.
+	auto const vertex_buffer = std::make_shared<Buffer>();
+	vertex_buffer->allocate(vertices.size(), vertices.data(), std::nullopt);
+	auto const index_buffer = std::make_shared<Buffer>();
+	index_buffer->allocate(indices.size(), indices.data(), std::nullopt);
+	buffers_.push_back(vertex_buffer);
+	buffers_.push_back(index_buffer);
+	gpu_check;
+
+	std::string const name(scene.string(record.name));
+	char label_suffix = '0';
+
+	std::span<hlxscene::primitive_record const> const primitives = scene.primitives(record);
+	primitives_.reserve(primitives.size());
+	for (hlxscene::primitive_record const &primitive : primitives) {
+		auto vertex_array = std::make_shared<VertexArray>();
+		vertex_array->bind();
+		vertex_array->setLabel(name + "#" + label_suffix++);
+
+		vertex_array->setVertexBuffer(0, *vertex_buffer, hlxscene::VERTEX_STRIDE, static_cast<i64>(primitive.vertex_offset));
+		vertex_array->vertex_buffer_count = 1;
+		for (VertexArrayAttribute const &attrib : PackedVertexAttributes)
+			vertex_array->setAttribute(attrib);
+
+		vertex_array->setElementBuffer(*index_buffer);
+		vertex_array->elements_count = primitive.index_count;
+		vertex_array->offset_of_elements = primitive.index_offset; //< offset is in bytes.
+		vertex_array->draw_elements_type = static_cast<gl::DrawElementsType>(primitive.index_type);
+		gpu_check;
+
+		std::span<Meshlet const> const meshlets = scene.meshlets(primitive);
+		Vec<MeshLodRange> lods;
+		for (hlxscene::lod_record const &lod : scene.lods(primitive))
+			lods.push_back({ .offset_of_elements = lod.index_offset, .elements_count = lod.index_count, .error = lod.error });
+
+		primitives_.push_back({
+			.vertex_array = std::move(vertex_array),
+			.material     = static_cast<std::size_t>(primitive.material) < data.materials.size()
+			                    ? loadMaterial(*this, data, primitive.material) : nullptr,
+			.aabb_        = AABB(primitive.aabb_center, primitive.aabb_extents.x, primitive.aabb_extents.y, primitive.aabb_extents.z),
+			.meshlets     = Vec<Meshlet>(meshlets.begin(), meshlets.end()),
+			.lods         = std::move(lods),
+			.packed_vertices = true,
+		});
+	}
+}
+
+namespace {
+	/* Appends `count` indices of `type` starting `offset` bytes into `source`, widened to u32. */
+	void appendIndices(Vec<u32> &destination, std::span<char const> const source, std::size_t const offset, u32 const count, gl::enum_t const type) {
+		std::size_t const first = destination.size();
+		destination.resize(first + count);
+		if (static_cast<gl::DrawElementsType>(type) == gl::DrawElementsType::UnsignedInt) {
+			std::memcpy(destination.data() + first, source.data() + offset, count * sizeof(u32));
+			return;
+		}
+		for (u32 i = 0; i < count; i++) {
+			u16 index;
+			std::memcpy(&index, source.data() + offset + i * sizeof(u16), sizeof(u16));
+			destination[first + i] = index;
+		}
+	}
+}
+
+void Mesh::addPooledPrimitives(gltf::data &data, hlxscene::scene const &scene, hlxscene::mesh_record const &record) {
+	// scene::open() rejected the cache if any primitive or level's range falls outside these spans.
+	std::span<char const> const vertices = scene.vertices(record);
+	std::span<char const> const indices = scene.indices(record);
+	ModelManager *const pool = ModelManager::singleton();
+
+	std::span<hlxscene::primitive_record const> const primitives = scene.primitives(record);
+	primitives_.reserve(primitives.size());
+	Vec<u32> pooled_indices;
+	for (hlxscene::primitive_record const &primitive : primitives) {
+		// Full detail first, then every simplified level, so meshlets still count from the allocation's first index.
+		pooled_indices.clear();
+		appendIndices(pooled_indices, indices, primitive.index_offset, primitive.index_count, primitive.index_type);
+		Vec<MeshLodRange> lods;
+		for (hlxscene::lod_record const &lod : scene.lods(primitive)) {
+			lods.push_back({ .offset_of_elements = pooled_indices.size() * sizeof(u32), .elements_count = lod.index_count, .error = lod.error });
+			appendIndices(pooled_indices, indices, lod.index_offset, lod.index_count, primitive.index_type);
+		}
+
+		std::span<Vertex const> const primitive_vertices(reinterpret_cast<Vertex const *>(vertices.data() + primitive.vertex_offset), primitive.vertex_count);
+		std::span<Meshlet const> const meshlets = scene.meshlets(primitive);
+		primitives_.push_back({
+			.material     = static_cast<std::size_t>(primitive.material) < data.materials.size()
+			                    ? loadMaterial(*this, data, primitive.material) : nullptr,
+			.aabb_        = AABB(primitive.aabb_center, primitive.aabb_extents.x, primitive.aabb_extents.y, primitive.aabb_extents.z),
+			.meshlets     = Vec<Meshlet>(meshlets.begin(), meshlets.end()),
+			.lods         = std::move(lods),
+			.geometry     = pool->allocate(primitive_vertices, pooled_indices),
+			.geometry_index_count = primitive.index_count,
+		});
+	}
+	gpu_check;
+}
+
+#if BENCHMARKS_ENABLED
+
+int benchmarkTangents(Vec<std::string_view> const &p_args) {
+	std::string const file_path = bench::argument(p_args, 0, bench::DEFAULT_SCENE);
+	u32 const iterations = bench::numberArgument(p_args, 1, 3);
+
+	Optional<gltf::data> const scene = bench::loadScene(file_path);
+	if (!scene)
+		return -1;
+	gltf::data const &data = *scene;
+
+	// Every primitive the importer would generate tangents for.
+	struct TangentJob {
+		gltf::id indices, positions, normals, texcoords;
+	};
+	Vec<TangentJob> jobs;
+	u64 triangles = 0;
+	for (gltf::mesh const &mesh : data.meshes) {
+		for (gltf::primitive const &primitive : mesh.primitives) {
+			TangentJob job{ primitive.indices, -1, -1, -1 };
+			bool has_tangent = false;
+			for (auto const &[name, accessor_id] : primitive.attributes) {
+				switch (hash(name)) {
+					case hash("POSITION"):   job.positions = accessor_id; break;
+					case hash("NORMAL"):     job.normals = accessor_id; break;
+					case hash("TEXCOORD_0"): job.texcoords = accessor_id; break;
+					case hash("TANGENT"):    has_tangent = true; break;
+					default: break;
+				}
+			}
+			if (has_tangent || job.indices == -1 || job.positions == -1 || job.normals == -1 || job.texcoords == -1)
+				continue;
+			jobs.push_back(job);
+			triangles += data.accessors[job.indices].count() / 3;
+		}
+	}
+	printf("[bench] %llu primitive(s), %llu triangle(s)\n", static_cast<unsigned long long>(jobs.size()), static_cast<unsigned long long>(triangles));
+
+	// The pool is a fixed size singleton, so the sweep uses its own workers pulling primitives off a shared counter.
+	u32 const max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	for (u32 thread_count = 1;; thread_count = std::min(thread_count * 2, max_threads)) {
+		std::string const label = "mikktspace, " + std::to_string(thread_count) + " thread(s)";
+		bench::Timing const timing = bench::measure(label.c_str(), iterations, [&] {
+			std::atomic<std::size_t> next{ 0 };
+			Vec<Thread> workers;
+			workers.reserve(thread_count);
+			for (u32 t = 0; t < thread_count; t++) {
+				workers.emplace_back([&] {
+					for (std::size_t i = next++; i < jobs.size(); i = next++) {
+						TangentJob const &job = jobs[i];
+						std::vector<vec4> const tangents = computeTangentsMikkt(data, gltf::AccessorView<u32>(data, job.indices).to_vector(), job.positions, job.normals, job.texcoords);
+						(void)tangents;
+					}
+				});
+			}
+		});
+		printf("[bench] %-32s %.2f M triangles/s (median)\n", label.c_str(), static_cast<f64>(triangles) / (timing.median_ms / 1000.0) / 1e6);
+		if (thread_count == max_threads)
+			break;
+	}
+	return 0;
+}
+
+#endif
@@ -4,13 +4,17 @@
 
 #include "types.hpp"
 #include "graphics.hpp"
+#include <cstddef>
 #include <mutex>
 #include <type_traits>
 
 #include "buffer.h"
 #include "geometry.hpp"
+#include "meshlet.hpp"
 #include "gltf.h"
+#include "gltf/accessor_view.hpp"
 class Material;
+class IndirectDrawBatch;
 struct AABB;
 namespace gltf {
 	struct skin;
@@ -21,6 +25,11 @@ namespace gltf {
 	class accessor;
 }
 
+namespace hlxscene {
+	class scene;
+	struct mesh_record;
+}
+
 constexpr static VertexArrayAttribute GenericPositionAttribute{
 	.index = 0,
 	.binding = 0,
@@ -74,6 +83,35 @@ struct Vertex {
 
 static_assert(sizeof(Vertex) == 64);
 
+/* Vertex as the g-buffer shaders expect it, every attribute reads binding 0. */
+constexpr static VertexArrayAttribute InterleavedVertexAttributes[] = {
+	{ .index = 0, .binding = 0, .size = 3, .stride = sizeof(Vertex), .offset = offsetof(Vertex, position),  .type = EComponentType::SINGLE_FLOAT, .normalized = false },
+	{ .index = 1, .binding = 0, .size = 3, .stride = sizeof(Vertex), .offset = offsetof(Vertex, normal),    .type = EComponentType::SINGLE_FLOAT, .normalized = false },
+	{ .index = 2, .binding = 0, .size = 4, .stride = sizeof(Vertex), .offset = offsetof(Vertex, tangent),   .type = EComponentType::SINGLE_FLOAT, .normalized = false },
+	{ .index = 3, .binding = 0, .size = 2, .stride = sizeof(Vertex), .offset = offsetof(Vertex, texcoord0), .type = EComponentType::SINGLE_FLOAT, .normalized = false },
+	{ .index = 4, .binding = 0, .size = 2, .stride = sizeof(Vertex), .offset = offsetof(Vertex, texcoord1), .type = EComponentType::SINGLE_FLOAT, .normalized = false },
+};
+
+/* One glTF primitive decoded into Vertex layout, see interleavePrimitive(). */
+struct InterleavedPrimitive {
+	Vec<Vertex> vertices;
+	Vec<u32> indices;
+	AABB aabb{ vec3(0.0f), vec3(0.0f) };
+	_STD size_t source_vertex_count = 0; //< Vertices in the glTF accessors, before welding.
+};
+
+/*
+ * Decodes a triangle primitive into interleaved vertices. Identical vertices are welded (every attribute counts,
+ * joints and weights included) and unreferenced ones dropped. Tangents come from the file when it has them and from
+ * MikkTSpace otherwise, primitives without indices get a trivial index list. Doesn't touch the GPU.
+ */
+extern InterleavedPrimitive interleavePrimitive(gltf::data const &data, gltf::primitive const &primitive);
+
+#if BENCHMARKS_ENABLED
+/* `--bench mesh-tangents [file] [iterations]`, MikkTSpace throughput in triangles/sec from one thread up to every core. */
+extern int benchmarkTangents(Vec<_STD string_view> const &p_args);
+#endif
+
 class CSkin {
 public:
 	CSkin();
@@ -87,13 +125,27 @@ public:
 	Buffer shader_storage_buffer_;
 };
 
+class PendingTangents;
+
+/* Geometry suballocated from ModelManager's pool, see ModelManager::allocate(). */
+using GeometryHandle = u32;
+constexpr GeometryHandle INVALID_GEOMETRY = ~0u;
+
+/* A simplified level of a primitive, another range of the same element buffer. */
+struct MeshLodRange {
+	_STD size_t offset_of_elements; //< Bytes, relative to the primitive's first index for pooled primitives.
+	_STD size_t elements_count;
+	f32 error; //< Object space distance from the full detail surface.
+};
+
 class Mesh {
 public:
 	Mesh();
 	Mesh(gltf::data const &data); //< Loads all meshes under one umbrella.
 	Mesh(gltf::data const &data, _STD size_t mesh_id); //< loads a specific mesh.
-	Mesh(gltf::data &data, _STD size_t mesh_id, Vec<SharedPtr<Buffer>> &views); //< loads a specific mesh.
+	Mesh(gltf::data &data, _STD size_t mesh_id, Vec<SharedPtr<Buffer>> &views, PendingTangents *pending_tangents = nullptr); //< loads a specific mesh, tangent jobs go to `pending_tangents` when given.
 	Mesh(gltf::data &data, _STD size_t mesh_id, _STD size_t skin_id); //< loads a specific mesh.
+	Mesh(gltf::data &data, hlxscene::scene const &scene, _STD size_t mesh_id); //< loads a cooked mesh, materials come from `data`.
 	~Mesh();
 
 	Mesh(Mesh const &) = delete;
@@ -103,8 +155,24 @@ public:
 
 	_NODISCARD _STD size_t subMeshCount() const;
 
-	void drawSubMesh(RenderPassInfo const &info, _STD size_t submesh) const;
+	/* `instances` above 1 issues a single instanced draw, the shader is expected to fetch per instance data itself. */
+	void drawSubMesh(RenderPassInfo const &info, _STD size_t submesh, u32 lod = 0, i32 instances = 1) const;
 	void drawAllSubMeshes(RenderPassInfo const &info) const;
+	/* Pooled submeshes can go to an IndirectDrawBatch instead of being drawn, see queueSubMesh(). */
+	_NODISCARD bool pooled(_STD size_t submesh) const;
+	/* drawSubMesh() for a pooled submesh, deferred to when `batch` is submitted. */
+	void queueSubMesh(IndirectDrawBatch &batch, u32 model_index, _STD size_t submesh, u32 lod = 0) const;
+
+	/*
+	 * Coarsest level of `submesh` whose error stays under `threshold_pixels` once projected, `pixels_per_unit` being
+	 * how many pixels one object space unit covers at the primitive's distance. 0 is full detail.
+	 */
+	_NODISCARD u32 selectLod(_STD size_t submesh, f32 pixels_per_unit, f32 threshold_pixels) const;
+	_NODISCARD AABB const &bounds(_STD size_t submesh) const;
+	_NODISCARD Material const *material(_STD size_t submesh) const;
+
+	/* Empty unless the mesh came from a scene cooked with meshlets. */
+	_NODISCARD _STD span<Meshlet const> meshlets(_STD size_t submesh) const;
 
 	void addPrimitive(SharedPtr<VertexArray> const &vertex_array, SharedPtr<Material> const &material, AABB const &aabb);
 	void addBuffer(SharedPtr<Buffer> const &buffer);
@@ -115,7 +183,9 @@ public:
 
 private:
 	
-	void processMesh(gltf::data &data, gltf::mesh const &mesh, Vec<SharedPtr<Buffer>> &views);
+	void processMesh(gltf::data &data, gltf::mesh const &mesh, Vec<SharedPtr<Buffer>> &views, PendingTangents *pending_tangents);
+	/* Cooked Vertex geometry goes to ModelManager's pool instead of buffers of its own. */
+	void addPooledPrimitives(gltf::data &data, hlxscene::scene const &scene, hlxscene::mesh_record const &record);
 	_NODISCARD static AABB processAABB(Vec<Vertex> const &vertices);
 	void processMeshAndSkin(gltf::data &data, gltf::mesh &mesh, gltf::skin &skin);
 	_NODISCARD PrimAttribResult processPrimitiveAttribs(
@@ -124,7 +194,7 @@ private:
 		gltf::primitive const &primitive,
 		Vec<SharedPtr<Buffer>> &views
 	);
-	void applyAccessorAsAttribute(gltf::data const &data, i32 index, SharedPtr<VertexArray> const &vertex_array, gltf::accessor const &accessor, Vec<SharedPtr<Buffer>> &views);
+	void applyAccessorAsAttribute(gltf::data const &data, i32 index, SharedPtr<VertexArray> const &vertex_array, gltf::accessor const &accessor, Vec<SharedPtr<Buffer>> &views, bool integer = false);
 	void applyAccessorAsAttributeSingleBuffer(size_t &file_buffer_id, std::fstream &file, std::vector<skinned_vertex> &buffer, size_t offset, gltf::data const &data, i32 index, SharedPtr<VertexArray> const &vertex_array, gltf::accessor const &accessor);
 	template <typename T> static void applyAccessorAsAttributeSingleBufferUnskinned(size_t &file_buffer_id, std::fstream &file, std::vector<T> &buffer, size_t offset, gltf::data const &data, i32 index, SharedPtr<VertexArray> const &vertex_array, gltf::accessor const &accessor);
 	void applyAccessorAsElementBuffer(gltf::data const &data, SharedPtr<VertexArray> const &vertex_array, gltf::accessor const &accessor,
@@ -139,6 +209,11 @@ private:
 		SharedPtr<VertexArray> vertex_array;
 		SharedPtr<Material> material;
 		AABB aabb_;
+		Vec<Meshlet> meshlets; //< Ranges of the element buffer, first_index counts from offset_of_elements.
+		Vec<MeshLodRange> lods; //< Level 1 onwards, empty unless the mesh came from a scene cooked with LODs.
+		bool packed_vertices = false; //< PackedVertex rather than Vertex, positions are relative to aabb_.
+		GeometryHandle geometry = INVALID_GEOMETRY; //< Set instead of vertex_array when the primitive lives in ModelManager's pool.
+		u32 geometry_index_count = 0; //< Full detail indices of `geometry`, the LOD levels' indices follow them.
 	};
 	Vec<SharedPtr<Buffer>> buffers_;
 	Vec<MeshPrimitive> primitives_;
@@ -149,6 +224,39 @@ private:
 	friend class CSkin;
 };
 
+/*
+ * MikkTSpace jobs running on the ThreadPool for one import. Meshes hand their jobs over instead of joining them,
+ * so tangents for every mesh of the import run side by side, and each result is uploaded as soon as it is ready.
+ * Everything here runs on the GL thread, and every Mesh handed to add() has to outlive finish().
+ */
+class PendingTangents {
+public:
+	PendingTangents() = default;
+	~PendingTangents();
+
+	PendingTangents(PendingTangents const &) = delete;
+	PendingTangents &operator=(PendingTangents const &) = delete;
+
+	void add(Mesh &mesh, SharedPtr<VertexArray> vertex_array, _STD future<Vec<vec4>> tangents);
+
+	/* Uploads every finished job without blocking, returns how many are still running. */
+	_STD size_t uploadReady();
+
+	/* Uploads the rest as they finish. Keeps the main thread queue moving meanwhile, pool threads may be waiting on it. */
+	void finish();
+
+	_NODISCARD bool empty() const { return jobs_.empty(); }
+
+private:
+	struct Job {
+		Mesh *mesh;
+		SharedPtr<VertexArray> vertex_array;
+		_STD future<Vec<vec4>> tangents;
+	};
+
+	Vec<Job> jobs_;
+};
+
 template <typename T>
 concept SkinnedVertex = requires(T a)
 {
@@ -167,34 +275,24 @@ void Mesh::applyAccessorAsAttributeSingleBufferUnskinned(
 	SharedPtr<VertexArray> const &vertex_array,
 	gltf::accessor const &accessor)
 {
-	gltf::buffer_view const buffer_view = data.buffer_views[accessor.bufferView()];
-	gltf::buffer const& gltf_buffer = data.buffers[buffer_view.buffer];
-
-	assert(gltf_buffer.length() >= buffer_view.offset + buffer_view.length);
-
-	size_t const data_offset = buffer_view.offset + accessor.offset();
-
-	auto const raw_data = &gltf_buffer.data()[data_offset];
-	for (size_t i = 0; i < accessor.count(); ++i) {
-		switch (index) {
-			case 0:
-				buffer[i].position  = reinterpret_cast<vec3 const *>(raw_data)[i];
-				break;
-			case 1:
-				buffer[i].normal    = reinterpret_cast<vec3 const *>(raw_data)[i];
-				break;
-			case 2:
-				buffer[i].tangent   = reinterpret_cast<vec4 const *>(raw_data)[i];
-				break;
-			case 3:
-				buffer[i].texcoord0 = reinterpret_cast<vec2 const *>(raw_data)[i];
-				break;
-			case 4:
-				buffer[i].texcoord1 = reinterpret_cast<vec2 const *>(raw_data)[i];
-				break;
-			default:
-				break;
-		}
+	switch (index) {
+		case 0:
+			gltf::AccessorView<vec3>(data, accessor).copy_to_strided(&buffer[0].position, sizeof(T));
+			break;
+		case 1:
+			gltf::AccessorView<vec3>(data, accessor).copy_to_strided(&buffer[0].normal, sizeof(T));
+			break;
+		case 2:
+			gltf::AccessorView<vec4>(data, accessor).copy_to_strided(&buffer[0].tangent, sizeof(T));
+			break;
+		case 3:
+			gltf::AccessorView<vec2>(data, accessor).copy_to_strided(&buffer[0].texcoord0, sizeof(T));
+			break;
+		case 4:
+			gltf::AccessorView<vec2>(data, accessor).copy_to_strided(&buffer[0].texcoord1, sizeof(T));
+			break;
+		default:
+			break;
 	}
 	VertexArrayAttribute attrib;
 	attrib.offset = static_cast<gltf::id>(offset);
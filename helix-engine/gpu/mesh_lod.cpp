@@ -0,0 +1,301 @@
+﻿#include "mesh_lod.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "mesh_optimizer.hpp"
+
+namespace {
+	/* Sum of weighted squared plane distances, the symmetric 4x4 matrix stored as its upper triangle. */
+	struct Quadric {
+		f64 a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		f64 a11 = 0, a12 = 0, a13 = 0;
+		f64 a22 = 0, a23 = 0;
+		f64 a33 = 0;
+		f64 weight = 0;
+
+		void addPlane(vec3 const &n, f64 const d, f64 const w) {
+			a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+			a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+			a22 += w * n.z * n.z; a23 += w * n.z * d;
+			a33 += w * d * d;
+			weight += w;
+		}
+
+		Quadric &operator+=(Quadric const &o) {
+			a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+			a11 += o.a11; a12 += o.a12; a13 += o.a13;
+			a22 += o.a22; a23 += o.a23;
+			a33 += o.a33;
+			weight += o.weight;
+			return *this;
+		}
+
+		_NODISCARD f64 evaluate(vec3 const &p) const {
+			f64 const x = p.x, y = p.y, z = p.z;
+			f64 const r = x * x * a00 + y * y * a11 + z * z * a22
+				+ 2.0 * (x * y * a01 + x * z * a02 + y * z * a12)
+				+ 2.0 * (x * a03 + y * a13 + z * a23)
+				+ a33;
+			return (std::max)(r, 0.0);
+		}
+	};
+
+	/*
+	 * Normals and UVs are unitless, these put a difference between the two ends of an edge on the same footing
+	 * as squared distances on the unit sized mesh. They only order collapses, the reported error is geometric.
+	 */
+	constexpr f32 NORMAL_WEIGHT = 0.01f;
+	constexpr f32 TEXCOORD_WEIGHT = 0.01f;
+
+	struct Collapse {
+		u32 from;
+		u32 to;
+		f32 cost;		//< Squared, relative, attributes included.
+		f32 distance;	//< Squared, relative, geometry only.
+	};
+
+	/* One id per distinct position, so vertices split by a seam can be recognised. */
+	Vec<u32> positionIds(std::span<Vertex const> const vertices) {
+		constexpr u32 EMPTY = ~0u;
+		std::size_t const table_size = std::bit_ceil((std::max)(vertices.size() * 2, std::size_t(16)));
+		Vec<u32> table(table_size, EMPTY);
+		Vec<u32> ids(vertices.size());
+		for (u32 v = 0; v < vertices.size(); v++) {
+			u32 bits[3];
+			std::memcpy(bits, &vertices[v].position, sizeof(bits));
+			std::size_t slot = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u)) & (table_size - 1);
+			while (table[slot] != EMPTY && std::memcmp(&vertices[table[slot]].position, &vertices[v].position, sizeof(vec3)) != 0)
+				slot = (slot + 1) & (table_size - 1);
+			if (table[slot] == EMPTY)
+				table[slot] = v;
+			ids[v] = table[slot];
+		}
+		return ids;
+	}
+
+	/* Locks open border vertices and every vertex sharing its position with another one. */
+	Vec<u8> lockedVertices(std::span<u32 const> const indices, std::span<Vertex const> vertices, Vec<u32> const &position_ids) {
+		Vec<u8> locked(vertices.size(), 0);
+
+		Vec<u32> copies(vertices.size(), 0);
+		for (u32 const id : position_ids)
+			copies[id]++;
+		for (std::size_t v = 0; v < vertices.size(); v++)
+			locked[v] = copies[position_ids[v]] > 1 ? 1 : 0;
+
+		// An edge without its opposite half edge is on the border. Half edges are sorted so the lookup is a binary search.
+		Vec<u64> half_edges;
+		half_edges.reserve(indices.size());
+		for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+			for (u32 e = 0; e < 3; e++) {
+				u64 const a = position_ids[indices[t + e]];
+				u64 const b = position_ids[indices[t + (e + 1) % 3]];
+				half_edges.push_back(a << 32 | b);
+			}
+		}
+		std::ranges::sort(half_edges);
+		for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+			for (u32 e = 0; e < 3; e++) {
+				u32 const a = indices[t + e];
+				u32 const b = indices[t + (e + 1) % 3];
+				u64 const opposite = static_cast<u64>(position_ids[b]) << 32 | position_ids[a];
+				if (!std::ranges::binary_search(half_edges, opposite)) {
+					locked[a] = 1;
+					locked[b] = 1;
+				}
+			}
+		}
+		return locked;
+	}
+
+	vec3 triangleNormal(vec3 const &a, vec3 const &b, vec3 const &c) {
+		return glm::cross(b - a, c - a);
+	}
+}
+
+f32 simplifyMesh(Vec<u32> &destination, std::span<u32 const> const indices, std::span<Vertex const> const vertices, std::size_t const target_index_count, f32 const target_error) {
+	destination.assign(indices.begin(), indices.end());
+	if (indices.size() < 6 || vertices.empty())
+		return 0.0f;
+
+	// Work on the mesh scaled into a unit box so `target_error` means the same thing for every asset.
+	vec3 min(std::numeric_limits<f32>::max()), max(std::numeric_limits<f32>::lowest());
+	for (Vertex const &vertex : vertices) {
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+	f32 const extent = (std::max)({ max.x - min.x, max.y - min.y, max.z - min.z });
+	f32 const inverse_extent = extent > 0.0f ? 1.0f / extent : 1.0f;
+	Vec<vec3> positions(vertices.size());
+	for (std::size_t v = 0; v < vertices.size(); v++)
+		positions[v] = (vertices[v].position - min) * inverse_extent;
+
+	Vec<u32> const position_ids = positionIds(vertices);
+	Vec<u8> const locked = lockedVertices(indices, vertices, position_ids);
+
+	Vec<Quadric> quadrics(vertices.size());
+	for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+		vec3 const &a = positions[indices[t]], &b = positions[indices[t + 1]], &c = positions[indices[t + 2]];
+		vec3 const n = triangleNormal(a, b, c);
+		f32 const area = glm::length(n);
+		if (area <= std::numeric_limits<f32>::min())
+			continue;
+		vec3 const unit = n / area;
+		f64 const d = -glm::dot(unit, a);
+		for (u32 corner = 0; corner < 3; corner++)
+			quadrics[indices[t + corner]].addPlane(unit, d, area);
+	}
+
+	auto const makeCollapse = [&](u32 const from, u32 const to) -> Collapse {
+		Quadric q = quadrics[from];
+		q += quadrics[to];
+		f32 const distance = q.weight > 0.0 ? static_cast<f32>(q.evaluate(positions[to]) / q.weight) : 0.0f;
+		vec3 const dn = vertices[from].normal - vertices[to].normal;
+		vec2 const duv = vertices[from].texcoord0 - vertices[to].texcoord0;
+		return { from, to, distance + NORMAL_WEIGHT * glm::dot(dn, dn) + TEXCOORD_WEIGHT * glm::dot(duv, duv), distance };
+	};
+
+	f32 const error_limit = target_error * target_error;
+	f32 result_error = 0.0f;
+	Vec<Collapse> candidates;
+	Vec<u8> touched(vertices.size());
+	Vec<u32> adjacency_offsets(vertices.size() + 1);
+	Vec<u32> adjacency;
+
+	while (destination.size() > target_index_count) {
+		// Triangles around each vertex, for the flip test.
+		std::ranges::fill(adjacency_offsets, 0u);
+		for (u32 const index : destination)
+			adjacency_offsets[index + 1]++;
+		std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+		adjacency.resize(destination.size());
+		{
+			Vec<u32> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (std::size_t i = 0; i < destination.size(); i++)
+				adjacency[cursor[destination[i]]++] = static_cast<u32>(i / 3);
+		}
+
+		// Cheapest direction of every edge, each edge is seen from both of its triangles but that only costs a duplicate.
+		candidates.clear();
+		for (std::size_t t = 0; t + 2 < destination.size(); t += 3) {
+			for (u32 e = 0; e < 3; e++) {
+				u32 const a = destination[t + e];
+				u32 const b = destination[t + (e + 1) % 3];
+				if (a > b && !locked[a] && !locked[b])
+					continue; // The other half edge proposes this one.
+				if (locked[a] && locked[b])
+					continue;
+				if (locked[a])
+					candidates.push_back(makeCollapse(b, a));
+				else if (locked[b])
+					candidates.push_back(makeCollapse(a, b));
+				else {
+					Collapse const ab = makeCollapse(a, b);
+					Collapse const ba = makeCollapse(b, a);
+					candidates.push_back(ab.cost <= ba.cost ? ab : ba);
+				}
+			}
+		}
+		if (candidates.empty())
+			break;
+		std::ranges::sort(candidates, {}, &Collapse::cost);
+
+		// Each collapse removes two triangles at most, stop at what the target asks for.
+		std::size_t const triangles_left = destination.size() / 3;
+		std::size_t const wanted = (triangles_left - target_index_count / 3 + 1) / 2;
+		std::size_t collapsed = 0;
+		std::ranges::fill(touched, u8(0));
+		Vec<u32> remap(vertices.size());
+		std::iota(remap.begin(), remap.end(), 0u);
+
+		for (Collapse const &collapse : candidates) {
+			if (collapsed >= wanted || collapse.cost > error_limit)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// Moving `from` onto `to` must not turn any remaining triangle around.
+			bool flips = false;
+			for (u32 k = adjacency_offsets[collapse.from]; k < adjacency_offsets[collapse.from + 1] && !flips; k++) {
+				u32 const *tri = &destination[static_cast<std::size_t>(adjacency[k]) * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+					continue;
+				vec3 p[3], q[3];
+				for (u32 corner = 0; corner < 3; corner++) {
+					p[corner] = positions[tri[corner]];
+					q[corner] = tri[corner] == collapse.from ? positions[collapse.to] : p[corner];
+				}
+				vec3 const before = triangleNormal(p[0], p[1], p[2]);
+				vec3 const after = triangleNormal(q[0], q[1], q[2]);
+				flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+			}
+			if (flips)
+				continue;
+
+			// Keep the neighbourhood still for the rest of the pass, the flip test above assumed it.
+			for (u32 k = adjacency_offsets[collapse.from]; k < adjacency_offsets[collapse.from + 1]; k++) {
+				u32 const *tri = &destination[static_cast<std::size_t>(adjacency[k]) * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+			touched[collapse.to] = 1;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			result_error = (std::max)(result_error, collapse.distance);
+			collapsed++;
+		}
+		if (collapsed == 0)
+			break;
+
+		std::size_t write = 0;
+		for (std::size_t t = 0; t + 2 < destination.size(); t += 3) {
+			u32 const a = remap[destination[t]], b = remap[destination[t + 1]], c = remap[destination[t + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			destination[write++] = a;
+			destination[write++] = b;
+			destination[write++] = c;
+		}
+		destination.resize(write);
+	}
+
+	return std::sqrt(result_error);
+}
+
+Vec<SimplifiedLod> buildLodChain(std::span<u32 const> const indices, std::span<Vertex const> const vertices) {
+	Vec<SimplifiedLod> lods;
+	if (vertices.empty())
+		return lods;
+
+	vec3 min(std::numeric_limits<f32>::max()), max(std::numeric_limits<f32>::lowest());
+	for (Vertex const &vertex : vertices) {
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+	f32 const extent = (std::max)({ max.x - min.x, max.y - min.y, max.z - min.z });
+
+	std::span<u32 const> previous = indices;
+	f32 accumulated = 0.0f;
+	for (u32 level = 1; level < MESH_LOD_COUNT; level++) {
+		std::size_t const target = (previous.size() / 3 / 2) * 3;
+		if (target < 3)
+			break;
+
+		SimplifiedLod lod;
+		f32 const relative = simplifyMesh(lod.indices, previous, vertices, target, MESH_LOD_MAX_RELATIVE_ERROR);
+		if (lod.indices.empty() || lod.indices.size() * 10 > previous.size() * 9)
+			break;
+
+		optimizeVertexCache(lod.indices, vertices.size());
+		accumulated += relative * extent;
+		lod.error = accumulated;
+		lods.push_back(std::move(lod));
+		previous = lods.back().indices;
+	}
+	return lods;
+}
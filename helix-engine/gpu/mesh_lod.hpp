@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <span>
+
+#include "types.hpp"
+#include "mesh.hpp"
+
+//
+// Level of detail by edge collapse with quadric error metrics (Garland and Heckbert, "Surface Simplification Using
+// Quadric Error Metrics"). Vertices only ever collapse onto other vertices, so every level indexes the same vertex
+// buffer and a LOD is nothing more than another index range.
+//
+
+/* Levels including the full resolution one. */
+constexpr u32 MESH_LOD_COUNT = 4;
+
+/* Errors are measured on the mesh scaled to a unit extent, this is the most a single level may introduce. */
+constexpr f32 MESH_LOD_MAX_RELATIVE_ERROR = 0.05f;
+
+struct SimplifiedLod {
+	Vec<u32> indices;
+	f32 error;	//< Object space distance the surface may have moved, accumulated over every level before this one.
+};
+
+/*
+ * Collapses edges until at most `target_index_count` indices are left or the next collapse would cost more than
+ * `target_error` (relative to the mesh extent). Normals and UV0 add to the cost, so seams and creases go last.
+ * Open borders and vertices split by attribute seams are locked. Returns the relative error reached.
+ */
+extern f32 simplifyMesh(Vec<u32> &destination, _STD span<u32 const> indices, _STD span<Vertex const> vertices, _STD size_t target_index_count, f32 target_error);
+
+/*
+ * Levels 1 to MESH_LOD_COUNT - 1, each half the triangles of the one before. The chain stops early when a level
+ * can't lose at least a tenth of its triangles within MESH_LOD_MAX_RELATIVE_ERROR.
+ */
+extern Vec<SimplifiedLod> buildLodChain(_STD span<u32 const> indices, _STD span<Vertex const> vertices);
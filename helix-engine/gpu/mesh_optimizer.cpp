@@ -0,0 +1,355 @@
+﻿#include "mesh_optimizer.hpp"
+
+#include <math.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+namespace {
+	/* Triangles around each vertex, `triangles[offsets[v] .. offsets[v + 1]]`. */
+	struct TriangleAdjacency {
+		Vec<u32> offsets;
+		Vec<u32> triangles;
+
+		TriangleAdjacency(std::span<u32 const> const indices, std::size_t const vertex_count) : offsets(vertex_count + 1, 0) {
+			for (u32 const index : indices)
+				offsets[index + 1]++;
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			triangles.resize(indices.size());
+			Vec<u32> cursor(offsets.begin(), offsets.end() - 1);
+			for (std::size_t i = 0; i < indices.size(); i++)
+				triangles[cursor[indices[i]]++] = static_cast<u32>(i / 3);
+		}
+	};
+
+	/* The timestamp FIFO both papers use, a vertex is resident while fewer than `size` misses happened since it was loaded. */
+	class FifoCache {
+	public:
+		FifoCache(std::size_t const vertex_count, u32 const size) : stamps_(vertex_count, 0), size_(size), time_(size + 1) {}
+
+		/* Returns true on a miss. */
+		bool access(u32 const vertex) {
+			if (time_ - stamps_[vertex] <= size_)
+				return false;
+			stamps_[vertex] = time_++;
+			return true;
+		}
+
+		u32 accessTriangle(u32 const *triangle) {
+			return static_cast<u32>(access(triangle[0])) + static_cast<u32>(access(triangle[1])) + static_cast<u32>(access(triangle[2]));
+		}
+
+		/* Ages everything out. */
+		void flush() { time_ += size_ + 1; }
+
+	private:
+		Vec<u32> stamps_;
+		u32 size_;
+		u32 time_;
+	};
+
+	/*
+	 * Tipsify. Fans around one vertex at a time, picking the next fanning vertex among the ones just emitted that will
+	 * still be in the cache once its remaining triangles are drawn. `clusters` receives the first triangle of every
+	 * run that started from a dead end, those are the hard boundaries the overdraw pass works with.
+	 */
+	void tipsify(std::span<u32 const> const indices, std::size_t const vertex_count, u32 const cache_size, Vec<u32> &destination, Vec<u32> *clusters) {
+		std::size_t const triangle_count = indices.size() / 3;
+		TriangleAdjacency const adjacency(indices, vertex_count);
+
+		Vec<u32> live(vertex_count);
+		for (std::size_t v = 0; v < vertex_count; v++)
+			live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+		Vec<u32> cache_time(vertex_count, 0);
+		Vec<u8> emitted(triangle_count, 0);
+		Vec<u32> dead_end;
+		dead_end.reserve(indices.size());
+
+		destination.clear();
+		destination.reserve(indices.size());
+
+		u32 timestamp = cache_size + 1;
+		std::size_t cursor = 0;
+		i64 fanning = -1;
+		while (cursor < vertex_count && fanning == -1) {
+			if (live[cursor] > 0)
+				fanning = static_cast<i64>(cursor);
+			cursor++;
+		}
+		if (clusters != nullptr && fanning != -1)
+			clusters->push_back(0);
+
+		while (fanning != -1) {
+			std::size_t const candidates_begin = dead_end.size();
+			u32 const f = static_cast<u32>(fanning);
+			for (u32 k = adjacency.offsets[f]; k < adjacency.offsets[f + 1]; k++) {
+				u32 const triangle = adjacency.triangles[k];
+				if (emitted[triangle])
+					continue;
+				for (u32 corner = 0; corner < 3; corner++) {
+					u32 const v = indices[triangle * 3 + corner];
+					destination.push_back(v);
+					dead_end.push_back(v);
+					live[v]--;
+					if (timestamp - cache_time[v] > cache_size)
+						cache_time[v] = timestamp++;
+				}
+				emitted[triangle] = 1;
+			}
+
+			// Prefer the candidate that has been in the cache the longest, as long as its fan still fits.
+			i64 best = -1;
+			i64 best_priority = -1;
+			for (std::size_t k = candidates_begin; k < dead_end.size(); k++) {
+				u32 const v = dead_end[k];
+				if (live[v] == 0)
+					continue;
+				i64 priority = 0;
+				if (timestamp - cache_time[v] + 2 * live[v] <= cache_size)
+					priority = timestamp - cache_time[v];
+				if (priority > best_priority) {
+					best = v;
+					best_priority = priority;
+				}
+			}
+
+			if (best == -1) {
+				while (!dead_end.empty() && best == -1) {
+					u32 const v = dead_end.back();
+					dead_end.pop_back();
+					if (live[v] > 0)
+						best = v;
+				}
+				while (cursor < vertex_count && best == -1) {
+					if (live[cursor] > 0)
+						best = static_cast<i64>(cursor);
+					cursor++;
+				}
+				std::size_t const emitted_triangles = destination.size() / 3;
+				if (clusters != nullptr && best != -1 && emitted_triangles < triangle_count && clusters->back() != emitted_triangles)
+					clusters->push_back(static_cast<u32>(emitted_triangles));
+			}
+			fanning = best;
+		}
+		assert(destination.size() == indices.size());
+	}
+
+	/* FNV-1a over one vertex of every stream. */
+	u64 hashVertex(std::span<VertexStream const> const streams, u32 const vertex) {
+		u64 h = 0xcbf29ce484222325ull;
+		for (VertexStream const &stream : streams) {
+			u8 const *bytes = static_cast<u8 const *>(stream.data) + static_cast<std::size_t>(vertex) * stream.stride;
+			for (std::size_t i = 0; i < stream.size; i++)
+				h = (h ^ bytes[i]) * 0x100000001b3ull;
+		}
+		return h;
+	}
+
+	bool equalVertices(std::span<VertexStream const> const streams, u32 const l, u32 const r) {
+		for (VertexStream const &stream : streams) {
+			u8 const *base = static_cast<u8 const *>(stream.data);
+			if (std::memcmp(base + static_cast<std::size_t>(l) * stream.stride, base + static_cast<std::size_t>(r) * stream.stride, stream.size) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	vec3 positionAt(void const *positions, std::size_t const stride, u32 const vertex) {
+		return *reinterpret_cast<vec3 const *>(static_cast<u8 const *>(positions) + static_cast<std::size_t>(vertex) * stride);
+	}
+}
+
+VertexCacheStats analyzeVertexCache(std::span<u32 const> const indices, std::size_t const vertex_count, u32 const cache_size) {
+	VertexCacheStats stats;
+	stats.triangles = indices.size() / 3;
+
+	FifoCache cache(vertex_count, cache_size);
+	Vec<u8> referenced(vertex_count, 0);
+	for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+		stats.transforms += cache.accessTriangle(&indices[i]);
+	for (u32 const index : indices) {
+		stats.vertices += referenced[index] == 0 ? 1 : 0;
+		referenced[index] = 1;
+	}
+	return stats;
+}
+
+void optimizeVertexCache(std::span<u32> const indices, std::size_t const vertex_count, u32 const cache_size) {
+	Vec<u32> ordered;
+	tipsify(indices, vertex_count, cache_size, ordered, nullptr);
+	std::ranges::copy(ordered, indices.begin());
+}
+
+void optimizeOverdraw(std::span<u32> const indices, void const *positions, std::size_t const position_stride, std::size_t const vertex_count,
+                      f32 const threshold, u32 const cache_size) {
+	std::size_t const triangle_count = indices.size() / 3;
+	if (triangle_count < 2)
+		return;
+
+	Vec<u32> ordered;
+	Vec<u32> hard_boundaries;
+	tipsify(indices, vertex_count, cache_size, ordered, &hard_boundaries);
+	hard_boundaries.push_back(static_cast<u32>(triangle_count));
+
+	// Cut every hard cluster further wherever the cache has warmed up enough that restarting costs less than `threshold`.
+	Vec<u32> clusters;
+	FifoCache cache(vertex_count, cache_size);
+	for (std::size_t h = 0; h + 1 < hard_boundaries.size(); h++) {
+		u32 const begin = hard_boundaries[h];
+		u32 const end = hard_boundaries[h + 1];
+
+		cache.flush();
+		u32 cluster_misses = 0;
+		for (u32 t = begin; t < end; t++)
+			cluster_misses += cache.accessTriangle(&ordered[t * 3]);
+		f32 const cluster_threshold = threshold * static_cast<f32>(cluster_misses) / static_cast<f32>(end - begin);
+
+		cache.flush();
+		clusters.push_back(begin);
+		u32 start = begin;
+		u32 misses = 0;
+		for (u32 t = begin; t < end; t++) {
+			misses += cache.accessTriangle(&ordered[t * 3]);
+			if (t + 1 < end && static_cast<f32>(misses) / static_cast<f32>(t - start + 1) <= cluster_threshold) {
+				clusters.push_back(t + 1);
+				cache.flush();
+				start = t + 1;
+				misses = 0;
+			}
+		}
+	}
+	clusters.push_back(static_cast<u32>(triangle_count));
+
+	// Area weighted centre of the mesh, and of each cluster along with its summed (area weighted) normal.
+	auto const triangleCentroidAndNormal = [&](u32 const triangle, vec3 &centroid, vec3 &normal) {
+		vec3 const a = positionAt(positions, position_stride, ordered[triangle * 3 + 0]);
+		vec3 const b = positionAt(positions, position_stride, ordered[triangle * 3 + 1]);
+		vec3 const c = positionAt(positions, position_stride, ordered[triangle * 3 + 2]);
+		centroid = (a + b + c) / 3.0f;
+		normal = glm::cross(b - a, c - a);
+	};
+
+	vec3 mesh_centroid(0.0f);
+	f32 mesh_area = 0.0f;
+	for (u32 t = 0; t < triangle_count; t++) {
+		vec3 centroid, normal;
+		triangleCentroidAndNormal(t, centroid, normal);
+		f32 const area = glm::length(normal);
+		mesh_centroid += centroid * area;
+		mesh_area += area;
+	}
+	mesh_centroid = mesh_area > 0.0f ? mesh_centroid / mesh_area : vec3(0.0f);
+
+	std::size_t const cluster_count = clusters.size() - 1;
+	Vec<f32> sort_keys(cluster_count, 0.0f);
+	for (std::size_t i = 0; i < cluster_count; i++) {
+		vec3 cluster_centroid(0.0f);
+		vec3 cluster_normal(0.0f);
+		f32 cluster_area = 0.0f;
+		for (u32 t = clusters[i]; t < clusters[i + 1]; t++) {
+			vec3 centroid, normal;
+			triangleCentroidAndNormal(t, centroid, normal);
+			f32 const area = glm::length(normal);
+			cluster_centroid += centroid * area;
+			cluster_normal += normal;
+			cluster_area += area;
+		}
+		f32 const normal_length = glm::length(cluster_normal);
+		if (cluster_area > 0.0f && normal_length > 0.0f)
+			sort_keys[i] = glm::dot(cluster_centroid / cluster_area - mesh_centroid, cluster_normal / normal_length);
+	}
+
+	// Outward facing clusters first, they are the likeliest to hide what comes after them.
+	Vec<u32> cluster_order(cluster_count);
+	std::iota(cluster_order.begin(), cluster_order.end(), 0u);
+	std::ranges::stable_sort(cluster_order, [&](u32 const l, u32 const r) { return sort_keys[l] > sort_keys[r]; });
+
+	std::size_t written = 0;
+	for (u32 const cluster : cluster_order) {
+		std::size_t const first = static_cast<std::size_t>(clusters[cluster]) * 3;
+		std::size_t const last = static_cast<std::size_t>(clusters[cluster + 1]) * 3;
+		std::copy(ordered.begin() + static_cast<std::ptrdiff_t>(first), ordered.begin() + static_cast<std::ptrdiff_t>(last), indices.begin() + static_cast<std::ptrdiff_t>(written));
+		written += last - first;
+	}
+}
+
+void optimizeVertexFetch(std::span<u32> const indices, Vec<Vertex> &vertices) {
+	constexpr u32 UNUSED = ~0u;
+	Vec<u32> remap(vertices.size(), UNUSED);
+	Vec<Vertex> fetch_ordered;
+	fetch_ordered.reserve(vertices.size());
+	for (u32 &index : indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = static_cast<u32>(fetch_ordered.size());
+			fetch_ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices = std::move(fetch_ordered);
+}
+
+std::size_t generateVertexRemap(Vec<u32> &remap, std::span<u32 const> const indices, std::size_t const vertex_count, std::span<VertexStream const> const streams) {
+	constexpr u32 EMPTY = ~0u;
+	remap.assign(vertex_count, EMPTY);
+
+	// Open addressing, kept at most half full so probe sequences stay short.
+	std::size_t const table_size = std::bit_ceil((std::max)(vertex_count * 2, std::size_t(16)));
+	std::size_t const mask = table_size - 1;
+	Vec<u32> table(table_size, EMPTY);
+
+	u32 unique = 0;
+	for (u32 const index : indices) {
+		if (remap[index] != EMPTY)
+			continue;
+
+		std::size_t slot = static_cast<std::size_t>(hashVertex(streams, index)) & mask;
+		while (table[slot] != EMPTY && !equalVertices(streams, table[slot], index))
+			slot = (slot + 1) & mask;
+
+		if (table[slot] == EMPTY) {
+			table[slot] = index;
+			remap[index] = unique++;
+		}
+		else {
+			remap[index] = remap[table[slot]];
+		}
+	}
+	return unique;
+}
+
+void remapIndices(std::span<u32> const indices, std::span<u32 const> const remap) {
+	for (u32 &index : indices) {
+		assert(remap[index] != ~0u);
+		index = remap[index];
+	}
+}
+
+void remapVertices(void *destination, void const *source, std::size_t const vertex_count, std::size_t const vertex_size, std::span<u32 const> const remap) {
+	u8 *const to = static_cast<u8 *>(destination);
+	u8 const *const from = static_cast<u8 const *>(source);
+	for (std::size_t v = 0; v < vertex_count; v++) {
+		if (remap[v] != ~0u)
+			std::memcpy(to + static_cast<std::size_t>(remap[v]) * vertex_size, from + v * vertex_size, vertex_size);
+	}
+}
+
+MeshOptimizationReport optimizeMesh(InterleavedPrimitive &primitive) {
+	MeshOptimizationReport report;
+	report.before = analyzeVertexCache(primitive.indices, primitive.vertices.size());
+	if (primitive.indices.size() % 3 != 0 || primitive.indices.size() < 6) {
+		report.after = report.before;
+		return report;
+	}
+
+	// Triangle order first, the fetch pass then numbers vertices in that order.
+	optimizeOverdraw(primitive.indices, &primitive.vertices.front().position, sizeof(Vertex), primitive.vertices.size());
+	optimizeVertexFetch(primitive.indices, primitive.vertices);
+
+	report.after = analyzeVertexCache(primitive.indices, primitive.vertices.size());
+	return report;
+}
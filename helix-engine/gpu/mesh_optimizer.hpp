@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <span>
+
+#include "types.hpp"
+#include "mesh.hpp"
+
+//
+// Import-time reordering of triangle lists, after Sander, Nehab and Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Tipsify).
+// None of this touches the GPU, it runs on the geometry a cook is about to write.
+//
+
+/* FIFO post-transform cache of the size Tipsify targets, close enough to what desktop GPUs behave like. */
+constexpr u32 VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+	u64 transforms = 0;	//< Cache misses, i.e. vertices the GPU had to shade.
+	u64 triangles = 0;
+	u64 vertices = 0;	//< Distinct vertices referenced.
+
+	/* Average cache miss ratio, transforms per triangle. 3 is no reuse at all, ~0.5 is as good as a regular grid gets. */
+	_NODISCARD f32 acmr() const { return triangles != 0 ? static_cast<f32>(transforms) / static_cast<f32>(triangles) : 0.0f; }
+	/* Average transform to vertex ratio, 1 means every vertex is shaded exactly once. */
+	_NODISCARD f32 atvr() const { return vertices != 0 ? static_cast<f32>(transforms) / static_cast<f32>(vertices) : 0.0f; }
+
+	VertexCacheStats &operator+=(VertexCacheStats const &other) {
+		transforms += other.transforms;
+		triangles += other.triangles;
+		vertices += other.vertices;
+		return *this;
+	}
+};
+
+/* Simulates the post-transform cache over a triangle list. */
+extern VertexCacheStats analyzeVertexCache(_STD span<u32 const> indices, _STD size_t vertex_count, u32 cache_size = VERTEX_CACHE_SIZE);
+
+/* Reorders triangles for post-transform cache hits (Tipsify). */
+extern void optimizeVertexCache(_STD span<u32> indices, _STD size_t vertex_count, u32 cache_size = VERTEX_CACHE_SIZE);
+
+/*
+ * Tipsify followed by the overdraw pass from the same paper: the cache-ordered list is cut into clusters wherever
+ * the cache is cold anyway, and clusters facing away from the mesh centre are drawn first so they occlude the rest.
+ * `threshold` is how much ACMR the cuts may cost, 1.05 allows 5%.
+ */
+extern void optimizeOverdraw(_STD span<u32> indices, void const *positions, _STD size_t position_stride, _STD size_t vertex_count,
+                             f32 threshold = 1.05f, u32 cache_size = VERTEX_CACHE_SIZE);
+
+/* Renumbers vertices in the order the index list first uses them, dropping any that aren't referenced. */
+extern void optimizeVertexFetch(_STD span<u32> indices, Vec<Vertex> &vertices);
+
+/* One attribute of every vertex, `size` bytes at `data + vertex * stride`. */
+struct VertexStream {
+	void const *data;
+	_STD size_t size;
+	_STD size_t stride;
+};
+
+/*
+ * Welds vertices that are bitwise identical across every stream. `remap[v]` receives the new index of vertex v,
+ * vertices the index list never references get ~0u. Returns how many vertices are left.
+ */
+extern _STD size_t generateVertexRemap(Vec<u32> &remap, _STD span<u32 const> indices, _STD size_t vertex_count, _STD span<VertexStream const> streams);
+
+/* Applies a remap from generateVertexRemap() to an index list. */
+extern void remapIndices(_STD span<u32> indices, _STD span<u32 const> remap);
+
+/* Compacts `source` into `destination` (room for the unique count), `vertex_size` bytes per vertex. */
+extern void remapVertices(void *destination, void const *source, _STD size_t vertex_count, _STD size_t vertex_size, _STD span<u32 const> remap);
+
+struct MeshOptimizationReport {
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+/* Runs every pass above over an interleaved primitive, in the order they need to run. */
+extern MeshOptimizationReport optimizeMesh(InterleavedPrimitive &primitive);
@@ -0,0 +1,261 @@
+﻿#include "meshlet.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "geometry.hpp"
+
+namespace {
+	vec3 positionAt(void const *positions, std::size_t const stride, u32 const vertex) {
+		vec3 position;
+		std::memcpy(&position, static_cast<u8 const *>(positions) + static_cast<std::size_t>(vertex) * stride, sizeof(vec3));
+		return position;
+	}
+
+	void computeBounds(Meshlet &meshlet, std::span<u32 const> const indices, void const *positions, std::size_t const stride) {
+		std::span<u32 const> const corners = indices.subspan(meshlet.first_index, static_cast<std::size_t>(meshlet.triangle_count) * 3);
+
+		vec3 min(std::numeric_limits<f32>::max());
+		vec3 max(std::numeric_limits<f32>::lowest());
+		for (u32 const index : corners) {
+			vec3 const p = positionAt(positions, stride, index);
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+		meshlet.aabb_center = (min + max) * 0.5f;
+		meshlet.aabb_extents = (max - min) * 0.5f;
+
+		// Centred on the box rather than a minimal sphere, it only has to be conservative.
+		meshlet.sphere_center = meshlet.aabb_center;
+		f32 radius_squared = 0.0f;
+		for (u32 const index : corners) {
+			vec3 const d = positionAt(positions, stride, index) - meshlet.sphere_center;
+			radius_squared = std::max(radius_squared, glm::dot(d, d));
+		}
+		meshlet.sphere_radius = std::sqrt(radius_squared);
+
+		// Cone around the average normal, degenerate triangles don't get a say.
+		Vec<vec3> normals;
+		normals.reserve(meshlet.triangle_count);
+		vec3 axis(0.0f);
+		for (std::size_t t = 0; t < corners.size(); t += 3) {
+			vec3 const a = positionAt(positions, stride, corners[t + 0]);
+			vec3 const n = glm::cross(positionAt(positions, stride, corners[t + 1]) - a, positionAt(positions, stride, corners[t + 2]) - a);
+			f32 const length = glm::length(n);
+			if (length <= std::numeric_limits<f32>::min())
+				continue;
+			normals.push_back(n / length);
+			axis += normals.back();
+		}
+
+		meshlet.cone_axis = vec3(0.0f, 0.0f, 1.0f);
+		meshlet.cone_apex = meshlet.sphere_center;
+		meshlet.cone_cutoff = 1.0f;
+		f32 const axis_length = glm::length(axis);
+		if (normals.empty() || axis_length <= std::numeric_limits<f32>::min())
+			return;
+		axis /= axis_length;
+
+		f32 min_dot = 1.0f;
+		for (vec3 const &n : normals)
+			min_dot = std::min(min_dot, glm::dot(axis, n));
+		// Normals spread over a hemisphere or more, no viewpoint sees only back faces.
+		if (min_dot <= 0.0f)
+			return;
+
+		// Slide the apex back along -axis until it is behind every triangle plane, then a view direction inside the cone
+		// (measured from the apex) is behind all of them too.
+		f32 max_t = 0.0f;
+		std::size_t n = 0;
+		for (std::size_t t = 0; t < corners.size(); t += 3) {
+			vec3 const a = positionAt(positions, stride, corners[t + 0]);
+			vec3 const normal = glm::cross(positionAt(positions, stride, corners[t + 1]) - a, positionAt(positions, stride, corners[t + 2]) - a);
+			if (glm::length(normal) <= std::numeric_limits<f32>::min())
+				continue;
+			vec3 const &unit = normals[n++];
+			max_t = std::max(max_t, glm::dot(meshlet.sphere_center - a, unit) / glm::dot(axis, unit));
+		}
+
+		meshlet.cone_axis = axis;
+		meshlet.cone_apex = meshlet.sphere_center - axis * max_t;
+		meshlet.cone_cutoff = std::sqrt(std::max(0.0f, 1.0f - min_dot * min_dot));
+	}
+}
+
+Vec<Meshlet> buildMeshlets(std::span<u32 const> const indices, void const *positions, std::size_t const position_stride) {
+	Vec<Meshlet> meshlets;
+	if (indices.size() < 3)
+		return meshlets;
+
+	// Vertices are looked up linearly in the current meshlet's list, 64 entries is cheaper than any hash table.
+	Array<u32, MESHLET_MAX_VERTICES> used{};
+	u32 used_count = 0;
+	Meshlet current{};
+
+	auto const flush = [&](u32 const next_index) {
+		if (current.triangle_count != 0) {
+			current.vertex_count = used_count;
+			computeBounds(current, indices, positions, position_stride);
+			meshlets.push_back(current);
+		}
+		current = Meshlet{ .first_index = next_index };
+		used_count = 0;
+	};
+
+	for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+		u32 new_vertices[3];
+		u32 new_count = 0;
+		for (u32 corner = 0; corner < 3; corner++) {
+			u32 const v = indices[t + corner];
+			bool const seen = std::find(used.begin(), used.begin() + used_count, v) != used.begin() + used_count
+				|| std::find(new_vertices, new_vertices + new_count, v) != new_vertices + new_count;
+			if (!seen)
+				new_vertices[new_count++] = v;
+		}
+
+		if (used_count + new_count > MESHLET_MAX_VERTICES || current.triangle_count == MESHLET_MAX_TRIANGLES) {
+			flush(static_cast<u32>(t));
+			// Starting over, every corner is new again.
+			new_count = 0;
+			for (u32 corner = 0; corner < 3; corner++) {
+				u32 const v = indices[t + corner];
+				if (std::find(new_vertices, new_vertices + new_count, v) == new_vertices + new_count)
+					new_vertices[new_count++] = v;
+			}
+		}
+
+		for (u32 i = 0; i < new_count; i++)
+			used[used_count++] = new_vertices[i];
+		current.triangle_count++;
+	}
+	flush(0);
+	return meshlets;
+}
+
+bool meshletConeCulled(Meshlet const &meshlet, vec3 const &camera_position) {
+	if (meshlet.cone_cutoff >= 1.0f)
+		return false;
+	vec3 const view = meshlet.cone_apex - camera_position;
+	f32 const distance = glm::length(view);
+	if (distance <= std::numeric_limits<f32>::min())
+		return false;
+	return glm::dot(view, meshlet.cone_axis) >= meshlet.cone_cutoff * distance;
+}
+
+void cullMeshlets(std::span<Meshlet const> const meshlets, mat4 const &model, Frustum const &frustum, vec3 const &camera_position, Vec<u32> &visible) {
+	f32 const scale = std::sqrt(std::max({ glm::dot(vec3(model[0]), vec3(model[0])), glm::dot(vec3(model[1]), vec3(model[1])), glm::dot(vec3(model[2]), vec3(model[2])) }));
+	mat3 const linear(model);
+	bool const cone_usable = glm::determinant(linear) > 0.0f;
+	vec3 const local_camera = cone_usable ? vec3(glm::inverse(model) * vec4(camera_position, 1.0f)) : vec3(0.0f);
+
+	for (std::size_t i = 0; i < meshlets.size(); i++) {
+		Meshlet const &meshlet = meshlets[i];
+		Sphere const world(vec3(model * vec4(meshlet.sphere_center, 1.0f)), meshlet.sphere_radius * scale);
+		if (!world.forwardPlane(frustum.leftFace) || !world.forwardPlane(frustum.rightFace) ||
+		    !world.forwardPlane(frustum.topFace) || !world.forwardPlane(frustum.bottomFace) ||
+		    !world.forwardPlane(frustum.nearFace) || !world.forwardPlane(frustum.farFace))
+			continue;
+		if (cone_usable && meshletConeCulled(meshlet, local_camera))
+			continue;
+		visible.push_back(static_cast<u32>(i));
+	}
+}
+
+#if BENCHMARKS_ENABLED
+
+#include <random>
+#include <string>
+
+#include "mesh.hpp"
+#include "util.hpp"
+
+int benchmarkMeshlets(Vec<std::string_view> const &p_args) {
+	std::string const file_path = bench::argument(p_args, 0, bench::DEFAULT_SCENE);
+	u32 const iterations = bench::numberArgument(p_args, 1, 3);
+	u32 const viewpoints = bench::numberArgument(p_args, 2, 64);
+
+	Optional<gltf::data> const scene = bench::loadScene(file_path);
+	if (!scene)
+		return -1;
+	gltf::data const &data = *scene;
+
+	Vec<InterleavedPrimitive> primitives;
+	u64 triangles = 0;
+	for (gltf::mesh const &mesh : data.meshes) {
+		for (gltf::primitive const &primitive : mesh.primitives) {
+			if (primitive.mode != gltf::primitive_mode::triangles)
+				continue;
+			InterleavedPrimitive &interleaved = primitives.emplace_back(interleavePrimitive(data, primitive));
+			triangles += interleaved.indices.size() / 3;
+		}
+	}
+	printf("[bench] %llu primitive(s), %llu triangle(s)\n", static_cast<unsigned long long>(primitives.size()), static_cast<unsigned long long>(triangles));
+
+	Vec<Vec<Meshlet>> meshlets(primitives.size());
+	bench::measure("buildMeshlets", iterations, [&] {
+		for (std::size_t i = 0; i < primitives.size(); i++) {
+			InterleavedPrimitive const &primitive = primitives[i];
+			if (!primitive.vertices.empty())
+				meshlets[i] = buildMeshlets(primitive.indices, &primitive.vertices.front().position, sizeof(Vertex));
+		}
+	});
+
+	u64 meshlet_count = 0;
+	u64 vertex_slots = 0;
+	u64 triangle_slots = 0;
+	u64 cullable = 0;
+	for (Vec<Meshlet> const &set : meshlets) {
+		for (Meshlet const &meshlet : set) {
+			meshlet_count++;
+			vertex_slots += meshlet.vertex_count;
+			triangle_slots += meshlet.triangle_count;
+			cullable += meshlet.cone_cutoff < 1.0f ? 1 : 0;
+		}
+	}
+	if (meshlet_count != 0) {
+		printf("[bench] %llu meshlet(s), %.1f vertices / %.1f triangles on average, %.1f%% with a usable cone\n",
+			static_cast<unsigned long long>(meshlet_count),
+			static_cast<f64>(vertex_slots) / static_cast<f64>(meshlet_count),
+			static_cast<f64>(triangle_slots) / static_cast<f64>(meshlet_count),
+			100.0 * static_cast<f64>(cullable) / static_cast<f64>(meshlet_count));
+	}
+
+	// Brute force: a cone-culled meshlet must not have a single triangle facing the camera.
+	std::mt19937 random(1234);
+	u64 cone_culled = 0;
+	u64 violations = 0;
+	for (std::size_t i = 0; i < primitives.size(); i++) {
+		InterleavedPrimitive const &primitive = primitives[i];
+		if (primitive.vertices.empty())
+			continue;
+		vec3 const extent = glm::max(primitive.aabb.extents, vec3(1e-3f));
+		std::uniform_real_distribution<f32> offset(-3.0f, 3.0f);
+		for (u32 v = 0; v < viewpoints; v++) {
+			vec3 const camera = primitive.aabb.center + vec3(offset(random), offset(random), offset(random)) * extent;
+			for (Meshlet const &meshlet : meshlets[i]) {
+				if (!meshletConeCulled(meshlet, camera))
+					continue;
+				cone_culled++;
+				for (u32 t = 0; t < meshlet.triangle_count; t++) {
+					u32 const *corner = &primitive.indices[meshlet.first_index + t * 3];
+					vec3 const a = primitive.vertices[corner[0]].position;
+					vec3 const normal = glm::cross(primitive.vertices[corner[1]].position - a, primitive.vertices[corner[2]].position - a);
+					vec3 const to_camera = camera - a;
+					// A little slack for triangles seen exactly edge-on, float noise isn't a miss.
+					if (glm::dot(normal, to_camera) > 1e-5f * glm::length(normal) * glm::length(to_camera)) {
+						violations++;
+						break;
+					}
+				}
+			}
+		}
+	}
+	printf("[bench] cone test: %llu meshlet(s) culled over %u viewpoint(s) per primitive, %llu with a front facing triangle\n",
+		static_cast<unsigned long long>(cone_culled), viewpoints, static_cast<unsigned long long>(violations));
+	return violations == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <span>
+
+#include "types.hpp"
+#include "math.hpp"
+#include "engine/benchmark.hpp"
+
+struct Frustum;
+
+//
+// Meshlets: runs of at most MESHLET_MAX_TRIANGLES triangles touching at most MESHLET_MAX_VERTICES vertices,
+// each with its own bounds and backface cone so whole clusters can be culled instead of whole primitives.
+// There is no mesh shader path, so a meshlet is a contiguous range of the primitive's index buffer
+// and a visible set can be drawn as a handful of glMultiDrawElements ranges.
+//
+
+constexpr u32 MESHLET_MAX_VERTICES = 64;
+constexpr u32 MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet {
+	u32 first_index;	//< Into the primitive's index buffer.
+	u32 triangle_count;
+	u32 vertex_count;	//< Distinct vertices, never more than MESHLET_MAX_VERTICES.
+	f32 cone_cutoff;	//< Sine of the cone's half angle, 1 when the triangles face every which way and the cone can't cull.
+
+	vec3 sphere_center;
+	f32 sphere_radius;
+	vec3 aabb_center;
+	vec3 aabb_extents;
+	vec3 cone_apex;		//< Every triangle plane has the apex behind it, see meshletConeCulled().
+	vec3 cone_axis;
+};
+
+/*
+ * Splits a triangle list into meshlets in index order, so run the vertex cache pass first if the order matters.
+ * Object space, `positions` are 3 floats `position_stride` bytes apart.
+ */
+extern Vec<Meshlet> buildMeshlets(_STD span<u32 const> indices, void const *positions, _STD size_t position_stride);
+
+/* True when every triangle of the meshlet faces away from `camera_position` (object space, counter-clockwise front faces). */
+_NODISCARD extern bool meshletConeCulled(Meshlet const &meshlet, vec3 const &camera_position);
+
+/*
+ * CPU reference culler: frustum test of the bounding spheres in world space, then the cone test in object space.
+ * Appends the indices of the surviving meshlets to `visible`. Mirrored transforms skip the cone test, their winding flips.
+ */
+extern void cullMeshlets(_STD span<Meshlet const> meshlets, mat4 const &model, Frustum const &frustum, vec3 const &camera_position, Vec<u32> &visible);
+
+#if BENCHMARKS_ENABLED
+/*
+ * `--bench meshlets [file] [iterations] [viewpoints]`, meshlet build time for every primitive, then checks that
+ * the cone test never culls a meshlet with a front facing triangle from random viewpoints. Exits with 1 if it does.
+ */
+extern int benchmarkMeshlets(Vec<_STD string_view> const &p_args);
+#endif
@@ -1,21 +1,178 @@
 ﻿#include "model_manager.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
 ModelManager * ModelManager::singleton() {
 	thread_local ModelManager singleton_;
 	return &singleton_;
 }
+
+GeometryHandle ModelManager::allocate(std::span<Vertex const> const vertices, std::span<u32 const> const indices) {
+	if (vertices.empty() || indices.empty())
+		return INVALID_GEOMETRY;
+
+	u32 const vertex_count = static_cast<u32>(vertices.size());
+	u32 const index_count = static_cast<u32>(indices.size());
+	// Both pools are packed together, so this has to happen before either one hands out space.
+	auto const scattered = [](Pool const &pool, u32 const count) {
+		return pool.allocator.largestFreeBlock() < count && pool.allocator.available() >= count;
+	};
+	if (scattered(vertices_, vertex_count) || scattered(indices_, index_count))
+		defragment();
+
+	u32 const base_vertex = reserve(vertices_, vertex_count);
+	u32 const first_index = reserve(indices_, index_count);
+	vertices_.buffer->update(vertices.size_bytes(), static_cast<i64>(base_vertex) * sizeof(Vertex), vertices.data());
+	indices_.buffer->update(indices.size_bytes(), static_cast<i64>(first_index) * sizeof(u32), indices.data());
+
+	GeometryRange const range{
+		.base_vertex = base_vertex,
+		.vertex_count = vertex_count,
+		.first_index = first_index,
+		.index_count = index_count
+	};
+	if (!free_handles_.empty()) {
+		GeometryHandle const handle = free_handles_.back();
+		free_handles_.pop_back();
+		ranges_[handle] = range;
+		return handle;
+	}
+	ranges_.push_back(range);
+	return static_cast<GeometryHandle>(ranges_.size() - 1);
+}
+
+void ModelManager::release(GeometryHandle const handle) {
+	// Meshes can outlive dispose(), everything is gone already by then.
+	if (handle >= ranges_.size() || ranges_[handle].index_count == 0)
+		return;
+	GeometryRange &range = ranges_[handle];
+	vertices_.allocator.release(range.base_vertex, range.vertex_count);
+	indices_.allocator.release(range.first_index, range.index_count);
+	range.index_count = 0;
+	free_handles_.push_back(handle);
+}
+
+void ModelManager::draw(GeometryHandle const handle, u32 const first_index, u32 const index_count, i32 const instances) const {
+	GeometryRange const &range = ranges_[handle];
+	assert(first_index + index_count <= range.index_count);
+	vertex_array_->drawRangeBaseVertex((static_cast<std::size_t>(range.first_index) + first_index) * sizeof(u32), index_count, static_cast<i32>(range.base_vertex), instances);
+}
+
+u32 ModelManager::reserve(Pool &pool, u32 const count) {
+	if (Optional<u32> const offset = pool.allocator.allocate(count); offset.has_value())
+		return offset.value();
+	// Sized so the new space alone fits it, whatever is free at the end now may be too small.
+	grow(pool, pool.allocator.capacity() + count);
+	Optional<u32> const offset = pool.allocator.allocate(count);
+	assert(offset.has_value());
+	return offset.value();
+}
+
+void ModelManager::grow(Pool &pool, u32 const min_capacity) {
+	u32 const initial = &pool == &vertices_ ? MODEL_MANAGER_INITIAL_VERTICES : MODEL_MANAGER_INITIAL_INDICES;
+	u32 capacity = std::max(pool.allocator.capacity(), initial);
+	while (capacity < min_capacity)
+		capacity = capacity > std::numeric_limits<u32>::max() / 2 ? std::numeric_limits<u32>::max() : capacity * 2;
+
+	// Immutable storage can't be resized, the contents move to a bigger buffer on the GPU.
+	auto const buffer = std::make_shared<Buffer>();
+	buffer->allocate(static_cast<std::size_t>(capacity) * pool.element_size, nullptr, gl::BufferStorageMask::DynamicStorageBit);
+	buffer->setLabel(pool.label);
+	if (pool.buffer != nullptr && pool.allocator.capacity() > 0)
+		pool.buffer->copySubData(*buffer, 0, 0, static_cast<i64>(pool.allocator.capacity()) * pool.element_size);
+#if MODEL_MANAGER_PRINT_STATISTICS
+	printf("[ModelManager] %s: %u -> %u elements\n", pool.label, pool.allocator.capacity(), capacity);
+#endif
+
+	pool.buffer = buffer;
+	pool.allocator.grow(capacity);
+	bindBuffers();
+}
+
+void ModelManager::defragment() {
+	if (vertices_.buffer == nullptr)
+		return;
+
+	// Live allocations in buffer order per pool, so each one only ever moves towards the front.
+	Vec<GeometryHandle> live;
+	live.reserve(ranges_.size());
+	for (GeometryHandle handle = 0; handle < ranges_.size(); handle++) {
+		if (ranges_[handle].index_count > 0)
+			live.push_back(handle);
+	}
+
+	auto const pack = [&](Pool &pool, auto offset_of, auto count_of) {
+		std::ranges::sort(live, {}, [&](GeometryHandle const handle) { return offset_of(ranges_[handle]); });
+		auto const buffer = std::make_shared<Buffer>();
+		buffer->allocate(static_cast<std::size_t>(pool.allocator.capacity()) * pool.element_size, nullptr, gl::BufferStorageMask::DynamicStorageBit);
+		buffer->setLabel(pool.label);
+
+		u32 packed = 0;
+		// Neighbouring allocations go over in one copy.
+		u32 run_source = 0, run_destination = 0, run_count = 0;
+		auto const flush = [&] {
+			if (run_count > 0)
+				pool.buffer->copySubData(*buffer, static_cast<i64>(run_source) * pool.element_size, static_cast<i64>(run_destination) * pool.element_size, static_cast<i64>(run_count) * pool.element_size);
+			run_count = 0;
+		};
+		for (GeometryHandle const handle : live) {
+			u32 &offset = offset_of(ranges_[handle]);
+			u32 const count = count_of(ranges_[handle]);
+			if (run_count == 0 || run_source + run_count != offset) {
+				flush();
+				run_source = offset;
+				run_destination = packed;
+			}
+			run_count += count;
+			offset = packed;
+			packed += count;
+		}
+		flush();
+
+		pool.buffer = buffer;
+		pool.allocator.reset(packed);
+	};
+	pack(vertices_,
+		[](GeometryRange &range) -> u32 & { return range.base_vertex; },
+		[](GeometryRange const &range) { return range.vertex_count; });
+	pack(indices_,
+		[](GeometryRange &range) -> u32 & { return range.first_index; },
+		[](GeometryRange const &range) { return range.index_count; });
+	bindBuffers();
+}
+
+void ModelManager::bindBuffers() {
+	if (vertices_.buffer == nullptr || indices_.buffer == nullptr)
+		return;
+	if (vertex_array_ == nullptr) {
+		vertex_array_ = std::make_shared<VertexArray>();
+		vertex_array_->setLabel("Geometry Pool");
+		for (VertexArrayAttribute const &attrib : InterleavedVertexAttributes)
+			vertex_array_->setAttribute(attrib);
+		vertex_array_->vertex_buffer_count = 1;
+		vertex_array_->draw_elements_type = gl::DrawElementsType::UnsignedInt;
+	}
+	vertex_array_->setVertexBuffer(0, *vertices_.buffer, sizeof(Vertex));
+	vertex_array_->setElementBuffer(*indices_.buffer);
+}
+
 void ModelManager::dispose() {
-	vertices_.clear();
-	indices_.clear();
+	ranges_.clear();
+	free_handles_.clear();
 	materials_.clear();
 	
-	vertex_buffer_.dispose();
-	index_buffer_.dispose();
+	vertices_.buffer.reset();
+	vertices_.allocator = RangeAllocator();
+	indices_.buffer.reset();
+	indices_.allocator = RangeAllocator();
+	vertex_array_.reset();
 	material_buffer_.dispose();
 }
 
 bool ModelManager::disposed() const {
-	return vertex_buffer_.disposed() ||
-			index_buffer_.disposed() ||
+	return vertices_.buffer == nullptr &&
+			indices_.buffer == nullptr &&
 			material_buffer_.disposed();
 }
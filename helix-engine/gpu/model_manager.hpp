@@ -1,22 +1,75 @@
 ﻿#pragma once
 
+#include <span>
+
 #include "buffer.h"
 #include "gpu/mesh.hpp"
 #include "material.hpp"
+#include "range_allocator.hpp"
+
+/* Vertices and indices the pool starts with, it doubles whenever an allocation doesn't fit. */
+#define MODEL_MANAGER_INITIAL_VERTICES (1u << 18)
+#define MODEL_MANAGER_INITIAL_INDICES (1u << 20)
+/* Print every time a pool grows. */
+#define MODEL_MANAGER_PRINT_STATISTICS 0
+
+/* Where one allocation lives in the pool. Indices are relative to base_vertex, so they never change when it moves. */
+struct GeometryRange {
+	u32 base_vertex;
+	u32 vertex_count;
+	u32 first_index;
+	u32 index_count; //< 0 once released.
+};
 
+/*
+ * Geometry pool: one immutable vertex buffer of Vertex, one of u32 indices and one VAO over both, so meshes in the pool
+ * draw without switching buffers or vertex arrays. Space is handed out by RangeAllocator, meshes keep a GeometryHandle
+ * and look its GeometryRange up at draw time, so allocations can move when the pool grows or gets defragmented.
+ * Everything here runs on the GL thread.
+ */
 class ModelManager : IDisposable {
 public:
 	static ModelManager *singleton();
 
+	/*
+	 * Copies the geometry into the pool. When enough space is free but no block is large enough the pool is defragmented,
+	 * when there isn't it grows. INVALID_GEOMETRY for empty input.
+	 */
+	_NODISCARD GeometryHandle allocate(_STD span<Vertex const> vertices, _STD span<u32 const> indices);
+	void release(GeometryHandle handle);
+
+	_NODISCARD GeometryRange const &range(GeometryHandle handle) const { return ranges_[handle]; }
+
+	/* `index_count` indices starting `first_index` into the allocation, `instances` times over. */
+	void draw(GeometryHandle handle, u32 first_index, u32 index_count, i32 instances = 1) const;
+	/* The VAO over both pools, for IndirectDrawBatch. Null until something was allocated. */
+	_NODISCARD VertexArray const *vertexArray() const { return vertex_array_.get(); }
+
+	/* Packs every live allocation to the front of new buffers. Ranges change, handles stay valid. */
+	void defragment();
+
 	void dispose() override;
 	[[nodiscard]] bool disposed() const override;
 	
 private:
-	Vec<Vertex> vertices_;
-	Vec<u32> indices_;
+	struct Pool {
+		SharedPtr<Buffer> buffer;
+		RangeAllocator allocator;
+		u32 element_size;
+		char const *label;
+	};
+
+	/* Room for `count` elements, grows the pool when no free block is large enough. */
+	_NODISCARD u32 reserve(Pool &pool, u32 count);
+	void grow(Pool &pool, u32 min_capacity);
+	void bindBuffers();
+
+	Pool vertices_{ .element_size = sizeof(Vertex), .label = "Geometry Pool Vertices" };
+	Pool indices_{ .element_size = sizeof(u32), .label = "Geometry Pool Indices" };
+	SharedPtr<VertexArray> vertex_array_;
+	Vec<GeometryRange> ranges_; //< Indexed by GeometryHandle.
+	Vec<GeometryHandle> free_handles_;
 	Vec<GpuMaterial> materials_;
 	
-	TypedBuffer<Vertex> vertex_buffer_;
-	TypedBuffer<u32> index_buffer_; //< This can become packed u8x4, u16x2, etc
 	TypedBuffer<GpuMaterial> material_buffer_;
-};
\ No newline at end of file
+};
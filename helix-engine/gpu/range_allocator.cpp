@@ -0,0 +1,85 @@
+﻿#include "range_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(u32 const capacity) : capacity_(capacity) {
+	if (capacity > 0)
+		free_.emplace(0u, capacity);
+}
+
+Optional<u32> RangeAllocator::allocate(u32 const count) {
+	if (count == 0)
+		return std::nullopt;
+	for (auto it = free_.begin(); it != free_.end(); ++it) {
+		auto const [offset, size] = *it;
+		if (size < count)
+			continue;
+		free_.erase(it);
+		if (size > count)
+			free_.emplace(offset + count, size - count);
+		used_ += count;
+		return offset;
+	}
+	return std::nullopt;
+}
+
+void RangeAllocator::release(u32 offset, u32 count) {
+	if (count == 0)
+		return;
+	assert(offset + count <= capacity_);
+	used_ -= count;
+
+	auto next = free_.lower_bound(offset);
+	assert(next == free_.end() || next->first >= offset + count);
+	if (next != free_.end() && next->first == offset + count) {
+		count += next->second;
+		next = free_.erase(next);
+	}
+	if (next != free_.begin()) {
+		auto const previous = std::prev(next);
+		assert(previous->first + previous->second <= offset);
+		if (previous->first + previous->second == offset) {
+			previous->second += count;
+			return;
+		}
+	}
+	free_.emplace_hint(next, offset, count);
+}
+
+void RangeAllocator::grow(u32 const new_capacity) {
+	if (new_capacity <= capacity_)
+		return;
+	u32 const added = new_capacity - capacity_;
+	if (!free_.empty()) {
+		auto last = std::prev(free_.end());
+		if (last->first + last->second == capacity_) {
+			last->second += added;
+			capacity_ = new_capacity;
+			return;
+		}
+	}
+	free_.emplace(capacity_, added);
+	capacity_ = new_capacity;
+}
+
+void RangeAllocator::reset(u32 const used) {
+	assert(used <= capacity_);
+	free_.clear();
+	if (used < capacity_)
+		free_.emplace(used, capacity_ - used);
+	used_ = used;
+}
+
+u32 RangeAllocator::largestFreeBlock() const {
+	u32 largest = 0;
+	for (auto const &[offset, size] : free_)
+		largest = std::max(largest, size);
+	return largest;
+}
+
+f32 RangeAllocator::fragmentation() const {
+	u32 const free_count = available();
+	return free_count == 0 ? 0.0f : 1.0f - static_cast<f32>(largestFreeBlock()) / static_cast<f32>(free_count);
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include "types.hpp"
+
+//
+// Bookkeeping for suballocating one big buffer. Offsets and counts are in elements (vertices, indices...),
+// the storage itself belongs to whoever owns the allocator, see ModelManager.
+//
+
+/*
+ * First fit free list over [0, capacity). Released blocks merge with their free neighbours, so the free list only
+ * ever holds disjoint, non-adjacent blocks. Doesn't touch the GPU.
+ */
+class RangeAllocator {
+public:
+	explicit RangeAllocator(u32 capacity = 0);
+
+	/* Offset of `count` free elements, nullopt when no single free block is large enough. */
+	_NODISCARD Optional<u32> allocate(u32 count);
+	void release(u32 offset, u32 count);
+
+	/* Appends [capacity, new_capacity) to the free space, merging with a free block at the end. */
+	void grow(u32 new_capacity);
+
+	/* Everything before `used` becomes allocated and everything after it free, for after live blocks were packed to the front. */
+	void reset(u32 used);
+
+	_NODISCARD u32 capacity() const { return capacity_; }
+	_NODISCARD u32 used() const { return used_; }
+	_NODISCARD u32 available() const { return capacity_ - used_; }
+	_NODISCARD u32 largestFreeBlock() const;
+
+	/* Share of the free space outside the largest free block, 0 when all of it is contiguous. */
+	_NODISCARD f32 fragmentation() const;
+
+private:
+	Map<u32, u32> free_; //< Offset -> count.
+	u32 capacity_ = 0;
+	u32 used_ = 0;
+};
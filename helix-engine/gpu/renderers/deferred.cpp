@@ -44,11 +44,16 @@ void DeferredRenderer::writeToGBuffer() {
 		.bind_normal_texture = true,
 		.bind_orm_texture = true,
 		.bind_object_id = true,
-		.frustum_culling = false,
+		.bind_vertex_packing = true,
+		.bind_instancing = true,
+		.frustum_culling = true,
+		.request_texture_streaming = true,
 		.render_sky = true,
 		.cull = true,
 		.bind_time = std::nullopt,
 		.viewport = viewport_size,
+		.indirect_draws = RENDER_MULTI_DRAW_INDIRECT ? &g_buffer_draws_ : nullptr,
+		.culling = &g_buffer_culling_,
 		.shader_program = &write_g_buffer_,
 		.depth = {
 			.depth_test = true
@@ -83,6 +88,10 @@ void DeferredRenderer::writeToGBuffer() {
 	editor_camera->refreshMatrices();
 	editor_camera->makeCurrent();
 
+	G_BUFFER_PASS.camera = editor_camera->makeFrustum();
+	G_BUFFER_PASS.camera_position = vec3(editor_camera->inverseViewMatrix()[3]);
+	G_BUFFER_PASS.lod_pixels_per_unit = static_cast<f32>(viewport_size.w) * 0.5f * editor_camera->projectionMatrix()[1][1];
+
 	write_g_buffer_.use();
 	
 	g_buffer_.bind();
@@ -215,11 +224,21 @@ Result<> DeferredRenderer::render() {
 	deferred_lighting_.integrityCheck();
 	texture_to_screen_.integrityCheck();
 
+	gpu::draw_statistics = {};
+
 	writeToGBuffer();
 	deferredLighting();
 	postProcess();
 
 	swapBuffers();
+
+#if RENDER_PRINT_DRAW_STATISTICS
+	static f64 last_print = 0.0;
+	if (f64 const now = glfwGetTime(); now - last_print >= 1.0) {
+		printf("[DeferredRenderer] %llu draw calls, %llu draws\n", gpu::draw_statistics.draw_calls, gpu::draw_statistics.draws);
+		last_print = now;
+	}
+#endif
 	
 	return OK;
 }
@@ -233,6 +252,7 @@ void DeferredRenderer::dispose() {
 	write_g_buffer_.dispose();
 	write_depth_.dispose();
 	deferred_lighting_.dispose();
+	g_buffer_draws_.dispose();
 	if (!window_->disposed())
 		window_->dispose();
 }
@@ -241,5 +261,6 @@ bool DeferredRenderer::disposed() const {
 	return compositor_.disposed()
 		&& write_g_buffer_.disposed() 
 		&& write_depth_.disposed() 
-		&& deferred_lighting_.disposed();
+		&& deferred_lighting_.disposed()
+		&& g_buffer_draws_.disposed();
 }
@@ -2,7 +2,12 @@
 #pragma once
 #include "renderer.hpp"
 #include "gpu/compositor.h"
+#include "gpu/frustum_culling.hpp"
 #include "gpu/geometry_buffer.hpp"
+#include "gpu/indirect_draws.hpp"
+
+/* Prints gpu::draw_statistics of the last frame once a second, compare with RENDER_MULTI_DRAW_INDIRECT on and off. */
+#define RENDER_PRINT_DRAW_STATISTICS 0
 
 class GBuffer;
 class Window;
@@ -40,6 +45,8 @@ public:
 
 private:
 	GBuffer g_buffer_;
+	IndirectDrawBatch g_buffer_draws_;
+	FrustumCuller g_buffer_culling_;
 	Compositor compositor_;
 	SharedPtr<Window> window_;
 };
\ No newline at end of file
@@ -0,0 +1,107 @@
+﻿#include "staging_ring.hpp"
+
+#include "buffer.h"
+#include "glad/glad.h"
+
+StagingRing *StagingRing::singleton() {
+	static StagingRing instance(STAGING_RING_BYTES);
+	return &instance;
+}
+
+StagingRing::StagingRing(u64 const capacity) : capacity_(capacity) {
+	buffer_ = std::make_shared<Buffer>();
+	buffer_->allocate(capacity, nullptr, gl::BufferStorageMask::MapWriteBit | gl::BufferStorageMask::MapPersistentBit | gl::BufferStorageMask::MapCoherentBit);
+	buffer_->setLabel("Staging ring");
+	mapping_ = static_cast<char *>(buffer_->mapRange(0, static_cast<i64>(capacity),
+		gl::MapBufferAccessMask::MapWriteBit | gl::MapBufferAccessMask::MapPersistentBit | gl::MapBufferAccessMask::MapCoherentBit));
+}
+
+StagingAllocation StagingRing::allocate(u64 const size, u64 const alignment) {
+	if (size == 0 || size > capacity_) {
+		++fallbacks_;
+		return {};
+	}
+
+	std::lock_guard lock(mutex_);
+	if (mapping_ == nullptr) {
+		++fallbacks_;
+		return {};
+	}
+
+	u64 start = (head_ + alignment - 1) / alignment * alignment;
+	if (start % capacity_ + size > capacity_)
+		start = (start / capacity_ + 1) * capacity_; //< Doesn't fit before the end of the buffer, start over at the front.
+	u64 const end = start + size;
+	if (end - tail_ > capacity_) {
+		++fallbacks_;
+		return {};
+	}
+
+	regions_.push_back({ .end = end });
+	head_ = end;
+	u64 const offset = start % capacity_;
+	return { .data = mapping_ + offset, .offset = offset, .size = size, .id = first_region_ + regions_.size() - 1 };
+}
+
+void StagingRing::release(StagingAllocation const &allocation) {
+	if (!allocation)
+		return;
+	std::lock_guard lock(mutex_);
+	if (allocation.id < first_region_ || allocation.id - first_region_ >= regions_.size())
+		return;
+	regions_[allocation.id - first_region_].fence = next_fence_;
+	fence_pending_ = true;
+}
+
+void StagingRing::retire() {
+	std::lock_guard lock(mutex_);
+	if (fence_pending_) {
+		fences_.push_back({ .serial = next_fence_++, .sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+		fence_pending_ = false;
+	}
+
+	while (!fences_.empty()) {
+		GLsync const sync = static_cast<GLsync>(fences_.front().sync);
+		GLenum const status = glClientWaitSync(sync, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		signalled_fence_ = fences_.front().serial;
+		glDeleteSync(sync);
+		fences_.pop_front();
+	}
+
+	while (!regions_.empty() && regions_.front().fence != 0 && regions_.front().fence <= signalled_fence_) {
+		tail_ = regions_.front().end;
+		regions_.pop_front();
+		first_region_++;
+	}
+}
+
+u32 StagingRing::buffer() const {
+	return buffer_ ? buffer_->buffer_object_ : 0;
+}
+
+u64 StagingRing::used() const {
+	std::lock_guard lock(mutex_);
+	return head_ - tail_;
+}
+
+void StagingRing::dispose() {
+	std::lock_guard lock(mutex_);
+	for (Fence const &fence : fences_)
+		glDeleteSync(static_cast<GLsync>(fence.sync));
+	fences_.clear();
+	first_region_ += regions_.size();
+	regions_.clear();
+	if (buffer_) {
+		buffer_->unmap();
+		buffer_.reset();
+	}
+	mapping_ = nullptr;
+	tail_ = head_;
+	disposed_ = true;
+}
+
+bool StagingRing::disposed() const {
+	return disposed_;
+}
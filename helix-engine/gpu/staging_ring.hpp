@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "types.hpp"
+#include "engine/disposable.hpp"
+
+class Buffer;
+
+/* Size of the persistently mapped staging buffer. Requests that don't fit in what's free fall back to the caller's own memory. */
+#define STAGING_RING_BYTES (64ull << 20)
+
+/* A region of the staging ring. `data` is null when the request didn't fit. */
+struct StagingAllocation {
+	char *data = nullptr;
+	u64 offset = 0;	//< Into StagingRing::buffer(), what GL gets instead of a pointer with GL_PIXEL_UNPACK_BUFFER bound.
+	u64 size = 0;
+	u64 id = 0;		//< The ring's record of it, for release().
+
+	_NODISCARD explicit operator bool() const { return data != nullptr; }
+};
+
+/*
+ * One persistently mapped, coherent buffer handed out front to back and reused once GL is done reading from it.
+ * allocate() only touches the mapping, so producers on worker threads write their pixels straight into it, no main thread
+ * round trip. When what's left doesn't fit the request it fails and the producer keeps its data in its own memory instead,
+ * nothing ever waits or throws.
+ *
+ * Regions are released on the main thread once the GL commands reading them are issued, retire() puts a fence behind them
+ * and reclaims everything whose fence has signalled. Regions come back in allocation order, one released early waits for
+ * the ones before it.
+ */
+class StagingRing : IDisposable {
+public:
+	/* The first call creates the buffer, it has to come from the main thread. */
+	static StagingRing *singleton();
+
+	/* Any thread. Requests larger than the ring always fail. */
+	_NODISCARD StagingAllocation allocate(u64 size, u64 alignment = 16);
+	/* Main thread, once GL commands reading from `allocation` are issued (or if it never gets used). */
+	void release(StagingAllocation const &allocation);
+	/* Main thread, once per frame after the frame's uploads. Fences what was released since the last call and reclaims what's done. */
+	void retire();
+
+	_NODISCARD u32 buffer() const;
+	_NODISCARD u64 capacity() const { return capacity_; }
+	/* Bytes between the oldest unreclaimed region and the newest, padding included. */
+	_NODISCARD u64 used() const;
+	/* allocate() calls that didn't fit so far. */
+	_NODISCARD u64 fallbacks() const { return fallbacks_.load(_STD memory_order_relaxed); }
+
+	void dispose() override;
+	[[nodiscard]] bool disposed() const override;
+
+private:
+	explicit StagingRing(u64 capacity);
+
+	struct Region {
+		u64 end;			//< Ring position one past the region, skipped bytes at the end of the buffer belong to the region after them.
+		u64 fence = 0;		//< Serial of the fence covering it, 0 until it's released.
+	};
+
+	struct Fence {
+		u64 serial;
+		void *sync;			//< GLsync
+	};
+
+	mutable std::mutex mutex_;
+	SharedPtr<Buffer> buffer_;
+	char *mapping_ = nullptr;
+	u64 capacity_ = 0;
+	// Positions only ever grow, `% capacity_` is where they are in the buffer.
+	u64 head_ = 0;
+	u64 tail_ = 0;
+	Deque<Region> regions_;		//< In allocation order, regions_[0] has id first_region_.
+	u64 first_region_ = 0;
+	Deque<Fence> fences_;		//< Oldest first.
+	u64 next_fence_ = 1;		//< Serial the next retire() fence gets.
+	u64 signalled_fence_ = 0;	//< Newest serial known to be done.
+	bool fence_pending_ = false;
+	std::atomic<u64> fallbacks_ = 0;
+	bool disposed_ = false;
+};
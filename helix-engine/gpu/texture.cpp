@@ -1,5 +1,7 @@
 ﻿#include "texture.h"
 
+#include <algorithm>
+
 #include <glm/gtc/type_ptr.hpp>
 
 #include "graphics.hpp"
@@ -13,96 +15,6 @@
 
 u32 Texture::bound_texture_2d_ = 0xFFFFFFFFu;
 
-AsyncTextureBank::AsyncTextureBank() : sem_(MAX_BUFFERS) {
-	for (size_t i = 0; i < MAX_BUFFERS; i++) {
-		buffers_registered_[i].in_use.store(false);
-		buffers_registered_[i].memsize = 0ull;
-		buffers_registered_[i].buffer = nullptr;
-	}
-}
-
-AsyncTextureBank * AsyncTextureBank::singleton() {
-	static AsyncTextureBank instance;
-	return &instance;
-}
-std::size_t AsyncTextureBank::requestOpenRegister(std::size_t const memsize) {
-	if (disposed()) [[unlikely]] throw std::runtime_error("AsyncTextureBank: Attempted to request an open register after the AsyncTextureBank has been disposed. This likely means there is a logic error in the code using the AsyncTextureBank, good luck finding it.");
-	for (auto &[in_use, reg_memsize, buffer] : buffers_registered_) {
-		if (!in_use.load() && reg_memsize >= memsize) {
-			in_use.store(true);
-			return reg_memsize;
-		}
-	}
-	return 0;	
-}
-Buffer const *AsyncTextureBank::checkout(std::size_t const memsize) {
-	if (!sem_.try_acquire()) return nullptr;
-
-	using enum gl::BufferStorageMask;
-
-	if (disposed()) [[unlikely]] throw std::runtime_error("AsyncTextureBank: Attempted to check out a buffer after the AsyncTextureBank has been disposed. This likely means there is a logic error in the code using the AsyncTextureBank, good luck finding it.");
-
-	// First attempt, try to find one that matches capacity.
-	for (auto &[in_use, reg_memsize, buffer] : buffers_registered_) {
-		if (!in_use.load() && reg_memsize >= memsize) {
-			in_use.store(true);
-			return buffer.get();
-		}
-	}
-
-	for (auto &[in_use, reg_memsize, buffer] : buffers_registered_) {
-		if (!in_use.load()) {
-			in_use.store(true);
-			reg_memsize = memsize;
-
-			if (Engine::singleton()->isOnMainThread()) {
-				SharedPtr<Buffer> new_buffer = std::make_shared<Buffer>();
-				new_buffer->allocate(memsize, nullptr, ClientStorageBit | MapWriteBit | MapPersistentBit);
-				buffer.swap(new_buffer);
-			}
-			else {
-				Engine::singleton()->addLazyTaskToMainThreadQueue([&buffer, memsize] {
-					SharedPtr<Buffer> new_buffer = std::make_shared<Buffer>();
-					new_buffer->allocate(memsize, nullptr, ClientStorageBit | MapWriteBit | MapPersistentBit);
-					buffer.swap(new_buffer);
-					return true;
-				}).wait();
-			}
-			return buffer.get();
-		}
-	}
-	
-	throw std::runtime_error("AsyncTextureBank: No available buffer register found for the requested memory size. Semaphore ticked so there must be an error somewhere, good luck.");
-}
-void AsyncTextureBank::checkin(Buffer const *buffer) {
-
-	if (disposed()) [[unlikely]] throw std::runtime_error("AsyncTextureBank: Attempted to check in a buffer after the AsyncTextureBank has been disposed. This likely means there is a logic error in the code using the AsyncTextureBank, good luck finding it.");
-	
-	for (auto &[in_use, reg_memsize, reg_buffer] : buffers_registered_) {
-		if (reg_buffer && *reg_buffer == *buffer) {
-			in_use.store(false);
-			sem_.release();
-			return;
-		}
-	}
-	throw std::runtime_error("AsyncTextureBank: Attempted to check in a buffer that was not registered as checked out. This likely means there is a logic error in the code using the AsyncTextureBank, good luck finding it.");
-}
-
-void AsyncTextureBank::dispose() {
-	for (auto &[in_use, reg_memsize, buffer] : buffers_registered_) {
-		buffer.reset(); //< Be free!
-		if (in_use.load()) {
-			in_use.store(false);
-			sem_.release();
-		}
-	}
-	disposed_ = true;
-}
-
-bool AsyncTextureBank::disposed() const {
-	return disposed_;
-}
-
 void Texture::createObject(gl::TextureTarget target) {
 	glCreateTextures((GLenum)target, 1, &texture_object_);
 }
@@ -300,6 +212,35 @@ void Texture::allocate(glm::ivec2 const &size, i32 const levels, gl::InternalFor
 	gpu_check;
 }
 
+void Texture::reallocateResidentLevels(glm::ivec2 const &full_size, i32 const levels, i32 const first_level) {
+	auto const levelSize = [&full_size](i32 const level) { return glm::max(ivec2(full_size.x >> level, full_size.y >> level), ivec2(1)); };
+
+	u32 object = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &object);
+	ivec2 const size = levelSize(first_level);
+	glTextureStorage2D(object, levels - first_level, static_cast<GLenum>(internal_format_), size.x, size.y);
+
+	// Sampler state belongs to the object, it has to come along.
+	for (GLenum const parameter : { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T }) {
+		GLint value = 0;
+		glGetTextureParameteriv(texture_object_, parameter, &value);
+		glTextureParameteri(object, parameter, value);
+	}
+	glTextureParameterf(object, GL_TEXTURE_MAX_ANISOTROPY, anisotropic_filtering_enabled_ ? 16.0f : 1.0f);
+
+	for (i32 level = std::max(first_level, resident_level_); level < levels; level++) {
+		ivec2 const copied = levelSize(level);
+		glCopyImageSubData(texture_object_, GL_TEXTURE_2D, level - resident_level_, 0, 0, 0,
+			object, GL_TEXTURE_2D, level - first_level, 0, 0, 0, copied.x, copied.y, 1);
+	}
+
+	glDeleteTextures(1, &texture_object_);
+	texture_object_ = object;
+	resident_level_ = first_level;
+	resolution_ = size;
+	gpu_check;
+}
+
 void Texture::allocate3D(ivec3 const &size, i32 const levels, gl::InternalFormat format) {
 	internal_format_ = format;
 	glTextureStorage3D(texture_object_, levels, static_cast<GLenum>(format), size.x, size.y, size.z);
@@ -46,37 +46,6 @@ struct image_descriptor {
 
 class Buffer;
 
-class AsyncTextureBank : IDisposable {
-public:
-
-	inline static constexpr size_t MAX_BUFFERS = 10;
-
-	AsyncTextureBank();
-
-	struct Register {
-		Atomic<bool> in_use = false;
-		std::size_t memsize = 0ull;
-		std::shared_ptr<Buffer> buffer;
-	};
-
-	Semaphore<MAX_BUFFERS> sem_;
-	Array<Register, MAX_BUFFERS> buffers_registered_;
-
-	static AsyncTextureBank *singleton();
-
-	std::size_t requestOpenRegister(std::size_t memsize);
-
-	Buffer const *checkout(std::size_t memsize);
-	
-	void checkin(Buffer const *buffer);
-
-	void dispose() override;
-	[[nodiscard]] bool disposed() const override;
-
-private:
-	bool disposed_ = false;
-};
-
 template <gl::TextureTarget T>
 struct TextureBuilder {
 	ivec2 image_resolution = ivec2(1, 1);
@@ -231,6 +200,9 @@ public:
 
 	u32 texture_object_;
 
+	i32 resident_level_ = 0;	//< Level of the full texture that level 0 of texture_object_ holds, above 0 while TextureStreamer keeps finer levels out.
+	u32 streaming_id_ = ~0u;	//< TextureStreamer's id for it, ~0u (INVALID_STREAMING_TEXTURE) when it isn't streamed.
+
 	std::future<void> future_;
 
 	template <gl::TextureTarget T>
@@ -323,6 +295,11 @@ public:
 
 	void allocate(::ivec2 const &size, i32 levels, gl::InternalFormat format);
 	void allocate3D(::ivec3 const &size, i32 levels, gl::InternalFormat format);
+	/*
+	 * Swaps texture_object_ for 2D storage holding levels `first_level` and down of a `full_size` texture with `levels`
+	 * levels, carrying the sampler state and every level both have over. Finer levels than before are left undefined.
+	 */
+	void reallocateResidentLevels(::ivec2 const &full_size, i32 levels, i32 first_level);
 	void uploadImage2D(void const *data, i32 level, ivec2 const &offset, ivec2 const &size, gl::PixelFormat format = gl::PixelFormat::Rgba, gl::PixelType type = gl::PixelType::Byte);
 	void setCompressedImage2D(void const *data, i32 level, ivec2 const &offset, ivec2 const &size, gl::PixelFormat format = gl::PixelFormat::Rgba, gl::sizei_t pixel_size = 0);
 
@@ -0,0 +1,220 @@
+﻿#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "graphics.hpp"
+#include "material.hpp"
+#include "texture.h"
+#include "engine/thread_pool.hpp"
+#include "glad/glad.h"
+
+TextureStreamer *TextureStreamer::singleton() {
+	static TextureStreamer instance;
+	return &instance;
+}
+
+u32 TextureStreamer::tailLevel(StagedTexture const &staged) {
+	for (u32 level = 0; level < staged.levels.size(); level++) {
+		ivec2 const size = staged.levels[level].size;
+		if (std::max(size.x, size.y) <= TEXTURE_STREAMING_TAIL_SIZE)
+			return level;
+	}
+	return static_cast<u32>(staged.levels.size() - 1);
+}
+
+bool TextureStreamer::streamable(StagedTexture const &staged) {
+#if TEXTURE_STREAMING
+	return !staged.generate_mipmaps && !staged.staging && !staged.levels.empty() && staged.levels.size() <= TEXTURE_STREAMING_MAX_LEVELS
+		&& tailLevel(staged) > 0;
+#else
+	static_cast<void>(staged);
+	return false;
+#endif
+}
+
+StagedTexture TextureStreamer::adopt(StagedTexture &&staged) {
+	assert(streamable(staged));
+	SharedPtr<Texture> const texture = std::move(staged.texture);
+	u32 const levels = static_cast<u32>(staged.levels.size());
+	u32 const tail = tailLevel(staged);
+
+	Array<u64, TEXTURE_STREAMING_MAX_LEVELS> level_bytes{};
+	for (u32 level = 0; level < levels; level++)
+		level_bytes[level] = staged.levels[level].size_bytes;
+	StreamingTextureId const id = scheduler_.add({ level_bytes.data(), levels }, tail);
+	if (id >= streamed_.size())
+		streamed_.resize(id + 1);
+
+	// The tail points into the source, which stays put until the texture is gone, and the tail keeps it alive until it's in.
+	texture->resident_level_ = static_cast<i32>(tail);
+	streamed_[id] = { .texture = texture, .source = std::move(staged) };
+	StagedTexture const &source = streamed_[id].source;
+	return {
+		.texture = texture,
+		.internal_format = source.internal_format,
+		.pixel_format = source.pixel_format,
+		.pixel_type = source.pixel_type,
+		.compressed = source.compressed,
+		.levels = Vec<StagedLevel>(source.levels.begin() + tail, source.levels.end()),
+		.pixels = source.pixels,
+		.streaming_id = id
+	};
+}
+
+void TextureStreamer::tailResident(StagedTexture const &tail) {
+	if (!disposed_)
+		tail.texture->streaming_id_ = tail.streaming_id;
+}
+
+void TextureStreamer::request(Texture &texture, f32 const screen_pixels) {
+	if (texture.streaming_id_ == INVALID_STREAMING_TEXTURE || disposed_)
+		return;
+	// The finest level the sampler would read at this size, one texel per pixel.
+	ivec2 const size = streamed_[texture.streaming_id_].source.levels.front().size;
+	f32 const texels = static_cast<f32>(std::max(size.x, size.y));
+	u32 const level = screen_pixels >= texels ? 0 : static_cast<u32>(std::log2(texels / std::max(screen_pixels, 1.0f)));
+	scheduler_.request(texture.streaming_id_, level, screen_pixels);
+}
+
+void TextureStreamer::request(Material const &material, f32 const screen_pixels) {
+	for (Texture *const texture : { material.diffuse_.get(), material.orm_.get(), material.normal_.get(), material.emissive_.get() }) {
+		if (texture)
+			request(*texture, screen_pixels);
+	}
+}
+
+void TextureStreamer::update() {
+	if (disposed_)
+		return;
+
+	for (StreamingTextureId id = 0; id < streamed_.size(); id++) {
+		Streamed &streamed = streamed_[id];
+		// Levels the scheduler asked for on an earlier frame, as soon as their copy is done.
+		if (streamed.stream_in && streamed.stream_in->copied.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			finishStreamIn(streamed);
+
+		// Textures go when their materials do, their levels stop counting against the budget.
+		if (streamed.source.levels.empty() || !streamed.texture.expired())
+			continue;
+		if (streamed.stream_in)
+			finishStreamIn(streamed);
+		scheduler_.remove(id);
+		streamed = {};
+	}
+
+	std::span<StreamingChange const> const changes = scheduler_.update(budget_bytes_, bytes_per_frame_);
+	for (StreamingChange const &change : changes)
+		startResidentLevel(streamed_[change.texture], change.resident_level);
+
+#if TEXTURE_STREAMING_PRINT_STATISTICS
+	if (!changes.empty()) {
+		TextureStreamingStatistics const &statistics = scheduler_.statistics();
+		printf("[textures] streamed %.2f MiB in %u levels, evicted %.2f MiB in %u levels, %u starved, %.2f of %.2f MiB resident\n",
+			static_cast<f64>(statistics.loaded_bytes) / (1 << 20), statistics.loads, static_cast<f64>(statistics.evicted_bytes) / (1 << 20),
+			statistics.evictions, statistics.starved, static_cast<f64>(statistics.resident_bytes) / (1 << 20), static_cast<f64>(budget_bytes_) / (1 << 20));
+	}
+#endif
+}
+
+void TextureStreamer::startResidentLevel(Streamed &streamed, u32 const level) {
+	// The scheduler changed its mind before the last one landed, which only happens when a texture swings within a frame or two.
+	if (streamed.stream_in)
+		finishStreamIn(streamed);
+
+	SharedPtr<Texture> const texture = streamed.texture.lock();
+	if (!texture)
+		return;
+	u32 const before = static_cast<u32>(texture->resident_level_);
+	if (level >= before) {
+		setResidentLevel(streamed, level, {});
+		return;
+	}
+
+	auto const stream_in = std::make_shared<StreamIn>();
+	stream_in->level = level;
+	Vec<StagedLevel> const levels(streamed.source.levels.begin() + level, streamed.source.levels.begin() + before);
+	stream_in->copied = ThreadPool::singleton()->addTaskToQueue([stream_in, levels, pixels = streamed.source.pixels] {
+		u64 bytes = 0;
+		for (StagedLevel const &layout : levels)
+			bytes += layout.size_bytes;
+		StagingAllocation const staging = StagingRing::singleton()->allocate(bytes);
+		u64 offset = 0;
+		for (StagedLevel const &layout : levels) {
+			std::span<char const> const source = pixels.subspan(layout.offset, layout.size_bytes);
+			if (staging)
+				std::memcpy(staging.data + offset, source.data(), source.size());
+			else
+				prefault(source);
+			offset += layout.size_bytes;
+		}
+		stream_in->staging = staging;
+	});
+	streamed.stream_in = stream_in;
+}
+
+void TextureStreamer::finishStreamIn(Streamed &streamed) {
+	SharedPtr<StreamIn> const stream_in = std::move(streamed.stream_in);
+	stream_in->copied.get();
+	setResidentLevel(streamed, stream_in->level, stream_in->staging);
+	StagingRing::singleton()->release(stream_in->staging);
+}
+
+void TextureStreamer::setResidentLevel(Streamed const &streamed, u32 const level, StagingAllocation const &staging) {
+	SharedPtr<Texture> const texture = streamed.texture.lock();
+	if (!texture)
+		return;
+	StagedTexture const &source = streamed.source;
+	u32 const before = static_cast<u32>(texture->resident_level_);
+	texture->reallocateResidentLevels(source.levels.front().size, static_cast<i32>(source.levels.size()), static_cast<i32>(level));
+	if (level < before)
+		uploadLevels(*texture, source, level, before, staging);
+}
+
+void TextureStreamer::uploadLevels(Texture &texture, StagedTexture const &source, u32 const first, u32 const last, StagingAllocation const &staging) {
+	// Same unpack state as TextureUploader::drain(), ring copies are read from the ring's buffer object.
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging ? StagingRing::singleton()->buffer() : 0);
+	u64 staged_offset = staging.offset;
+	for (u32 level = first; level < last; level++) {
+		StagedLevel const &layout = source.levels[level];
+		void const *pixels = staging
+			? reinterpret_cast<void const *>(static_cast<std::uintptr_t>(staged_offset))
+			: source.pixels.data() + layout.offset;
+		staged_offset += layout.size_bytes;
+		i32 const storage_level = static_cast<i32>(level) - texture.resident_level_;
+		if (source.compressed) {
+			glCompressedTextureSubImage2D(texture.texture_object_, storage_level, 0, 0, layout.size.x, layout.size.y,
+				static_cast<GLenum>(source.internal_format), static_cast<GLsizei>(layout.size_bytes), pixels);
+		}
+		else {
+			glTextureSubImage2D(texture.texture_object_, storage_level, 0, 0, layout.size.x, layout.size.y,
+				static_cast<GLenum>(source.pixel_format), static_cast<GLenum>(source.pixel_type), pixels);
+		}
+	}
+	if (staging)
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	gpu_check;
+}
+
+void TextureStreamer::dispose() {
+	// Workers may still be reading sources.
+	for (Streamed &streamed : streamed_) {
+		if (!streamed.stream_in)
+			continue;
+		streamed.stream_in->copied.get();
+		StagingRing::singleton()->release(streamed.stream_in->staging);
+	}
+	streamed_.clear();
+	scheduler_ = {};
+	disposed_ = true;
+}
+
+bool TextureStreamer::disposed() const {
+	return disposed_;
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include <future>
+
+#include "texture_streaming.hpp"
+#include "texture_upload.hpp"
+#include "types.hpp"
+#include "engine/disposable.hpp"
+
+class Material;
+class Texture;
+
+/* Stream material textures instead of uploading every level as it loads. */
+#define TEXTURE_STREAMING 1
+/* Bytes of streamed textures resident at once unless config.ini's Engine/Assets TextureStreamingBudgetBytes says otherwise. */
+#define TEXTURE_STREAMING_BUDGET_BYTES (512ull << 20)
+/* Bytes of levels streamed in per frame. */
+#define TEXTURE_STREAMING_BYTES_PER_FRAME (16ull << 20)
+/* Levels this size and smaller are the mip tail, resident for as long as the texture lives. */
+#define TEXTURE_STREAMING_TAIL_SIZE 64
+/* Print the scheduler's statistics every frame something changed. */
+#define TEXTURE_STREAMING_PRINT_STATISTICS 0
+
+/*
+ * Keeps the source of every streamed texture (the decoded pixels, the mapped DDS, the ktxTexture) and only what
+ * TextureStreamingScheduler decides on in GL. A streamed texture's storage starts at Texture::resident_level_ rather than
+ * level 0 and is reallocated whenever that changes, so evicted levels really give their memory back. Materials bind
+ * texture_object_ when they draw, they don't notice the swap; bindless handles of a streamed texture would go stale.
+ *
+ * Visible primitives request() their material's textures while the G-buffer pass draws, update() runs the scheduler
+ * once the frame is drawn and applies its changes. Evictions apply right away, levels being streamed in are copied into
+ * the StagingRing on the ThreadPool first and go up in the first update() after the copy is done, so reading the source
+ * (page faults on a mapped DDS included) never happens on the main thread.
+ */
+class TextureStreamer : IDisposable {
+public:
+	static TextureStreamer *singleton();
+
+	/* Whether adopt() takes `staged`: a chain finer than the tail that GL doesn't have to generate, not in the StagingRing. */
+	_NODISCARD static bool streamable(StagedTexture const &staged);
+	/* First level no larger than TEXTURE_STREAMING_TAIL_SIZE, or the last one. */
+	_NODISCARD static u32 tailLevel(StagedTexture const &staged);
+	/*
+	 * Main thread. Keeps `staged` around for streaming and returns its mip tail, which the caller queues like any other
+	 * upload, see streamable(). The texture isn't streamed until tailResident() says the tail is in.
+	 */
+	_NODISCARD StagedTexture adopt(StagedTexture &&staged);
+	/* Main thread, once every level of the tail adopt() returned is uploaded. */
+	void tailResident(StagedTexture const &tail);
+
+	/* Main thread. `texture` covers about `screen_pixels` across on screen this frame. Ignores textures that aren't streamed. */
+	void request(Texture &texture, f32 screen_pixels);
+	void request(Material const &material, f32 screen_pixels);
+	/* Main thread, once per frame after drawing. */
+	void update();
+
+	void setBudget(u64 const bytes) { budget_bytes_ = bytes; }
+	_NODISCARD u64 budget() const { return budget_bytes_; }
+	void setBytesPerFrame(u64 const bytes) { bytes_per_frame_ = bytes; }
+	_NODISCARD TextureStreamingScheduler const &scheduler() const { return scheduler_; }
+
+	void dispose() override;
+	[[nodiscard]] bool disposed() const override;
+
+private:
+	/* Levels a worker copies for a texture, finest first and back to back. */
+	struct StreamIn {
+		u32 level;					//< Resident level once it's applied.
+		StagingAllocation staging;	//< Empty when the ring was full, the levels were only faulted in.
+		_STD future<void> copied;
+	};
+
+	struct Streamed {
+		Weak<Texture> texture;
+		StagedTexture source;		//< `source.texture` is reset, the streamer doesn't keep textures alive.
+		SharedPtr<StreamIn> stream_in;	//< In flight, the worker reads `source` until it's done.
+	};
+
+	TextureStreamer() = default;
+
+	/* Moves `streamed` to `level`, right away when that evicts, through a StreamIn when it loads. */
+	void startResidentLevel(Streamed &streamed, u32 level);
+	/* Waits for `streamed`'s StreamIn if it hasn't finished, then applies it. */
+	void finishStreamIn(Streamed &streamed);
+	/* Reallocates `streamed`'s texture to start at `level` and uploads whatever it didn't have from `staging`, or the source when it's empty. */
+	void setResidentLevel(Streamed const &streamed, u32 level, StagingAllocation const &staging);
+	void uploadLevels(Texture &texture, StagedTexture const &source, u32 first, u32 last, StagingAllocation const &staging);
+
+	TextureStreamingScheduler scheduler_;
+	Vec<Streamed> streamed_;	//< Indexed by StreamingTextureId.
+	u64 budget_bytes_ = TEXTURE_STREAMING_BUDGET_BYTES;
+	u64 bytes_per_frame_ = TEXTURE_STREAMING_BYTES_PER_FRAME;
+	bool disposed_ = false;
+};
@@ -0,0 +1,335 @@
+﻿#include "texture_streaming.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#if BENCHMARKS_ENABLED
+#include <cstdio>
+#include <random>
+#include <string>
+#endif
+
+StreamingTextureId TextureStreamingScheduler::add(std::span<u64 const> const level_bytes, u32 const tail_level) {
+	assert(!level_bytes.empty() && level_bytes.size() <= TEXTURE_STREAMING_MAX_LEVELS);
+
+	StreamingTextureId id;
+	if (!free_ids_.empty()) {
+		id = free_ids_.back();
+		free_ids_.pop_back();
+	}
+	else {
+		id = static_cast<StreamingTextureId>(textures_.size());
+		textures_.emplace_back();
+	}
+
+	Record &record = textures_[id];
+	record = {};
+	record.levels = static_cast<u32>(level_bytes.size());
+	std::ranges::copy(level_bytes, record.level_bytes.begin());
+	record.tail = std::min(tail_level, record.levels - 1);
+	record.resident = record.tail;
+	record.resident_before = record.tail;
+	record.last_used = frame_;
+	record.live = true;
+	for (u32 level = record.resident; level < record.levels; level++)
+		resident_bytes_ += record.level_bytes[level];
+	return id;
+}
+
+void TextureStreamingScheduler::remove(StreamingTextureId const id) {
+	Record &record = textures_[id];
+	assert(record.live);
+	for (u32 level = record.resident; level < record.levels; level++)
+		resident_bytes_ -= record.level_bytes[level];
+	record.live = false;
+	free_ids_.push_back(id);
+}
+
+void TextureStreamingScheduler::request(StreamingTextureId const id, u32 const level, f32 const priority) {
+	Record &record = textures_[id];
+	assert(record.live);
+	u32 const wanted = std::min(level, record.tail);
+	if (!requestedThisFrame(record)) {
+		record.requested_frame = frame_;
+		record.wanted = wanted;
+		record.priority = priority;
+	}
+	else {
+		record.wanted = std::min(record.wanted, wanted);
+		record.priority = std::max(record.priority, priority);
+	}
+	record.last_used = frame_;
+}
+
+void TextureStreamingScheduler::evictLevel(StreamingTextureId const id) {
+	Record &record = textures_[id];
+	assert(record.resident < record.tail);
+	resident_bytes_ -= record.level_bytes[record.resident];
+	statistics_.evicted_bytes += record.level_bytes[record.resident];
+	statistics_.evictions++;
+	record.resident++;
+}
+
+std::span<StreamingChange const> TextureStreamingScheduler::update(u64 const budget_bytes, u64 const load_bytes) {
+	statistics_ = {};
+	changes_.clear();
+	candidates_.clear();
+	victims_.clear();
+
+	for (StreamingTextureId id = 0; id < textures_.size(); id++) {
+		Record &record = textures_[id];
+		if (!record.live)
+			continue;
+		record.resident_before = record.resident;
+		if (record.resident < record.tail)
+			victims_.push_back(id);
+		if (requestedThisFrame(record) && record.wanted < record.resident)
+			candidates_.push_back(id);
+	}
+
+	// Least valuable first: textures nobody asked for this frame, oldest request first, then the rest by priority.
+	std::ranges::sort(victims_, [this](StreamingTextureId const a, StreamingTextureId const b) {
+		Record const &ra = textures_[a];
+		Record const &rb = textures_[b];
+		bool const requested_a = requestedThisFrame(ra);
+		bool const requested_b = requestedThisFrame(rb);
+		if (requested_a != requested_b)
+			return !requested_a;
+		if (!requested_a)
+			return ra.last_used != rb.last_used ? ra.last_used < rb.last_used : a < b;
+		return ra.priority != rb.priority ? ra.priority < rb.priority : a < b;
+	});
+	std::ranges::sort(candidates_, [this](StreamingTextureId const a, StreamingTextureId const b) {
+		f32 const pa = textures_[a].priority;
+		f32 const pb = textures_[b].priority;
+		return pa != pb ? pa > pb : a < b;
+	});
+
+	// Evicts until `bytes` more fit the budget, from victims that may give way to a request of `priority`. Textures that run
+	// out of levels stay behind the cursor, nothing coming after them in the frame can take from them either.
+	std::size_t first_victim = 0;
+	auto const makeRoom = [&](u64 const bytes, f32 const priority, StreamingTextureId const requester) {
+		std::size_t i = first_victim;
+		while (resident_bytes_ + bytes > budget_bytes) {
+			while (i < victims_.size() && (victims_[i] == requester || textures_[victims_[i]].resident >= textures_[victims_[i]].tail))
+				i++;
+			if (i == victims_.size())
+				return false;
+			Record const &victim = textures_[victims_[i]];
+			if (requestedThisFrame(victim) && victim.priority >= priority)
+				return false;
+			evictLevel(victims_[i]);
+			while (first_victim < victims_.size() && textures_[victims_[first_victim]].resident >= textures_[victims_[first_victim]].tail)
+				first_victim++;
+		}
+		return true;
+	};
+
+	// The budget may have shrunk since the last frame.
+	static_cast<void>(makeRoom(0, std::numeric_limits<f32>::infinity(), INVALID_STREAMING_TEXTURE));
+
+	// One level per request per round, so the visible set sharpens together rather than one texture at a time.
+	bool progress = true;
+	while (progress) {
+		progress = false;
+		for (StreamingTextureId const id : candidates_) {
+			Record &record = textures_[id];
+			if (record.resident <= record.wanted)
+				continue;
+			u64 const bytes = record.level_bytes[record.resident - 1];
+			if (statistics_.loads != 0 && statistics_.loaded_bytes + bytes > load_bytes) {
+				progress = false;
+				break;
+			}
+			if (!makeRoom(bytes, record.priority, id)) {
+				// Gives up on this one for the frame, what it has stays.
+				record.wanted = record.resident;
+				statistics_.starved++;
+				continue;
+			}
+			record.resident--;
+			resident_bytes_ += bytes;
+			statistics_.loaded_bytes += bytes;
+			statistics_.loads++;
+			progress = true;
+		}
+	}
+
+	for (StreamingTextureId id = 0; id < textures_.size(); id++) {
+		Record const &record = textures_[id];
+		if (record.live && record.resident != record.resident_before)
+			changes_.push_back({ id, record.resident });
+	}
+	statistics_.resident_bytes = resident_bytes_;
+	frame_++;
+	return changes_;
+}
+
+#if BENCHMARKS_ENABLED
+
+/* Level sizes of a `size` x `size` texture with `bytes_per_texel` bytes per texel, finest first. */
+static Vec<u64> TextureStreaming_LevelBytes(u32 size, u32 const bytes_per_texel) {
+	Vec<u64> levels;
+	for (;;) {
+		levels.push_back(static_cast<u64>(size) * size * bytes_per_texel);
+		if (size == 1)
+			return levels;
+		size /= 2;
+	}
+}
+
+static u64 TextureStreaming_Bytes(std::span<u64 const> const levels, u32 const first) {
+	u64 bytes = 0;
+	for (std::size_t level = first; level < levels.size(); level++)
+		bytes += levels[level];
+	return bytes;
+}
+
+int benchmarkTextureStreaming(Vec<std::string_view> const &p_args) {
+	u32 const texture_count = !p_args.empty() ? static_cast<u32>(std::stoul(std::string(p_args[0]))) : 10000;
+	u32 const frame_count = p_args.size() > 1 ? static_cast<u32>(std::stoul(std::string(p_args[1]))) : 200;
+
+	u32 failures = 0;
+	auto const check = [&](bool const ok, char const *test, char const *what) {
+		if (!ok) {
+			printf("[bench] FAIL %-24s %s\n", test, what);
+			failures++;
+		}
+	};
+
+	// 256x256 RGBA8, the tail is 64x64 and down.
+	Vec<u64> const rgba256 = TextureStreaming_LevelBytes(256, 4);
+	u32 const tail = 2;
+	u64 const tail_bytes = TextureStreaming_Bytes(rgba256, tail);
+	u64 const full_bytes = TextureStreaming_Bytes(rgba256, 0);
+	u64 constexpr unlimited = ~0ull;
+
+	{
+		// Room for one full texture, both want it, the higher priority one gets it.
+		TextureStreamingScheduler scheduler;
+		StreamingTextureId const low = scheduler.add(rgba256, tail);
+		StreamingTextureId const high = scheduler.add(rgba256, tail);
+		u64 const budget = tail_bytes + full_bytes;
+		for (u32 frame = 0; frame < 4; frame++) {
+			scheduler.request(low, 0, 1.0f);
+			scheduler.request(high, 0, 10.0f);
+			static_cast<void>(scheduler.update(budget, unlimited));
+			check(scheduler.residentBytes() <= budget, "priority", "over budget");
+		}
+		check(scheduler.residentLevel(high) == 0, "priority", "the higher priority request isn't fully resident");
+		check(scheduler.residentLevel(low) == tail, "priority", "the lower priority request got levels there's no room for");
+		check(scheduler.statistics().starved == 1, "priority", "the lower priority request isn't counted as starved");
+	}
+	{
+		// Room for two full textures, three get asked for in turn, the one asked for longest ago goes.
+		TextureStreamingScheduler scheduler;
+		Array<StreamingTextureId, 3> ids;
+		for (StreamingTextureId &id : ids)
+			id = scheduler.add(rgba256, tail);
+		u64 const budget = 3 * tail_bytes + 2 * (full_bytes - tail_bytes);
+		for (StreamingTextureId const id : ids) {
+			scheduler.request(id, 0, 1.0f);
+			static_cast<void>(scheduler.update(budget, unlimited));
+			static_cast<void>(scheduler.update(budget, unlimited));
+		}
+		check(scheduler.residentLevel(ids[0]) == tail, "lru", "the least recently used texture kept its levels");
+		check(scheduler.residentLevel(ids[1]) == 0 && scheduler.residentLevel(ids[2]) == 0, "lru", "a recently used texture lost levels");
+		check(scheduler.residentBytes() == budget, "lru", "resident bytes don't add up");
+	}
+	{
+		// No budget at all, tails stay and nothing else comes in.
+		TextureStreamingScheduler scheduler;
+		StreamingTextureId const id = scheduler.add(rgba256, tail);
+		scheduler.request(id, 0, 1.0f);
+		std::span<StreamingChange const> const changes = scheduler.update(0, unlimited);
+		check(changes.empty() && scheduler.residentLevel(id) == tail, "tail", "a level past the tail was loaded or the tail evicted");
+		check(scheduler.residentBytes() == tail_bytes, "tail", "the tail isn't counted");
+	}
+	{
+		// A per-frame limit smaller than a level still lets one level through.
+		TextureStreamingScheduler scheduler;
+		StreamingTextureId const id = scheduler.add(rgba256, tail);
+		scheduler.request(id, 0, 1.0f);
+		static_cast<void>(scheduler.update(unlimited, 16));
+		check(scheduler.statistics().loads == 1 && scheduler.residentLevel(id) == tail - 1, "load limit", "didn't load exactly one level");
+		scheduler.request(id, 0, 1.0f);
+		static_cast<void>(scheduler.update(unlimited, 16));
+		check(scheduler.residentLevel(id) == 0, "load limit", "didn't continue the next frame");
+	}
+	{
+		// Unrequested textures keep their levels while there's room, and removing a texture gives its bytes back.
+		TextureStreamingScheduler scheduler;
+		StreamingTextureId const id = scheduler.add(rgba256, tail);
+		scheduler.request(id, 0, 1.0f);
+		static_cast<void>(scheduler.update(unlimited, unlimited));
+		static_cast<void>(scheduler.update(unlimited, unlimited));
+		check(scheduler.residentLevel(id) == 0, "idle", "an unrequested texture was evicted with room to spare");
+		scheduler.remove(id);
+		check(scheduler.residentBytes() == 0, "idle", "remove() didn't give the bytes back");
+		check(scheduler.add(rgba256, tail) == id, "idle", "ids aren't reused");
+	}
+
+	// Random frames: the budget and the limit hold, and the changes describe residency exactly.
+	std::mt19937 rng(0x5eed);
+	std::uniform_int_distribution<u32> size_log2(4, 12);
+	std::uniform_real_distribution<f32> unit(0.0f, 1.0f);
+	Vec<Vec<u64>> levels(texture_count);
+	Vec<u32> applied(texture_count);
+	TextureStreamingScheduler scheduler;
+	u64 full_total = 0;
+	u64 tail_total = 0;
+	for (u32 i = 0; i < texture_count; i++) {
+		levels[i] = TextureStreaming_LevelBytes(1u << size_log2(rng), 4);
+		u32 const texture_tail = levels[i].size() > 7 ? static_cast<u32>(levels[i].size()) - 7 : 0;
+		StreamingTextureId const id = scheduler.add(levels[i], texture_tail);
+		applied[id] = scheduler.residentLevel(id);
+		full_total += TextureStreaming_Bytes(levels[i], 0);
+		tail_total += TextureStreaming_Bytes(levels[i], texture_tail);
+	}
+	// Tight enough that most frames have to evict.
+	u64 const budget = tail_total + (full_total - tail_total) / 128;
+	u64 constexpr load_limit = 16ull << 20;
+
+	auto const requestFrame = [&] {
+		for (u32 i = 0; i < texture_count; i++) {
+			if (unit(rng) < 0.1f)
+				scheduler.request(i, static_cast<u32>(unit(rng) * static_cast<f32>(levels[i].size())), unit(rng));
+		}
+	};
+	u64 evicted_bytes = 0;
+	for (u32 frame = 0; frame < frame_count; frame++) {
+		requestFrame();
+		for (StreamingChange const &change : scheduler.update(budget, load_limit))
+			applied[change.texture] = change.resident_level;
+
+		TextureStreamingStatistics const &statistics = scheduler.statistics();
+		evicted_bytes += statistics.evicted_bytes;
+		check(scheduler.residentBytes() <= budget, "random", "over budget");
+		check(statistics.loaded_bytes <= load_limit || statistics.loads == 1, "random", "over the load limit");
+		u64 resident = 0;
+		for (u32 i = 0; i < texture_count; i++) {
+			if (applied[i] != scheduler.residentLevel(i) || applied[i] > scheduler.tailLevel(i)) {
+				check(false, "random", "changes don't match residency, or a tail was evicted");
+				break;
+			}
+			resident += TextureStreaming_Bytes(levels[i], applied[i]);
+		}
+		check(resident == scheduler.residentBytes(), "random", "resident bytes don't add up");
+		if (failures != 0)
+			break;
+	}
+	printf("[bench] %u textures, %.1f MiB of tails, %.1f MiB budget, %.1f MiB resident and %.1f MiB evicted after %u frames\n", texture_count,
+		static_cast<f64>(tail_total) / (1 << 20), static_cast<f64>(budget) / (1 << 20), static_cast<f64>(scheduler.residentBytes()) / (1 << 20),
+		static_cast<f64>(evicted_bytes) / (1 << 20), frame_count);
+
+	bench::measure("TextureStreamingScheduler update", 100, [&] {
+		requestFrame();
+		static_cast<void>(scheduler.update(budget, load_limit));
+	});
+
+	printf("[bench] texture streaming, %u failures\n", failures);
+	return failures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <span>
+
+#include "types.hpp"
+#include "engine/benchmark.hpp"
+
+/* Most levels a streamed texture can have, enough for 32768x32768. */
+#define TEXTURE_STREAMING_MAX_LEVELS 16
+
+using StreamingTextureId = u32;
+constexpr StreamingTextureId INVALID_STREAMING_TEXTURE = ~0u;
+
+/* The finest level of `texture` that should be resident once the change is applied, coarser than before for an eviction. */
+struct StreamingChange {
+	StreamingTextureId texture;
+	u32 resident_level;
+};
+
+struct TextureStreamingStatistics {
+	u64 resident_bytes = 0;		//< After the last update().
+	u64 loaded_bytes = 0;		//< By the last update().
+	u64 evicted_bytes = 0;
+	u32 loads = 0;				//< Levels.
+	u32 evictions = 0;			//< Levels.
+	u32 starved = 0;			//< Requests the last update() couldn't make room for.
+};
+
+/*
+ * Decides which mip levels of which textures are resident, without touching GL, so all of it can run (and be checked)
+ * without a context. Every texture keeps its mip tail, the levels from `tail_level` down, resident for as long as it's
+ * registered. Finer levels come and go, always as a contiguous range from the tail up to the finest resident level.
+ *
+ * Once per frame, request() says how fine each visible texture should be and how much it matters, and update() turns that
+ * into changes: requests are served one level at a time in priority order within a per-frame byte limit, making room under
+ * the budget by evicting levels, finest first, from the least recently requested textures. Textures requested this frame
+ * only give up levels to requests with a higher priority.
+ */
+class TextureStreamingScheduler {
+public:
+	/* `level_bytes` is the size of every level, finest first. Returns an id that stays valid until remove(). */
+	_NODISCARD StreamingTextureId add(_STD span<u64 const> level_bytes, u32 tail_level);
+	void remove(StreamingTextureId id);
+
+	/* This frame wants `level` or finer resident for `id`. Repeated requests keep the finest level and the highest priority. */
+	void request(StreamingTextureId id, u32 level, f32 priority);
+	/*
+	 * Ends the frame. Keeps resident bytes under `budget_bytes` (tails excepted, they never go) and loads at most
+	 * `load_bytes` worth of levels, or one level if even the smallest wanted one is larger. The caller applies the
+	 * returned changes before the next update(), residency here already reflects them.
+	 */
+	_NODISCARD _STD span<StreamingChange const> update(u64 budget_bytes, u64 load_bytes);
+
+	_NODISCARD u32 residentLevel(StreamingTextureId const id) const { return textures_[id].resident; }
+	_NODISCARD u32 tailLevel(StreamingTextureId const id) const { return textures_[id].tail; }
+	_NODISCARD u64 residentBytes() const { return resident_bytes_; }
+	_NODISCARD u64 frame() const { return frame_; }
+	_NODISCARD TextureStreamingStatistics const &statistics() const { return statistics_; }
+
+private:
+	struct Record {
+		Array<u64, TEXTURE_STREAMING_MAX_LEVELS> level_bytes{};
+		u32 levels = 0;
+		u32 tail = 0;				//< First level of the mip tail.
+		u32 resident = 0;			//< Finest resident level, levels resident..levels-1 are in.
+		u32 resident_before = 0;	//< `resident` when update() started, to tell what changed.
+		u32 wanted = 0;				//< Only meaningful when requested_frame == frame_.
+		f32 priority = 0.0f;		//< Same.
+		u64 requested_frame = ~0ull;
+		u64 last_used = 0;			//< Frame of the last request, what eviction goes by.
+		bool live = false;
+	};
+
+	_NODISCARD bool requestedThisFrame(Record const &record) const { return record.requested_frame == frame_; }
+	/* Drops `id`'s finest resident level. */
+	void evictLevel(StreamingTextureId id);
+
+	Vec<Record> textures_;		//< Indexed by StreamingTextureId.
+	Vec<StreamingTextureId> free_ids_;
+	// Scratch for update().
+	Vec<StreamingTextureId> candidates_;
+	Vec<StreamingTextureId> victims_;
+	Vec<StreamingChange> changes_;
+	u64 resident_bytes_ = 0;
+	u64 frame_ = 1;
+	TextureStreamingStatistics statistics_;
+};
+
+#if BENCHMARKS_ENABLED
+/*
+ * `--bench texture-streaming [textures] [frames]`, checks TextureStreamingScheduler on scripted cases (requests served
+ * by priority, eviction by least recent use, tails kept, the byte limits kept) and on random frames over `textures`
+ * textures, then times update() on them. Exits with 1 if anything breaks.
+ */
+extern int benchmarkTextureStreaming(Vec<_STD string_view> const &p_args);
+#endif
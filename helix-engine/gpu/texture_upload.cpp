@@ -0,0 +1,231 @@
+﻿#include "texture_upload.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "graphics.hpp"
+#include "texture.h"
+#include "texture_streamer.hpp"
+#include "glad/glad.h"
+
+static u64 TextureUploader_Bytes(StagedTexture const &staged) {
+	u64 bytes = 0;
+	for (StagedLevel const &level : staged.levels)
+		bytes += level.size_bytes;
+	return bytes;
+}
+
+TextureUploader *TextureUploader::singleton() {
+	static TextureUploader instance;
+	return &instance;
+}
+
+void TextureUploader::enqueue(StagedTexture &&staged) {
+	assert(!staged.levels.empty());
+	queued_bytes_ += TextureUploader_Bytes(staged);
+
+	std::lock_guard lock(incoming_mutex_);
+	incoming_.push_back(std::move(staged));
+}
+
+void buildMipChain(StagedTexture &staged, u32 const channels) {
+	assert(staged.levels.size() == 1 && !staged.compressed && staged.pixel_type == gl::PixelType::UnsignedByte);
+	ivec2 size = staged.levels.front().size;
+	u64 total = staged.levels.front().size_bytes;
+	while (size.x > 1 || size.y > 1) {
+		size = glm::max(size / 2, ivec2(1));
+		u64 const bytes = static_cast<u64>(size.x) * size.y * channels;
+		staged.levels.push_back({ size, total, bytes });
+		total += bytes;
+	}
+	staged.storage.resize(total);
+
+	for (std::size_t i = 1; i < staged.levels.size(); i++) {
+		StagedLevel const &source = staged.levels[i - 1];
+		StagedLevel const &destination = staged.levels[i];
+		u8 const *src = reinterpret_cast<u8 const *>(staged.storage.data() + source.offset);
+		u8 *dst = reinterpret_cast<u8 *>(staged.storage.data() + destination.offset);
+		std::size_t const src_row = static_cast<std::size_t>(source.size.x) * channels;
+
+		for (i32 y = 0; y < destination.size.y; y++) {
+			u8 const *row0 = src + std::min(2 * y, source.size.y - 1) * src_row;
+			u8 const *row1 = src + std::min(2 * y + 1, source.size.y - 1) * src_row;
+			for (i32 x = 0; x < destination.size.x; x++) {
+				std::size_t const x0 = static_cast<std::size_t>(std::min(2 * x, source.size.x - 1)) * channels;
+				std::size_t const x1 = static_cast<std::size_t>(std::min(2 * x + 1, source.size.x - 1)) * channels;
+				for (u32 c = 0; c < channels; c++)
+					*dst++ = static_cast<u8>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+	staged.pixels = { staged.storage.data(), staged.storage.size() };
+}
+
+void stageInRing(StagedTexture &staged) {
+	// Streamed textures read from their source for as long as they live, the ring only holds things for a few frames.
+	if (TextureStreamer::streamable(staged)) {
+		for (u32 level = TextureStreamer::tailLevel(staged); level < staged.levels.size(); level++)
+			prefault(staged.pixels.subspan(staged.levels[level].offset, staged.levels[level].size_bytes));
+		return;
+	}
+	StagingAllocation const allocation = StagingRing::singleton()->allocate(staged.pixels.size());
+	if (!allocation)
+		return;
+	std::memcpy(allocation.data, staged.pixels.data(), staged.pixels.size());
+	staged.staging = allocation;
+	staged.pixels = { allocation.data, allocation.size };
+	staged.storage = {};
+	staged.keep_alive.reset();
+}
+
+void prefault(std::span<char const> const bytes) {
+	char touched = 0;
+	for (std::size_t i = 0; i < bytes.size(); i += 4096)
+		touched ^= *static_cast<char const volatile *>(&bytes[i]);
+	static_cast<void>(touched);
+}
+
+bool TextureUploader::later(Pending const &a, Pending const &b) {
+	u64 const a_bytes = a.nextLevelBytes();
+	u64 const b_bytes = b.nextLevelBytes();
+	return a_bytes != b_bytes ? a_bytes > b_bytes : a.sequence > b.sequence;
+}
+
+void TextureUploader::drain() {
+	drain(budget_bytes_);
+}
+
+void TextureUploader::finish() {
+	while (queuedBytes() != 0)
+		drain(~0ull);
+}
+
+void TextureUploader::drain(u64 const budget_bytes) {
+	using clock = std::chrono::steady_clock;
+	clock::time_point const start = clock::now();
+	statistics_ = {};
+
+	Vec<StagedTexture> arrived;
+	{
+		std::lock_guard lock(incoming_mutex_);
+		arrived.swap(incoming_);
+	}
+
+	// Storage costs no bandwidth, every texture gets it the frame it arrives.
+	for (StagedTexture &staged : arrived) {
+		if (TextureStreamer::streamable(staged)) {
+			// Only its mip tail is queued, TextureStreamer brings in the rest as it gets seen.
+			u64 const full_bytes = TextureUploader_Bytes(staged);
+			staged = TextureStreamer::singleton()->adopt(std::move(staged));
+			queued_bytes_ -= full_bytes - TextureUploader_Bytes(staged);
+		}
+		ivec2 const size = staged.levels.front().size;
+		i32 const levels = staged.generate_mipmaps ? std::bit_width(static_cast<u32>(std::max(size.x, size.y))) : static_cast<i32>(staged.levels.size());
+		staged.texture->allocate(size, levels, staged.internal_format);
+		glTextureParameteri(staged.texture->texture_object_, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		glTextureParameteri(staged.texture->texture_object_, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(staged.levels.size() - 1));
+		gpu_check;
+
+		u32 const remaining = static_cast<u32>(staged.levels.size());
+		pending_.push_back({ .staged = std::move(staged), .remaining = remaining, .sequence = sequence_++ });
+		std::ranges::push_heap(pending_, later);
+	}
+
+	StagingRing *const ring = StagingRing::singleton();
+	if (!pending_.empty()) {
+		// Rows of odd sized RGB levels aren't 4 byte aligned.
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		u32 bound_unpack_buffer = 0;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		while (!pending_.empty()) {
+			if (statistics_.levels_uploaded != 0 && statistics_.uploaded_bytes + pending_.front().nextLevelBytes() > budget_bytes)
+				break;
+
+			std::ranges::pop_heap(pending_, later);
+			Pending &pending = pending_.back();
+			StagedTexture const &staged = pending.staged;
+			u32 const object = staged.texture->texture_object_;
+			i32 const level = static_cast<i32>(--pending.remaining);
+			StagedLevel const &layout = staged.levels[level];
+
+			// Ring staged levels are read from the ring's buffer object, with an offset where the pointer would be.
+			u32 const unpack_buffer = staged.staging ? ring->buffer() : 0;
+			if (unpack_buffer != bound_unpack_buffer) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpack_buffer);
+				bound_unpack_buffer = unpack_buffer;
+			}
+			void const *pixels = staged.staging
+				? reinterpret_cast<void const *>(static_cast<std::uintptr_t>(staged.staging.offset + layout.offset))
+				: staged.pixels.data() + layout.offset;
+
+			if (staged.compressed) {
+				glCompressedTextureSubImage2D(object, level, 0, 0, layout.size.x, layout.size.y,
+					static_cast<GLenum>(staged.internal_format), static_cast<GLsizei>(layout.size_bytes), pixels);
+			}
+			else {
+				glTextureSubImage2D(object, level, 0, 0, layout.size.x, layout.size.y,
+					static_cast<GLenum>(staged.pixel_format), static_cast<GLenum>(staged.pixel_type), pixels);
+			}
+			// Levels base..max are all in now, sampling goes from blurry to sharp as they arrive.
+			glTextureParameteri(object, GL_TEXTURE_BASE_LEVEL, level);
+			gpu_check;
+
+			statistics_.uploaded_bytes += layout.size_bytes;
+			statistics_.levels_uploaded++;
+			queued_bytes_ -= layout.size_bytes;
+
+			if (pending.remaining == 0) {
+				if (staged.generate_mipmaps)
+					staged.texture->generateMipmap();
+				if (staged.streaming_id != INVALID_STREAMING_TEXTURE)
+					TextureStreamer::singleton()->tailResident(staged);
+				ring->release(staged.staging);
+				statistics_.textures_completed++;
+				pending_.pop_back();
+			}
+			else {
+				std::ranges::push_heap(pending_, later);
+			}
+		}
+
+		if (bound_unpack_buffer != 0)
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	// Every frame, fences from earlier frames signal whether or not anything was uploaded in this one.
+	ring->retire();
+
+	statistics_.queued_bytes = queuedBytes();
+	statistics_.stall_ms = std::chrono::duration<f64, std::milli>(clock::now() - start).count();
+
+#if TEXTURE_UPLOAD_PRINT_STATISTICS
+	if (statistics_.levels_uploaded != 0) {
+		printf("[textures] %.2f MiB in %u levels (%u textures done) in %.3f ms, %.2f MiB queued\n",
+			static_cast<f64>(statistics_.uploaded_bytes) / (1 << 20), statistics_.levels_uploaded, statistics_.textures_completed,
+			statistics_.stall_ms, static_cast<f64>(statistics_.queued_bytes) / (1 << 20));
+	}
+#endif
+}
+
+void TextureUploader::dispose() {
+	{
+		std::lock_guard lock(incoming_mutex_);
+		for (StagedTexture const &staged : incoming_)
+			StagingRing::singleton()->release(staged.staging);
+		incoming_.clear();
+	}
+	for (Pending const &pending : pending_)
+		StagingRing::singleton()->release(pending.staged.staging);
+	pending_.clear();
+	queued_bytes_ = 0;
+	disposed_ = true;
+}
+
+bool TextureUploader::disposed() const {
+	return disposed_;
+}
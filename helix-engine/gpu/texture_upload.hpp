@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <span>
+
+#include "math.hpp"
+#include "opengl_enums2.hpp"
+#include "staging_ring.hpp"
+#include "texture_streaming.hpp"
+#include "types.hpp"
+#include "engine/disposable.hpp"
+
+class Texture;
+
+/* Bytes handed to GL per drain() unless config.ini's Engine/Assets TextureUploadBytesPerFrame says otherwise. */
+#define TEXTURE_UPLOAD_BYTES_PER_FRAME (8ull << 20)
+/* Print TextureUploader::statistics() every frame something was uploaded. */
+#define TEXTURE_UPLOAD_PRINT_STATISTICS 0
+
+/* One mip level of a StagedTexture. */
+struct StagedLevel {
+	ivec2 size;
+	u64 offset;		//< Bytes, into StagedTexture::pixels.
+	u64 size_bytes;
+};
+
+/*
+ * A 2D texture a worker has already decoded, waiting for the main thread. `pixels` is owned by `storage`
+ * when the decoder produced it and by `keep_alive` when it points into something else (a mapped DdsImage, a ktxTexture),
+ * by `staging` once stageInRing() moved it into the StagingRing, or by TextureStreamer for the mip tail adopt() returns.
+ */
+struct StagedTexture {
+	SharedPtr<Texture> texture;
+	gl::InternalFormat internal_format = gl::InternalFormat::Rgba8;
+	gl::PixelFormat pixel_format = gl::PixelFormat::Rgba;	//< Ignored for compressed formats.
+	gl::PixelType pixel_type = gl::PixelType::UnsignedByte;	//< Ignored for compressed formats.
+	bool compressed = false;
+	bool generate_mipmaps = false;	//< Only level 0 is staged, storage gets a full chain that GL fills in once it's uploaded.
+	Vec<StagedLevel> levels;		//< Level i is levels[i], finest first.
+	_STD span<char const> pixels;
+	Vec<char> storage;
+	SharedPtr<void> keep_alive;
+	StagingAllocation staging;		//< Uploads read from the ring's buffer object instead of `pixels` when set.
+	StreamingTextureId streaming_id = INVALID_STREAMING_TEXTURE;	//< Set on the mip tail TextureStreamer::adopt() returns.
+};
+
+/*
+ * Box filters level 0 of `staged` (tightly packed, 8 bits per channel, the only level) down to 1x1 into `storage`,
+ * and points `pixels` at it. Every texel averages a 2x2 block, odd sized levels leave their last row or column out.
+ * Meant for worker threads.
+ */
+extern void buildMipChain(StagedTexture &staged, u32 channels);
+
+/*
+ * Copies `pixels` into the StagingRing, points `pixels` at the copy and lets go of `storage` and `keep_alive`.
+ * Leaves `staged` as it is when the ring has no room, the upload then reads from client memory like before,
+ * and when TextureStreamer will stream it, its source has to outlive the ring's few frames. Only its mip tail is faulted in then.
+ * Meant for worker threads, the last thing before enqueue().
+ */
+extern void stageInRing(StagedTexture &staged);
+
+/* Reads a byte from every page of `bytes`, so a mapped file is in memory before the main thread reads it. Meant for worker threads. */
+extern void prefault(_STD span<char const> bytes);
+
+struct TextureUploadStatistics {
+	u64 queued_bytes = 0;		//< Staged but not uploaded yet, when the last drain() returned.
+	u64 uploaded_bytes = 0;		//< Handed to GL by the last drain().
+	f64 stall_ms = 0.0;			//< Main thread time the last drain() took.
+	u32 levels_uploaded = 0;
+	u32 textures_completed = 0;
+};
+
+/*
+ * Moves texture uploads off whatever code loads them and onto one place in the frame. Loaders decode on worker threads and
+ * enqueue() the result, the main thread drain()s up to the byte budget once per frame. Storage is allocated as soon as a
+ * texture arrives, levels go up smallest first across every queued texture, and each texture's base level follows its
+ * finest uploaded level, so everything is sampleable at low resolution long before the big levels are in.
+ */
+class TextureUploader : IDisposable {
+public:
+	static TextureUploader *singleton();
+
+	/* Any thread. */
+	void enqueue(StagedTexture &&staged);
+	/* Main thread, once per frame. Always uploads at least one level, so a level larger than the budget still gets through. */
+	void drain();
+	/* Main thread, drains until nothing is queued, ignoring the budget. */
+	void finish();
+
+	void setBudget(u64 const bytes_per_frame) { budget_bytes_ = bytes_per_frame; }
+	_NODISCARD u64 budget() const { return budget_bytes_; }
+	_NODISCARD TextureUploadStatistics const &statistics() const { return statistics_; }
+	_NODISCARD u64 queuedBytes() const { return queued_bytes_.load(_STD memory_order_relaxed); }
+
+	void dispose() override;
+	[[nodiscard]] bool disposed() const override;
+
+private:
+	struct Pending {
+		StagedTexture staged;
+		u32 remaining;	//< Levels not uploaded yet, the next one is remaining - 1.
+		u64 sequence;	//< Arrival order, breaks ties between levels of the same size.
+
+		_NODISCARD u64 nextLevelBytes() const { return staged.levels[remaining - 1].size_bytes; }
+	};
+
+	TextureUploader() = default;
+
+	void drain(u64 budget_bytes);
+	/* Pending textures are a min-heap on their next level's size. */
+	static bool later(Pending const &a, Pending const &b);
+
+	std::mutex incoming_mutex_;
+	Vec<StagedTexture> incoming_;
+	Vec<Pending> pending_;
+	std::atomic<u64> queued_bytes_ = 0;
+	u64 sequence_ = 0;
+	u64 budget_bytes_ = TEXTURE_UPLOAD_BYTES_PER_FRAME;
+	TextureUploadStatistics statistics_;
+	bool disposed_ = false;
+};
@@ -0,0 +1,162 @@
+﻿#include "vertex_packing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+	u16 quantizeUnorm16(f32 const value) {
+		return static_cast<u16>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	i16 quantizeSnorm16(f32 const value) {
+		return static_cast<i16>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	f32 signNotZero(f32 const value) {
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+}
+
+vec2 octEncode(vec3 const &n) {
+	f32 const l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (l1 <= 0.0f)
+		return vec2(0.0f);
+	vec2 e = vec2(n.x, n.y) / l1;
+	if (n.z < 0.0f)
+		e = vec2((1.0f - std::abs(e.y)) * signNotZero(e.x), (1.0f - std::abs(e.x)) * signNotZero(e.y));
+	return e;
+}
+
+vec3 octDecode(vec2 const &e) {
+	vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	f32 const t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+void packVertices(std::span<Vertex const> const vertices, AABB const &bounds, PackedVertex *destination) {
+	PositionDequantization const dequantization = PositionDequantization::fromBounds(bounds);
+	// A flat axis has nothing to quantize, every position lands on 0.
+	vec3 const inverse_scale(
+		dequantization.scale.x > 0.0f ? 1.0f / dequantization.scale.x : 0.0f,
+		dequantization.scale.y > 0.0f ? 1.0f / dequantization.scale.y : 0.0f,
+		dequantization.scale.z > 0.0f ? 1.0f / dequantization.scale.z : 0.0f);
+
+	for (std::size_t i = 0; i < vertices.size(); i++) {
+		Vertex const &vertex = vertices[i];
+		PackedVertex &packed = destination[i];
+
+		vec3 const unorm = (vertex.position - dequantization.offset) * inverse_scale;
+		packed.position[0] = quantizeUnorm16(unorm.x);
+		packed.position[1] = quantizeUnorm16(unorm.y);
+		packed.position[2] = quantizeUnorm16(unorm.z);
+		packed.position[3] = vertex.tangent.w < 0.0f ? 0 : 65535;
+
+		vec2 const normal = octEncode(vertex.normal);
+		packed.normal[0] = quantizeSnorm16(normal.x);
+		packed.normal[1] = quantizeSnorm16(normal.y);
+
+		vec2 const tangent = octEncode(vec3(vertex.tangent));
+		packed.tangent[0] = quantizeSnorm16(tangent.x);
+		packed.tangent[1] = quantizeSnorm16(tangent.y);
+
+		packed.texcoord0[0] = glm::packHalf1x16(vertex.texcoord0.x);
+		packed.texcoord0[1] = glm::packHalf1x16(vertex.texcoord0.y);
+		packed.texcoord1[0] = glm::packHalf1x16(vertex.texcoord1.x);
+		packed.texcoord1[1] = glm::packHalf1x16(vertex.texcoord1.y);
+	}
+}
+
+Vertex unpackVertex(PackedVertex const &packed, PositionDequantization const &dequantization) {
+	Vertex vertex{};
+	vertex.position = dequantization.offset + vec3(packed.position[0], packed.position[1], packed.position[2]) / 65535.0f * dequantization.scale;
+	// GL maps snorm16 with max(c / 32767, -1), same as here.
+	vertex.normal = octDecode(glm::max(vec2(packed.normal[0], packed.normal[1]) / 32767.0f, vec2(-1.0f)));
+	vertex.tangent = vec4(octDecode(glm::max(vec2(packed.tangent[0], packed.tangent[1]) / 32767.0f, vec2(-1.0f))), packed.position[3] != 0 ? 1.0f : -1.0f);
+	vertex.texcoord0 = vec2(glm::unpackHalf1x16(packed.texcoord0[0]), glm::unpackHalf1x16(packed.texcoord0[1]));
+	vertex.texcoord1 = vec2(glm::unpackHalf1x16(packed.texcoord1[0]), glm::unpackHalf1x16(packed.texcoord1[1]));
+	return vertex;
+}
+
+#if BENCHMARKS_ENABLED
+
+#include <string>
+
+#include "util.hpp"
+
+int benchmarkVertexPacking(Vec<std::string_view> const &p_args) {
+	std::string const file_path = bench::argument(p_args, 0, bench::DEFAULT_SCENE);
+	u32 const iterations = bench::numberArgument(p_args, 1, 3);
+
+	Optional<gltf::data> const scene = bench::loadScene(file_path);
+	if (!scene)
+		return -1;
+	gltf::data const &data = *scene;
+
+	Vec<InterleavedPrimitive> primitives;
+	u64 vertex_count = 0;
+	for (gltf::mesh const &mesh : data.meshes) {
+		for (gltf::primitive const &primitive : mesh.primitives) {
+			if (primitive.mode != gltf::primitive_mode::triangles)
+				continue;
+			InterleavedPrimitive &interleaved = primitives.emplace_back(interleavePrimitive(data, primitive));
+			if (!interleaved.vertices.empty())
+				interleaved.aabb = computePositionBounds(&interleaved.vertices.front().position, interleaved.vertices.size(), sizeof(Vertex));
+			vertex_count += interleaved.vertices.size();
+		}
+	}
+
+	Vec<Vec<PackedVertex>> packed(primitives.size());
+	for (std::size_t i = 0; i < primitives.size(); i++)
+		packed[i].resize(primitives[i].vertices.size());
+	bench::measure("packVertices", iterations, [&] {
+		for (std::size_t i = 0; i < primitives.size(); i++)
+			packVertices(primitives[i].vertices, primitives[i].aabb, packed[i].data());
+	});
+
+	f64 const float_mib = static_cast<f64>(vertex_count * sizeof(Vertex)) / (1024.0 * 1024.0);
+	f64 const packed_mib = static_cast<f64>(vertex_count * sizeof(PackedVertex)) / (1024.0 * 1024.0);
+	printf("[bench] %llu vertices, %.2f MiB as Vertex, %.2f MiB packed, %.1f%% less memory and vertex fetch bandwidth\n",
+		static_cast<unsigned long long>(vertex_count), float_mib, packed_mib, 100.0 * (1.0 - packed_mib / float_mib));
+
+	// Worst case errors. Positions are relative to the primitive's extent, the unit vectors in degrees.
+	f32 worst_position = 0.0f;
+	f32 worst_normal = 0.0f;
+	f32 worst_tangent = 0.0f;
+	f32 worst_texcoord = 0.0f;
+	u64 sign_flips = 0;
+	auto const degreesBetween = [](vec3 const &a, vec3 const &b) {
+		f32 const la = glm::length(a), lb = glm::length(b);
+		if (la <= 0.0f || lb <= 0.0f)
+			return 0.0f;
+		return glm::degrees(std::acos(std::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f)));
+	};
+	for (std::size_t i = 0; i < primitives.size(); i++) {
+		InterleavedPrimitive const &primitive = primitives[i];
+		PositionDequantization const dequantization = PositionDequantization::fromBounds(primitive.aabb);
+		f32 const extent = std::max({ dequantization.scale.x, dequantization.scale.y, dequantization.scale.z, 1e-12f });
+		for (std::size_t v = 0; v < primitive.vertices.size(); v++) {
+			Vertex const &reference = primitive.vertices[v];
+			Vertex const decoded = unpackVertex(packed[i][v], dequantization);
+			vec3 const d = glm::abs(decoded.position - reference.position);
+			worst_position = std::max(worst_position, std::max({ d.x, d.y, d.z }) / extent);
+			worst_normal = std::max(worst_normal, degreesBetween(decoded.normal, reference.normal));
+			worst_tangent = std::max(worst_tangent, degreesBetween(vec3(decoded.tangent), vec3(reference.tangent)));
+			// Half floats keep 11 significant bits, compare against the magnitude of the value.
+			vec2 const uv = glm::abs(decoded.texcoord0 - reference.texcoord0) / glm::max(glm::abs(reference.texcoord0), vec2(1.0f));
+			worst_texcoord = std::max({ worst_texcoord, uv.x, uv.y });
+			sign_flips += (decoded.tangent.w < 0.0f) != (reference.tangent.w < 0.0f) ? 1 : 0;
+		}
+	}
+	printf("[bench] worst error: position %.2e of extent, normal %.4f deg, tangent %.4f deg, uv0 %.2e relative, %llu tangent sign flip(s)\n",
+		worst_position, worst_normal, worst_tangent, worst_texcoord, static_cast<unsigned long long>(sign_flips));
+
+	// Half a unorm16 step, a bit over what octahedral snorm16 can miss by, and half a half float ulp.
+	bool const within = worst_position <= 0.5f / 65535.0f + 1e-6f && worst_normal <= 0.01f && worst_tangent <= 0.01f
+		&& worst_texcoord <= 1.0f / 2048.0f && sign_flips == 0;
+	return within ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <span>
+
+#include "types.hpp"
+#include "geometry.hpp"
+#include "mesh.hpp"
+#include "engine/benchmark.hpp"
+
+//
+// Quantized vertices for static meshes. Everything here has a GLSL twin in shaders/vertex_packing.glsl,
+// keep the two in step.
+//
+
+/* Explicit uniform locations used by vertex_packing.glsl: packed flag, position offset, position scale. */
+constexpr i32 VERTEX_PACKING_UNIFORM_LOCATION = 40;
+
+/*
+ * 24 bytes against Vertex's 64. Positions are 16 bit fractions of the primitive's bounds, normals and tangents
+ * are octahedral in two snorm16 each, UVs are half floats.
+ */
+struct PackedVertex {
+	u16 position[4];	//< xyz unorm16 over the primitive's bounds, w holds the tangent's sign (0 is -1, 65535 is +1).
+	i16 normal[2];		//< Octahedral, snorm16.
+	i16 tangent[2];		//< Octahedral, snorm16.
+	u16 texcoord0[2];	//< Half floats.
+	u16 texcoord1[2];	//< Half floats.
+};
+
+static_assert(sizeof(PackedVertex) == 24);
+
+/* Maps a packed position back to object space, `position = offset + unorm * scale`. */
+struct PositionDequantization {
+	vec3 offset;
+	vec3 scale;
+
+	static PositionDequantization fromBounds(AABB const &bounds) { return { bounds.center - bounds.extents, bounds.extents * 2.0f }; }
+};
+
+/* Octahedral mapping of a unit vector onto [-1, 1]^2 (Cigolle et al., "A Survey of Efficient Representations for Independent Unit Vectors"). */
+_NODISCARD extern vec2 octEncode(vec3 const &n);
+_NODISCARD extern vec3 octDecode(vec2 const &e);
+
+/* Packs `vertices` against `bounds`, which must contain every position. */
+extern void packVertices(_STD span<Vertex const> vertices, AABB const &bounds, PackedVertex *destination);
+
+/* What the vertex shader reconstructs, for checking precision on the CPU. */
+_NODISCARD extern Vertex unpackVertex(PackedVertex const &packed, PositionDequantization const &dequantization);
+
+#if BENCHMARKS_ENABLED
+/*
+ * `--bench vertex-packing [file] [iterations]`, packing throughput and the worst position, normal, tangent and UV
+ * error against the float path over every primitive. Exits with 1 if any of them is beyond what the encoding allows.
+ */
+extern int benchmarkVertexPacking(Vec<_STD string_view> const &p_args);
+#endif
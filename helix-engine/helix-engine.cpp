@@ -44,6 +44,7 @@
 #include "gpu/placeholders.hpp"
 #include "gpu/png.hpp"
 #include "gpu/render_server.h"
+#include "gpu/staging_ring.hpp"
 #include "gpu/texture.h"
 #include "gpu/voxelizer.hpp"
 
@@ -322,7 +323,7 @@ int main(
 		ImGui_ImplOpenGL3_Init();
 
 		LightingSystem::singleton(); //< Allocation
-		AsyncTextureBank::singleton(); // LET IT ALLOCATE ON MAIN THREAD
+		StagingRing::singleton(); // LET IT ALLOCATE ON MAIN THREAD
 		
 		auto tree = _STD make_shared<SceneTree>(windowPtr);
 
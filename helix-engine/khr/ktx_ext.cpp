@@ -871,4 +871,13 @@ namespace ktx {
 			return detail::texture2Load(reinterpret_cast<ktxTexture2 *>(texture), object);
 		return ERR_INVALID_DECLARATION;
 	}
+
+	GlFormat glFormat(ktxTexture *texture) {
+		if (texture->classId == ktxTexture1_c) {
+			auto const texture1 = reinterpret_cast<ktxTexture1 *>(texture);
+			return { texture1->glFormat, texture1->glInternalformat, texture1->glType };
+		}
+		auto const vk_format = static_cast<VkFormat>(reinterpret_cast<ktxTexture2 *>(texture)->vkFormat);
+		return { detail::vkFormat2glFormat(vk_format), detail::vkFormat2glInternalFormat(vk_format), detail::vkFormat2glType(vk_format) };
+	}
 }
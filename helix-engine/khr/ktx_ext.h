@@ -5,4 +5,12 @@
 
 namespace ktx {
 	extern Error textureLoad(ktxTexture *texture, u32 object);
+
+	struct GlFormat {
+		u32 format;
+		u32 internal_format;
+		u32 type;
+	};
+	/* What textureLoad() would upload `texture` as. */
+	extern GlFormat glFormat(ktxTexture *texture);
 }
\ No newline at end of file
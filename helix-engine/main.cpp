@@ -3,6 +3,7 @@
 #include <string>
 
 #include "os.hpp"
+#include "engine/benchmark.hpp"
 #include "engine/engine.h"
 #include "engine/filesystem.hpp"
 #include "engine/main-loop.hpp"
@@ -11,7 +12,10 @@
 #include "gpu/lighting.hpp"
 #include "gpu/model_manager.hpp"
 #include "gpu/render_server.h"
+#include "gpu/staging_ring.hpp"
 #include "gpu/texture.h"
+#include "gpu/texture_streamer.hpp"
+#include "gpu/texture_upload.hpp"
 
 #define USE_HIGH_RESOLUTION_CLOCK
 
@@ -27,6 +31,13 @@ int main(int argc, char **argv) {
 
 		Engine::singleton()->markAsMainThread();
 
+#if BENCHMARKS_ENABLED
+		if (argc >= 3 && std::string_view(argv[1]) == "--bench") {
+			Vec<std::string_view> const bench_args(argv + 3, argv + argc);
+			return bench::run(argv[2], bench_args);
+		}
+#endif
+
 		/* Preinitialize our graphics */
 		initGraphics();
 	
@@ -49,10 +60,12 @@ int main(int argc, char **argv) {
 
 		/* The main loop must make its context current! */
 		/* All singletons are now established here, */
-		AsyncTextureBank *async_texture_bank = AsyncTextureBank::singleton();
 		LightingSystem *lighting_system = LightingSystem::singleton();
 		ModelManager *model_manager = ModelManager::singleton();
 		ThreadPool *thread_pool = ThreadPool::singleton();
+		StagingRing *staging_ring = StagingRing::singleton();
+		TextureStreamer *texture_streamer = TextureStreamer::singleton();
+		TextureUploader *texture_uploader = TextureUploader::singleton();
 		FileSystem::singleton();
 		RenderServer::singleton(); //< TODO: Needs to be gutted. Didn't know exactly what I wanted with this and turned out to be a bigger mess than it was worth.
 
@@ -76,7 +89,9 @@ int main(int argc, char **argv) {
 			std::cerr << "Failed to stop main loop: " << result.error() << '\n';
 			return -1;
 		}
-		async_texture_bank->dispose();
+		texture_uploader->dispose();
+		texture_streamer->dispose();
+		staging_ring->dispose();
 		lighting_system->dispose();
 		model_manager->dispose();
 
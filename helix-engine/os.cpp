@@ -1,6 +1,15 @@
 ﻿#include "os.hpp"
 
+#ifdef _WIN32
 #include <Windows.h>
+#include <Psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <cstdio>
 #include <future>
 #include <iostream>
 
@@ -161,3 +170,115 @@ void os::watch(std::wstring_view const path, FFileChangedCallback callback) {
 	CDirectoryWatcher::watchers_[hash(path)] = callback;
 }
 */
+
+#ifdef _WIN32
+
+Result<SharedPtr<os::MappedFile>> os::MappedFile::open(std::string const &path) {
+	HANDLE const file = CreateFileA(
+		path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr
+	);
+	if (file == INVALID_HANDLE_VALUE)
+		return { ERR_FILE_CANT_OPEN, __LINE__ };
+
+	LARGE_INTEGER file_size{};
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		// Zero byte files can't be mapped, let the caller fall back to a regular read.
+		CloseHandle(file);
+		return { ERR_FILE_CANT_READ, __LINE__ };
+	}
+
+	HANDLE const mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return { ERR_CANT_CREATE, __LINE__ };
+	}
+
+	void *const view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return { ERR_OUT_OF_MEMORY, __LINE__ };
+	}
+
+	SharedPtr<MappedFile> mapped_file(new MappedFile());
+	mapped_file->data_ = static_cast<char *>(view);
+	mapped_file->size_ = static_cast<u64>(file_size.QuadPart);
+	mapped_file->file_handle_ = file;
+	mapped_file->mapping_handle_ = mapping;
+	return mapped_file;
+}
+
+os::MappedFile::~MappedFile() {
+	if (data_ != nullptr)
+		UnmapViewOfFile(data_);
+	if (mapping_handle_ != nullptr)
+		CloseHandle(mapping_handle_);
+	if (file_handle_ != nullptr)
+		CloseHandle(file_handle_);
+}
+
+os::memory_usage os::memoryUsage() {
+	PROCESS_MEMORY_COUNTERS_EX counters{};
+	counters.cb = sizeof(counters);
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS *>(&counters), sizeof(counters)))
+		return {};
+	return { .resident = counters.WorkingSetSize, .private_committed = counters.PrivateUsage };
+}
+
+#else
+
+Result<SharedPtr<os::MappedFile>> os::MappedFile::open(std::string const &path) {
+	int const descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (descriptor < 0)
+		return { ERR_FILE_CANT_OPEN, __LINE__ };
+
+	struct stat file_stat{};
+	if (fstat(descriptor, &file_stat) != 0 || file_stat.st_size == 0) {
+		// Zero byte files can't be mapped, let the caller fall back to a regular read.
+		::close(descriptor);
+		return { ERR_FILE_CANT_READ, __LINE__ };
+	}
+
+	// MAP_PRIVATE + PROT_WRITE gives copy-on-write pages, same as FILE_MAP_COPY.
+	void *const view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+	if (view == MAP_FAILED) {
+		::close(descriptor);
+		return { ERR_OUT_OF_MEMORY, __LINE__ };
+	}
+	(void)madvise(view, static_cast<size_t>(file_stat.st_size), MADV_WILLNEED);
+
+	SharedPtr<MappedFile> mapped_file(new MappedFile());
+	mapped_file->data_ = static_cast<char *>(view);
+	mapped_file->size_ = static_cast<u64>(file_stat.st_size);
+	mapped_file->descriptor_ = descriptor;
+	return mapped_file;
+}
+
+os::MappedFile::~MappedFile() {
+	if (data_ != nullptr)
+		munmap(data_, static_cast<size_t>(size_));
+	if (descriptor_ >= 0)
+		::close(descriptor_);
+}
+
+os::memory_usage os::memoryUsage() {
+	// statm: size resident shared text lib data dt, in pages. Private resident = resident - shared.
+	FILE *statm = fopen("/proc/self/statm", "r");
+	if (statm == nullptr)
+		return {};
+	unsigned long long pages_total = 0, pages_resident = 0, pages_shared = 0;
+	int const read = fscanf(statm, "%llu %llu %llu", &pages_total, &pages_resident, &pages_shared);
+	fclose(statm);
+	if (read != 3)
+		return {};
+	u64 const page_size = static_cast<u64>(sysconf(_SC_PAGESIZE));
+	return { .resident = pages_resident * page_size, .private_committed = (pages_resident - pages_shared) * page_size };
+}
+
+#endif
@@ -86,4 +86,46 @@ namespace os {
 	extern void printLastError();
 }
 
-#endif // _WIN32
\ No newline at end of file
+#endif // _WIN32
+
+#include <span>
+#include <string>
+#include "types.hpp"
+
+namespace os {
+	/*
+	 * A whole file mapped copy-on-write into the address space, so the importer can rewrite bytes in place (index narrowing)
+	 * without touching the file. Reads are served from the page cache and only pages that get written to are copied.
+	 * Windows charges the whole view against the commit limit when it's mapped, POSIX only charges the written pages.
+	 * Unmapped when the last owner goes away.
+	 */
+	class MappedFile : public NoCopy {
+	public:
+		~MappedFile() override;
+
+		static Result<SharedPtr<MappedFile>> open(_STD string const &path);
+
+		_NODISCARD char *data() const { return data_; }
+		_NODISCARD u64 size() const { return size_; }
+		_NODISCARD _STD span<char> bytes() const { return { data_, static_cast<size_t>(size_) }; }
+
+	private:
+		MappedFile() = default;
+
+		char *data_ = nullptr;
+		u64 size_ = 0;
+#ifdef _WIN32
+		void *file_handle_ = nullptr;
+		void *mapping_handle_ = nullptr;
+#else
+		int descriptor_ = -1;
+#endif
+	};
+
+	struct memory_usage {
+		u64 resident;			//< Working set, mapped file pages included.
+		u64 private_committed;	//< Windows: commit charge, copy-on-write views count in full once mapped. POSIX: resident pages that aren't shared.
+	};
+
+	extern memory_usage memoryUsage();
+}
@@ -1,10 +1,13 @@
 #version 460 core
 
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 
 layout (location = 0) uniform mat4 model;
 
+#pragma include "shaders/vertex_packing.glsl"
+#pragma include "shaders/instancing.glsl"
+
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
+    gl_Position = model * instanceTransform() * vec4(decodePosition(aPos), 1.0);
 }
\ No newline at end of file
@@ -10,13 +10,16 @@ layout (location = 3) in vec2  aTexCoord0; // 0x20 | 36
 layout (location = 4) in uvec4 aJoints0;   // 0x30 | 48
 layout (location = 5) in vec4  aWeights0;  // 0x40 | 64
 #else
-layout (location = 0) in vec3  aPosition;  // 0x00 | 00
+layout (location = 0) in vec4  aPosition;  // 0x00 | 00 << w is only read for packed vertices.
 layout (location = 1) in vec3  aNormal;    // 0x0C | 12
 layout (location = 2) in vec4  aTangent;   // 0x18 | 32 << Tangent is placed here so that UV0 aligns on the 32 byte point.
 layout (location = 3) in vec2  aTexCoord0; // 0x20 | 24
 // layout (location = 4) in vec2  aTexCoord1; // 0x20 | 24
 #endif
 
+#pragma include "shaders/vertex_packing.glsl"
+#pragma include "shaders/instancing.glsl"
+
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
@@ -59,10 +62,22 @@ mat3 make_basis(vec3 normal)
 }
 
 void main() {
-    vec4 frag = projection * view * model * vec4(aPosition, 1.0);
+#ifdef SKINNED
+    // Skinned vertices are never packed and carry no tangent, build one from the normal.
+    vec3 position = aPosition;
+    vec3 normal = aNormal;
+    vec4 tangent = vec4(make_basis(normal)[0], 1.0);
+#else
+    vec3 position = decodePosition(aPosition);
+    vec3 normal = decodeNormal(aNormal);
+    vec4 tangent = decodeTangent(aTangent, aPosition);
+#endif
+
+    mat4 instanceModel = model * instanceTransform();
+    vec4 frag = projection * view * instanceModel * vec4(position, 1.0);
     gl_Position = frag;
-    mat4 modelViewMatrix  = mat4(view * model);
-    fs_in.position = (modelViewMatrix * vec4(aPosition, 1.0)).xyz;
+    mat4 modelViewMatrix  = mat4(view * instanceModel);
+    fs_in.position = (modelViewMatrix * vec4(position, 1.0)).xyz;
     fs_in.uv0 = aTexCoord0; // Flip V coordinate for OpenGL
     fs_in.uv1 = aTexCoord0;
 
@@ -75,10 +90,10 @@ void main() {
     mat3 modelView_NormalMatrix = mat3(modelViewMatrix);
     mat3 normalMatrix   = transpose(inverse(modelView_NormalMatrix));
 
-    vec3 T = (modelView_NormalMatrix * aTangent.xyz);
-    vec3 N = normalize((normalMatrix) * aNormal);
+    vec3 T = (modelView_NormalMatrix * tangent.xyz);
+    vec3 N = normalize((normalMatrix) * normal);
     //T = normalize(T - dot(T, N) * N);
-    vec3 B = (aTangent.w * cross(N, T)); // Calculate bitangent using the normal and tangent, and apply handedness
+    vec3 B = (tangent.w * cross(N, T)); // Calculate bitangent using the normal and tangent, and apply handedness
 
     fs_in.TBN = mat3(T, B, N);
 
@@ -88,7 +103,7 @@ void main() {
     //  fs_in.tangent    =  normalize(T - dot(T, N) * N);
     fs_in.bitangent  =  B;//normalize(cross(N, T));
     fs_in.normal     =  N;//normalize(normalViewModelMatrix * aNormal);
-    fs_in.handedness =  (aTangent.w);
+    fs_in.handedness =  (tangent.w);
     
-    handedness = (float(aTangent.w));
+    handedness = (float(tangent.w));
 }
\ No newline at end of file
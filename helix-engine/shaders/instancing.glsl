@@ -0,0 +1,33 @@
+﻿// Per instance transforms for InstancedMeshRenderer3D (ecs/instanced-mesh-renderer.h). With u_instanced at 0
+// the buffer is never read and instanceTransform() is the identity, so one shader serves both renderers.
+//
+// Instance transforms sit between the model matrix and the vertex: model * instanceTransform() * position.
+//
+// With u_indirect set the draw comes from an IndirectDrawBatch (gpu/indirect_draws.hpp), model is the identity and
+// the model matrix is looked up through the draw's IndirectDrawData instead, gl_BaseInstance being its index.
+
+layout (location = 43) uniform int u_instanced;
+layout (location = 44) uniform int u_indirect;
+
+layout (std430, binding = 14) restrict readonly buffer InstanceTransformBuffer {
+    mat4 instance_transforms[];
+};
+
+struct IndirectDrawData {
+    uint model_index;
+    uint material_index;
+};
+
+layout (std430, binding = 15) restrict readonly buffer IndirectModelBuffer {
+    mat4 indirect_models[];
+};
+
+layout (std430, binding = 16) restrict readonly buffer IndirectDrawBuffer {
+    IndirectDrawData indirect_draws[];
+};
+
+mat4 instanceTransform() {
+    if (u_indirect != 0)
+        return indirect_models[indirect_draws[gl_BaseInstance].model_index];
+    return u_instanced != 0 ? instance_transforms[gl_InstanceID] : mat4(1.0);
+}
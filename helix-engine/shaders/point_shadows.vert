@@ -1,10 +1,12 @@
 ﻿#version 460 core
 
-layout (location = 0) in vec3 aPosition;
+layout (location = 0) in vec4 aPosition;
 
 layout (location = 0) uniform mat4 model;
 
+#pragma include "shaders/vertex_packing.glsl"
+
 void main() {
-    vec4 frag = model * vec4(aPosition, 1.0);
+    vec4 frag = model * vec4(decodePosition(aPosition), 1.0);
     gl_Position = frag;
 }
\ No newline at end of file
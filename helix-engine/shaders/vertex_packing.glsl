@@ -0,0 +1,28 @@
+﻿// Decode for PackedVertex (gpu/vertex_packing.hpp). With u_packedVertices at 0 every function passes
+// the float Vertex attributes through untouched, so one shader serves both layouts.
+//
+// Packed attributes arrive normalized: position as unorm16 xyzw (w is the tangent sign),
+// normal and tangent as octahedral snorm16 in .xy, UVs as half floats.
+
+layout (location = 40) uniform int  u_packedVertices;
+layout (location = 41) uniform vec3 u_positionOffset;
+layout (location = 42) uniform vec3 u_positionScale;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 decodePosition(vec4 position) {
+    return u_packedVertices != 0 ? u_positionOffset + position.xyz * u_positionScale : position.xyz;
+}
+
+vec3 decodeNormal(vec3 normal) {
+    return u_packedVertices != 0 ? octDecode(normal.xy) : normal;
+}
+
+vec4 decodeTangent(vec4 tangent, vec4 position) {
+    return u_packedVertices != 0 ? vec4(octDecode(tangent.xy), position.w * 2.0 - 1.0) : tangent;
+}
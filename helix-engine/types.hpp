@@ -228,7 +228,9 @@ public:
 	_NODISCARD bool has_value() const { return has_value_; }
 	_NODISCARD bool is_null() const { return !has_value_; }
 
-	_NODISCARD T value() noexcept { if constexpr(is_reference_wrapped) return value_.value().get(); else return value_.value(); }
+	_NODISCARD T value() & noexcept { if constexpr(is_reference_wrapped) return value_.value().get(); else return value_.value(); }
+	/* Moves the value out, `_STD move(result).value()` for results that are done with. */
+	_NODISCARD T value() && noexcept { return _STD move(value_).value(); }
 	_NODISCARD Error error() const noexcept { return error_; }
 
 	// ReSharper disable once CppNonExplicitConversionOperator